@@ -25,6 +25,7 @@
 #include "oboe/ResultWithValue.h"
 #include "oboe/AudioStreamBuilder.h"
 #include "oboe/AudioStreamBase.h"
+#include "oboe/StreamTelemetry.h"
 
 /** WARNING - UNDER CONSTRUCTION - THIS API WILL CHANGE. */
 
@@ -179,6 +180,16 @@ public:
         return Result::ErrorUnimplemented;
     }
 
+    /**
+     * Get the part of the capacity for which memory is already allocated.
+     * Some streams only allocate the rest when the buffer size is raised above this.
+     *
+     * @return allocated capacity in frames, which is at most getBufferCapacityInFrames()
+     */
+    virtual int32_t getAllocatedCapacityInFrames() const {
+        return getBufferCapacityInFrames();
+    }
+
     /**
      * An XRun is an Underrun or an Overrun.
      * During playing, an underrun will occur if the stream is not written in time
@@ -436,6 +447,41 @@ public:
         return mErrorCallbackResult;
     }
 
+    /**
+     * Get the health statistics of the stream, for example the callback durations
+     * and any underruns. Call StreamTelemetry::getSnapshot() to read them from any thread.
+     *
+     * @return the statistics collected since the stream was opened
+     */
+    virtual const StreamTelemetry &getTelemetry() const {
+        return mTelemetry;
+    }
+
+    /**
+     * Get the quality that Oboe's sample rate converter is using now. This may be lower than
+     * getSampleRateConversionQuality() if the quality is adaptive and the callback was late.
+     * See AudioStreamBuilder::setSampleRateConversionQualityAdaptive().
+     * This may be called from any thread.
+     *
+     * @return the current quality, or None if Oboe is not converting the sample rate
+     */
+    virtual SampleRateConversionQuality getCurrentSampleRateConversionQuality() const {
+        return SampleRateConversionQuality::None;
+    }
+
+    /**
+     * Get the number of times that an adaptive sample rate converter has changed its quality.
+     * This may be called from any thread.
+     *
+     * @param numLowered receives the number of times the quality was lowered
+     * @param numRaised receives the number of times the quality was raised
+     */
+    virtual void getSampleRateConversionQualityChanges(int64_t *numLowered,
+                                                       int64_t *numRaised) const {
+        *numLowered = 0;
+        *numRaised = 0;
+    }
+
 protected:
 
     /**
@@ -540,6 +586,8 @@ protected:
      */
     int32_t              mFramesPerBurst = kUnspecified;
 
+    StreamTelemetry      mTelemetry; // written by the callback thread
+
 private:
 
     // Log the scheduler if it changes.
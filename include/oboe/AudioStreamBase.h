@@ -178,6 +178,13 @@ public:
         return mSampleRateConversionQuality;
     }
 
+    /**
+     * @return true if Oboe may lower the sample rate conversion quality when the callback is late
+     */
+    bool isSampleRateConversionQualityAdaptive() const {
+        return mSampleRateConversionQualityAdaptive;
+    }
+
 protected:
     /** The callback which will be fired when new data is ready to be read/written. **/
     AudioStreamDataCallback        *mDataCallback = nullptr;
@@ -229,6 +236,8 @@ protected:
     bool                            mFormatConversionAllowed = false;
     // Control whether and how Oboe can convert sample rates to achieve optimal results.
     SampleRateConversionQuality     mSampleRateConversionQuality = SampleRateConversionQuality::None;
+    // Control whether Oboe can lower the sample rate conversion quality when the CPU is busy.
+    bool                            mSampleRateConversionQualityAdaptive = false;
 
     /** Validate stream parameters that might not be checked in lower layers */
     virtual Result isValidConfig() {
@@ -157,8 +157,10 @@ public:
      * Specifying OpenSLES should mainly be used to test legacy performance/functionality.
      *
      * If the caller requests AAudio and it is supported then AAudio will be used.
+     * Specifying Virtual will use a simulated device, see VirtualDevice.
      *
-     * @param audioApi Must be AudioApi::Unspecified, AudioApi::OpenSLES or AudioApi::AAudio.
+     * @param audioApi Must be AudioApi::Unspecified, AudioApi::OpenSLES, AudioApi::AAudio
+     *                 or AudioApi::Virtual.
      * @return pointer to the builder so calls can be chained
      */
     AudioStreamBuilder *setAudioApi(AudioApi audioApi) {
@@ -426,6 +428,24 @@ public:
         return this;
     }
 
+    /**
+     * Allow Oboe to lower the quality of its sample rate converter while the data callback
+     * is taking too long, and raise it again when there is time to spare.
+     *
+     * The quality set by setSampleRateConversionQuality() is the highest that will be used.
+     * Oboe builds resamplers for it and for up to two lower qualities when the stream is opened,
+     * and crossfades between them so that a change of quality does not click.
+     * Use AudioStream::getCurrentSampleRateConversionQuality() to see which one is in use.
+     *
+     * This only has an effect if Oboe converts the sample rate and a data callback is used.
+     *
+     * Default is false.
+     */
+    AudioStreamBuilder *setSampleRateConversionQualityAdaptive(bool adaptive) {
+        mSampleRateConversionQualityAdaptive = adaptive;
+        return this;
+    }
+
     /**
     * Declare the name of the package creating the stream.
     *
@@ -0,0 +1,192 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_AUDIO_WORKER_POOL_H
+#define OBOE_AUDIO_WORKER_POOL_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "oboe/Definitions.h"
+
+namespace oboe {
+
+class FutexEvent;
+
+/**
+ * Split the work of one audio callback across several cores.
+ *
+ * The pool keeps a few worker threads that are created by start(). The callback
+ * calls run() with a number of independent jobs, for example groups of mixer tracks
+ * that each render into their own buffer. The calling thread and the workers take
+ * jobs until they are all done, then run() returns. So the callback can still finish
+ * on time if a worker is slow to wake up, it just does more of the jobs itself.
+ *
+ * run() does not allocate memory or take a lock. Idle workers spin for a short
+ * time and then sleep on a futex, which run() wakes up.
+ *
+ *     pool.run(numGroups, [&](int32_t group) {
+ *         mixers[group].renderAudio(groupBuffers[group], numFrames);
+ *     });
+ */
+class AudioWorkerPool {
+public:
+    /**
+     * A job is called with the context that was passed to run() and a job index
+     * from 0 to numJobs - 1.
+     */
+    typedef void (*JobFunction)(void *context, int32_t jobIndex);
+
+    /** Default for setSpinNanos(). */
+    static constexpr int64_t kDefaultSpinNanos = 50 * kNanosPerMicrosecond; // arbitrary
+
+    /**
+     * @param numWorkers number of threads to create, not counting the thread that calls run().
+     *        Zero is allowed, then run() calls every job itself.
+     */
+    explicit AudioWorkerPool(int32_t numWorkers);
+
+    virtual ~AudioWorkerPool();
+
+    /**
+     * Pin the workers to CPUs. Worker i runs on cpuIds[i % cpuIds.size()].
+     * An empty list lets them run anywhere, which is the default.
+     * Call this before start().
+     */
+    void setCpuIds(const std::vector<int32_t> &cpuIds) {
+        mCpuIds = cpuIds;
+    }
+
+    /**
+     * Run the workers with SCHED_FIFO at this priority, usually the same as the
+     * audio callback thread. Zero leaves the normal scheduler, which is the default.
+     * If the priority cannot be set then the workers run at normal priority.
+     * Call this before start().
+     */
+    void setRealTimePriority(int32_t priority) {
+        mRealTimePriority = priority;
+    }
+
+    /**
+     * Set how long an idle worker, or run() waiting for a worker, spins before it sleeps.
+     * Spinning wakes up faster but uses a core while it waits.
+     */
+    void setSpinNanos(int64_t spinNanos) {
+        mSpinNanos.store(spinNanos, std::memory_order_relaxed);
+    }
+
+    /**
+     * Create the worker threads. This is not real-time safe so call it before the
+     * stream is started.
+     *
+     * @return Result::OK, or Result::ErrorInvalidState if the pool has already been started
+     */
+    Result start();
+
+    /**
+     * Stop and join the worker threads. Do not call this while run() is running.
+     */
+    void stop();
+
+    int32_t getNumWorkers() const {
+        return mNumWorkers;
+    }
+
+    /**
+     * Call job(context, i) once for every i from 0 to numJobs - 1, using the calling thread
+     * and the workers, and return when every job has finished.
+     * Jobs may run in any order and at the same time, so they must not write to the same data.
+     * Only one thread may call run() at a time. If the pool is not started then the jobs
+     * all run on the calling thread.
+     */
+    void run(JobFunction job, void *context, int32_t numJobs);
+
+    /**
+     * Call function(i) for every i from 0 to numJobs - 1, as above.
+     * The function, usually a lambda, is called through a pointer so nothing is allocated.
+     */
+    template <typename Function>
+    void run(int32_t numJobs, Function &&function) {
+        typedef typename std::remove_reference<Function>::type FunctionType;
+        run(&callFunction<FunctionType>,
+            const_cast<void *>(static_cast<const void *>(&function)),
+            numJobs);
+    }
+
+    /**
+     * @return number of jobs that ran on the workers instead of the calling thread,
+     *         which shows how much the pool is helping
+     */
+    int64_t getWorkerJobCount() const {
+        return mWorkerJobCount.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return total number of jobs passed to run()
+     */
+    int64_t getJobCount() const {
+        return mJobCount.load(std::memory_order_relaxed);
+    }
+
+private:
+    template <typename FunctionType>
+    static void callFunction(void *context, int32_t jobIndex) {
+        (*static_cast<FunctionType *>(context))(jobIndex);
+    }
+
+    void workerLoop(int32_t workerIndex);
+    void configureWorkerThread(int32_t workerIndex);
+    void joinRound(uint32_t round);
+    int32_t runJobs();
+
+    template <typename Predicate>
+    void waitUntil(Predicate isDone);
+
+    static bool isRoundOpen(uint32_t round) {
+        return (round & 1) != 0;
+    }
+
+    const int32_t mNumWorkers;
+    std::vector<int32_t> mCpuIds;
+    int32_t mRealTimePriority = 0;
+    std::atomic<int64_t> mSpinNanos{kDefaultSpinNanos};
+    std::vector<std::thread> mThreads;
+    std::atomic<bool> mStopping{false};
+
+    // Set by run() while no worker is in a round.
+    JobFunction mJob = nullptr;
+    void *mContext = nullptr;
+    int32_t mNumJobs = 0;
+
+    // Odd while a round is open. Incremented to open a round and again to close it.
+    std::atomic<uint32_t> mRound{0};
+    std::atomic<int32_t> mNextJob{0};
+    std::atomic<int32_t> mNumJobsDone{0};
+    std::atomic<int32_t> mNumWorkersInRound{0};
+    std::unique_ptr<FutexEvent> mStartEvent; // signalled when a round opens or on stop()
+    std::unique_ptr<FutexEvent> mJoinEvent; // signalled when the jobs or the workers finish
+
+    std::atomic<int64_t> mWorkerJobCount{0};
+    std::atomic<int64_t> mJobCount{0};
+};
+
+} // namespace oboe
+
+#endif //OBOE_AUDIO_WORKER_POOL_H
@@ -250,7 +250,14 @@ namespace oboe {
         /**
          * Try to use AAudio. Fail if unavailable.
          */
-        AAudio
+        AAudio,
+
+        /**
+         * Use a simulated device that runs on a timer thread. See VirtualDevice.
+         * This does not produce any sound. It is for testing and benchmarking,
+         * including on a Linux host.
+         */
+        Virtual
     };
 
     /**
@@ -26,8 +26,29 @@
 
 namespace oboe {
 
+class TimestampRing;
+
 class FifoBuffer {
 public:
+    /**
+     * How the read and write counters will be used.
+     */
+    enum class Mode {
+        /**
+         * The counters may be set from any thread.
+         */
+        Default,
+
+        /**
+         * Exactly one thread calls read() or setReadCounter() and exactly one thread
+         * calls write() or setWriteCounter(). The counters must not be moved backwards
+         * while the other thread is using the FIFO.
+         * This avoids atomic read-modify-write operations and most cache line transfers
+         * between the two threads.
+         */
+        SingleProducerSingleConsumer,
+    };
+
 	/**
 	 * Construct a `FifoBuffer`.
 	 *
@@ -36,6 +57,16 @@ public:
 	 */
     FifoBuffer(uint32_t bytesPerFrame, uint32_t capacityInFrames);
 
+    /**
+     * Construct a `FifoBuffer` that allocates its own storage and uses the given Mode.
+     * A capacity that is a power of two is slightly faster.
+     *
+     * @param bytesPerFrame amount of bytes for one frame
+     * @param capacityInFrames the capacity of frames in fifo
+     * @param mode how the counters will be used
+     */
+    FifoBuffer(uint32_t bytesPerFrame, uint32_t capacityInFrames, Mode mode);
+
 	/**
 	 * Construct a `FifoBuffer`.
 	 * To be used if the storage allocation is done outside of FifoBuffer.
@@ -86,6 +117,55 @@ public:
 	 */
     uint32_t getBufferCapacityInFrames() const;
 
+    /**
+     * Part of the FIFO storage that can be read or written in place.
+     * It is split in two when it wraps around the end of the storage,
+     * otherwise numFrames[1] is zero.
+     */
+    struct Region {
+        uint8_t *data[2];
+        int32_t numFrames[2];
+
+        int32_t getTotalFrames() const {
+            return numFrames[0] + numFrames[1];
+        }
+    };
+
+    /**
+     * Get the frames that can be read without copying them.
+     * The data stays valid until commitRead() is called.
+     * This must only be called by the thread that reads the FIFO.
+     *
+     * @param maxFrames maximum number of frames to return
+     * @return region with up to maxFrames full frames, may be empty
+     */
+    Region acquireReadRegion(int32_t maxFrames);
+
+    /**
+     * Release frames that were read from a region returned by acquireReadRegion().
+     *
+     * @param numFrames number of frames consumed, no more than the region contained
+     */
+    void commitRead(int32_t numFrames);
+
+    /**
+     * Get the empty frames that can be written without copying,
+     * for example by rendering or converting straight into the FIFO.
+     * This must only be called by the thread that writes the FIFO.
+     *
+     * @param maxFrames maximum number of frames to return
+     * @return region with up to maxFrames empty frames, may be empty
+     */
+    Region acquireWriteRegion(int32_t maxFrames);
+
+    /**
+     * Make frames that were written into a region returned by acquireWriteRegion()
+     * available to the reader.
+     *
+     * @param numFrames number of frames written, no more than the region contained
+     */
+    void commitWrite(int32_t numFrames);
+
     /**
      * Calls read(). If all of the frames cannot be read then the remainder of the buffer
      * is set to zero.
@@ -96,6 +176,45 @@ public:
      */
     int32_t readNow(void *destination, int32_t numFrames);
 
+    /**
+     * Allocate a ring of timestamps that travels next to the data.
+     * This must be called before the FIFO is used by more than one thread.
+     *
+     * @param maxTimestamps number of timestamps to keep, for example two per burst in the FIFO
+     */
+    void enableTimestamps(int32_t maxTimestamps);
+
+    /**
+     * Record the time at which the frame at frameCounter entered or will leave the FIFO,
+     * usually once per burst. It is keyed by the frame counter so it stays with the
+     * data even if some frames were skipped or zero filled, for example after an xrun.
+     * This must only be called by one thread, and frameCounter must increase.
+     * It is ignored if enableTimestamps() was not called.
+     *
+     * @param frameCounter value of the read or write counter for the frame
+     * @param timeNanoseconds time of that frame, in CLOCK_MONOTONIC
+     */
+    void writeTimestamp(uint64_t frameCounter, int64_t timeNanoseconds);
+
+    /**
+     * Calculate the time of any frame from the nearest timestamp at or before it.
+     * This may be called from any thread.
+     *
+     * @param frameCounter position of the frame
+     * @param sampleRate used to calculate the time between frames
+     * @param timeNanoseconds receives the time of the frame
+     * @return Result::OK, or Result::ErrorUnavailable if no timestamp has been written
+     */
+    Result getTimestamp(uint64_t frameCounter, int32_t sampleRate, int64_t *timeNanoseconds) const;
+
+    /**
+     * Get the most recent timestamp that was written.
+     *
+     * @param timestamp receives the frame counter and time
+     * @return Result::OK, or Result::ErrorUnavailable if no timestamp has been written
+     */
+    Result getLatestTimestamp(FrameTimestamp *timestamp) const;
+
 	/**
 	 * Get the number of frames in the fifo.
 	 *
@@ -151,12 +270,15 @@ public:
     }
 
 private:
+    Region makeRegion(uint32_t index, uint32_t numFrames);
+
     uint32_t mBytesPerFrame;
     uint8_t* mStorage;
     bool     mStorageOwned; // did this object allocate the storage?
     std::unique_ptr<FifoControllerBase> mFifo;
     uint64_t mFramesReadCount;
     uint64_t mFramesUnderrunCount;
+    std::unique_ptr<TimestampRing> mTimestamps; // optional
 };
 
 } // namespace oboe
@@ -96,6 +96,32 @@ public:
 	 */
     uint32_t getFrameCapacity() const { return mTotalFrames; }
 
+    /**
+     * Like getFullFramesAvailable() but only called by the thread that reads the FIFO.
+     * A controller may return a smaller number, as long as it is at least framesWanted
+     * or the real number of full frames. This lets it avoid reading the write counter.
+     *
+     * @param framesWanted number of frames the reader would like to read
+     * @return number of frames that can safely be read
+     */
+    virtual uint32_t getFullFramesAvailableToRead(uint32_t framesWanted) {
+        (void) framesWanted;
+        return getFullFramesAvailable();
+    }
+
+    /**
+     * Like getEmptyFramesAvailable() but only called by the thread that writes the FIFO.
+     * A controller may return a smaller number, as long as it is at least framesWanted
+     * or the real number of empty frames. This lets it avoid reading the read counter.
+     *
+     * @param framesWanted number of frames the writer would like to write
+     * @return number of frames that can safely be written
+     */
+    virtual uint32_t getEmptyFramesAvailableToWrite(uint32_t framesWanted) {
+        (void) framesWanted;
+        return getEmptyFramesAvailable();
+    }
+
     virtual uint64_t getReadCounter() const = 0;
     virtual void setReadCounter(uint64_t n) = 0;
     virtual void incrementReadCounter(uint64_t n) = 0;
@@ -103,8 +129,15 @@ public:
     virtual void setWriteCounter(uint64_t n) = 0;
     virtual void incrementWriteCounter(uint64_t n) = 0;
 
+protected:
+    /**
+     * @return frames between the counters, clipped to the range 0 to the capacity
+     */
+    uint32_t getFramesBetween(uint64_t readCounter, uint64_t writeCounter) const;
+
 private:
     uint32_t mTotalFrames;
+    uint32_t mIndexMask; // capacity - 1 if the capacity is a power of two, otherwise zero
 };
 
 } // namespace oboe
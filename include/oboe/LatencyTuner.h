@@ -19,11 +19,15 @@
 
 #include <atomic>
 #include <cstdint>
+#include <memory>
 #include "oboe/Definitions.h"
 #include "oboe/AudioStream.h"
 
 namespace oboe {
 
+template <typename T>
+class SequencedRing;
+
 /**
  * LatencyTuner can be used to dynamically tune the latency of an output stream.
  * It adjusts the stream's bufferSize by monitoring the number of underruns.
@@ -35,12 +39,69 @@ namespace oboe {
  * Call tune() right before calling write() if using blocking writes.
  *
  * If you want to see the ongoing results of this tuning process then call
- * stream->getBufferSize() periodically.
+ * stream->getBufferSize() periodically, or call getDecisions().
  *
+ * By default the tuner only raises the buffer size. In Mode::Bidirectional it also lowers
+ * the buffer size, one increment at a time, after several windows in a row had no xruns
+ * and enough headroom. See DecreasePolicy.
  */
 class LatencyTuner {
 public:
 
+    enum class Mode {
+        /**
+         * Raise the buffer size after an xrun. Only requestReset() lowers it.
+         */
+        IncreaseOnly,
+
+        /**
+         * Also lower the buffer size when the stream has been stable for a while.
+         */
+        Bidirectional,
+    };
+
+    /**
+     * Controls when Mode::Bidirectional lowers the buffer size.
+     *
+     * The tuner watches the stream in windows of windowMillis of audio. A window is stable
+     * if it had no xruns and the headroom never fell below the size increment plus
+     * headroomMarginFrames. For an output stream the headroom is the data left in the buffer
+     * when tune() is called, so it shows how much of the buffer was never needed.
+     * After stableWindows stable windows in a row the buffer size is lowered by
+     * one increment and the count starts again.
+     *
+     * If an xrun happens within stableWindows windows of lowering the buffer size then
+     * the number of stable windows needed is doubled, up to maxStableWindows.
+     * This stops the tuner from going back and forth between two sizes.
+     * requestReset() clears the doubling.
+     */
+    struct DecreasePolicy {
+        int32_t windowMillis = 250; // arbitrary
+        int32_t stableWindows = 16; // arbitrary, 4 seconds
+        int32_t maxStableWindows = 512; // arbitrary, about 2 minutes
+        int32_t headroomMarginFrames = kUnspecified; // kUnspecified means one burst
+    };
+
+    enum class Action : int32_t {
+        Increase, // after an xrun
+        Decrease, // after stableWindows stable windows
+        Reset,    // requested by requestReset()
+    };
+
+    /**
+     * A change of buffer size made by tune().
+     */
+    struct Decision {
+        Action action;
+        int32_t oldBufferSize;
+        int32_t newBufferSize;
+        int32_t xRunCount;         // from getXRunCount() when the decision was made
+        int32_t minHeadroomFrames; // lowest headroom in the last window, only for Decrease
+        int64_t timeNanos;         // CLOCK_MONOTONIC
+    };
+
+    static constexpr int32_t kMaxDecisions = 16;
+
     /**
      * Construct a new LatencyTuner object which will act on the given audio stream
      *
@@ -56,9 +117,12 @@ public:
      */
     explicit LatencyTuner(AudioStream &stream, int32_t maximumBufferSize);
 
+    ~LatencyTuner();
+
     /**
      * Adjust the bufferSizeInFrames to optimize latency.
      * It will start with a low latency and then raise it if an underrun occurs.
+     * In Mode::Bidirectional it will also lower the latency when there is spare headroom.
      *
      * Latency tuning is only supported for AAudio.
      *
@@ -113,6 +177,50 @@ public:
         return mBufferSizeIncrement;
     }
 
+    /**
+     * Choose whether the tuner may lower the buffer size. The default is Mode::IncreaseOnly.
+     * Call this before the first call to tune(), or from the thread that calls tune().
+     *
+     * @param mode
+     */
+    void setMode(Mode mode) {
+        mMode = mode;
+    }
+
+    Mode getMode() const {
+        return mMode;
+    }
+
+    /**
+     * Set when Mode::Bidirectional lowers the buffer size.
+     * Call this before the first call to tune(), or from the thread that calls tune().
+     *
+     * @param policy
+     */
+    void setDecreasePolicy(const DecreasePolicy &policy) {
+        mPolicy = policy;
+    }
+
+    const DecreasePolicy &getDecreasePolicy() const {
+        return mPolicy;
+    }
+
+    /**
+     * Copy the most recent changes of buffer size made by tune(), oldest first.
+     * This may be called from any thread. A decision that is being recorded
+     * at the same time may be left out.
+     *
+     * @param decisions array to receive the decisions
+     * @param maxDecisions size of the array, at most kMaxDecisions will be copied
+     * @return number of decisions copied
+     */
+    int32_t getDecisions(Decision *decisions, int32_t maxDecisions) const;
+
+    /**
+     * @return total number of decisions made, including those no longer in the history
+     */
+    int64_t getDecisionCount() const;
+
 private:
 
     /**
@@ -123,6 +231,21 @@ private:
      */
     void reset();
 
+    /**
+     * Add the xruns and headroom of one call to the current window.
+     * Lower the buffer size when enough windows in a row were stable.
+     */
+    Result trackWindow(int32_t numXRuns, int32_t xRunCount);
+
+    /**
+     * Called after an xrun raised the buffer size, to double the number of stable
+     * windows needed if the buffer had been lowered too far.
+     */
+    void onIncrease();
+
+    void recordDecision(Action action, int32_t oldBufferSize, int32_t newBufferSize,
+                        int32_t xRunCount, int32_t minHeadroomFrames);
+
     enum class State {
         Idle,
         Active,
@@ -143,6 +266,17 @@ private:
     int32_t               mBufferSizeIncrement;
     std::atomic<int32_t>  mLatencyTriggerRequests{0}; // TODO user atomic requester from AAudio
     std::atomic<int32_t>  mLatencyTriggerResponses{0};
+
+    Mode                  mMode = Mode::IncreaseOnly;
+    DecreasePolicy        mPolicy;
+    int64_t               mWindowStartPosition = -1; // -1 until the first window starts
+    int32_t               mWindowXRuns = 0;
+    int32_t               mWindowMinHeadroom = INT32_MAX; // INT32_MAX if not measured
+    int32_t               mStableWindowCount = 0;
+    int32_t               mBackoffShift = 0; // stableWindows is doubled this many times
+    int32_t               mWindowsSinceDecrease = INT32_MAX; // INT32_MAX if never lowered
+
+    std::unique_ptr<SequencedRing<Decision>> mDecisions;
 };
 
 } // namespace oboe
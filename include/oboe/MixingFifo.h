@@ -0,0 +1,130 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_MIXING_FIFO_H
+#define OBOE_MIXING_FIFO_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+#include "oboe/AudioStreamCallback.h"
+#include "oboe/Definitions.h"
+#include "oboe/ResultWithValue.h"
+
+namespace oboe {
+
+/**
+ * Mix float audio from several producer threads into one output stream without a lock.
+ *
+ * Each producer opens its own lane, which is a single producer single consumer FIFO,
+ * and writes to it from one thread. The consumer calls mix(), usually from the data callback,
+ * which adds every lane into the output with the lane's gain.
+ * A lane that does not have enough data is mixed as far as it goes and counted as an underrun.
+ *
+ * A MixingFifo can be passed directly to AudioStreamBuilder::setDataCallback() for a
+ * float output stream with the same channel count.
+ */
+class MixingFifo : public AudioStreamDataCallback {
+public:
+    /**
+     * @param channelCount samples per frame in every lane and in the output
+     * @param capacityInFrames capacity of each lane
+     * @param maxLanes maximum number of lanes that can be open at the same time
+     */
+    MixingFifo(int32_t channelCount, int32_t capacityInFrames, int32_t maxLanes);
+
+    virtual ~MixingFifo();
+
+    /**
+     * Claim a free lane for a producer. May be called from any thread.
+     * The gain of the lane starts at 1.0.
+     *
+     * @return lane index, or Result::ErrorNoFreeHandles if every lane is in use
+     */
+    ResultWithValue<int32_t> openLane();
+
+    /**
+     * Stop writing to a lane. Any data left in the lane will still be mixed,
+     * then the lane becomes free. Call this from the thread that wrote to the lane.
+     */
+    void closeLane(int32_t lane);
+
+    /**
+     * Write to a lane. Only one thread may write to each lane.
+     *
+     * @return number of frames written, which may be less than numFrames if the lane is full
+     */
+    int32_t write(int32_t lane, const float *buffer, int32_t numFrames);
+
+    /**
+     * @return number of frames that can be written to the lane without blocking
+     */
+    int32_t getEmptyFramesAvailable(int32_t lane) const;
+
+    /**
+     * Set the gain that is applied when the lane is mixed. May be called from any thread.
+     */
+    void setGain(int32_t lane, float gain);
+
+    /**
+     * @return number of times that mix() found less data in the lane than it needed,
+     *         since the first data was written to the lane
+     */
+    int32_t getUnderrunCount(int32_t lane) const;
+
+    /**
+     * Add every open lane into the output. Only one thread may call this.
+     * Lanes are mixed from their first write, so a lane that is opened but not yet
+     * written does not count as an underrun.
+     *
+     * @param output numFrames of interleaved float frames, overwritten with the mix
+     * @param numFrames number of frames to mix
+     * @return number of lanes that were mixed
+     */
+    int32_t mix(float *output, int32_t numFrames);
+
+    /**
+     * Mix into the stream's buffer. The stream must be float with the same channel count.
+     */
+    DataCallbackResult onAudioReady(AudioStream *audioStream,
+                                    void *audioData,
+                                    int32_t numFrames) override;
+
+    int32_t getChannelCount() const {
+        return mChannelCount;
+    }
+
+    int32_t getMaxLanes() const {
+        return mMaxLanes;
+    }
+
+private:
+    struct Lane;
+
+    bool isValidLane(int32_t lane) const {
+        return lane >= 0 && lane < mMaxLanes;
+    }
+
+    const int32_t mChannelCount;
+    const int32_t mCapacityInFrames;
+    const int32_t mMaxLanes;
+    std::unique_ptr<Lane[]> mLanes;
+};
+
+} // namespace oboe
+
+#endif //OBOE_MIXING_FIFO_H
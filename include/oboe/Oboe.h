@@ -30,9 +30,15 @@
 #include "oboe/AudioStream.h"
 #include "oboe/AudioStreamBase.h"
 #include "oboe/AudioStreamBuilder.h"
+#include "oboe/AudioWorkerPool.h"
 #include "oboe/Utilities.h"
 #include "oboe/Version.h"
 #include "oboe/StabilizedCallback.h"
 #include "oboe/FifoBuffer.h"
+#include "oboe/MixingFifo.h"
+#include "oboe/SharedMemoryFifo.h"
+#include "oboe/StreamTelemetry.h"
+#include "oboe/TraceRecorder.h"
+#include "oboe/VirtualDevice.h"
 
 #endif //OBOE_OBOE_H
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_SHARED_MEMORY_FIFO_H
+#define OBOE_SHARED_MEMORY_FIFO_H
+
+#include <memory>
+#include <stdint.h>
+
+#include "oboe/Definitions.h"
+#include "oboe/FifoBuffer.h"
+
+namespace oboe {
+
+/**
+ * A FifoBuffer whose counters and data are in shared memory,
+ * so that audio can be passed between two processes without copying it through IPC calls.
+ *
+ * One process calls create() and sends the file descriptor to the other process,
+ * for example over Binder or a Unix domain socket. The other process calls attach().
+ * Each side then uses getFifoBuffer(), one as the writer and the other as the reader.
+ * The region API of FifoBuffer can be used to render or read in place.
+ *
+ * The memory starts with a header that holds the format, the channel count, the capacity
+ * and the read and write counters on separate cache lines, followed by the audio data.
+ * This only uses Linux shared memory so it works on Android and on a Linux host.
+ */
+class SharedMemoryFifo {
+public:
+    ~SharedMemoryFifo();
+
+    /**
+     * Create a shared FIFO backed by an anonymous memory file.
+     *
+     * @param format sample format
+     * @param channelCount samples per frame
+     * @param capacityInFrames capacity of the FIFO in frames
+     * @param fifo receives the new object
+     * @return Result::OK or an error
+     */
+    static Result create(AudioFormat format,
+                         int32_t channelCount,
+                         int32_t capacityInFrames,
+                         std::unique_ptr<SharedMemoryFifo> &fifo);
+
+    /**
+     * Map a shared FIFO that was created in another process.
+     * The header is checked before the FIFO is used. The memory must be sealed
+     * so that it cannot shrink, as it is by create().
+     * The caller keeps ownership of the file descriptor and may close it after this returns.
+     *
+     * @param fileDescriptor descriptor received from the process that called create()
+     * @param fifo receives the new object
+     * @return Result::OK, Result::ErrorInvalidHandle if the descriptor is not sealed memory,
+     *         or Result::ErrorInvalidFormat if the memory does not hold a valid FIFO
+     */
+    static Result attach(int fileDescriptor, std::unique_ptr<SharedMemoryFifo> &fifo);
+
+    /**
+     * @return descriptor to send to the other process, or -1 if this FIFO was attached
+     */
+    int getFileDescriptor() const {
+        return mFileDescriptor;
+    }
+
+    /**
+     * @return FifoBuffer that reads and writes the shared memory
+     */
+    FifoBuffer *getFifoBuffer() {
+        return mFifoBuffer.get();
+    }
+
+    AudioFormat getFormat() const {
+        return mFormat;
+    }
+
+    int32_t getChannelCount() const {
+        return mChannelCount;
+    }
+
+private:
+    SharedMemoryFifo() = default;
+
+    int mFileDescriptor = -1; // only owned by the creator
+    uint8_t *mMemory = nullptr;
+    size_t mSizeInBytes = 0;
+    // Copied from the header so the other process cannot change them.
+    AudioFormat mFormat = AudioFormat::Invalid;
+    int32_t mChannelCount = 0;
+    std::unique_ptr<FifoBuffer> mFifoBuffer;
+};
+
+} // namespace oboe
+
+#endif //OBOE_SHARED_MEMORY_FIFO_H
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_STREAM_TELEMETRY_H
+#define OBOE_STREAM_TELEMETRY_H
+
+#include <atomic>
+#include <memory>
+#include <stdint.h>
+
+namespace oboe {
+
+template <typename T>
+class SequencedRing;
+
+/**
+ * Health statistics for a stream that are collected by the audio thread
+ * and can be read from any other thread.
+ *
+ * The audio thread records each callback duration, the fill level of the stream's FIFO
+ * if it has one, and each underrun or overrun. Only one thread records at a time,
+ * so recording is a few relaxed stores with no read-modify-write operations and no locks.
+ * getSnapshot() only reads, so it does not disturb the audio thread.
+ * A snapshot taken while the audio thread is recording may be one callback out of date
+ * in some of its fields.
+ */
+class StreamTelemetry {
+public:
+    static constexpr int kNumFillLevelBins = 16;
+    static constexpr int kNumDurationBins = 64;
+    static constexpr int kMaxEvents = 16;
+
+    enum class XRunType : int32_t {
+        Underrun, // an output callback did not have enough data in the FIFO
+        Overrun,  // an input callback did not have enough room in the FIFO
+    };
+
+    struct XRunEvent {
+        XRunType type;
+        int32_t numFrames;     // frames that were zero filled or dropped
+        int64_t framePosition; // FIFO position where it happened
+        int64_t timeNanos;     // CLOCK_MONOTONIC
+    };
+
+    struct Snapshot {
+        int64_t callbackCount;
+
+        // Callback durations, in nanoseconds. The percentiles are the upper edge of a
+        // histogram bin so they may be up to 25% high. The maximum is exact.
+        int64_t callbackNanos50;
+        int64_t callbackNanos90;
+        int64_t callbackNanos99;
+        int64_t callbackNanosMax;
+
+        // Number of callbacks that found the FIFO at each fraction of its size.
+        // Only streams that use a FIFO record these.
+        int64_t fillLevelCount;
+        int64_t fillLevelHistogram[kNumFillLevelBins];
+        // Spare frames after a callback, that is, how close the stream came to an xrun.
+        // Negative if there was an xrun.
+        int32_t minHeadroomFrames;
+        int32_t maxHeadroomFrames;
+
+        int64_t underrunCount;
+        int64_t overrunCount;
+        int64_t framesUnderrun;
+        int64_t framesOverrun;
+        // The most recent xruns, oldest first.
+        int32_t numEvents;
+        XRunEvent events[kMaxEvents];
+    };
+
+    StreamTelemetry();
+    ~StreamTelemetry();
+    StreamTelemetry(const StreamTelemetry &) = delete;
+    StreamTelemetry &operator=(const StreamTelemetry &) = delete;
+
+    /**
+     * Record how long one callback took. Called by the audio thread.
+     */
+    void recordCallbackDuration(int64_t nanoseconds);
+
+    /**
+     * Record the state of the FIFO at a callback. Called by the audio thread.
+     *
+     * @param framesFull frames in the FIFO before the callback transferred its data
+     * @param size size of the FIFO in frames
+     * @param headroomFrames frames to spare after the transfer, negative for an xrun
+     */
+    void recordFillLevel(int32_t framesFull, int32_t size, int32_t headroomFrames);
+
+    /**
+     * Record an underrun or overrun. Called by the audio thread.
+     */
+    void recordXRun(XRunType type, int64_t framePosition, int32_t numFrames, int64_t timeNanos);
+
+    /**
+     * Copy the statistics. May be called from any thread.
+     */
+    void getSnapshot(Snapshot *snapshot) const;
+
+    /**
+     * @return index of the duration histogram bin for a number of microseconds
+     */
+    static int32_t getDurationBin(int64_t micros);
+
+    /**
+     * @return largest number of microseconds that falls in the bin
+     */
+    static int64_t getDurationBinLimit(int32_t bin);
+
+private:
+    // Only the audio thread writes, so it does not need an atomic increment.
+    static void increment(std::atomic<int64_t> &counter, int64_t delta = 1) {
+        counter.store(counter.load(std::memory_order_relaxed) + delta,
+                      std::memory_order_relaxed);
+    }
+
+    int64_t getPercentile(const int64_t *histogram, int64_t total, int percent) const;
+
+    std::atomic<int64_t> mCallbackCount{0};
+    std::atomic<int64_t> mCallbackNanosMax{0};
+    std::atomic<int64_t> mDurationHistogram[kNumDurationBins] = {};
+
+    std::atomic<int64_t> mFillLevelCount{0};
+    std::atomic<int64_t> mFillLevelHistogram[kNumFillLevelBins] = {};
+    std::atomic<int32_t> mMinHeadroomFrames{INT32_MAX};
+    std::atomic<int32_t> mMaxHeadroomFrames{INT32_MIN};
+
+    std::atomic<int64_t> mUnderrunCount{0};
+    std::atomic<int64_t> mOverrunCount{0};
+    std::atomic<int64_t> mFramesUnderrun{0};
+    std::atomic<int64_t> mFramesOverrun{0};
+    std::unique_ptr<SequencedRing<XRunEvent>> mEvents;
+};
+
+} // namespace oboe
+
+#endif //OBOE_STREAM_TELEMETRY_H
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef OBOE_TRACE_RECORDER_H
+#define OBOE_TRACE_RECORDER_H
+
+#include <atomic>
+#include <cstdio>
+#include <stdint.h>
+
+namespace oboe {
+
+/**
+ * Records where the time goes in each callback, from any thread, without locks.
+ *
+ * Each thread that records gets its own ring of events. An event is a registered ID,
+ * a begin or end mark, a CLOCK_MONOTONIC time and an integer argument, so recording
+ * does not format any text. When tracing is disabled, which is the default,
+ * recording is a single relaxed load. The first event recorded by a thread
+ * allocates its ring, which is kept for reuse by later threads.
+ *
+ * Oboe records the data callback, the data conversion of a FilterAudioStream,
+ * the app callback inside the conversion, and the loads of a StabilizedCallback.
+ * On Android the events are also passed to ATrace, so they appear in systrace and Perfetto,
+ * once loadATrace() or setEnabled(true) has been called. That does not depend on
+ * whether recording is enabled. A StabilizedCallback loads ATrace when it is constructed.
+ * On any platform the rings can be written as Chrome JSON, which can be loaded
+ * into chrome://tracing or ui.perfetto.dev.
+ */
+class TraceRecorder {
+public:
+    static constexpr int32_t kMaxEventTypes = 64;
+    static constexpr int32_t kEventsPerThread = 8192; // arbitrary, power of two, about 256 KB
+
+    // Events recorded by Oboe. The argument is the number of frames or nanoseconds.
+    static constexpr int32_t kEventDataCallback = 0;
+    static constexpr int32_t kEventConversion = 1;
+    static constexpr int32_t kEventAppCallback = 2;
+    static constexpr int32_t kEventActualLoad = 3;
+    static constexpr int32_t kEventStabilizedLoad = 4;
+
+    /**
+     * Start or stop recording. Starting also calls loadATrace().
+     */
+    static void setEnabled(bool enabled);
+
+    /**
+     * @return true if events are being recorded in the rings
+     */
+    static bool isEnabled() {
+        return (mFlags.load(std::memory_order_relaxed) & kFlagRecording) != 0;
+    }
+
+    /**
+     * Pass every event to ATrace from now on, if it is available, even when recording
+     * is not enabled. This only does something on Android. It takes a lock
+     * and may load a library the first time, so do not call it from the audio thread.
+     */
+    static void loadATrace();
+
+    /**
+     * Register a name for an app event. This takes a lock so call it before recording.
+     *
+     * @param name must remain valid, for example a string literal
+     * @return an ID for begin() and end(), or -1 if kMaxEventTypes have been registered
+     */
+    static int32_t registerEvent(const char *name);
+
+    /**
+     * Prefer a Scope, which always ends what it began.
+     */
+    static void begin(int32_t eventId, int64_t arg = 0) {
+        uint32_t flags = mFlags.load(std::memory_order_relaxed);
+        if (flags != 0) record(eventId, true, arg, flags);
+    }
+
+    /**
+     * ATrace is only ended if this thread began a section that has not been ended,
+     * so an end() does not close someone else's section if ATrace was loaded after begin().
+     */
+    static void end(int32_t eventId) {
+        uint32_t flags = mFlags.load(std::memory_order_relaxed);
+        if (flags != 0) record(eventId, false, 0, flags);
+    }
+
+    /**
+     * Records a begin when constructed and the matching end when destroyed.
+     */
+    class Scope {
+    public:
+        explicit Scope(int32_t eventId, int64_t arg = 0)
+                : mEventId(eventId)
+                , mBeginFlags(mFlags.load(std::memory_order_relaxed)) {
+            if (mBeginFlags != 0) record(eventId, true, arg, mBeginFlags);
+        }
+
+        ~Scope() {
+            if (mBeginFlags != 0) record(mEventId, false, 0, mBeginFlags);
+        }
+
+    private:
+        const int32_t  mEventId;
+        const uint32_t mBeginFlags; // so the end goes wherever the begin went
+    };
+
+    /**
+     * Forget the events recorded so far. The rings are not changed,
+     * older events are just not written by writeChromeJson().
+     */
+    static void clear();
+
+    /**
+     * Write the most recent events of every thread in the Chrome trace event format.
+     * This may be called while recording. An event that is being overwritten while
+     * this runs is skipped, so the file may then have a begin without its end.
+     *
+     * @param file where to write the JSON
+     * @return number of events written, or a negative number if writing failed
+     */
+    static int32_t writeChromeJson(FILE *file);
+
+private:
+    struct ThreadRing;
+    class RingOwner;
+
+    static constexpr uint32_t kFlagRecording = 1;
+    static constexpr uint32_t kFlagATrace = 2;
+
+    static void record(int32_t eventId, bool isBegin, int64_t arg, uint32_t flags);
+    static ThreadRing *claimRing();
+
+    static std::atomic<uint32_t>     mFlags;
+    static std::atomic<int64_t>      mClearTimeNanos;
+    static std::atomic<int32_t>      mNumEventTypes;
+    static std::atomic<const char *> mEventNames[kMaxEventTypes];
+    // All of the rings ever allocated. They are only added, at the head.
+    static std::atomic<ThreadRing *> mRings;
+};
+
+} // namespace oboe
+
+#endif //OBOE_TRACE_RECORDER_H
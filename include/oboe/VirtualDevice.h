@@ -0,0 +1,142 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef OBOE_VIRTUAL_DEVICE_H
+#define OBOE_VIRTUAL_DEVICE_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include "oboe/Definitions.h"
+
+namespace oboe {
+
+/**
+ * The simulated device that is used by streams opened with AudioApi::Virtual.
+ *
+ * A virtual stream runs its callbacks from a timer thread that wakes up once per burst,
+ * like the DSP of a real device. Output data is discarded and input data is silence.
+ * This lets the whole stream stack, including data conversion, blocking reads and writes
+ * and the LatencyTuner, be tested and benchmarked without audio hardware,
+ * for example on a Linux host.
+ *
+ * The format, rate, channel count, burst size and capacity are read when a stream is opened.
+ * They are used for any stream properties that were left unspecified.
+ * The jitter can be changed while streams are running. A stall or a disconnect
+ * affects every virtual stream that is open when it is injected.
+ *
+ * All of the methods are thread safe.
+ */
+class VirtualDevice {
+public:
+    static constexpr int32_t kDefaultSampleRate = 48000;
+    static constexpr int32_t kDefaultFramesPerBurst = 192; // 4 msec at 48000 Hz
+    static constexpr int32_t kDefaultChannelCount = 2;
+    static constexpr int32_t kDefaultBurstsPerBuffer = 16; // arbitrary, like a legacy track
+
+    /**
+     * @return the device that is shared by all virtual streams
+     */
+    static VirtualDevice &getInstance();
+
+    void setSampleRate(int32_t sampleRate) { mSampleRate.store(sampleRate); }
+    int32_t getSampleRate() const { return mSampleRate.load(); }
+
+    void setFramesPerBurst(int32_t framesPerBurst) { mFramesPerBurst.store(framesPerBurst); }
+    int32_t getFramesPerBurst() const { return mFramesPerBurst.load(); }
+
+    void setChannelCount(int32_t channelCount) { mChannelCount.store(channelCount); }
+    int32_t getChannelCount() const { return mChannelCount.load(); }
+
+    void setFormat(AudioFormat format) { mFormat.store(format); }
+    AudioFormat getFormat() const { return mFormat.load(); }
+
+    /**
+     * The buffer capacity of a stream that uses a data callback, in bursts.
+     */
+    void setBurstsPerBuffer(int32_t numBursts) { mBurstsPerBuffer.store(numBursts); }
+    int32_t getBurstsPerBuffer() const { return mBurstsPerBuffer.load(); }
+
+    /**
+     * Each burst the timer thread wakes up late by a random time between zero and this.
+     * A stream has an xrun if it is late by more than its buffer size minus one burst.
+     *
+     * @param nanoseconds maximum extra delay for each burst
+     */
+    void setJitterNanoseconds(int64_t nanoseconds) { mJitterNanos.store(nanoseconds); }
+    int64_t getJitterNanoseconds() const { return mJitterNanos.load(); }
+
+    /**
+     * Block the timer thread of every running stream once, for the given time,
+     * as if the device was busy. The missed bursts are counted as xruns.
+     *
+     * @param nanoseconds length of the stall
+     */
+    void injectStall(int64_t nanoseconds) {
+        mStallNanos.store(nanoseconds);
+        mStallSequence.fetch_add(1);
+    }
+
+    /**
+     * Disconnect every open stream, as if the device was unplugged.
+     * The streams go to StreamState::Disconnected and their error callbacks are called.
+     * Streams opened afterwards are not affected.
+     */
+    void injectDisconnect() { mDisconnectSequence.fetch_add(1); }
+
+    /**
+     * Restore the default configuration.
+     */
+    void reset() {
+        setSampleRate(kDefaultSampleRate);
+        setFramesPerBurst(kDefaultFramesPerBurst);
+        setChannelCount(kDefaultChannelCount);
+        setFormat(AudioFormat::Float);
+        setBurstsPerBuffer(kDefaultBurstsPerBuffer);
+        setJitterNanoseconds(0);
+    }
+
+    /**
+     * For internal use only.
+     * @return a count that changes each time injectStall() is called
+     */
+    int32_t getStallSequence() const { return mStallSequence.load(); }
+    int64_t getStallNanoseconds() const { return mStallNanos.load(); }
+
+    /**
+     * For internal use only.
+     * @return a count that changes each time injectDisconnect() is called
+     */
+    int32_t getDisconnectSequence() const { return mDisconnectSequence.load(); }
+
+private:
+    VirtualDevice() = default;
+
+    std::atomic<int32_t>     mSampleRate{kDefaultSampleRate};
+    std::atomic<int32_t>     mFramesPerBurst{kDefaultFramesPerBurst};
+    std::atomic<int32_t>     mChannelCount{kDefaultChannelCount};
+    std::atomic<AudioFormat> mFormat{AudioFormat::Float};
+    std::atomic<int32_t>     mBurstsPerBuffer{kDefaultBurstsPerBuffer};
+    std::atomic<int64_t>     mJitterNanos{0};
+    std::atomic<int64_t>     mStallNanos{0};
+    std::atomic<int32_t>     mStallSequence{0};
+    std::atomic<int32_t>     mDisconnectSequence{0};
+};
+
+} // namespace oboe
+
+#endif //OBOE_VIRTUAL_DEVICE_H
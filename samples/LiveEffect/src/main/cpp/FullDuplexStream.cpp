@@ -50,6 +50,10 @@ oboe::DataCallbackResult FullDuplexStream::onAudioReady(
         // Let the input fill up a bit so we are not so close to the write pointer.
         mCountInputBurstsCushion--;
 
+    } else if (mResampler) {
+        // The resampler keeps the input in step so there is nothing to discard.
+        callbackResult = processWithDriftCompensation(audioData, numFrames);
+
     } else if (mCountCallbacksToDiscard > 0) {
         // Ignore. Allow the input to reach to equilibrium with the output.
         oboe::ResultWithValue<int32_t> result = mInputStream->read(mInputBuffer.get(),
@@ -84,6 +88,50 @@ oboe::DataCallbackResult FullDuplexStream::onAudioReady(
     return callbackResult;
 }
 
+oboe::DataCallbackResult FullDuplexStream::processWithDriftCompensation(
+        void *audioData,
+        int numFrames) {
+    const int32_t channelCount = mInputStream->getChannelCount();
+
+    // Steer the resampler so that the input stays near the target fill level.
+    oboe::ResultWithValue<int32_t> available = mInputStream->getAvailableFrames();
+    if (available) {
+        int32_t fillLevel = available.value() + (mNumValidInputFrames - mInputCursor);
+        mResampler->setRateScaler(mFillLevelController.update(fillLevel, numFrames));
+    }
+
+    float *resampledBuffer = mResampledBuffer.get();
+    int32_t framesProduced = 0;
+    while (framesProduced < numFrames) {
+        if (mResampler->isWriteNeeded() && mInputCursor >= mNumValidInputFrames) {
+            // Only read about as much as we need so the rest stays in the input buffer.
+            oboe::ResultWithValue<int32_t> readResult = mInputStream->read(
+                    mInputBuffer.get(),
+                    numFrames - framesProduced,
+                    0 /* timeout */);
+            if (!readResult) {
+                return oboe::DataCallbackResult::Stop;
+            } else if (readResult.value() == 0) {
+                break; // The input ran dry so the end of the output will be silent.
+            }
+            mInputCursor = 0;
+            mNumValidInputFrames = readResult.value();
+        }
+        resampler::MultiChannelResampler::ProcessResult result = mResampler->process(
+                &mInputBuffer[mInputCursor * channelCount],
+                mNumValidInputFrames - mInputCursor,
+                &resampledBuffer[framesProduced * channelCount],
+                numFrames - framesProduced);
+        mInputCursor += result.framesConsumed;
+        framesProduced += result.framesProduced;
+    }
+
+    return onBothStreamsReady(
+            mInputStream, resampledBuffer, framesProduced,
+            mOutputStream, audioData, numFrames
+    );
+}
+
 oboe::Result FullDuplexStream::start() {
     mCountCallbacksToDrain = kNumCallbacksToDrain;
     mCountInputBurstsCushion = mNumInputBurstsCushion;
@@ -91,11 +139,32 @@ oboe::Result FullDuplexStream::start() {
 
     // Determine maximum size that could possibly be called.
     int32_t bufferSize = mOutputStream->getBufferCapacityInFrames()
-            * mOutputStream->getChannelCount();
+            * std::max(mOutputStream->getChannelCount(), mInputStream->getChannelCount());
     if (bufferSize > mBufferSize) {
         mInputBuffer = std::make_unique<float[]>(bufferSize);
+        mResampledBuffer = std::make_unique<float[]>(bufferSize);
         mBufferSize = bufferSize;
     }
+
+    mResampler.reset();
+    if (mDriftCompensationEnabled
+            && mInputStream->getFormat() == oboe::AudioFormat::Float
+            && mOutputStream->getFormat() == oboe::AudioFormat::Float) {
+        resampler::MultiChannelResampler::Builder builder;
+        builder.setChannelCount(mInputStream->getChannelCount())
+                ->setNumTaps(16)
+                ->setInputRate(mInputStream->getSampleRate())
+                ->setOutputRate(mOutputStream->getSampleRate())
+                ->setVariableRate(true);
+        mResampler.reset(builder.build());
+        // The fill level goes up and down by a burst so aim for the middle.
+        const int32_t framesPerBurst = mInputStream->getFramesPerBurst();
+        mFillLevelController.setTargetFrames(
+                (mNumInputBurstsCushion * framesPerBurst) + (framesPerBurst / 2));
+        mFillLevelController.reset();
+        mInputCursor = 0;
+        mNumValidInputFrames = 0;
+    }
     oboe::Result result = mInputStream->requestStart();
     if (result != oboe::Result::OK) {
         return result;
@@ -21,6 +21,8 @@
 #include <sys/types.h>
 
 #include "oboe/Oboe.h"
+#include "flowgraph/resampler/FillLevelController.h"
+#include "flowgraph/resampler/MultiChannelResampler.h"
 
 class FullDuplexStream : public oboe::AudioStreamCallback {
 public:
@@ -72,8 +74,28 @@ public:
      */
     void setNumInputBurstsCushion(int32_t numInputBurstsCushion);
 
+    /**
+     * Pass the input through a variable rate resampler that follows the drift
+     * between the input and output clocks. This keeps the input near the cushion
+     * so it does not slowly fill up or run dry, and the input does not need to be
+     * discarded while the streams settle.
+     * Only used when both streams are Float. Takes effect at the next start().
+     * Default is true.
+     *
+     * @param enabled true to resample the input
+     */
+    void setDriftCompensationEnabled(bool enabled) {
+        mDriftCompensationEnabled = enabled;
+    }
+
+    bool isDriftCompensationEnabled() const {
+        return mDriftCompensationEnabled;
+    }
+
 private:
 
+    oboe::DataCallbackResult processWithDriftCompensation(void *audioData, int numFrames);
+
     // TODO add getters and setters
     static constexpr int32_t kNumCallbacksToDrain   = 20;
     static constexpr int32_t kNumCallbacksToDiscard = 30;
@@ -96,6 +118,13 @@ private:
 
     int32_t              mBufferSize = 0;
     std::unique_ptr<float[]> mInputBuffer;
+
+    bool                 mDriftCompensationEnabled = true;
+    std::unique_ptr<resampler::MultiChannelResampler> mResampler;
+    resampler::FillLevelController mFillLevelController;
+    std::unique_ptr<float[]> mResampledBuffer;
+    int32_t              mInputCursor = 0;         // next frame to resample in mInputBuffer
+    int32_t              mNumValidInputFrames = 0; // frames read into mInputBuffer
 };
 
 
@@ -20,7 +20,9 @@
 #include <dlfcn.h>
 #include <stdint.h>
 
+#ifdef __ANDROID__
 #include <sys/system_properties.h>
+#endif
 
 #include "common/OboeDebug.h"
 #include "oboe/Oboe.h"
@@ -110,10 +112,14 @@ private:
 
     int getIntegerProperty(const char *name, int defaultValue) {
         int result = defaultValue;
+#ifdef __ANDROID__
         char valueText[PROP_VALUE_MAX] = {0};
         if (__system_property_get(name, valueText) != 0) {
             result = atoi(valueText);
         }
+#else
+        (void) name;
+#endif
         return result;
     }
 
@@ -66,6 +66,39 @@ typedef int32_t aaudio_session_id_t;
 #define __NDK_MAJOR__ 0
 #endif
 
+// These are defined by <android/api-level.h>, which is not available on a Linux host.
+#ifndef __ANDROID_API_L__
+#define __ANDROID_API_L__ 21
+#endif
+
+#ifndef __ANDROID_API_M__
+#define __ANDROID_API_M__ 23
+#endif
+
+#ifndef __ANDROID_API_N__
+#define __ANDROID_API_N__ 24
+#endif
+
+#ifndef __ANDROID_API_O__
+#define __ANDROID_API_O__ 26
+#endif
+
+#ifndef __ANDROID_API_O_MR1__
+#define __ANDROID_API_O_MR1__ 27
+#endif
+
+#ifndef __ANDROID_API_P__
+#define __ANDROID_API_P__ 28
+#endif
+
+#ifndef __ANDROID_API_Q__
+#define __ANDROID_API_Q__ 29
+#endif
+
+#ifndef __ANDROID_API_R__
+#define __ANDROID_API_R__ 30
+#endif
+
 #ifndef __ANDROID_API_S__
 #define __ANDROID_API_S__ 31
 #endif
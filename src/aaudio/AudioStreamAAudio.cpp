@@ -24,11 +24,10 @@
 #include "common/OboeDebug.h"
 #include "oboe/Utilities.h"
 #include "AAudioExtensions.h"
+#include "common/QuirksManager.h"
 
 #ifdef __ANDROID__
 #include <sys/system_properties.h>
-#include <common/QuirksManager.h>
-
 #endif
 
 #ifndef OBOE_FIX_FORCE_STARTING_TO_STARTED
@@ -378,7 +377,7 @@ DataCallbackResult AudioStreamAAudio::callOnAudioReady(AAudioStream * /*stream*/
         if (result == DataCallbackResult::Stop) {
             LOGD("Oboe callback returned DataCallbackResult::Stop");
         } else {
-            LOGE("Oboe callback returned unexpected value = %d", result);
+            LOGE("Oboe callback returned unexpected value = %d", static_cast<int>(result));
         }
 
         // Returning Stop caused various problems before S. See #1230
@@ -15,6 +15,7 @@
  */
 
 #include "AudioSourceCaller.h"
+#include "oboe/TraceRecorder.h"
 
 using namespace oboe;
 using namespace flowgraph;
@@ -24,11 +25,15 @@ int32_t AudioSourceCaller::onProcessFixedBlock(uint8_t *buffer, int32_t numBytes
     int32_t result = 0;
     int32_t numFrames = numBytes / mStream->getBytesPerFrame();
     if (callback != nullptr) {
-        DataCallbackResult callbackResult = callback->onAudioReady(mStream, buffer, numFrames);
+        // Do not call the app again after it has returned Stop.
+        if (mCallbackResult != DataCallbackResult::Continue) {
+            return 0;
+        }
+        TraceRecorder::Scope traceScope(TraceRecorder::kEventAppCallback, numFrames);
+        mCallbackResult = callback->onAudioReady(mStream, buffer, numFrames);
         // onAudioReady() does not return the number of bytes processed so we have to assume all.
-        result = (callbackResult == DataCallbackResult::Continue)
-                ? numBytes
-                : -1;
+        // The app may have rendered its last data before returning Stop, so use it.
+        result = numBytes;
     } else {
         auto readResult = mStream->read(buffer, numFrames, mTimeoutNanos);
         if (!readResult) return (int32_t) readResult.error();
@@ -34,8 +34,11 @@ class AudioStream;
  */
 class AudioSourceCaller : public flowgraph::FlowGraphSource, public FixedBlockProcessor {
 public:
-    AudioSourceCaller(int32_t channelCount, int32_t framesPerCallback, int32_t bytesPerSample)
-            : FlowGraphSource(channelCount)
+    AudioSourceCaller(int32_t channelCount,
+                      int32_t framesPerCallback,
+                      int32_t bytesPerSample,
+                      int32_t framesPerBuffer = flowgraph::kDefaultBufferSize)
+            : FlowGraphSource(channelCount, framesPerBuffer)
             , mBlockReader(*this) {
         mBlockReader.open(channelCount * framesPerCallback * bytesPerSample);
     }
@@ -72,9 +75,24 @@ public:
      */
     int32_t onProcessFixedBlock(uint8_t *buffer, int32_t numBytes) override;
 
+    /**
+     * @return Stop if the app callback has returned Stop
+     */
+    DataCallbackResult getDataCallbackResult() const {
+        return mCallbackResult;
+    }
+
+    /**
+     * Allow the app callback to be called again, for example after the stream is restarted.
+     */
+    void resetDataCallbackResult() {
+        mCallbackResult = DataCallbackResult::Continue;
+    }
+
 protected:
     oboe::AudioStream         *mStream = nullptr;
     int64_t                    mTimeoutNanos = 0;
+    DataCallbackResult         mCallbackResult = DataCallbackResult::Continue;
 
     FixedBlockReader           mBlockReader;
 };
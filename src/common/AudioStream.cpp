@@ -22,6 +22,7 @@
 #include "OboeDebug.h"
 #include "AudioClock.h"
 #include <oboe/Utilities.h>
+#include <oboe/TraceRecorder.h>
 
 namespace oboe {
 
@@ -58,12 +59,17 @@ DataCallbackResult AudioStream::fireDataCallback(void *audioData, int32_t numFra
         return DataCallbackResult::Stop; // Should not be getting called
     }
 
+    int64_t startNanos = AudioClock::getNanoseconds();
     DataCallbackResult result;
-    if (mDataCallback) {
-        result = mDataCallback->onAudioReady(this, audioData, numFrames);
-    } else {
-        result = onDefaultCallback(audioData, numFrames);
+    {
+        TraceRecorder::Scope traceScope(TraceRecorder::kEventDataCallback, numFrames);
+        if (mDataCallback) {
+            result = mDataCallback->onAudioReady(this, audioData, numFrames);
+        } else {
+            result = onDefaultCallback(audioData, numFrames);
+        }
     }
+    mTelemetry.recordCallbackDuration(AudioClock::getNanoseconds() - startNanos);
     // On Oreo, we might get called after returning stop.
     // So block that here.
     setDataCallbackEnabled(result == DataCallbackResult::Continue);
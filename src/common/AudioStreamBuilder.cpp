@@ -23,10 +23,13 @@
 #include "OboeDebug.h"
 #include "oboe/Oboe.h"
 #include "oboe/AudioStreamBuilder.h"
+#ifdef __ANDROID__
 #include "opensles/AudioInputStreamOpenSLES.h"
 #include "opensles/AudioOutputStreamOpenSLES.h"
 #include "opensles/AudioStreamOpenSLES.h"
+#endif
 #include "QuirksManager.h"
+#include "virtual/AudioStreamVirtual.h"
 
 bool oboe::OboeGlobals::mWorkaroundsEnabled = true;
 
@@ -66,17 +69,21 @@ bool AudioStreamBuilder::isAAudioRecommended() {
 
 AudioStream *AudioStreamBuilder::build() {
     AudioStream *stream = nullptr;
-    if (isAAudioRecommended() && mAudioApi != AudioApi::OpenSLES) {
+    if (mAudioApi == AudioApi::Virtual) {
+        stream = new AudioStreamVirtual(*this);
+    } else if (isAAudioRecommended() && mAudioApi != AudioApi::OpenSLES) {
         stream = new AudioStreamAAudio(*this);
     } else if (isAAudioSupported() && mAudioApi == AudioApi::AAudio) {
         stream = new AudioStreamAAudio(*this);
         LOGE("Creating AAudio stream on 8.0 because it was specified. This is error prone.");
     } else {
+#ifdef __ANDROID__
         if (getDirection() == oboe::Direction::Output) {
             stream = new AudioOutputStreamOpenSLES(*this);
         } else if (getDirection() == oboe::Direction::Input) {
             stream = new AudioInputStreamOpenSLES(*this);
         }
+#endif
     }
     return stream;
 }
@@ -91,7 +98,7 @@ bool AudioStreamBuilder::isCompatible(AudioStreamBase &other) {
 Result AudioStreamBuilder::openStream(AudioStream **streamPP) {
     auto result = isValidConfig();
     if (result != Result::OK) {
-        LOGW("%s() invalid config %d", __func__, result);
+        LOGW("%s() invalid config %d", __func__, static_cast<int>(result));
         return result;
     }
 
@@ -178,8 +185,9 @@ Result AudioStreamBuilder::openStream(AudioStream **streamPP) {
         // Use a reasonable default buffer size.
         if (streamP->getDirection() == Direction::Input) {
             // For input, small size does not improve latency because the stream is usually
-            // run close to empty. And a low size can result in XRuns so always use the maximum.
-            optimalBufferSize = streamP->getBufferCapacityInFrames();
+            // run close to empty. And a low size can result in XRuns so use all of the storage.
+            // Do not use the full capacity because a FIFO would then grow when it opens.
+            optimalBufferSize = streamP->getAllocatedCapacityInFrames();
         } else if (streamP->getPerformanceMode() == PerformanceMode::LowLatency
                 && streamP->getDirection() == Direction::Output)  { // Output check is redundant.
             optimalBufferSize = streamP->getFramesPerBurst() *
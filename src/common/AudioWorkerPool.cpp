@@ -0,0 +1,175 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <sched.h>
+
+#include "common/AudioClock.h"
+#include "common/FutexEvent.h"
+#include "common/OboeDebug.h"
+#include "oboe/AudioWorkerPool.h"
+#include "oboe/StabilizedCallback.h" // for cpu_relax()
+
+using namespace oboe;
+
+// Sleeping threads check for stop() at least this often.
+constexpr int64_t kMaxSleepNanos = 100 * kNanosPerMillisecond; // arbitrary
+
+// Definitions for C++14, where the constants may be passed by reference.
+constexpr int64_t AudioWorkerPool::kDefaultSpinNanos;
+
+AudioWorkerPool::AudioWorkerPool(int32_t numWorkers)
+        : mNumWorkers(std::max(0, numWorkers))
+        , mStartEvent(std::make_unique<FutexEvent>())
+        , mJoinEvent(std::make_unique<FutexEvent>()) {
+}
+
+AudioWorkerPool::~AudioWorkerPool() {
+    stop();
+}
+
+Result AudioWorkerPool::start() {
+    if (!mThreads.empty()) {
+        return Result::ErrorInvalidState;
+    }
+    mStopping.store(false);
+    mThreads.reserve(mNumWorkers);
+    for (int32_t i = 0; i < mNumWorkers; i++) {
+        mThreads.emplace_back(&AudioWorkerPool::workerLoop, this, i);
+    }
+    return Result::OK;
+}
+
+void AudioWorkerPool::stop() {
+    if (mThreads.empty()) {
+        return;
+    }
+    mStopping.store(true);
+    mStartEvent->signal();
+    for (std::thread &thread : mThreads) {
+        thread.join();
+    }
+    mThreads.clear();
+}
+
+void AudioWorkerPool::configureWorkerThread(int32_t workerIndex) {
+    if (!mCpuIds.empty()) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        CPU_SET(mCpuIds[workerIndex % mCpuIds.size()], &cpuSet);
+        if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+            LOGW("AudioWorkerPool: could not pin worker %d to CPU %d",
+                 workerIndex, mCpuIds[workerIndex % mCpuIds.size()]);
+        }
+    }
+    if (mRealTimePriority > 0) {
+        struct sched_param param;
+        param.sched_priority = mRealTimePriority;
+        if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+            LOGW("AudioWorkerPool: could not set SCHED_FIFO priority %d for worker %d",
+                 mRealTimePriority, workerIndex);
+        }
+    }
+}
+
+void AudioWorkerPool::workerLoop(int32_t workerIndex) {
+    configureWorkerThread(workerIndex);
+    // Rounds are even when closed. If run() opened one before this thread started then join it.
+    uint32_t lastRound = mRound.load() & ~1u;
+    int64_t spinUntilNanos = 0;
+    while (!mStopping.load()) {
+        // Read the sequence before checking the round so a signal cannot be missed.
+        int32_t sequence = mStartEvent->getSequence();
+        uint32_t round = mRound.load();
+        if (isRoundOpen(round) && round != lastRound) {
+            lastRound = round;
+            joinRound(round);
+            spinUntilNanos = AudioClock::getNanoseconds() + mSpinNanos.load(std::memory_order_relaxed);
+        } else if (AudioClock::getNanoseconds() < spinUntilNanos) {
+            cpu_relax();
+        } else {
+            mStartEvent->wait(sequence, kMaxSleepNanos);
+        }
+    }
+}
+
+// A worker only reads the job after it is counted in the round and has seen that the
+// round is still open. run() closes the round and waits for the count to reach zero
+// before it changes the job, so a late worker never sees a job from the next round.
+void AudioWorkerPool::joinRound(uint32_t round) {
+    mNumWorkersInRound.fetch_add(1);
+    if (mRound.load() == round) {
+        int32_t numJobsRun = runJobs();
+        mWorkerJobCount.fetch_add(numJobsRun, std::memory_order_relaxed);
+    }
+    if (mNumWorkersInRound.fetch_sub(1) == 1) {
+        mJoinEvent->signal();
+    }
+}
+
+int32_t AudioWorkerPool::runJobs() {
+    int32_t numJobsRun = 0;
+    int32_t jobIndex;
+    while ((jobIndex = mNextJob.fetch_add(1)) < mNumJobs) {
+        mJob(mContext, jobIndex);
+        numJobsRun++;
+        if (mNumJobsDone.fetch_add(1) + 1 == mNumJobs) {
+            mJoinEvent->signal();
+        }
+    }
+    return numJobsRun;
+}
+
+template <typename Predicate>
+void AudioWorkerPool::waitUntil(Predicate isDone) {
+    const int64_t spinUntilNanos = AudioClock::getNanoseconds()
+            + mSpinNanos.load(std::memory_order_relaxed);
+    while (!isDone()) {
+        if (AudioClock::getNanoseconds() < spinUntilNanos) {
+            cpu_relax();
+        } else {
+            int32_t sequence = mJoinEvent->getSequence();
+            if (isDone()) break;
+            mJoinEvent->wait(sequence, kMaxSleepNanos);
+        }
+    }
+}
+
+void AudioWorkerPool::run(JobFunction job, void *context, int32_t numJobs) {
+    if (numJobs <= 0) {
+        return;
+    }
+    mJobCount.fetch_add(numJobs, std::memory_order_relaxed);
+    if (mThreads.empty() || numJobs == 1) {
+        for (int32_t i = 0; i < numJobs; i++) {
+            job(context, i);
+        }
+        return;
+    }
+    mJob = job;
+    mContext = context;
+    mNumJobs = numJobs;
+    mNextJob.store(0);
+    mNumJobsDone.store(0);
+    mRound.fetch_add(1); // open
+    mStartEvent->signal();
+
+    runJobs(); // on this thread too
+    waitUntil([this]() { return mNumJobsDone.load() == mNumJobs; });
+
+    mRound.fetch_add(1); // close
+    waitUntil([this]() { return mNumWorkersInRound.load() == 0; });
+}
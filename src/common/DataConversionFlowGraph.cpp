@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
+#include "oboe/TraceRecorder.h"
+#include "AudioClock.h"
 #include "OboeDebug.h"
 #include "DataConversionFlowGraph.h"
 #include "SourceFloatCaller.h"
@@ -41,6 +45,13 @@ using namespace oboe;
 using namespace flowgraph;
 using namespace resampler;
 
+// Upper limit for the block size so that a large callback does not thrash the caches.
+constexpr int32_t kMaxFramesPerBuffer = 512; // arbitrary
+
+// Definitions for C++14, where the constants may be passed by reference.
+constexpr int32_t DataConversionFlowGraph::kNumLowerQualityTiers;
+constexpr int32_t DataConversionFlowGraph::kQualityCrossfadeFrames;
+
 void DataConversionFlowGraph::setSource(const void *buffer, int32_t numFrames) {
     mSource->setData(buffer, numFrames);
 }
@@ -97,10 +108,23 @@ Result DataConversionFlowGraph::configure(AudioStream *sourceStream, AudioStream
          ", rate: %d to %d, cbsize: %d to %d, qual = %d",
             __func__,
             sourceChannelCount, sinkChannelCount,
-            sourceFormat, sinkFormat,
+            static_cast<int>(sourceFormat), static_cast<int>(sinkFormat),
             sourceSampleRate, sinkSampleRate,
             sourceFramesPerCallback, sinkFramesPerCallback,
-            sourceStream->getSampleRateConversionQuality());
+            static_cast<int>(sourceStream->getSampleRateConversionQuality()));
+
+    int32_t actualSourceFramesPerCallback = (sourceFramesPerCallback == kUnspecified)
+            ? sourceStream->getFramesPerBurst()
+            : sourceFramesPerCallback;
+    int32_t actualSinkFramesPerCallback = (sinkFramesPerCallback == kUnspecified)
+            ? sinkStream->getFramesPerBurst()
+            : sinkFramesPerCallback;
+
+    // Use a block size that lets a whole callback go through the graph in one pass.
+    // All of the port buffers are allocated here, when the nodes are constructed.
+    mFramesPerBuffer = std::max(actualSourceFramesPerCallback, actualSinkFramesPerCallback);
+    mFramesPerBuffer = std::max(kDefaultBufferSize,
+                                std::min(kMaxFramesPerBuffer, mFramesPerBuffer));
 
     // Source
     // IF OUTPUT and using a callback then call back to the app using a SourceCaller.
@@ -108,28 +132,30 @@ Result DataConversionFlowGraph::configure(AudioStream *sourceStream, AudioStream
     bool isDataCallbackSpecified = sourceStream->isDataCallbackSpecified();
     if ((isDataCallbackSpecified && isOutput)
         || (!isDataCallbackSpecified && isInput)) {
-        int32_t actualSourceFramesPerCallback = (sourceFramesPerCallback == kUnspecified)
-                ? sourceStream->getFramesPerBurst()
-                : sourceFramesPerCallback;
         switch (sourceFormat) {
             case AudioFormat::Float:
                 mSourceCaller = std::make_unique<SourceFloatCaller>(sourceChannelCount,
-                                                                    actualSourceFramesPerCallback);
+                                                                    actualSourceFramesPerCallback,
+                                                                    mFramesPerBuffer);
                 break;
             case AudioFormat::I16:
                 mSourceCaller = std::make_unique<SourceI16Caller>(sourceChannelCount,
-                                                                  actualSourceFramesPerCallback);
+                                                                  actualSourceFramesPerCallback,
+                                                                  mFramesPerBuffer);
                 break;
             case AudioFormat::I24:
                 mSourceCaller = std::make_unique<SourceI24Caller>(sourceChannelCount,
-                                                                  actualSourceFramesPerCallback);
+                                                                  actualSourceFramesPerCallback,
+                                                                  mFramesPerBuffer);
                 break;
             case AudioFormat::I32:
                 mSourceCaller = std::make_unique<SourceI32Caller>(sourceChannelCount,
-                                                                  actualSourceFramesPerCallback);
+                                                                  actualSourceFramesPerCallback,
+                                                                  mFramesPerBuffer);
                 break;
             default:
-                LOGE("%s() Unsupported source caller format = %d", __func__, sourceFormat);
+                LOGE("%s() Unsupported source caller format = %d", __func__,
+                     static_cast<int>(sourceFormat));
                 return Result::ErrorIllegalArgument;
         }
         mSourceCaller->setStream(sourceStream);
@@ -139,29 +165,25 @@ Result DataConversionFlowGraph::configure(AudioStream *sourceStream, AudioStream
         // OR IF INPUT and using a callback then write to the app using a BlockWriter.
         switch (sourceFormat) {
             case AudioFormat::Float:
-                mSource = std::make_unique<SourceFloat>(sourceChannelCount);
+                mSource = std::make_unique<SourceFloat>(sourceChannelCount, mFramesPerBuffer);
                 break;
             case AudioFormat::I16:
-                mSource = std::make_unique<SourceI16>(sourceChannelCount);
+                mSource = std::make_unique<SourceI16>(sourceChannelCount, mFramesPerBuffer);
                 break;
             case AudioFormat::I24:
-                mSource = std::make_unique<SourceI24>(sourceChannelCount);
+                mSource = std::make_unique<SourceI24>(sourceChannelCount, mFramesPerBuffer);
                 break;
             case AudioFormat::I32:
-                mSource = std::make_unique<SourceI32>(sourceChannelCount);
+                mSource = std::make_unique<SourceI32>(sourceChannelCount, mFramesPerBuffer);
                 break;
             default:
-                LOGE("%s() Unsupported source format = %d", __func__, sourceFormat);
+                LOGE("%s() Unsupported source format = %d", __func__,
+                     static_cast<int>(sourceFormat));
                 return Result::ErrorIllegalArgument;
         }
         if (isInput) {
-            int32_t actualSinkFramesPerCallback = (sinkFramesPerCallback == kUnspecified)
-                    ? sinkStream->getFramesPerBurst()
-                    : sinkFramesPerCallback;
             // The BlockWriter is after the Sink so use the SinkStream size.
             mBlockWriter.open(actualSinkFramesPerCallback * sinkStream->getBytesPerFrame());
-            mAppBuffer = std::make_unique<uint8_t[]>(
-                    kDefaultBufferSize * sinkStream->getBytesPerFrame());
         }
         lastOutput = &mSource->output;
     }
@@ -170,13 +192,15 @@ Result DataConversionFlowGraph::configure(AudioStream *sourceStream, AudioStream
     // sample rate converter.
     if (sourceChannelCount > sinkChannelCount) {
         if (sinkChannelCount == 1) {
-            mMultiToMonoConverter = std::make_unique<MultiToMonoConverter>(sourceChannelCount);
+            mMultiToMonoConverter = std::make_unique<MultiToMonoConverter>(sourceChannelCount,
+                                                                           mFramesPerBuffer);
             lastOutput->connect(&mMultiToMonoConverter->input);
             lastOutput = &mMultiToMonoConverter->output;
         } else {
             mChannelCountConverter = std::make_unique<ChannelCountConverter>(
                     sourceChannelCount,
-                    sinkChannelCount);
+                    sinkChannelCount,
+                    mFramesPerBuffer);
             lastOutput->connect(&mChannelCountConverter->input);
             lastOutput = &mChannelCountConverter->output;
         }
@@ -184,15 +208,46 @@ Result DataConversionFlowGraph::configure(AudioStream *sourceStream, AudioStream
 
     // Sample Rate conversion
     if (sourceSampleRate != sinkSampleRate) {
-        // Create a resampler to do the math.
-        mResampler.reset(MultiChannelResampler::make(lastOutput->getSamplesPerFrame(),
-                                                     sourceSampleRate,
-                                                     sinkSampleRate,
-                                                     convertOboeSRQualityToMCR(
-                                                             sourceStream->getSampleRateConversionQuality())));
+        SampleRateConversionQuality quality = sourceStream->getSampleRateConversionQuality();
+        if (quality == SampleRateConversionQuality::None) {
+            quality = SampleRateConversionQuality::Medium; // same as convertOboeSRQualityToMCR()
+        }
+        mCurrentQuality.store(static_cast<int32_t>(quality), std::memory_order_relaxed);
+        // The callback duration is only known when the graph runs in a callback.
+        if (mFilterStream->isSampleRateConversionQualityAdaptive()
+                && isDataCallbackSpecified
+                && quality > SampleRateConversionQuality::Fastest) {
+            // Build the lower tiers now so that switching does not allocate memory.
+            mLowestQuality = static_cast<SampleRateConversionQuality>(std::max(
+                    static_cast<int32_t>(SampleRateConversionQuality::Fastest),
+                    static_cast<int32_t>(quality) - kNumLowerQualityTiers));
+            std::vector<MultiChannelResampler::Quality> qualities;
+            for (int32_t tier = static_cast<int32_t>(mLowestQuality);
+                    tier <= static_cast<int32_t>(quality); tier++) {
+                qualities.push_back(convertOboeSRQualityToMCR(
+                        static_cast<SampleRateConversionQuality>(tier)));
+            }
+            mTieredResampler = new TieredResampler(lastOutput->getSamplesPerFrame(),
+                                                   sourceSampleRate,
+                                                   sinkSampleRate,
+                                                   qualities,
+                                                   kQualityCrossfadeFrames);
+            mResampler.reset(mTieredResampler);
+            // The callback is run by the child stream, so the budget is set by its rate.
+            mGovernor = std::make_unique<ResamplerGovernor>(
+                    mTieredResampler->getNumTiers(),
+                    isOutput ? sinkSampleRate : sourceSampleRate);
+        } else {
+            // Create a resampler to do the math.
+            mResampler.reset(MultiChannelResampler::make(lastOutput->getSamplesPerFrame(),
+                                                         sourceSampleRate,
+                                                         sinkSampleRate,
+                                                         convertOboeSRQualityToMCR(quality)));
+        }
         // Make a flowgraph node that uses the resampler.
         mRateConverter = std::make_unique<SampleRateConverter>(lastOutput->getSamplesPerFrame(),
-                                                               *mResampler.get());
+                                                               *mResampler.get(),
+                                                               mFramesPerBuffer);
         lastOutput->connect(&mRateConverter->input);
         lastOutput = &mRateConverter->output;
     }
@@ -200,13 +255,15 @@ Result DataConversionFlowGraph::configure(AudioStream *sourceStream, AudioStream
     // Expand the number of channels if required.
     if (sourceChannelCount < sinkChannelCount) {
         if (sourceChannelCount == 1) {
-            mMonoToMultiConverter = std::make_unique<MonoToMultiConverter>(sinkChannelCount);
+            mMonoToMultiConverter = std::make_unique<MonoToMultiConverter>(sinkChannelCount,
+                                                                           mFramesPerBuffer);
             lastOutput->connect(&mMonoToMultiConverter->input);
             lastOutput = &mMonoToMultiConverter->output;
         } else {
             mChannelCountConverter = std::make_unique<ChannelCountConverter>(
                     sourceChannelCount,
-                    sinkChannelCount);
+                    sinkChannelCount,
+                    mFramesPerBuffer);
             lastOutput->connect(&mChannelCountConverter->input);
             lastOutput = &mChannelCountConverter->output;
         }
@@ -215,53 +272,104 @@ Result DataConversionFlowGraph::configure(AudioStream *sourceStream, AudioStream
     // Sink
     switch (sinkFormat) {
         case AudioFormat::Float:
-            mSink = std::make_unique<SinkFloat>(sinkChannelCount);
+            mSink = std::make_unique<SinkFloat>(sinkChannelCount, mFramesPerBuffer);
             break;
         case AudioFormat::I16:
-            mSink = std::make_unique<SinkI16>(sinkChannelCount);
+            mSink = std::make_unique<SinkI16>(sinkChannelCount, mFramesPerBuffer);
             break;
         case AudioFormat::I24:
-            mSink = std::make_unique<SinkI24>(sinkChannelCount);
+            mSink = std::make_unique<SinkI24>(sinkChannelCount, mFramesPerBuffer);
             break;
         case AudioFormat::I32:
-            mSink = std::make_unique<SinkI32>(sinkChannelCount);
+            mSink = std::make_unique<SinkI32>(sinkChannelCount, mFramesPerBuffer);
             break;
         default:
-            LOGE("%s() Unsupported sink format = %d", __func__, sinkFormat);
+            LOGE("%s() Unsupported sink format = %d", __func__, static_cast<int>(sinkFormat));
             return Result::ErrorIllegalArgument;;
     }
     lastOutput->connect(&mSink->input);
 
+    // Sort the nodes now so the audio thread can run them without walking the graph.
+    // Nodes that can process in place share their upstream buffer to save memory traffic,
+    // for example a converter that drops channels writes into the buffer of the source.
+    mGraph.setProcessInPlaceEnabled(true);
+    mGraph.compile(*mSink);
+
     return Result::OK;
 }
 
 int32_t DataConversionFlowGraph::read(void *buffer, int32_t numFrames, int64_t timeoutNanos) {
+    TraceRecorder::Scope traceScope(TraceRecorder::kEventConversion, numFrames);
+    const int64_t startNanos = mGovernor ? AudioClock::getNanoseconds() : 0;
     if (mSourceCaller) {
         mSourceCaller->setTimeoutNanos(timeoutNanos);
     }
     int32_t numRead = mSink->read(buffer, numFrames);
+    if (numRead > 0) {
+        mSinkFramesRead += numRead;
+    }
+    if (mGovernor) {
+        updateQuality(AudioClock::getNanoseconds() - startNanos, numFrames);
+    }
     return numRead;
 }
 
 // This is similar to pushing data through the flowgraph.
 int32_t DataConversionFlowGraph::write(void *inputBuffer, int32_t numFrames) {
+    TraceRecorder::Scope traceScope(TraceRecorder::kEventConversion, numFrames);
+    const int64_t startNanos = mGovernor ? AudioClock::getNanoseconds() : 0;
     // Put the data from the input at the head of the flowgraph.
     mSource->setData(inputBuffer, numFrames);
-    while (true) {
-        // Pull and read some data in app format into a small buffer.
-        int32_t framesRead = mSink->read(mAppBuffer.get(), flowgraph::kDefaultBufferSize);
+    const int32_t bytesPerFrame = mFilterStream->getBytesPerFrame();
+    mCallbackResult = DataCallbackResult::Continue;
+    // Stop calling the app as soon as it returns Stop.
+    while (mCallbackResult == DataCallbackResult::Continue) {
+        // Convert straight into the block that will be passed to the app.
+        // The block adapter calls the app whenever the block is full.
+        int32_t bytesAvailable = 0;
+        uint8_t *block = mBlockWriter.acquireWrite(&bytesAvailable);
+        int32_t framesRead = mSink->read(block, bytesAvailable / bytesPerFrame);
         if (framesRead <= 0) break;
-        // Write to a block adapter, which will call the destination whenever it has enough data.
-        int32_t bytesRead = mBlockWriter.write(mAppBuffer.get(),
-                                               framesRead * mFilterStream->getBytesPerFrame());
-        if (bytesRead < 0) return bytesRead; // TODO review
+        mSinkFramesRead += framesRead;
+        int32_t bytesWritten = mBlockWriter.commitWrite(framesRead * bytesPerFrame);
+        if (bytesWritten < 0) return bytesWritten;
+    }
+    if (mGovernor) {
+        updateQuality(AudioClock::getNanoseconds() - startNanos, numFrames);
     }
     return numFrames;
 }
 
+void DataConversionFlowGraph::updateQuality(int64_t callbackNanos, int32_t numFrames) {
+    int32_t previousTier = mGovernor->getTier();
+    int32_t tier = mGovernor->update(callbackNanos, numFrames);
+    if (tier == previousTier) {
+        return;
+    }
+    mTieredResampler->setTier(tier);
+    mCurrentQuality.store(static_cast<int32_t>(mLowestQuality) + tier, std::memory_order_relaxed);
+    if (tier < previousTier) {
+        mNumQualityLowered.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        mNumQualityRaised.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void DataConversionFlowGraph::getFramePositions(int64_t *sourcePosition,
+                                                int64_t *sinkPosition) const {
+    if (mRateConverter) {
+        // The other nodes do not change the number of frames.
+        *sourcePosition = mRateConverter->getInputFramesConsumed();
+        *sinkPosition = mRateConverter->getOutputFramesProduced();
+    } else {
+        *sourcePosition = mSinkFramesRead;
+        *sinkPosition = mSinkFramesRead;
+    }
+}
+
 int32_t DataConversionFlowGraph::onProcessFixedBlock(uint8_t *buffer, int32_t numBytes) {
     int32_t numFrames = numBytes / mFilterStream->getBytesPerFrame();
+    TraceRecorder::Scope traceScope(TraceRecorder::kEventAppCallback, numFrames);
     mCallbackResult = mFilterStream->getDataCallback()->onAudioReady(mFilterStream, buffer, numFrames);
-    // TODO handle STOP from callback, process data remaining in the block adapter
     return numBytes;
 }
@@ -17,17 +17,21 @@
 #ifndef OBOE_OBOE_FLOW_GRAPH_H
 #define OBOE_OBOE_FLOW_GRAPH_H
 
+#include <atomic>
 #include <memory>
 #include <stdint.h>
 #include <sys/types.h>
 
 #include <flowgraph/ChannelCountConverter.h>
+#include <flowgraph/FlowGraph.h>
 #include <flowgraph/MonoToMultiConverter.h>
 #include <flowgraph/MultiToMonoConverter.h>
 #include <flowgraph/SampleRateConverter.h>
+#include <flowgraph/resampler/TieredResampler.h>
 #include <oboe/Definitions.h>
 #include "AudioSourceCaller.h"
 #include "FixedBlockWriter.h"
+#include "ResamplerGovernor.h"
 
 namespace oboe {
 
@@ -62,24 +66,96 @@ public:
 
     int32_t onProcessFixedBlock(uint8_t *buffer, int32_t numBytes) override;
 
+    /**
+     * @return Stop if the app callback has returned Stop
+     */
     DataCallbackResult getDataCallbackResult() {
+        if (mSourceCaller && mSourceCaller->getDataCallbackResult() != DataCallbackResult::Continue) {
+            return mSourceCaller->getDataCallbackResult();
+        }
         return mCallbackResult;
     }
 
+    /**
+     * Allow the app callback to be called again after it returned Stop.
+     */
+    void resetDataCallbackResult() {
+        if (mSourceCaller) {
+            mSourceCaller->resetDataCallbackResult();
+        }
+        mCallbackResult = DataCallbackResult::Continue;
+    }
+
+    /**
+     * Get a pair of frame positions, at the source and the sink, that refer to the same
+     * point in the audio. They are counted from when the flowgraph was configured.
+     * If the sample rate is converted then the source position is measured where the
+     * resampler uses the data, so it does not include frames waiting in its input buffer.
+     * This should be called from the thread that calls read() or write().
+     *
+     * @param sourcePosition receives the position in the source stream
+     * @param sinkPosition receives the position in the sink stream
+     */
+    void getFramePositions(int64_t *sourcePosition, int64_t *sinkPosition) const;
+
+    /**
+     * This may be called from any thread.
+     * @return the quality of the resampler in use, or None if the rate is not converted
+     */
+    SampleRateConversionQuality getCurrentQuality() const {
+        return static_cast<SampleRateConversionQuality>(
+                mCurrentQuality.load(std::memory_order_relaxed));
+    }
+
+    /**
+     * Get the number of times the adaptive quality was changed. This may be called from any thread.
+     */
+    void getQualityChanges(int64_t *numLowered, int64_t *numRaised) const {
+        *numLowered = mNumQualityLowered.load(std::memory_order_relaxed);
+        *numRaised = mNumQualityRaised.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return number of nodes that process in place in the buffer of the node before them
+     */
+    int32_t getSharedBufferCount() const {
+        return mGraph.getSharedBufferCount();
+    }
+
+    // Number of tiers below the requested quality that adaptive quality can use.
+    static constexpr int32_t kNumLowerQualityTiers = 2;
+    // Length of the crossfade when the adaptive quality changes, about 5 msec at 48000 Hz.
+    static constexpr int32_t kQualityCrossfadeFrames = 256; // arbitrary
+
 private:
+    /**
+     * Give the governor the duration of a callback and switch the resampler tier if it says so.
+     */
+    void updateQuality(int64_t callbackNanos, int32_t numFrames);
+
     std::unique_ptr<flowgraph::FlowGraphSourceBuffered>    mSource;
     std::unique_ptr<AudioSourceCaller>                 mSourceCaller;
     std::unique_ptr<flowgraph::MonoToMultiConverter>   mMonoToMultiConverter;
     std::unique_ptr<flowgraph::MultiToMonoConverter>   mMultiToMonoConverter;
     std::unique_ptr<flowgraph::ChannelCountConverter>  mChannelCountConverter;
     std::unique_ptr<resampler::MultiChannelResampler>  mResampler;
+    resampler::TieredResampler                        *mTieredResampler = nullptr; // in mResampler
+    std::unique_ptr<ResamplerGovernor>                 mGovernor; // if the quality is adaptive
+    SampleRateConversionQuality                        mLowestQuality = SampleRateConversionQuality::None;
     std::unique_ptr<flowgraph::SampleRateConverter>    mRateConverter;
     std::unique_ptr<flowgraph::FlowGraphSink>              mSink;
 
     FixedBlockWriter                                   mBlockWriter;
     DataCallbackResult                                 mCallbackResult = DataCallbackResult::Continue;
     AudioStream                                       *mFilterStream = nullptr;
-    std::unique_ptr<uint8_t[]>                         mAppBuffer;
+    int32_t                                            mFramesPerBuffer = flowgraph::kDefaultBufferSize;
+    int64_t                                            mSinkFramesRead = 0;
+    std::atomic<int32_t>                               mCurrentQuality{
+            static_cast<int32_t>(SampleRateConversionQuality::None)};
+    std::atomic<int64_t>                               mNumQualityLowered{0};
+    std::atomic<int64_t>                               mNumQualityRaised{0};
+    // Execution plan for the nodes above. Declared last so it is deleted before them.
+    flowgraph::FlowGraph                               mGraph;
 };
 
 }
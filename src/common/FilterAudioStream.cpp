@@ -15,6 +15,7 @@
  */
 
 #include <memory>
+#include <string.h>
 
 #include "OboeDebug.h"
 #include "FilterAudioStream.h"
@@ -79,6 +80,7 @@ ResultWithValue<int32_t> FilterAudioStream::write(const void *buffer,
         }
         framesWritten += writeResult.value();
     }
+    recordFramePositions();
     return ResultWithValue<int32_t>::createBasedOnSign(framesWritten);
 }
 
@@ -88,6 +90,7 @@ ResultWithValue<int32_t> FilterAudioStream::read(void *buffer,
                                                   int32_t numFrames,
                                                   int64_t timeoutNanoseconds) {
     int32_t framesRead = mFlowGraph->read(buffer, numFrames, timeoutNanoseconds);
+    recordFramePositions();
     return ResultWithValue<int32_t>::createBasedOnSign(framesRead);
 }
 
@@ -97,10 +100,46 @@ DataCallbackResult FilterAudioStream::onAudioReady(AudioStream *oboeStream,
     int32_t framesProcessed;
     if (oboeStream->getDirection() == Direction::Output) {
         framesProcessed = mFlowGraph->read(audioData, numFrames, 0 /* timeout */);
+        recordFramePositions();
+        // If the app returned Stop then keep going until the data that it rendered before
+        // that has been passed to the child. Otherwise it would be lost.
+        if (framesProcessed > 0) {
+            if (framesProcessed < numFrames) {
+                int32_t bytesPerFrame = oboeStream->getBytesPerFrame();
+                memset(static_cast<uint8_t *>(audioData) + (framesProcessed * bytesPerFrame), 0,
+                       static_cast<size_t>((numFrames - framesProcessed) * bytesPerFrame));
+            }
+            return DataCallbackResult::Continue;
+        }
+        // Call the app again if the stream is restarted.
+        mFlowGraph->resetDataCallbackResult();
+        return DataCallbackResult::Stop;
     } else {
         framesProcessed = mFlowGraph->write(audioData, numFrames);
+        recordFramePositions();
+        return (framesProcessed < numFrames)
+               ? DataCallbackResult::Stop
+               : mFlowGraph->getDataCallbackResult();
+    }
+}
+
+void FilterAudioStream::recordFramePositions() {
+    int64_t sourcePosition = 0;
+    int64_t sinkPosition = 0;
+    mFlowGraph->getFramePositions(&sourcePosition, &sinkPosition);
+    if (getDirection() == Direction::Output) {
+        mFramePositions.write(sinkPosition, sourcePosition);
+    } else {
+        mFramePositions.write(sourcePosition, sinkPosition);
+    }
+}
+
+// Use the positions recorded by the flowgraph so that the result follows the data
+// through the resampler. Fall back to the ratio of the sample rates before the first burst.
+int64_t FilterAudioStream::convertChildPosition(int64_t childPosition) const {
+    int64_t position = 0;
+    if (!mFramePositions.interpolate(childPosition, mRateScaler, &position)) {
+        position = static_cast<int64_t>(childPosition * mRateScaler);
     }
-    return (framesProcessed < numFrames)
-           ? DataCallbackResult::Stop
-           : mFlowGraph->getDataCallbackResult();
+    return position;
 }
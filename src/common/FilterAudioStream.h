@@ -20,6 +20,7 @@
 #include <memory>
 #include <oboe/AudioStream.h>
 #include "DataConversionFlowGraph.h"
+#include "fifo/TimestampRing.h"
 
 namespace oboe {
 
@@ -136,12 +137,12 @@ public:
 
     void updateFramesWritten() override {
         // TODO for output, just count local writes?
-        mFramesWritten = static_cast<int64_t>(mChildStream->getFramesWritten() * mRateScaler);
+        mFramesWritten = convertChildPosition(mChildStream->getFramesWritten());
     }
 
     void updateFramesRead() override {
         // TODO for input, just count local reads?
-        mFramesRead = static_cast<int64_t>(mChildStream->getFramesRead() * mRateScaler);
+        mFramesRead = convertChildPosition(mChildStream->getFramesRead());
     }
 
     void *getUnderlyingStream() const  override {
@@ -157,6 +158,10 @@ public:
         return mBufferSizeInFrames;
     }
 
+    int32_t getAllocatedCapacityInFrames() const override {
+        return mChildStream->getAllocatedCapacityInFrames();
+    }
+
     ResultWithValue<int32_t> getXRunCount() override {
         return mChildStream->getXRunCount();
     }
@@ -173,7 +178,7 @@ public:
         Result result = mChildStream->getTimestamp(clockId, &childPosition, timeNanoseconds);
         // It is OK if framePosition is null.
         if (framePosition) {
-            *framePosition = childPosition * mRateScaler;
+            *framePosition = convertChildPosition(childPosition);
         }
         return result;
     }
@@ -210,12 +215,39 @@ public:
         return mChildStream->getLastErrorCallbackResult();
     }
 
+    // The child stream runs the callbacks and the buffer.
+    const StreamTelemetry &getTelemetry() const override {
+        return mChildStream->getTelemetry();
+    }
+
+    SampleRateConversionQuality getCurrentSampleRateConversionQuality() const override {
+        return mFlowGraph ? mFlowGraph->getCurrentQuality() : SampleRateConversionQuality::None;
+    }
+
+    void getSampleRateConversionQualityChanges(int64_t *numLowered,
+                                               int64_t *numRaised) const override {
+        if (mFlowGraph) {
+            mFlowGraph->getQualityChanges(numLowered, numRaised);
+        } else {
+            AudioStream::getSampleRateConversionQualityChanges(numLowered, numRaised);
+        }
+    }
+
 private:
 
+    // Remember how the positions in the two streams line up after each burst.
+    void recordFramePositions();
+
+    // Convert a position in the child stream to a position in this stream.
+    int64_t convertChildPosition(int64_t childPosition) const;
+
+    static constexpr int32_t kMaxFramePositions = 64; // arbitrary, covers a large child buffer
+
     std::unique_ptr<AudioStream>             mChildStream; // this stream wraps the child stream
     std::unique_ptr<DataConversionFlowGraph> mFlowGraph; // for converting data
     std::unique_ptr<uint8_t[]>               mBlockingBuffer; // temp buffer for write()
     double                                   mRateScaler = 1.0; // ratio parent/child sample rates
+    TimestampRing                            mFramePositions{kMaxFramePositions}; // child to parent
 };
 
 } // oboe
@@ -14,6 +14,7 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <stdint.h>
 #include <memory.h>
 
@@ -45,6 +46,20 @@ int32_t FixedBlockReader::readFromStorage(uint8_t *buffer, int32_t numBytes) {
     return bytesToRead;
 }
 
+const uint8_t *FixedBlockReader::acquireRead(int32_t maxBytes, int32_t *numBytes) {
+    if (mPosition >= mValid) {
+        int32_t bytesRead = mFixedBlockProcessor.onProcessFixedBlock(mStorage.get(), mSize);
+        if (bytesRead < 0) {
+            *numBytes = bytesRead;
+            return nullptr;
+        }
+        mPosition = 0;
+        mValid = bytesRead;
+    }
+    *numBytes = std::min(maxBytes, mValid - mPosition);
+    return mStorage.get() + mPosition;
+}
+
 int32_t FixedBlockReader::read(uint8_t *buffer, int32_t numBytes) {
     int32_t bytesRead;
     int32_t bytesLeft = numBytes;
@@ -50,6 +50,28 @@ public:
      */
     int32_t read(uint8_t *buffer, int32_t numBytes);
 
+    /**
+     * Get data from the current block without copying it.
+     * If the block has been used up then the processor is called to fill the next one.
+     * The data stays valid until commitRead() is called.
+     *
+     * @param maxBytes maximum number of bytes wanted
+     * @param numBytes receives the number of bytes at the returned address, which may be
+     *                 less than maxBytes at the end of a block, zero if the processor had
+     *                 no more data, or a negative error code
+     * @return address of the data in the block
+     */
+    const uint8_t *acquireRead(int32_t maxBytes, int32_t *numBytes);
+
+    /**
+     * Release data that was returned by acquireRead().
+     *
+     * @param numBytes number of bytes used, no more than acquireRead() returned
+     */
+    void commitRead(int32_t numBytes) {
+        mPosition += numBytes;
+    }
+
 private:
     int32_t readFromStorage(uint8_t *buffer, int32_t numBytes);
 
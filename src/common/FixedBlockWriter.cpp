@@ -35,6 +35,16 @@ int32_t FixedBlockWriter::writeToStorage(uint8_t *buffer, int32_t numBytes) {
     return bytesToStore;
 }
 
+int32_t FixedBlockWriter::commitWrite(int32_t numBytes) {
+    mPosition += numBytes;
+    if (mPosition == mSize) {
+        int32_t bytesWritten = mFixedBlockProcessor.onProcessFixedBlock(mStorage.get(), mSize);
+        mPosition = 0;
+        if (bytesWritten < 0) return bytesWritten;
+    }
+    return numBytes;
+}
+
 int32_t FixedBlockWriter::write(uint8_t *buffer, int32_t numBytes) {
     int32_t bytesLeft = numBytes;
 
@@ -56,7 +66,7 @@ int32_t FixedBlockWriter::write(uint8_t *buffer, int32_t numBytes) {
     }
 
     // Write through if enough for a complete block.
-    while(bytesLeft > mSize) {
+    while(bytesLeft >= mSize) {
         int32_t bytesWritten = mFixedBlockProcessor.onProcessFixedBlock(buffer, mSize);
         if (bytesWritten < 0) return bytesWritten;
         buffer += bytesWritten;
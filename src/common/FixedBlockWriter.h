@@ -46,6 +46,27 @@ public:
      */
     int32_t write(uint8_t *buffer, int32_t numBytes);
 
+    /**
+     * Get the empty part of the current block so that it can be filled in place,
+     * for example by a flowgraph sink, without copying it afterwards.
+     *
+     * @param numBytes receives the number of bytes that can be written
+     * @return address of the first empty byte in the block
+     */
+    uint8_t *acquireWrite(int32_t *numBytes) {
+        *numBytes = mSize - mPosition;
+        return mStorage.get() + mPosition;
+    }
+
+    /**
+     * Add bytes that were written at the address returned by acquireWrite() to the block.
+     * If that fills the block then it is passed to the processor.
+     *
+     * @param numBytes number of bytes written, no more than acquireWrite() returned
+     * @return numBytes or a negative error code from the processor
+     */
+    int32_t commitWrite(int32_t numBytes);
+
 private:
 
     int32_t writeToStorage(uint8_t *buffer, int32_t numBytes);
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "oboe/Definitions.h"
+#include "FutexEvent.h"
+
+namespace oboe {
+
+static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t),
+              "the futex must be the same size as the atomic");
+
+void FutexEvent::wait(int32_t sequence, int64_t timeoutNanoseconds) {
+    if (timeoutNanoseconds <= 0) {
+        return;
+    }
+    struct timespec timeout;
+    timeout.tv_sec = static_cast<time_t>(timeoutNanoseconds / kNanosPerSecond);
+    timeout.tv_nsec = static_cast<long>(timeoutNanoseconds % kNanosPerSecond);
+    // Sequentially consistent so signal() cannot miss the waiter and also skip the wake.
+    mNumWaiters.fetch_add(1);
+    // The kernel only sleeps if the sequence still matches.
+    syscall(SYS_futex, reinterpret_cast<int32_t *>(&mSequence), FUTEX_WAIT_PRIVATE,
+            sequence, &timeout, nullptr, 0);
+    mNumWaiters.fetch_sub(1);
+}
+
+void FutexEvent::signal() {
+    mSequence.fetch_add(1);
+    if (mNumWaiters.load() > 0) {
+        syscall(SYS_futex, reinterpret_cast<int32_t *>(&mSequence), FUTEX_WAKE_PRIVATE,
+                INT_MAX, nullptr, nullptr, 0);
+    }
+}
+
+} // namespace oboe
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_FUTEX_EVENT_H
+#define OBOE_FUTEX_EVENT_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace oboe {
+
+/**
+ * Lets a thread sleep until another thread signals that something has changed.
+ *
+ * signal() never blocks and only makes a system call when a thread is waiting,
+ * so it can be called from a real-time audio callback.
+ *
+ * The waiter reads getSequence() before checking its condition and passes that value to wait().
+ * If signal() is called in between then wait() returns immediately, so no signal is lost.
+ * This uses a Linux futex on the sequence number.
+ */
+class FutexEvent {
+public:
+    /**
+     * @return a value to pass to wait()
+     */
+    int32_t getSequence() const {
+        return mSequence.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Sleep until signal() is called, unless it has already been called since the
+     * sequence was read. May also return early for no reason so check the condition again.
+     *
+     * @param sequence value from getSequence()
+     * @param timeoutNanoseconds maximum time to sleep
+     */
+    void wait(int32_t sequence, int64_t timeoutNanoseconds);
+
+    /**
+     * Wake every thread that is in wait().
+     */
+    void signal();
+
+private:
+    std::atomic<int32_t> mSequence{0};
+    std::atomic<int32_t> mNumWaiters{0};
+};
+
+} // namespace oboe
+
+#endif //OBOE_FUTEX_EVENT_H
@@ -15,22 +15,30 @@
  */
 
 #include "oboe/LatencyTuner.h"
+#include "common/AudioClock.h"
+#include "fifo/SequencedRing.h"
 
 using namespace oboe;
 
+// Definition for C++14, where the constant may be passed by reference.
+constexpr int32_t LatencyTuner::kMaxDecisions;
+
 LatencyTuner::LatencyTuner(AudioStream &stream)
         : LatencyTuner(stream, stream.getBufferCapacityInFrames()) {
 }
 
 LatencyTuner::LatencyTuner(oboe::AudioStream &stream, int32_t maximumBufferSize)
         : mStream(stream)
-        , mMaxBufferSize(maximumBufferSize) {
+        , mMaxBufferSize(maximumBufferSize)
+        , mDecisions(std::make_unique<SequencedRing<Decision>>(kMaxDecisions)) {
     int32_t burstSize = stream.getFramesPerBurst();
     setMinimumBufferSize(kDefaultNumBursts * burstSize);
     setBufferSizeIncrement(burstSize);
     reset();
 }
 
+LatencyTuner::~LatencyTuner() = default;
+
 Result LatencyTuner::tune() {
     if (mState == State::Unsupported) {
         return Result::ErrorUnimplemented;
@@ -42,7 +50,10 @@ Result LatencyTuner::tune() {
     int32_t numRequests = mLatencyTriggerRequests.load();
     if (numRequests != mLatencyTriggerResponses.load()) {
         mLatencyTriggerResponses.store(numRequests);
+        int32_t oldBufferSize = mStream.getBufferSizeInFrames();
         reset();
+        recordDecision(Action::Reset, oldBufferSize, mStream.getBufferSizeInFrames(),
+                       mPreviousXRuns, 0);
     }
 
     // Set state to Active if the idle countdown has reached zero.
@@ -51,11 +62,14 @@ Result LatencyTuner::tune() {
     }
 
     // When state is Active attempt to change the buffer size if the number of xRuns has increased.
-    if (mState == State::Active) {
+    // In Mode::Bidirectional keep watching at the maximum because the size may come down again.
+    if (mState == State::Active
+            || (mState == State::AtMax && mMode == Mode::Bidirectional)) {
 
         auto xRunCountResult = mStream.getXRunCount();
         if (xRunCountResult == Result::OK) {
-            if ((xRunCountResult.value() - mPreviousXRuns) > 0) {
+            int32_t numXRuns = xRunCountResult.value() - mPreviousXRuns;
+            if (numXRuns > 0) {
                 mPreviousXRuns = xRunCountResult.value();
                 int32_t oldBufferSize = mStream.getBufferSizeInFrames();
                 int32_t requestedBufferSize = oldBufferSize + getBufferSizeIncrement();
@@ -64,15 +78,29 @@ Result LatencyTuner::tune() {
                 // or was from stream->getBufferCapacityInFrames())
                 if (requestedBufferSize > mMaxBufferSize) requestedBufferSize = mMaxBufferSize;
 
-                // Note that this will not allocate more memory. It simply determines
+                // For AAudio this will not allocate more memory. It simply determines
                 // how much of the existing buffer capacity will be used. The size will be
-                // clipped to the bufferCapacity by AAudio.
+                // clipped to the bufferCapacity. An OpenSL ES stream using blocking writes
+                // may grow its FIFO up to the capacity.
                 auto setBufferResult = mStream.setBufferSizeInFrames(requestedBufferSize);
                 if (setBufferResult != Result::OK) {
                     result = setBufferResult;
                     mState = State::Unsupported;
                 } else if (setBufferResult.value() == oldBufferSize) {
                     mState = State::AtMax;
+                } else {
+                    recordDecision(Action::Increase, oldBufferSize, setBufferResult.value(),
+                                   mPreviousXRuns, 0);
+                }
+                if (mState != State::Unsupported && mMode == Mode::Bidirectional) {
+                    onIncrease();
+                }
+            }
+            if (mState != State::Unsupported && mMode == Mode::Bidirectional) {
+                auto trackResult = trackWindow(numXRuns > 0 ? numXRuns : 0, mPreviousXRuns);
+                if (trackResult != Result::OK) {
+                    result = trackResult;
+                    mState = State::Unsupported;
                 }
             }
         } else {
@@ -90,6 +118,98 @@ Result LatencyTuner::tune() {
     return result;
 }
 
+void LatencyTuner::onIncrease() {
+    // An xrun soon after lowering the buffer means it was lowered too far,
+    // so wait longer before trying again.
+    if (mWindowsSinceDecrease < mPolicy.stableWindows) {
+        int64_t stableWindows = static_cast<int64_t>(mPolicy.stableWindows) << (mBackoffShift + 1);
+        if (stableWindows <= mPolicy.maxStableWindows) {
+            mBackoffShift++;
+        }
+        mWindowsSinceDecrease = INT32_MAX;
+    }
+    mStableWindowCount = 0;
+}
+
+Result LatencyTuner::trackWindow(int32_t numXRuns, int32_t xRunCount) {
+    const bool isOutput = mStream.getDirection() == Direction::Output;
+    // The frames that the device has played or recorded give the time in audio frames.
+    int64_t position = isOutput ? mStream.getFramesRead() : mStream.getFramesWritten();
+    int32_t bufferSize = mStream.getBufferSizeInFrames();
+    ResultWithValue<int32_t> available = mStream.getAvailableFrames();
+    if (available) {
+        int32_t headroom = isOutput ? available.value() : bufferSize - available.value();
+        if (headroom < mWindowMinHeadroom) mWindowMinHeadroom = headroom;
+    }
+    mWindowXRuns += numXRuns;
+
+    if (mWindowStartPosition < 0) {
+        mWindowStartPosition = position;
+        return Result::OK;
+    }
+    int64_t framesPerWindow = static_cast<int64_t>(mPolicy.windowMillis)
+            * mStream.getSampleRate() / kMillisPerSecond;
+    if (position - mWindowStartPosition < framesPerWindow) {
+        return Result::OK;
+    }
+
+    // The window is complete.
+    int32_t margin = (mPolicy.headroomMarginFrames == kUnspecified)
+            ? mStream.getFramesPerBurst() : mPolicy.headroomMarginFrames;
+    int32_t minHeadroom = mWindowMinHeadroom;
+    bool isStable = mWindowXRuns == 0
+            && minHeadroom != INT32_MAX
+            && minHeadroom >= getBufferSizeIncrement() + margin;
+    mStableWindowCount = isStable ? mStableWindowCount + 1 : 0;
+    if (mWindowsSinceDecrease < INT32_MAX) mWindowsSinceDecrease++;
+    mWindowStartPosition = position;
+    mWindowXRuns = 0;
+    mWindowMinHeadroom = INT32_MAX;
+
+    if (mStableWindowCount < (static_cast<int64_t>(mPolicy.stableWindows) << mBackoffShift)) {
+        return Result::OK;
+    }
+    mStableWindowCount = 0;
+    int32_t requestedBufferSize = bufferSize - getBufferSizeIncrement();
+    if (requestedBufferSize < getMinimumBufferSize()) requestedBufferSize = getMinimumBufferSize();
+    if (requestedBufferSize >= bufferSize) {
+        return Result::OK; // already at the minimum
+    }
+    auto setBufferResult = mStream.setBufferSizeInFrames(requestedBufferSize);
+    if (setBufferResult != Result::OK) {
+        return setBufferResult.error();
+    }
+    // AAudio may round the size up to the old size.
+    if (setBufferResult.value() < bufferSize) {
+        recordDecision(Action::Decrease, bufferSize, setBufferResult.value(),
+                       xRunCount, minHeadroom);
+        mWindowsSinceDecrease = 0;
+        if (mState == State::AtMax) mState = State::Active;
+    }
+    return Result::OK;
+}
+
+void LatencyTuner::recordDecision(Action action, int32_t oldBufferSize, int32_t newBufferSize,
+                                  int32_t xRunCount, int32_t minHeadroomFrames) {
+    Decision decision;
+    decision.action = action;
+    decision.oldBufferSize = oldBufferSize;
+    decision.newBufferSize = newBufferSize;
+    decision.xRunCount = xRunCount;
+    decision.minHeadroomFrames = minHeadroomFrames;
+    decision.timeNanos = AudioClock::getNanoseconds();
+    // Only the thread calling tune() writes.
+    mDecisions->write(decision);
+}
+
+int32_t LatencyTuner::getDecisions(Decision *decisions, int32_t maxDecisions) const {
+    return mDecisions->readLatest(decisions, maxDecisions);
+}
+
+int64_t LatencyTuner::getDecisionCount() const {
+    return static_cast<int64_t>(mDecisions->getWriteCount());
+}
+
 void LatencyTuner::requestReset() {
     if (mState != State::Unsupported) {
         mLatencyTriggerRequests++;
@@ -99,6 +219,12 @@ void LatencyTuner::requestReset() {
 void LatencyTuner::reset() {
     mState = State::Idle;
     mIdleCountDown = kIdleCount;
+    mWindowStartPosition = -1;
+    mWindowXRuns = 0;
+    mWindowMinHeadroom = INT32_MAX;
+    mStableWindowCount = 0;
+    mBackoffShift = 0;
+    mWindowsSinceDecrease = INT32_MAX;
     // Set to minimal latency
     mStream.setBufferSizeInFrames(getMinimumBufferSize());
 }
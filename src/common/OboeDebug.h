@@ -18,7 +18,22 @@
 #ifndef OBOE_DEBUG_H
 #define OBOE_DEBUG_H
 
+#ifdef __ANDROID__
 #include <android/log.h>
+#else
+// Log to stderr so that the portable parts of Oboe can be built and benchmarked on a host.
+#include <stdio.h>
+#define ANDROID_LOG_VERBOSE  2
+#define ANDROID_LOG_DEBUG    3
+#define ANDROID_LOG_INFO     4
+#define ANDROID_LOG_WARN     5
+#define ANDROID_LOG_ERROR    6
+#define ANDROID_LOG_FATAL    7
+#define __android_log_print(priority, tag, ...) \
+        (fprintf(stderr, "%d/%s: ", (priority), (tag)), \
+        fprintf(stderr, __VA_ARGS__), \
+        fprintf(stderr, "\n"))
+#endif
 
 #ifndef MODULE_NAME
 #define MODULE_NAME  "OboeAudio"
@@ -191,6 +191,31 @@ bool QuirksManager::isConversionNeeded(
     const bool isInput = builder.getDirection() == Direction::Input;
     const bool isFloat = builder.getFormat() == AudioFormat::Float;
 
+    // The virtual device has no quirks. It only has a native configuration,
+    // which is used for the child stream when the app asks for something else.
+    if (builder.getAudioApi() == AudioApi::Virtual) {
+        const VirtualDevice &device = VirtualDevice::getInstance();
+        if (builder.getSampleRate() != oboe::Unspecified
+                && builder.getSampleRate() != device.getSampleRate()
+                && builder.getSampleRateConversionQuality() != SampleRateConversionQuality::None) {
+            childBuilder.setSampleRate(oboe::Unspecified);
+            conversionNeeded = true;
+        }
+        if (builder.getFormat() != AudioFormat::Unspecified
+                && builder.getFormat() != device.getFormat()
+                && builder.isFormatConversionAllowed()) {
+            childBuilder.setFormat(AudioFormat::Unspecified);
+            conversionNeeded = true;
+        }
+        if (builder.getChannelCount() != oboe::Unspecified
+                && builder.getChannelCount() != device.getChannelCount()
+                && builder.isChannelConversionAllowed()) {
+            childBuilder.setChannelCount(oboe::Unspecified);
+            conversionNeeded = true;
+        }
+        return conversionNeeded;
+    }
+
     // There are multiple bugs involving using callback with a specified callback size.
     // Issue #778: O to Q had a problem with Legacy INPUT streams for FLOAT streams
     // and a specified callback size. It would assert because of a bad buffer size.
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+
+#include "oboe/Definitions.h"
+#include "ResamplerGovernor.h"
+
+using namespace oboe;
+
+// Definitions for C++14, where the constants may be passed by reference.
+constexpr double ResamplerGovernor::kHighLoad;
+constexpr double ResamplerGovernor::kLowLoad;
+
+// Each callback moves the smoothed load this fraction of the way to its own load.
+constexpr double kLoadSmoothing = 1.0 / 16; // arbitrary
+// Wait after lowering the tier so the crossfade and the smoothed load can settle.
+constexpr int64_t kLowerHoldMillis = 100; // arbitrary
+constexpr int64_t kRaiseDelayMillis = 2000; // arbitrary
+constexpr int64_t kMaxRaiseDelayMillis = 64000; // arbitrary
+
+ResamplerGovernor::ResamplerGovernor(int32_t numTiers, int32_t sampleRate)
+        : mNumTiers(numTiers)
+        , mSampleRate(sampleRate)
+        , mTier(numTiers - 1)
+        , mRaiseDelayFrames(kRaiseDelayMillis * sampleRate / kMillisPerSecond) {
+}
+
+int32_t ResamplerGovernor::update(int64_t callbackNanos, int32_t numFrames) {
+    if (numFrames <= 0 || mSampleRate <= 0) {
+        return mTier;
+    }
+    const double budgetNanos = static_cast<double>(numFrames) * kNanosPerSecond / mSampleRate;
+    const double load = callbackNanos / budgetNanos;
+    mSmoothedLoad += (load - mSmoothedLoad) * kLoadSmoothing;
+    mFramesSinceChange += numFrames;
+    mFramesSinceLowLoad = (mSmoothedLoad < kLowLoad) ? mFramesSinceLowLoad + numFrames : 0;
+
+    const int64_t holdFrames = kLowerHoldMillis * mSampleRate / kMillisPerSecond;
+    if ((load > 1.0 || mSmoothedLoad > kHighLoad)
+            && mTier > 0
+            && mFramesSinceChange >= holdFrames) {
+        // Raising the tier was a mistake if the load went up soon after.
+        if (mWasRaised && mFramesSinceChange < 2 * mRaiseDelayFrames) {
+            mRaiseDelayFrames = std::min(2 * mRaiseDelayFrames,
+                                         kMaxRaiseDelayMillis * mSampleRate / kMillisPerSecond);
+        }
+        mTier--;
+        mWasRaised = false;
+        mFramesSinceChange = 0;
+        mFramesSinceLowLoad = 0;
+    } else if (mTier < mNumTiers - 1 && mFramesSinceLowLoad >= mRaiseDelayFrames) {
+        mTier++;
+        mWasRaised = true;
+        mFramesSinceChange = 0;
+        mFramesSinceLowLoad = 0;
+    }
+    return mTier;
+}
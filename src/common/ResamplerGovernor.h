@@ -0,0 +1,87 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef OBOE_RESAMPLER_GOVERNOR_H
+#define OBOE_RESAMPLER_GOVERNOR_H
+
+#include <stdint.h>
+
+namespace oboe {
+
+/**
+ * Choose the quality tier of a TieredResampler based on how long the callbacks take.
+ *
+ * The load of a callback is its duration divided by the duration of the audio in it.
+ * The tier is lowered at once if a callback overruns, or if the smoothed load is high.
+ * It is raised again, one tier at a time, after the smoothed load has been low for a while.
+ * If the load gets high soon after raising the tier then the wait before the next
+ * raise is doubled, so the quality does not keep going up and down.
+ *
+ * This is called by the audio thread and is not thread safe.
+ */
+class ResamplerGovernor {
+public:
+    /**
+     * @param numTiers number of tiers, it starts at the highest
+     * @param sampleRate rate of the frames passed to update()
+     */
+    ResamplerGovernor(int32_t numTiers, int32_t sampleRate);
+
+    /**
+     * Call after each callback.
+     *
+     * @param callbackNanos how long the callback took
+     * @param numFrames number of frames in the callback
+     * @return the tier to use
+     */
+    int32_t update(int64_t callbackNanos, int32_t numFrames);
+
+    int32_t getTier() const {
+        return mTier;
+    }
+
+    /**
+     * @return the smoothed load, where 1.0 means the callbacks take all of the time available
+     */
+    double getSmoothedLoad() const {
+        return mSmoothedLoad;
+    }
+
+    /**
+     * @return how long the load must stay low before the tier is raised, in frames
+     */
+    int64_t getRaiseDelayFrames() const {
+        return mRaiseDelayFrames;
+    }
+
+    static constexpr double kHighLoad = 0.8; // arbitrary
+    static constexpr double kLowLoad = 0.5; // arbitrary
+
+private:
+    const int32_t mNumTiers;
+    const int32_t mSampleRate;
+    int32_t       mTier;
+    double        mSmoothedLoad = 0.0;
+    int64_t       mFramesSinceChange = 0;
+    int64_t       mFramesSinceLowLoad = 0; // frames since the load was not low
+    int64_t       mRaiseDelayFrames;
+    bool          mWasRaised = false; // the last change raised the tier
+};
+
+} // namespace oboe
+
+#endif //OBOE_RESAMPLER_GOVERNOR_H
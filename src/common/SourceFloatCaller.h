@@ -30,8 +30,10 @@ namespace oboe {
  */
 class SourceFloatCaller : public AudioSourceCaller {
 public:
-    SourceFloatCaller(int32_t channelCount, int32_t framesPerCallback)
-    : AudioSourceCaller(channelCount, framesPerCallback, (int32_t)sizeof(float)) {}
+    SourceFloatCaller(int32_t channelCount,
+                      int32_t framesPerCallback,
+                      int32_t framesPerBuffer = flowgraph::kDefaultBufferSize)
+    : AudioSourceCaller(channelCount, framesPerCallback, (int32_t)sizeof(float), framesPerBuffer) {}
 
     int32_t onProcess(int32_t numFrames) override;
 
@@ -30,18 +30,16 @@ namespace oboe {
  */
 class SourceI16Caller : public AudioSourceCaller {
 public:
-    SourceI16Caller(int32_t channelCount, int32_t framesPerCallback)
-    : AudioSourceCaller(channelCount, framesPerCallback, sizeof(int16_t)) {
-        mConversionBuffer = std::make_unique<int16_t[]>(channelCount * output.getFramesPerBuffer());
-    }
+    SourceI16Caller(int32_t channelCount,
+                   int32_t framesPerCallback,
+                   int32_t framesPerBuffer = flowgraph::kDefaultBufferSize)
+    : AudioSourceCaller(channelCount, framesPerCallback, sizeof(int16_t), framesPerBuffer) {}
 
     int32_t onProcess(int32_t numFrames) override;
 
     const char *getName() override {
         return "SourceI16Caller";
     }
-private:
-    std::unique_ptr<int16_t[]>  mConversionBuffer;
 };
 
 }
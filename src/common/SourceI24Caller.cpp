@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <unistd.h>
 #include "flowgraph/FlowGraphNode.h"
+#include "flowgraph/SampleConversion.h"
 #include "SourceI24Caller.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -27,30 +28,28 @@ using namespace oboe;
 using namespace flowgraph;
 
 int32_t SourceI24Caller::onProcess(int32_t numFrames) {
-    int32_t numBytes = mStream->getBytesPerFrame() * numFrames;
-    int32_t bytesRead = mBlockReader.read((uint8_t *) mConversionBuffer.get(), numBytes);
-    int32_t framesRead = bytesRead / mStream->getBytesPerFrame();
-
+    const int32_t bytesPerFrame = mStream->getBytesPerFrame();
+    const int32_t samplesPerFrame = output.getSamplesPerFrame();
     float *floatData = output.getBuffer();
-    const uint8_t *byteData = mConversionBuffer.get();
-    int32_t numSamples = framesRead * output.getSamplesPerFrame();
+    int32_t framesLeft = numFrames;
+    while (framesLeft > 0) {
+        // Convert straight from the block that the app filled.
+        int32_t numBytes = 0;
+        const uint8_t *byteData = mBlockReader.acquireRead(framesLeft * bytesPerFrame,
+                                                           &numBytes);
+        if (numBytes <= 0) break;
+        int32_t framesRead = numBytes / bytesPerFrame;
+        int32_t numSamples = framesRead * samplesPerFrame;
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-    memcpy_to_float_from_p24(floatData, byteData, numSamples);
+        memcpy_to_float_from_p24(floatData, byteData, numSamples);
 #else
-    static const float scale = 1. / (float)(1UL << 31);
-    for (int i = 0; i < numSamples; i++) {
-        // Assemble the data assuming Little Endian format.
-        int32_t pad = byteData[2];
-        pad <<= 8;
-        pad |= byteData[1];
-        pad <<= 8;
-        pad |= byteData[0];
-        pad <<= 8; // Shift to 32 bit data so the sign is correct.
-        byteData += kBytesPerI24Packed;
-        *floatData++ = pad * scale; // scale to range -1.0 to 1.0
-    }
+        SampleConversion::packedI24ToFloat(floatData, byteData, numSamples);
 #endif
 
-    return framesRead;
+        mBlockReader.commitRead(framesRead * bytesPerFrame);
+        floatData += numSamples;
+        framesLeft -= framesRead;
+    }
+    return numFrames - framesLeft;
 }
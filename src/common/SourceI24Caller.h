@@ -31,11 +31,10 @@ namespace oboe {
  */
 class SourceI24Caller : public AudioSourceCaller {
 public:
-    SourceI24Caller(int32_t channelCount, int32_t framesPerCallback)
-    : AudioSourceCaller(channelCount, framesPerCallback, kBytesPerI24Packed) {
-        mConversionBuffer = std::make_unique<uint8_t[]>(
-                kBytesPerI24Packed * channelCount * output.getFramesPerBuffer());
-    }
+    SourceI24Caller(int32_t channelCount,
+                   int32_t framesPerCallback,
+                   int32_t framesPerBuffer = flowgraph::kDefaultBufferSize)
+    : AudioSourceCaller(channelCount, framesPerCallback, kBytesPerI24Packed, framesPerBuffer) {}
 
     int32_t onProcess(int32_t numFrames) override;
 
@@ -44,7 +43,6 @@ public:
     }
 
 private:
-    std::unique_ptr<uint8_t[]>  mConversionBuffer;
     static constexpr int kBytesPerI24Packed = 3;
 };
 
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <unistd.h>
 #include "flowgraph/FlowGraphNode.h"
+#include "flowgraph/SampleConversion.h"
 #include "SourceI32Caller.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -27,21 +28,28 @@ using namespace oboe;
 using namespace flowgraph;
 
 int32_t SourceI32Caller::onProcess(int32_t numFrames) {
-    int32_t numBytes = mStream->getBytesPerFrame() * numFrames;
-    int32_t bytesRead = mBlockReader.read((uint8_t *) mConversionBuffer.get(), numBytes);
-    int32_t framesRead = bytesRead / mStream->getBytesPerFrame();
-
+    const int32_t bytesPerFrame = mStream->getBytesPerFrame();
+    const int32_t samplesPerFrame = output.getSamplesPerFrame();
     float *floatData = output.getBuffer();
-    const int32_t *intData = mConversionBuffer.get();
-    int32_t numSamples = framesRead * output.getSamplesPerFrame();
+    int32_t framesLeft = numFrames;
+    while (framesLeft > 0) {
+        // Convert straight from the block that the app filled.
+        int32_t numBytes = 0;
+        const uint8_t *data = mBlockReader.acquireRead(framesLeft * bytesPerFrame, &numBytes);
+        if (numBytes <= 0) break;
+        int32_t framesRead = numBytes / bytesPerFrame;
+        int32_t numSamples = framesRead * samplesPerFrame;
+        const int32_t *intData = reinterpret_cast<const int32_t *>(data);
 
 #if FLOWGRAPH_ANDROID_INTERNAL
-    memcpy_to_float_from_i32(floatData, shortData, numSamples);
+        memcpy_to_float_from_i32(floatData, intData, numSamples);
 #else
-    for (int i = 0; i < numSamples; i++) {
-        *floatData++ = *intData++ * kScale;
-    }
+        SampleConversion::i32ToFloat(floatData, intData, numSamples);
 #endif
 
-    return framesRead;
+        mBlockReader.commitRead(framesRead * bytesPerFrame);
+        floatData += numSamples;
+        framesLeft -= framesRead;
+    }
+    return numFrames - framesLeft;
 }
@@ -32,10 +32,10 @@ namespace oboe {
  */
 class SourceI32Caller : public AudioSourceCaller {
 public:
-    SourceI32Caller(int32_t channelCount, int32_t framesPerCallback)
-    : AudioSourceCaller(channelCount, framesPerCallback, sizeof(int32_t)) {
-        mConversionBuffer = std::make_unique<int32_t[]>(channelCount * output.getFramesPerBuffer());
-    }
+    SourceI32Caller(int32_t channelCount,
+                   int32_t framesPerCallback,
+                   int32_t framesPerBuffer = flowgraph::kDefaultBufferSize)
+    : AudioSourceCaller(channelCount, framesPerCallback, sizeof(int32_t), framesPerBuffer) {}
 
     int32_t onProcess(int32_t numFrames) override;
 
@@ -43,8 +43,6 @@ public:
         return "SourceI32Caller";
     }
 
-private:
-    std::unique_ptr<int32_t[]>  mConversionBuffer;
     static constexpr float kScale = 1.0 / (1UL << 31);
 };
 
@@ -16,7 +16,7 @@
 
 #include "oboe/StabilizedCallback.h"
 #include "common/AudioClock.h"
-#include "common/Trace.h"
+#include "oboe/TraceRecorder.h"
 
 constexpr int32_t kLoadGenerationStepSizeNanos = 20000;
 constexpr float kPercentageOfCallbackToUse = 0.8;
@@ -24,7 +24,8 @@ constexpr float kPercentageOfCallbackToUse = 0.8;
 using namespace oboe;
 
 StabilizedCallback::StabilizedCallback(AudioStreamCallback *callback) : mCallback(callback){
-    Trace::initialize();
+    // Show the loads in systrace, as before TraceRecorder existed.
+    TraceRecorder::loadATrace();
 }
 
 /**
@@ -64,16 +65,20 @@ StabilizedCallback::onAudioReady(AudioStream *oboeStream, void *audioData, int32
     int64_t targetDurationNanos = static_cast<int64_t>(
             (numFramesAsNanos * kPercentageOfCallbackToUse) - lateStartNanos);
 
-    Trace::beginSection("Actual load");
-    DataCallbackResult result = mCallback->onAudioReady(oboeStream, audioData, numFrames);
-    Trace::endSection();
+    DataCallbackResult result;
+    {
+        TraceRecorder::Scope traceScope(TraceRecorder::kEventActualLoad, numFrames);
+        result = mCallback->onAudioReady(oboeStream, audioData, numFrames);
+    }
 
     int64_t executionDurationNanos = AudioClock::getNanoseconds() - startTimeNanos;
     int64_t stabilizingLoadDurationNanos = targetDurationNanos - executionDurationNanos;
 
-    Trace::beginSection("Stabilized load for %lldns", stabilizingLoadDurationNanos);
-    generateLoad(stabilizingLoadDurationNanos);
-    Trace::endSection();
+    {
+        TraceRecorder::Scope traceScope(TraceRecorder::kEventStabilizedLoad,
+                                        stabilizingLoadDurationNanos);
+        generateLoad(stabilizingLoadDurationNanos);
+    }
 
     // Wraparound: At 48000 frames per second mFrameCount wraparound will occur after 6m years,
     // significantly longer than the average lifetime of an Android phone.
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fifo/SequencedRing.h"
+#include "oboe/Definitions.h"
+#include "oboe/StreamTelemetry.h"
+
+namespace oboe {
+
+// Definitions for C++14, where the constants may be passed by reference.
+constexpr int StreamTelemetry::kNumFillLevelBins;
+constexpr int StreamTelemetry::kNumDurationBins;
+constexpr int StreamTelemetry::kMaxEvents;
+
+StreamTelemetry::StreamTelemetry()
+        : mEvents(std::make_unique<SequencedRing<XRunEvent>>(kMaxEvents)) {
+}
+
+StreamTelemetry::~StreamTelemetry() = default;
+
+// The first bins hold 0 to 7 microseconds exactly.
+// After that each doubling of the duration is split into four bins.
+constexpr int32_t kNumExactDurationBins = 8;
+constexpr int32_t kBinsPerOctave = 4;
+
+int32_t StreamTelemetry::getDurationBin(int64_t micros) {
+    if (micros < kNumExactDurationBins) {
+        return (micros < 0) ? 0 : static_cast<int32_t>(micros);
+    }
+    int32_t highestBit = 63 - __builtin_clzll(static_cast<uint64_t>(micros)); // 3 or more
+    int32_t quarter = static_cast<int32_t>(micros >> (highestBit - 2)) & 3;
+    int32_t bin = kNumExactDurationBins + ((highestBit - 3) * kBinsPerOctave) + quarter;
+    return (bin < kNumDurationBins) ? bin : kNumDurationBins - 1;
+}
+
+int64_t StreamTelemetry::getDurationBinLimit(int32_t bin) {
+    if (bin < kNumExactDurationBins) {
+        return bin;
+    }
+    int32_t highestBit = 3 + ((bin - kNumExactDurationBins) / kBinsPerOctave);
+    int64_t quarter = (bin - kNumExactDurationBins) % kBinsPerOctave;
+    return ((5 + quarter) << (highestBit - 2)) - 1;
+}
+
+void StreamTelemetry::recordCallbackDuration(int64_t nanoseconds) {
+    increment(mCallbackCount);
+    increment(mDurationHistogram[getDurationBin(nanoseconds / kNanosPerMicrosecond)]);
+    if (nanoseconds > mCallbackNanosMax.load(std::memory_order_relaxed)) {
+        mCallbackNanosMax.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+void StreamTelemetry::recordFillLevel(int32_t framesFull, int32_t size, int32_t headroomFrames) {
+    if (size <= 0) {
+        return;
+    }
+    int32_t bin = static_cast<int32_t>(static_cast<int64_t>(framesFull) * kNumFillLevelBins / size);
+    bin = (bin < 0) ? 0 : ((bin < kNumFillLevelBins) ? bin : kNumFillLevelBins - 1);
+    increment(mFillLevelHistogram[bin]);
+    increment(mFillLevelCount);
+    if (headroomFrames < mMinHeadroomFrames.load(std::memory_order_relaxed)) {
+        mMinHeadroomFrames.store(headroomFrames, std::memory_order_relaxed);
+    }
+    if (headroomFrames > mMaxHeadroomFrames.load(std::memory_order_relaxed)) {
+        mMaxHeadroomFrames.store(headroomFrames, std::memory_order_relaxed);
+    }
+}
+
+void StreamTelemetry::recordXRun(XRunType type,
+                                 int64_t framePosition,
+                                 int32_t numFrames,
+                                 int64_t timeNanos) {
+    if (type == XRunType::Underrun) {
+        increment(mUnderrunCount);
+        increment(mFramesUnderrun, numFrames);
+    } else {
+        increment(mOverrunCount);
+        increment(mFramesOverrun, numFrames);
+    }
+    XRunEvent event;
+    event.type = type;
+    event.numFrames = numFrames;
+    event.framePosition = framePosition;
+    event.timeNanos = timeNanos;
+    mEvents->write(event);
+}
+
+int64_t StreamTelemetry::getPercentile(const int64_t *histogram, int64_t total, int percent) const {
+    // Find the first bin where the running total reaches the percentile.
+    int64_t target = (total * percent + 99) / 100;
+    int64_t sum = 0;
+    for (int32_t bin = 0; bin < kNumDurationBins; bin++) {
+        sum += histogram[bin];
+        if (sum >= target && sum > 0) {
+            return getDurationBinLimit(bin) * kNanosPerMicrosecond;
+        }
+    }
+    return 0;
+}
+
+void StreamTelemetry::getSnapshot(Snapshot *snapshot) const {
+    int64_t durations[kNumDurationBins];
+    int64_t totalDurations = 0;
+    for (int32_t bin = 0; bin < kNumDurationBins; bin++) {
+        durations[bin] = mDurationHistogram[bin].load(std::memory_order_relaxed);
+        totalDurations += durations[bin];
+    }
+    snapshot->callbackCount = mCallbackCount.load(std::memory_order_relaxed);
+    snapshot->callbackNanos50 = getPercentile(durations, totalDurations, 50);
+    snapshot->callbackNanos90 = getPercentile(durations, totalDurations, 90);
+    snapshot->callbackNanos99 = getPercentile(durations, totalDurations, 99);
+    snapshot->callbackNanosMax = mCallbackNanosMax.load(std::memory_order_relaxed);
+
+    snapshot->fillLevelCount = mFillLevelCount.load(std::memory_order_relaxed);
+    for (int32_t bin = 0; bin < kNumFillLevelBins; bin++) {
+        snapshot->fillLevelHistogram[bin] = mFillLevelHistogram[bin].load(
+                std::memory_order_relaxed);
+    }
+    bool hasFillLevel = snapshot->fillLevelCount > 0;
+    snapshot->minHeadroomFrames = hasFillLevel
+            ? mMinHeadroomFrames.load(std::memory_order_relaxed) : 0;
+    snapshot->maxHeadroomFrames = hasFillLevel
+            ? mMaxHeadroomFrames.load(std::memory_order_relaxed) : 0;
+
+    snapshot->underrunCount = mUnderrunCount.load(std::memory_order_relaxed);
+    snapshot->overrunCount = mOverrunCount.load(std::memory_order_relaxed);
+    snapshot->framesUnderrun = mFramesUnderrun.load(std::memory_order_relaxed);
+    snapshot->framesOverrun = mFramesOverrun.load(std::memory_order_relaxed);
+
+    // Oldest first, skipping any that are being overwritten.
+    snapshot->numEvents = mEvents->readLatest(snapshot->events, kMaxEvents);
+}
+
+} // namespace oboe
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <dlfcn.h>
+#include <mutex>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/AudioClock.h"
+#include "common/OboeDebug.h"
+#include "fifo/SequencedRing.h"
+#include "oboe/TraceRecorder.h"
+
+namespace oboe {
+
+constexpr int32_t TraceRecorder::kMaxEventTypes;
+constexpr int32_t TraceRecorder::kEventsPerThread;
+constexpr int32_t TraceRecorder::kEventDataCallback;
+constexpr int32_t TraceRecorder::kEventConversion;
+constexpr int32_t TraceRecorder::kEventAppCallback;
+constexpr int32_t TraceRecorder::kEventActualLoad;
+constexpr int32_t TraceRecorder::kEventStabilizedLoad;
+constexpr uint32_t TraceRecorder::kFlagRecording;
+constexpr uint32_t TraceRecorder::kFlagATrace;
+
+static_assert((TraceRecorder::kEventsPerThread & (TraceRecorder::kEventsPerThread - 1)) == 0,
+              "kEventsPerThread must be a power of two");
+
+constexpr int kThreadNameLength = 16; // including the terminator, as for prctl(PR_GET_NAME)
+
+struct TraceRecorder::ThreadRing {
+    struct Event {
+        int64_t timeNanos;
+        int64_t arg;
+        int32_t idAndPhase; // (eventId << 1) | isBegin
+        int32_t threadId;
+    };
+
+    ThreadRing() : events(kEventsPerThread) {}
+
+    // Written by the owner. writeChromeJson() skips events that are being overwritten.
+    SequencedRing<Event>  events;
+    std::atomic<bool>     isOwned{false};
+    // The latest thread to own the ring, which is used to name the thread in the trace.
+    std::atomic<int32_t>  ownerThreadId{0};
+    std::atomic<uint64_t> ownerName[kThreadNameLength / sizeof(uint64_t)] = {};
+    ThreadRing           *next = nullptr; // not changed after the ring is added to the list
+};
+
+// Gives the ring back when the thread exits so that another thread can use it.
+class TraceRecorder::RingOwner {
+public:
+    ~RingOwner() {
+        if (ring != nullptr) {
+            ring->isOwned.store(false, std::memory_order_release);
+        }
+    }
+
+    ThreadRing *ring = nullptr;
+};
+
+typedef void *(*fp_ATrace_beginSection)(const char *sectionName);
+typedef void *(*fp_ATrace_endSection)();
+
+static std::atomic<fp_ATrace_beginSection> sATraceBeginSection{nullptr};
+static std::atomic<fp_ATrace_endSection> sATraceEndSection{nullptr};
+
+std::atomic<uint32_t> TraceRecorder::mFlags{0};
+std::atomic<int64_t> TraceRecorder::mClearTimeNanos{0};
+std::atomic<int32_t> TraceRecorder::mNumEventTypes{kEventStabilizedLoad + 1};
+std::atomic<const char *> TraceRecorder::mEventNames[kMaxEventTypes] = {
+        {"DataCallback"},
+        {"Conversion"},
+        {"AppCallback"},
+        {"ActualLoad"},
+        {"StabilizedLoad"},
+};
+std::atomic<TraceRecorder::ThreadRing *> TraceRecorder::mRings{nullptr};
+
+static std::mutex sRegisterLock;
+
+static int32_t getThreadId() {
+    return static_cast<int32_t>(syscall(SYS_gettid));
+}
+
+static bool loadATraceSymbols() {
+#ifdef __ANDROID__
+    // Using dlsym allows us to use tracing on API 21+ without needing android/trace.h which wasn't
+    // published until API 23
+    void *lib = dlopen("libandroid.so", RTLD_NOW | RTLD_LOCAL);
+    if (lib == nullptr) {
+        LOGW("Could not open libandroid.so to dynamically load tracing symbols");
+        return false;
+    }
+    auto beginSection = reinterpret_cast<fp_ATrace_beginSection>(
+            dlsym(lib, "ATrace_beginSection"));
+    auto endSection = reinterpret_cast<fp_ATrace_endSection>(
+            dlsym(lib, "ATrace_endSection"));
+    if (beginSection != nullptr && endSection != nullptr) {
+        sATraceBeginSection.store(beginSection);
+        sATraceEndSection.store(endSection);
+        return true;
+    }
+#endif
+    return false;
+}
+
+void TraceRecorder::loadATrace() {
+    static std::once_flag sLoadATraceOnce;
+    std::call_once(sLoadATraceOnce, []() {
+        if (loadATraceSymbols()) {
+            mFlags.fetch_or(kFlagATrace);
+        }
+    });
+}
+
+void TraceRecorder::setEnabled(bool enabled) {
+    if (enabled) {
+        loadATrace();
+        mFlags.fetch_or(kFlagRecording);
+    } else {
+        mFlags.fetch_and(~kFlagRecording);
+    }
+}
+
+int32_t TraceRecorder::registerEvent(const char *name) {
+    std::lock_guard<std::mutex> lock(sRegisterLock);
+    int32_t eventId = mNumEventTypes.load();
+    if (eventId >= kMaxEventTypes) {
+        return -1;
+    }
+    mEventNames[eventId].store(name);
+    mNumEventTypes.store(eventId + 1);
+    return eventId;
+}
+
+TraceRecorder::ThreadRing *TraceRecorder::claimRing() {
+    ThreadRing *ring = nullptr;
+    for (ThreadRing *candidate = mRings.load(std::memory_order_acquire);
+            candidate != nullptr; candidate = candidate->next) {
+        bool isOwned = false;
+        if (candidate->isOwned.compare_exchange_strong(isOwned, true,
+                                                       std::memory_order_acquire)) {
+            ring = candidate;
+            break;
+        }
+    }
+    const bool isNew = (ring == nullptr);
+    if (isNew) {
+        ring = new ThreadRing();
+        ring->isOwned.store(true, std::memory_order_relaxed);
+    }
+
+    ring->ownerThreadId.store(getThreadId(), std::memory_order_relaxed);
+    uint64_t name[kThreadNameLength / sizeof(uint64_t)] = {};
+    prctl(PR_GET_NAME, reinterpret_cast<char *>(name));
+    for (size_t i = 0; i < kThreadNameLength / sizeof(uint64_t); i++) {
+        ring->ownerName[i].store(name[i], std::memory_order_relaxed);
+    }
+
+    if (isNew) {
+        ring->next = mRings.load(std::memory_order_relaxed);
+        while (!mRings.compare_exchange_weak(ring->next, ring,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        }
+    }
+    return ring;
+}
+
+void TraceRecorder::record(int32_t eventId, bool isBegin, int64_t arg, uint32_t flags) {
+    if (eventId < 0 || eventId >= kMaxEventTypes) {
+        return;
+    }
+    if (flags & kFlagATrace) {
+        // Sections begun on this thread and not yet ended.
+        static thread_local int32_t sATraceDepth = 0;
+        if (isBegin) {
+            fp_ATrace_beginSection beginSection = sATraceBeginSection.load();
+            const char *name = mEventNames[eventId].load(std::memory_order_relaxed);
+            if (beginSection != nullptr && name != nullptr) {
+                beginSection(name);
+                sATraceDepth++;
+            }
+        } else if (sATraceDepth > 0) {
+            fp_ATrace_endSection endSection = sATraceEndSection.load();
+            endSection(); // loaded before the begin
+            sATraceDepth--;
+        }
+    }
+    if ((flags & kFlagRecording) == 0) {
+        return;
+    }
+    static thread_local RingOwner owner;
+    if (owner.ring == nullptr) {
+        owner.ring = claimRing(); // only the first event of each thread
+    }
+    ThreadRing *ring = owner.ring;
+    ThreadRing::Event event;
+    event.timeNanos = AudioClock::getNanoseconds();
+    event.arg = arg;
+    event.idAndPhase = (eventId << 1) | (isBegin ? 1 : 0);
+    event.threadId = ring->ownerThreadId.load(std::memory_order_relaxed);
+    ring->events.write(event);
+}
+
+void TraceRecorder::clear() {
+    mClearTimeNanos.store(AudioClock::getNanoseconds());
+}
+
+static void writeJsonString(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const char *c = text; *c != 0; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        } else if (static_cast<unsigned char>(*c) >= 0x20) {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+int32_t TraceRecorder::writeChromeJson(FILE *file) {
+    const int pid = static_cast<int>(getpid());
+    const int64_t clearTimeNanos = mClearTimeNanos.load();
+    int32_t numEvents = 0;
+    const char *separator = "\n";
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (ThreadRing *ring = mRings.load(std::memory_order_acquire);
+            ring != nullptr; ring = ring->next) {
+        uint64_t name[kThreadNameLength / sizeof(uint64_t)] = {};
+        for (size_t i = 0; i < kThreadNameLength / sizeof(uint64_t); i++) {
+            name[i] = ring->ownerName[i].load(std::memory_order_relaxed);
+        }
+        char *nameText = reinterpret_cast<char *>(name);
+        nameText[kThreadNameLength - 1] = 0;
+        fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+                      "\"args\":{\"name\":",
+                separator, pid, ring->ownerThreadId.load(std::memory_order_relaxed));
+        writeJsonString(file, nameText);
+        fprintf(file, "}}");
+        separator = ",\n";
+
+        const uint64_t writeCount = ring->events.getWriteCount();
+        const uint64_t capacity = static_cast<uint64_t>(ring->events.getCapacity());
+        const uint64_t firstIndex = (writeCount > capacity) ? writeCount - capacity : 0;
+        for (uint64_t index = firstIndex; index < writeCount; index++) {
+            ThreadRing::Event event;
+            if (!ring->events.read(index, &event)) {
+                continue; // being overwritten by the owner
+            }
+            const int64_t timeNanos = event.timeNanos;
+            const int32_t idAndPhase = event.idAndPhase;
+            const int32_t eventId = idAndPhase >> 1;
+            const char *eventName = (eventId < kMaxEventTypes)
+                    ? mEventNames[eventId].load(std::memory_order_relaxed) : nullptr;
+            if (timeNanos < clearTimeNanos || eventName == nullptr) {
+                continue;
+            }
+            const bool isBegin = (idAndPhase & 1) != 0;
+            fprintf(file, "%s{\"name\":", separator);
+            writeJsonString(file, eventName);
+            // Chrome uses microseconds.
+            fprintf(file, ",\"ph\":\"%c\",\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d",
+                    isBegin ? 'B' : 'E',
+                    static_cast<long long>(timeNanos / kNanosPerMicrosecond),
+                    static_cast<long long>(timeNanos % kNanosPerMicrosecond),
+                    pid, event.threadId);
+            if (isBegin) {
+                fprintf(file, ",\"args\":{\"arg\":%lld}", static_cast<long long>(event.arg));
+            }
+            fprintf(file, "}");
+            numEvents++;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return ferror(file) ? -1 : numEvents;
+}
+
+} // namespace oboe
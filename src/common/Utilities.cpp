@@ -175,6 +175,7 @@ const char *convertToText<AudioApi>(AudioApi audioApi) {
         case AudioApi::Unspecified: return "Unspecified";
         case AudioApi::OpenSLES:    return "OpenSLES";
         case AudioApi::AAudio:      return "AAudio";
+        case AudioApi::Virtual:     return "Virtual";
         default:                    return "Unrecognized audio API";
     }
 }
@@ -21,17 +21,28 @@
 #include "oboe/FifoControllerBase.h"
 #include "fifo/FifoController.h"
 #include "fifo/FifoControllerIndirect.h"
+#include "fifo/FifoControllerSpsc.h"
+#include "fifo/TimestampRing.h"
 #include "oboe/FifoBuffer.h"
 
 namespace oboe {
 
 FifoBuffer::FifoBuffer(uint32_t bytesPerFrame, uint32_t capacityInFrames)
+        : FifoBuffer(bytesPerFrame, capacityInFrames, Mode::Default)
+{
+}
+
+FifoBuffer::FifoBuffer(uint32_t bytesPerFrame, uint32_t capacityInFrames, Mode mode)
         : mBytesPerFrame(bytesPerFrame)
         , mStorage(nullptr)
         , mFramesReadCount(0)
         , mFramesUnderrunCount(0)
 {
-    mFifo = std::make_unique<FifoController>(capacityInFrames);
+    if (mode == Mode::SingleProducerSingleConsumer) {
+        mFifo = std::make_unique<FifoControllerSpsc>(capacityInFrames);
+    } else {
+        mFifo = std::make_unique<FifoController>(capacityInFrames);
+    }
     // allocate buffer
     int32_t bytesPerBuffer = bytesPerFrame * capacityInFrames;
     mStorage = new uint8_t[bytesPerBuffer];
@@ -66,89 +77,84 @@ int32_t FifoBuffer::convertFramesToBytes(int32_t frames) {
     return frames * mBytesPerFrame;
 }
 
+FifoBuffer::Region FifoBuffer::makeRegion(uint32_t index, uint32_t numFrames) {
+    Region region;
+    // The first part runs up to the end of the storage.
+    uint32_t frames1 = std::min(numFrames, mFifo->getFrameCapacity() - index);
+    region.data[0] = &mStorage[convertFramesToBytes(index)];
+    region.numFrames[0] = static_cast<int32_t>(frames1);
+    // The second part, if any, is at the beginning of mStorage.
+    region.data[1] = &mStorage[0];
+    region.numFrames[1] = static_cast<int32_t>(numFrames - frames1);
+    return region;
+}
+
+FifoBuffer::Region FifoBuffer::acquireReadRegion(int32_t maxFrames) {
+    // safe because maxFrames is clipped to be positive
+    uint32_t framesToRead = static_cast<uint32_t>(std::max(0, maxFrames));
+    if (framesToRead > 0) {
+        framesToRead = std::min(framesToRead, mFifo->getFullFramesAvailableToRead(framesToRead));
+    }
+    return makeRegion(mFifo->getReadIndex(), framesToRead);
+}
+
+void FifoBuffer::commitRead(int32_t numFrames) {
+    if (numFrames > 0) {
+        mFifo->advanceReadIndex(static_cast<uint32_t>(numFrames));
+    }
+}
+
+FifoBuffer::Region FifoBuffer::acquireWriteRegion(int32_t maxFrames) {
+    uint32_t framesToWrite = static_cast<uint32_t>(std::max(0, maxFrames));
+    if (framesToWrite > 0) {
+        framesToWrite = std::min(framesToWrite,
+                                 mFifo->getEmptyFramesAvailableToWrite(framesToWrite));
+    }
+    return makeRegion(mFifo->getWriteIndex(), framesToWrite);
+}
+
+void FifoBuffer::commitWrite(int32_t numFrames) {
+    if (numFrames > 0) {
+        mFifo->advanceWriteIndex(static_cast<uint32_t>(numFrames));
+    }
+}
+
 int32_t FifoBuffer::read(void *buffer, int32_t numFrames) {
     if (numFrames <= 0) {
         return 0;
     }
-    // safe because numFrames is guaranteed positive
-    uint32_t framesToRead = static_cast<uint32_t>(numFrames);
-    uint32_t framesAvailable = mFifo->getFullFramesAvailable();
-    framesToRead = std::min(framesToRead, framesAvailable);
-
-    uint32_t readIndex = mFifo->getReadIndex(); // ranges 0 to capacity
+    Region region = acquireReadRegion(numFrames);
     uint8_t *destination = reinterpret_cast<uint8_t *>(buffer);
-    uint8_t *source = &mStorage[convertFramesToBytes(readIndex)];
-    if ((readIndex + framesToRead) > mFifo->getFrameCapacity()) {
-        // read in two parts, first part here is at the end of the mStorage buffer
-        int32_t frames1 = static_cast<int32_t>(mFifo->getFrameCapacity() - readIndex);
-        int32_t numBytes = convertFramesToBytes(frames1);
+    for (int part = 0; part < 2; part++) {
+        int32_t numBytes = convertFramesToBytes(region.numFrames[part]);
         if (numBytes < 0) {
             return static_cast<int32_t>(Result::ErrorOutOfRange);
         }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
+        memcpy(destination, region.data[part], static_cast<size_t>(numBytes));
         destination += numBytes;
-        // read second part, which is at the beginning of mStorage
-        source = &mStorage[0];
-        int32_t frames2 = static_cast<uint32_t>(framesToRead - frames1);
-        numBytes = convertFramesToBytes(frames2);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
-    } else {
-        // just read in one shot
-        int32_t numBytes = convertFramesToBytes(framesToRead);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
     }
-    mFifo->advanceReadIndex(framesToRead);
-
-    return framesToRead;
+    int32_t framesRead = region.getTotalFrames();
+    commitRead(framesRead);
+    return framesRead;
 }
 
 int32_t FifoBuffer::write(const void *buffer, int32_t numFrames) {
     if (numFrames <= 0) {
         return 0;
     }
-    // Guaranteed positive.
-    uint32_t framesToWrite = static_cast<uint32_t>(numFrames);
-    uint32_t framesAvailable = mFifo->getEmptyFramesAvailable();
-    framesToWrite = std::min(framesToWrite, framesAvailable);
-
-    uint32_t writeIndex = mFifo->getWriteIndex();
-    int byteIndex = convertFramesToBytes(writeIndex);
+    Region region = acquireWriteRegion(numFrames);
     const uint8_t *source = reinterpret_cast<const uint8_t *>(buffer);
-    uint8_t *destination = &mStorage[byteIndex];
-    if ((writeIndex + framesToWrite) > mFifo->getFrameCapacity()) {
-        // write in two parts, first part here
-        int32_t frames1 = static_cast<uint32_t>(mFifo->getFrameCapacity() - writeIndex);
-        int32_t numBytes = convertFramesToBytes(frames1);
+    for (int part = 0; part < 2; part++) {
+        int32_t numBytes = convertFramesToBytes(region.numFrames[part]);
         if (numBytes < 0) {
             return static_cast<int32_t>(Result::ErrorOutOfRange);
         }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
-        // read second part
-        source += convertFramesToBytes(frames1);
-        destination = &mStorage[0];
-        int frames2 = static_cast<uint32_t>(framesToWrite - frames1);
-        numBytes = convertFramesToBytes(frames2);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
-    } else {
-        // just write in one shot
-        int32_t numBytes = convertFramesToBytes(framesToWrite);
-        if (numBytes < 0) {
-            return static_cast<int32_t>(Result::ErrorOutOfRange);
-        }
-        memcpy(destination, source, static_cast<size_t>(numBytes));
+        memcpy(region.data[part], source, static_cast<size_t>(numBytes));
+        source += numBytes;
     }
-    mFifo->advanceWriteIndex(framesToWrite);
-
-    return framesToWrite;
+    int32_t framesWritten = region.getTotalFrames();
+    commitWrite(framesWritten);
+    return framesWritten;
 }
 
 int32_t FifoBuffer::readNow(void *buffer, int32_t numFrames) {
@@ -175,4 +181,38 @@ uint32_t FifoBuffer::getBufferCapacityInFrames() const {
     return mFifo->getFrameCapacity();
 }
 
+void FifoBuffer::enableTimestamps(int32_t maxTimestamps) {
+    mTimestamps = std::make_unique<TimestampRing>(maxTimestamps);
+}
+
+void FifoBuffer::writeTimestamp(uint64_t frameCounter, int64_t timeNanoseconds) {
+    if (mTimestamps) {
+        mTimestamps->write(static_cast<int64_t>(frameCounter), timeNanoseconds);
+    }
+}
+
+Result FifoBuffer::getTimestamp(uint64_t frameCounter,
+                                int32_t sampleRate,
+                                int64_t *timeNanoseconds) const {
+    if (sampleRate <= 0) {
+        return Result::ErrorInvalidRate;
+    }
+    double nanosPerFrame = static_cast<double>(kNanosPerSecond) / sampleRate;
+    if (mTimestamps && mTimestamps->interpolate(static_cast<int64_t>(frameCounter),
+                                                nanosPerFrame, timeNanoseconds)) {
+        return Result::OK;
+    }
+    return Result::ErrorUnavailable;
+}
+
+Result FifoBuffer::getLatestTimestamp(FrameTimestamp *timestamp) const {
+    TimestampRing::Entry entry;
+    if (mTimestamps && mTimestamps->getLatest(&entry)) {
+        timestamp->position = entry.position;
+        timestamp->timestamp = entry.value;
+        return Result::OK;
+    }
+    return Result::ErrorUnavailable;
+}
+
 } // namespace oboe
@@ -24,14 +24,23 @@ namespace oboe {
 
 FifoControllerBase::FifoControllerBase(uint32_t capacityInFrames)
         : mTotalFrames(capacityInFrames)
+        , mIndexMask(0)
 {
     // Avoid ridiculously large buffers and the arithmetic wraparound issues that can follow.
     assert(capacityInFrames <= (UINT32_MAX / 4));
+    if (capacityInFrames > 1 && (capacityInFrames & (capacityInFrames - 1)) == 0) {
+        mIndexMask = capacityInFrames - 1;
+    }
 }
 
 uint32_t FifoControllerBase::getFullFramesAvailable() const {
     uint64_t writeCounter =  getWriteCounter();
     uint64_t readCounter = getReadCounter();
+    return getFramesBetween(readCounter, writeCounter);
+}
+
+uint32_t FifoControllerBase::getFramesBetween(uint64_t readCounter,
+                                              uint64_t writeCounter) const {
     if (readCounter > writeCounter) {
         return 0;
     }
@@ -44,6 +53,9 @@ uint32_t FifoControllerBase::getFullFramesAvailable() const {
 }
 
 uint32_t FifoControllerBase::getReadIndex() const {
+    if (mIndexMask != 0) {
+        return static_cast<uint32_t>(getReadCounter() & mIndexMask);
+    }
     // % works with non-power of two sizes
     return static_cast<uint32_t>(getReadCounter() % mTotalFrames);
 }
@@ -57,6 +69,9 @@ uint32_t FifoControllerBase::getEmptyFramesAvailable() const {
 }
 
 uint32_t FifoControllerBase::getWriteIndex() const {
+    if (mIndexMask != 0) {
+        return static_cast<uint32_t>(getWriteCounter() & mIndexMask);
+    }
     // % works with non-power of two sizes
     return static_cast<uint32_t>(getWriteCounter() % mTotalFrames);
 }
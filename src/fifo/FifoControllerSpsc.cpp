@@ -0,0 +1,51 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdint.h>
+
+#include "FifoControllerSpsc.h"
+
+namespace oboe {
+
+FifoControllerSpsc::FifoControllerSpsc(uint32_t numFrames)
+        : FifoControllerBase(numFrames)
+{
+}
+
+uint32_t FifoControllerSpsc::getFullFramesAvailableToRead(uint32_t framesWanted) {
+    uint64_t readCounter = mReadCounter.load(std::memory_order_relaxed);
+    uint32_t framesAvailable = getFramesBetween(readCounter, mCachedWriteCounter);
+    if (framesAvailable < framesWanted) {
+        // Acquire so that we see the data written before the counter.
+        mCachedWriteCounter = mWriteCounter.load(std::memory_order_acquire);
+        framesAvailable = getFramesBetween(readCounter, mCachedWriteCounter);
+    }
+    return framesAvailable;
+}
+
+uint32_t FifoControllerSpsc::getEmptyFramesAvailableToWrite(uint32_t framesWanted) {
+    uint64_t writeCounter = mWriteCounter.load(std::memory_order_relaxed);
+    uint32_t framesAvailable = getFrameCapacity()
+            - getFramesBetween(mCachedReadCounter, writeCounter);
+    if (framesAvailable < framesWanted) {
+        // Acquire so that the reader has finished with the data before we overwrite it.
+        mCachedReadCounter = mReadCounter.load(std::memory_order_acquire);
+        framesAvailable = getFrameCapacity() - getFramesBetween(mCachedReadCounter, writeCounter);
+    }
+    return framesAvailable;
+}
+
+} // namespace oboe
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NATIVEOBOE_FIFOCONTROLLERSPSC_H
+#define NATIVEOBOE_FIFOCONTROLLERSPSC_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include "oboe/FifoControllerBase.h"
+
+namespace oboe {
+
+/**
+ * A FifoController for exactly one reading thread and one writing thread.
+ *
+ * Each counter is only modified by its own thread, so it can be advanced with a plain
+ * release store instead of an atomic read-modify-write.
+ * The counters are on separate cache lines so the two threads do not contend for one line.
+ * Each thread keeps a copy of the other thread's counter next to its own counter,
+ * and only reloads it when the copy says there is not enough data or space.
+ *
+ * The read counter must only be set or advanced by the reader, and the write counter by the
+ * writer. Counters must not move backwards while the other thread is using the FIFO.
+ */
+class FifoControllerSpsc : public FifoControllerBase
+{
+public:
+    FifoControllerSpsc(uint32_t bufferSize);
+    virtual ~FifoControllerSpsc() = default;
+
+    uint32_t getFullFramesAvailableToRead(uint32_t framesWanted) override;
+    uint32_t getEmptyFramesAvailableToWrite(uint32_t framesWanted) override;
+
+    virtual uint64_t getReadCounter() const override {
+        return mReadCounter.load(std::memory_order_acquire);
+    }
+    virtual void setReadCounter(uint64_t n) override {
+        mReadCounter.store(n, std::memory_order_release);
+    }
+    virtual void incrementReadCounter(uint64_t n) override {
+        // Only the reader modifies the read counter.
+        uint64_t readCounter = mReadCounter.load(std::memory_order_relaxed);
+        mReadCounter.store(readCounter + n, std::memory_order_release);
+    }
+    virtual uint64_t getWriteCounter() const override {
+        return mWriteCounter.load(std::memory_order_acquire);
+    }
+    virtual void setWriteCounter(uint64_t n) override {
+        mWriteCounter.store(n, std::memory_order_release);
+    }
+    virtual void incrementWriteCounter(uint64_t n) override {
+        // Only the writer modifies the write counter.
+        uint64_t writeCounter = mWriteCounter.load(std::memory_order_relaxed);
+        mWriteCounter.store(writeCounter + n, std::memory_order_release);
+    }
+
+private:
+    static constexpr int kCacheLineSize = 64; // for most Android CPUs
+
+    // Used by the reader.
+    alignas(kCacheLineSize) std::atomic<uint64_t> mReadCounter{};
+    uint64_t mCachedWriteCounter = 0;
+
+    // Used by the writer.
+    alignas(kCacheLineSize) std::atomic<uint64_t> mWriteCounter{};
+    uint64_t mCachedReadCounter = 0;
+};
+
+} // namespace oboe
+
+#endif //NATIVEOBOE_FIFOCONTROLLERSPSC_H
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "oboe/AudioStream.h"
+#include "oboe/FifoBuffer.h"
+#include "oboe/MixingFifo.h"
+
+namespace oboe {
+
+// Keep each lane on its own cache lines because different producers write to them.
+struct alignas(64) MixingFifo::Lane {
+    enum State : int32_t {
+        Free,
+        Opening, // claimed by openLane() but not ready yet
+        Open,
+        Closing, // mixed until it is empty, then freed by mix()
+    };
+
+    std::atomic<int32_t> state{Free};
+    std::atomic<float> gain{1.0f};
+    std::atomic<int32_t> underrunCount{0};
+    std::unique_ptr<FifoBuffer> fifo;
+    bool started = false; // only used by mix()
+};
+
+MixingFifo::MixingFifo(int32_t channelCount, int32_t capacityInFrames, int32_t maxLanes)
+        : mChannelCount(channelCount)
+        , mCapacityInFrames(capacityInFrames)
+        , mMaxLanes(maxLanes)
+        , mLanes(new Lane[maxLanes]) {
+    for (int32_t i = 0; i < mMaxLanes; i++) {
+        mLanes[i].fifo = std::make_unique<FifoBuffer>(
+                static_cast<uint32_t>(channelCount * sizeof(float)),
+                static_cast<uint32_t>(capacityInFrames),
+                FifoBuffer::Mode::SingleProducerSingleConsumer);
+    }
+}
+
+MixingFifo::~MixingFifo() = default;
+
+ResultWithValue<int32_t> MixingFifo::openLane() {
+    for (int32_t i = 0; i < mMaxLanes; i++) {
+        Lane &lane = mLanes[i];
+        int32_t expected = Lane::Free;
+        if (lane.state.compare_exchange_strong(expected, Lane::Opening,
+                                               std::memory_order_acquire)) {
+            lane.gain.store(1.0f, std::memory_order_relaxed);
+            lane.underrunCount.store(0, std::memory_order_relaxed);
+            lane.state.store(Lane::Open, std::memory_order_release);
+            return ResultWithValue<int32_t>(i);
+        }
+    }
+    return ResultWithValue<int32_t>(Result::ErrorNoFreeHandles);
+}
+
+void MixingFifo::closeLane(int32_t lane) {
+    if (isValidLane(lane)) {
+        int32_t expected = Lane::Open;
+        mLanes[lane].state.compare_exchange_strong(expected, Lane::Closing,
+                                                   std::memory_order_release);
+    }
+}
+
+int32_t MixingFifo::write(int32_t lane, const float *buffer, int32_t numFrames) {
+    if (!isValidLane(lane)) {
+        return static_cast<int32_t>(Result::ErrorOutOfRange);
+    }
+    return mLanes[lane].fifo->write(buffer, numFrames);
+}
+
+int32_t MixingFifo::getEmptyFramesAvailable(int32_t lane) const {
+    if (!isValidLane(lane)) {
+        return static_cast<int32_t>(Result::ErrorOutOfRange);
+    }
+    return mCapacityInFrames - static_cast<int32_t>(mLanes[lane].fifo->getFullFramesAvailable());
+}
+
+void MixingFifo::setGain(int32_t lane, float gain) {
+    if (isValidLane(lane)) {
+        mLanes[lane].gain.store(gain, std::memory_order_relaxed);
+    }
+}
+
+int32_t MixingFifo::getUnderrunCount(int32_t lane) const {
+    if (!isValidLane(lane)) {
+        return static_cast<int32_t>(Result::ErrorOutOfRange);
+    }
+    return mLanes[lane].underrunCount.load(std::memory_order_relaxed);
+}
+
+int32_t MixingFifo::mix(float *output, int32_t numFrames) {
+    const int32_t numSamples = numFrames * mChannelCount;
+    for (int32_t i = 0; i < numSamples; i++) {
+        output[i] = 0.0f;
+    }
+    int32_t lanesMixed = 0;
+    for (int32_t i = 0; i < mMaxLanes; i++) {
+        Lane &lane = mLanes[i];
+        const int32_t state = lane.state.load(std::memory_order_acquire);
+        if (state != Lane::Open && state != Lane::Closing) {
+            continue;
+        }
+        FifoBuffer::Region region = lane.fifo->acquireReadRegion(numFrames);
+        const int32_t framesRead = region.getTotalFrames();
+        if (framesRead > 0) {
+            const float gain = lane.gain.load(std::memory_order_relaxed);
+            float *destination = output;
+            for (int part = 0; part < 2; part++) {
+                const float *source = reinterpret_cast<const float *>(region.data[part]);
+                const int32_t partSamples = region.numFrames[part] * mChannelCount;
+                for (int32_t sample = 0; sample < partSamples; sample++) {
+                    destination[sample] += gain * source[sample];
+                }
+                destination += partSamples;
+            }
+            lane.fifo->commitRead(framesRead);
+            lane.started = true;
+            lanesMixed++;
+        }
+        if (framesRead < numFrames) {
+            if (state == Lane::Closing) {
+                // The producer has finished and everything it wrote has been mixed.
+                lane.started = false;
+                lane.state.store(Lane::Free, std::memory_order_release);
+            } else if (lane.started) {
+                // Only mix() changes the count so it does not need an atomic increment.
+                lane.underrunCount.store(lane.underrunCount.load(std::memory_order_relaxed) + 1,
+                                         std::memory_order_relaxed);
+            }
+        }
+    }
+    return lanesMixed;
+}
+
+DataCallbackResult MixingFifo::onAudioReady(AudioStream *audioStream,
+                                            void *audioData,
+                                            int32_t numFrames) {
+    if (audioStream->getFormat() != AudioFormat::Float
+            || audioStream->getChannelCount() != mChannelCount) {
+        return DataCallbackResult::Stop;
+    }
+    mix(static_cast<float *>(audioData), numFrames);
+    return DataCallbackResult::Continue;
+}
+
+} // namespace oboe
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_SEQUENCED_RING_H
+#define OBOE_SEQUENCED_RING_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdint.h>
+#include <type_traits>
+
+namespace oboe {
+
+/**
+ * A ring of small records that one thread writes and any thread can read without blocking.
+ *
+ * Each slot is protected by a sequence count, which is odd while the slot is being written.
+ * A reader copies the record and then checks that the count did not change,
+ * so it never returns a record that is half written. The count also tells the reader
+ * which record is in the slot, so a slot that was overwritten by a newer record
+ * is not returned in place of an older one.
+ * When the ring is full the oldest records are overwritten.
+ *
+ * The records are stored as atomic words so a reader that races with the writer
+ * is not a data race. T must be trivially copyable.
+ */
+template <typename T>
+class SequencedRing {
+public:
+    static_assert(std::is_trivially_copyable<T>::value, "records are copied as words");
+
+    /**
+     * @param capacity maximum number of records kept, rounded up to a power of two
+     */
+    explicit SequencedRing(int32_t capacity) {
+        uint32_t size = 1;
+        mIndexShift = 0;
+        while (size < static_cast<uint32_t>(std::max(capacity, 1))) {
+            size <<= 1;
+            mIndexShift++;
+        }
+        mSlots = std::make_unique<Slot[]>(size);
+        mIndexMask = size - 1;
+    }
+
+    int32_t getCapacity() const {
+        return static_cast<int32_t>(mIndexMask + 1);
+    }
+
+    /**
+     * @return number of records written, including those that have been overwritten
+     */
+    uint64_t getWriteCount() const {
+        return mWriteCount.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Add a record. This must only be called by one thread.
+     */
+    void write(const T &record) {
+        uint64_t words[kNumWords] = {};
+        memcpy(words, &record, sizeof(T));
+        uint64_t count = mWriteCount.load(std::memory_order_relaxed);
+        Slot &slot = mSlots[count & mIndexMask];
+        uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        // The release stores make sure a reader sees the odd sequence before any of the new data.
+        for (size_t i = 0; i < kNumWords; i++) {
+            slot.words[i].store(words[i], std::memory_order_release);
+        }
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        mWriteCount.store(count + 1, std::memory_order_release);
+    }
+
+    /**
+     * Read the record with an index below getWriteCount().
+     *
+     * @return false if the record has been overwritten or is being overwritten
+     */
+    bool read(uint64_t index, T *record) const {
+        const Slot &slot = mSlots[index & mIndexMask];
+        uint32_t sequenceBefore = slot.sequence.load(std::memory_order_acquire);
+        // Each write adds two, so this is the count after the write of this index.
+        const uint32_t expectedSequence = static_cast<uint32_t>((index >> mIndexShift) + 1) * 2;
+        if (sequenceBefore != expectedSequence) {
+            return false;
+        }
+        uint64_t words[kNumWords];
+        for (size_t i = 0; i < kNumWords; i++) {
+            words[i] = slot.words[i].load(std::memory_order_acquire);
+        }
+        // The acquire loads make sure the data is read before checking the sequence again.
+        if (slot.sequence.load(std::memory_order_relaxed) != sequenceBefore) {
+            return false;
+        }
+        memcpy(record, words, sizeof(T));
+        return true;
+    }
+
+    /**
+     * Copy up to maxRecords of the most recent records, oldest first,
+     * skipping any that are being overwritten.
+     *
+     * @return number of records copied
+     */
+    int32_t readLatest(T *records, int32_t maxRecords) const {
+        uint64_t count = getWriteCount();
+        uint64_t numRecords = std::min<uint64_t>(count, mIndexMask + 1);
+        numRecords = std::min<uint64_t>(numRecords, static_cast<uint64_t>(std::max(maxRecords, 0)));
+        int32_t numCopied = 0;
+        for (uint64_t index = count - numRecords; index < count; index++) {
+            if (read(index, &records[numCopied])) {
+                numCopied++;
+            }
+        }
+        return numCopied;
+    }
+
+private:
+    static constexpr size_t kNumWords = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    struct Slot {
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<uint64_t> words[kNumWords] = {};
+    };
+
+    std::unique_ptr<Slot[]> mSlots;
+    uint32_t                mIndexMask;
+    uint32_t                mIndexShift; // log2 of the capacity
+    std::atomic<uint64_t>   mWriteCount{0};
+};
+
+} // namespace oboe
+
+#endif //OBOE_SEQUENCED_RING_H
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "common/OboeDebug.h"
+#include "oboe/SharedMemoryFifo.h"
+#include "oboe/Utilities.h"
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC 0x0001U
+#endif
+#ifndef MFD_ALLOW_SEALING
+#define MFD_ALLOW_SEALING 0x0002U
+#endif
+#ifndef F_ADD_SEALS
+#define F_ADD_SEALS   1033
+#define F_GET_SEALS   1034
+#define F_SEAL_SEAL   0x0001
+#define F_SEAL_SHRINK 0x0002
+#define F_SEAL_GROW   0x0004
+#endif
+
+namespace oboe {
+
+constexpr uint32_t kSharedFifoMagic = 0x4F424646; // "OBFF"
+constexpr uint32_t kSharedFifoVersion = 1;
+constexpr size_t kCacheLineSize = 64; // for most Android CPUs
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free,
+              "the counters must be lock free to work between processes");
+
+/**
+ * Layout of the start of the shared memory.
+ * Both processes must use the same layout, so change kSharedFifoVersion if this changes.
+ */
+struct SharedMemoryFifoHeader {
+    uint32_t magic;
+    uint32_t version;
+    int32_t format;
+    int32_t channelCount;
+    uint32_t bytesPerFrame;
+    uint32_t capacityInFrames;
+    uint64_t dataOffset; // from the start of the header
+
+    // Each counter is on its own cache line.
+    alignas(kCacheLineSize) std::atomic<uint64_t> readCounter;
+    alignas(kCacheLineSize) std::atomic<uint64_t> writeCounter;
+};
+
+// The data starts on the cache line after the header.
+constexpr size_t kDataOffset = ((sizeof(SharedMemoryFifoHeader) + kCacheLineSize - 1)
+        / kCacheLineSize) * kCacheLineSize;
+
+SharedMemoryFifo::~SharedMemoryFifo() {
+    mFifoBuffer.reset();
+    if (mMemory != nullptr) {
+        munmap(mMemory, mSizeInBytes);
+    }
+    if (mFileDescriptor >= 0) {
+        close(mFileDescriptor);
+    }
+}
+
+Result SharedMemoryFifo::create(AudioFormat format,
+                                int32_t channelCount,
+                                int32_t capacityInFrames,
+                                std::unique_ptr<SharedMemoryFifo> &fifo) {
+    int32_t bytesPerSample = convertFormatToSizeInBytes(format);
+    if (bytesPerSample <= 0 || channelCount <= 0) {
+        return Result::ErrorInvalidFormat;
+    }
+    // Same limit as FifoControllerBase.
+    const uint64_t bytesPerFrame = static_cast<uint64_t>(bytesPerSample) * channelCount;
+    if (capacityInFrames <= 0
+            || static_cast<uint64_t>(capacityInFrames) > (UINT32_MAX / 4)
+            || bytesPerFrame * capacityInFrames > INT32_MAX) {
+        return Result::ErrorOutOfRange;
+    }
+    const size_t sizeInBytes = kDataOffset + (bytesPerFrame * capacityInFrames);
+
+    // memfd_create() is not in older NDK headers so call it directly.
+    int fd = static_cast<int>(syscall(SYS_memfd_create, "oboe_fifo",
+                                      MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (fd < 0) {
+        LOGE("SharedMemoryFifo::%s() memfd_create() failed, errno = %d", __func__, errno);
+        return Result::ErrorNoMemory;
+    }
+    if (ftruncate(fd, static_cast<off_t>(sizeInBytes)) < 0) {
+        LOGE("SharedMemoryFifo::%s() ftruncate() failed, errno = %d", __func__, errno);
+        close(fd);
+        return Result::ErrorNoMemory;
+    }
+    // The other process must not be able to shrink the memory under us.
+    if (fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        LOGE("SharedMemoryFifo::%s() F_ADD_SEALS failed, errno = %d", __func__, errno);
+        close(fd);
+        return Result::ErrorInternal;
+    }
+
+    std::unique_ptr<SharedMemoryFifo> newFifo(new SharedMemoryFifo());
+    newFifo->mFileDescriptor = fd;
+    uint8_t *memory = static_cast<uint8_t *>(mmap(nullptr, sizeInBytes,
+            PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    if (memory == MAP_FAILED) {
+        LOGE("SharedMemoryFifo::%s() mmap() failed, errno = %d", __func__, errno);
+        return Result::ErrorNoMemory;
+    }
+    newFifo->mMemory = memory;
+    newFifo->mSizeInBytes = sizeInBytes;
+
+    SharedMemoryFifoHeader *header = new (memory) SharedMemoryFifoHeader;
+    header->version = kSharedFifoVersion;
+    header->format = static_cast<int32_t>(format);
+    header->channelCount = channelCount;
+    header->bytesPerFrame = static_cast<uint32_t>(bytesPerFrame);
+    header->capacityInFrames = static_cast<uint32_t>(capacityInFrames);
+    header->dataOffset = kDataOffset;
+    header->readCounter.store(0);
+    header->writeCounter.store(0);
+    header->magic = kSharedFifoMagic;
+
+    newFifo->mFormat = format;
+    newFifo->mChannelCount = channelCount;
+    newFifo->mFifoBuffer = std::make_unique<FifoBuffer>(header->bytesPerFrame,
+                                                        header->capacityInFrames,
+                                                        &header->readCounter,
+                                                        &header->writeCounter,
+                                                        memory + kDataOffset);
+    fifo = std::move(newFifo);
+    return Result::OK;
+}
+
+Result SharedMemoryFifo::attach(int fileDescriptor, std::unique_ptr<SharedMemoryFifo> &fifo) {
+    // If the memory could shrink then touching the FIFO would crash with SIGBUS.
+    int seals = fcntl(fileDescriptor, F_GET_SEALS);
+    if (seals < 0) {
+        LOGE("SharedMemoryFifo::%s() F_GET_SEALS failed, errno = %d", __func__, errno);
+        return Result::ErrorInvalidHandle;
+    }
+    if ((seals & F_SEAL_SHRINK) == 0) {
+        LOGE("SharedMemoryFifo::%s() the memory is not sealed against shrinking", __func__);
+        return Result::ErrorInvalidHandle;
+    }
+    struct stat status;
+    if (fstat(fileDescriptor, &status) < 0) {
+        LOGE("SharedMemoryFifo::%s() fstat() failed, errno = %d", __func__, errno);
+        return Result::ErrorInvalidHandle;
+    }
+    const size_t sizeInBytes = static_cast<size_t>(status.st_size);
+    if (sizeInBytes < kDataOffset) {
+        return Result::ErrorInvalidFormat;
+    }
+    uint8_t *memory = static_cast<uint8_t *>(mmap(nullptr, sizeInBytes,
+            PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0));
+    if (memory == MAP_FAILED) {
+        LOGE("SharedMemoryFifo::%s() mmap() failed, errno = %d", __func__, errno);
+        return Result::ErrorNoMemory;
+    }
+    std::unique_ptr<SharedMemoryFifo> newFifo(new SharedMemoryFifo());
+    newFifo->mMemory = memory;
+    newFifo->mSizeInBytes = sizeInBytes;
+
+    // Copy the fields so the other process cannot change them after they are checked.
+    SharedMemoryFifoHeader *header = reinterpret_cast<SharedMemoryFifoHeader *>(memory);
+    const uint32_t magic = header->magic;
+    const uint32_t version = header->version;
+    const AudioFormat format = static_cast<AudioFormat>(header->format);
+    const int32_t channelCount = header->channelCount;
+    const uint32_t bytesPerFrame = header->bytesPerFrame;
+    const uint32_t capacityInFrames = header->capacityInFrames;
+    const uint64_t dataOffset = header->dataOffset;
+    if (magic != kSharedFifoMagic || version != kSharedFifoVersion) {
+        LOGE("SharedMemoryFifo::%s() not a FIFO or a different version", __func__);
+        return Result::ErrorInvalidFormat;
+    }
+    const int32_t bytesPerSample = convertFormatToSizeInBytes(format);
+    const uint64_t dataBytes = static_cast<uint64_t>(bytesPerFrame) * capacityInFrames;
+    if (bytesPerSample <= 0 || channelCount <= 0
+            || bytesPerFrame != static_cast<uint64_t>(bytesPerSample) * channelCount
+            || capacityInFrames == 0 || capacityInFrames > (UINT32_MAX / 4)
+            || dataOffset != kDataOffset || dataOffset + dataBytes > sizeInBytes) {
+        LOGE("SharedMemoryFifo::%s() header does not match the memory size", __func__);
+        return Result::ErrorInvalidFormat;
+    }
+
+    newFifo->mFormat = format;
+    newFifo->mChannelCount = channelCount;
+    newFifo->mFifoBuffer = std::make_unique<FifoBuffer>(bytesPerFrame,
+                                                        capacityInFrames,
+                                                        &header->readCounter,
+                                                        &header->writeCounter,
+                                                        memory + dataOffset);
+    fifo = std::move(newFifo);
+    return Result::OK;
+}
+
+} // namespace oboe
@@ -0,0 +1,62 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+
+#include "fifo/TimestampRing.h"
+
+namespace oboe {
+
+TimestampRing::TimestampRing(int32_t capacity)
+        : mRing(capacity) {
+}
+
+void TimestampRing::write(int64_t position, int64_t value) {
+    mRing.write(Entry{position, value});
+}
+
+bool TimestampRing::getLatest(Entry *entry) const {
+    uint64_t count = mRing.getWriteCount();
+    // The writer cannot overwrite the newest slot without first adding another pair.
+    return count > 0 && mRing.read(count - 1, entry);
+}
+
+bool TimestampRing::interpolate(int64_t position, double valuePerFrame, int64_t *value) const {
+    uint64_t count = mRing.getWriteCount();
+    uint64_t numSlots = static_cast<uint64_t>(mRing.getCapacity());
+    uint64_t oldest = (count > numSlots) ? count - numSlots : 0;
+    Entry entry{};
+    bool found = false;
+    // Search from the newest pair back to the oldest.
+    for (uint64_t index = count; index > oldest; index--) {
+        Entry candidate;
+        if (!mRing.read(index - 1, &candidate)) {
+            continue; // overwritten while we were looking
+        }
+        entry = candidate;
+        found = true;
+        if (candidate.position <= position) {
+            break;
+        }
+    }
+    if (found) {
+        double offset = static_cast<double>(position - entry.position) * valuePerFrame;
+        *value = entry.value + static_cast<int64_t>(std::llround(offset));
+    }
+    return found;
+}
+
+} // namespace oboe
@@ -0,0 +1,75 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_TIMESTAMP_RING_H
+#define OBOE_TIMESTAMP_RING_H
+
+#include <stdint.h>
+
+#include "fifo/SequencedRing.h"
+
+namespace oboe {
+
+/**
+ * A small ring of (framePosition, value) pairs that travels next to a stream of audio data.
+ * The value is usually a time in nanoseconds, or the matching frame position
+ * in another stream, for example on the other side of a sample rate converter.
+ *
+ * One thread writes a pair per burst, with increasing positions.
+ * Any thread may look up a position. The lookup does not block and never sees
+ * a pair that is half written. When the ring is full the oldest pairs are overwritten.
+ */
+class TimestampRing {
+public:
+    struct Entry {
+        int64_t position;
+        int64_t value;
+    };
+
+    /**
+     * @param capacity maximum number of pairs kept, rounded up to a power of two
+     */
+    explicit TimestampRing(int32_t capacity);
+
+    /**
+     * Add a pair. This must only be called by one thread.
+     */
+    void write(int64_t position, int64_t value);
+
+    /**
+     * @param entry receives the most recent pair
+     * @return true if there was a pair
+     */
+    bool getLatest(Entry *entry) const;
+
+    /**
+     * Calculate the value for a position from the newest pair at or before that position.
+     * If the position is older than every pair then the oldest pair is used.
+     *
+     * @param position frame position to look up
+     * @param valuePerFrame how much the value changes for each frame
+     * @param value receives the calculated value
+     * @return true if there was a pair to calculate from
+     */
+    bool interpolate(int64_t position, double valuePerFrame, int64_t *value) const;
+
+private:
+    SequencedRing<Entry> mRing;
+};
+
+} // namespace oboe
+
+#endif //OBOE_TIMESTAMP_RING_H
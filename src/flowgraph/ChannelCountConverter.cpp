@@ -22,9 +22,10 @@ using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
 ChannelCountConverter::ChannelCountConverter(
         int32_t inputChannelCount,
-        int32_t outputChannelCount)
-        : input(*this, inputChannelCount)
-        , output(*this, outputChannelCount) {
+        int32_t outputChannelCount,
+        int32_t framesPerBuffer)
+        : input(*this, inputChannelCount, framesPerBuffer)
+        , output(*this, outputChannelCount, framesPerBuffer) {
 }
 
 ChannelCountConverter::~ChannelCountConverter() { }
@@ -34,6 +35,9 @@ int32_t ChannelCountConverter::onProcess(int32_t numFrames) {
     float *outputBuffer = output.getBuffer();
     int32_t inputChannelCount = input.getSamplesPerFrame();
     int32_t outputChannelCount = output.getSamplesPerFrame();
+    if (inputBuffer == outputBuffer && inputChannelCount == outputChannelCount) {
+        return numFrames; // Sharing a buffer with the same channel count so nothing to copy.
+    }
     for (int i = 0; i < numFrames; i++) {
         int inputChannel = 0;
         for (int outputChannel = 0; outputChannel < outputChannelCount; outputChannel++) {
@@ -34,12 +34,18 @@ namespace flowgraph {
     public:
         explicit ChannelCountConverter(
                 int32_t inputChannelCount,
-                int32_t outputChannelCount);
+                int32_t outputChannelCount,
+                int32_t framesPerBuffer = kDefaultBufferSize);
 
         virtual ~ChannelCountConverter();
 
         int32_t onProcess(int32_t numFrames) override;
 
+        bool canProcessInPlace() const override {
+            // Dropping channels only writes samples that have already been read.
+            return input.getSamplesPerFrame() >= output.getSamplesPerFrame();
+        }
+
         const char *getName() override {
             return "ChannelCountConverter";
         }
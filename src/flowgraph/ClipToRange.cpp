@@ -21,8 +21,8 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-ClipToRange::ClipToRange(int32_t channelCount)
-        : FlowGraphFilter(channelCount) {
+ClipToRange::ClipToRange(int32_t channelCount, int32_t framesPerBuffer)
+        : FlowGraphFilter(channelCount, framesPerBuffer) {
 }
 
 int32_t ClipToRange::onProcess(int32_t numFrames) {
@@ -33,12 +33,16 @@ constexpr float kDefaultMinHeadroom = -kDefaultMaxHeadroom;
 
 class ClipToRange : public FlowGraphFilter {
 public:
-    explicit ClipToRange(int32_t channelCount);
+    explicit ClipToRange(int32_t channelCount, int32_t framesPerBuffer = kDefaultBufferSize);
 
     virtual ~ClipToRange() = default;
 
     int32_t onProcess(int32_t numFrames) override;
 
+    bool canProcessInPlace() const override {
+        return true;
+    }
+
     void setMinimum(float min) {
         mMinimum = min;
     }
@@ -0,0 +1,218 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <sys/types.h>
+
+#include "FlowGraph.h"
+
+using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
+
+/***************************************************************************/
+int32_t FlowGraphExecutionPlan::execute(int64_t callCount, int32_t numFrames) {
+    int32_t frameCount = 0;
+    for (Step &step : mSteps) {
+        FlowGraphNode *node = step.node;
+        // Same rules as FlowGraphNode::pullData() so the two can be mixed.
+        if (callCount > node->mLastCallCount) {
+            node->mLastCallCount = callCount;
+            frameCount = std::min(numFrames, step.maxFrames);
+            const int32_t *inputSteps = mInputSteps.data() + step.firstInputStep;
+            for (int32_t i = 0; i < step.numInputSteps; i++) {
+                frameCount = std::min(frameCount, mSteps[inputSteps[i]].framesProcessed);
+            }
+            if (frameCount > 0) {
+                frameCount = node->onProcess(frameCount);
+            }
+            node->mLastFrameCount = frameCount;
+        } else {
+            frameCount = node->mLastFrameCount;
+        }
+        step.framesProcessed = frameCount;
+    }
+    return frameCount;
+}
+
+/***************************************************************************/
+void FlowGraph::compile(FlowGraphNode &sink) {
+    clear();
+    for (auto &port : sink.mInputPorts) {
+        compilePort(port.get());
+    }
+    if (mProcessInPlaceEnabled) {
+        planBuffers(sink);
+    }
+}
+
+void FlowGraph::clear() {
+    for (FlowGraphPortFloatInput *port : mCompiledPorts) {
+        port->mExecutionPlan = nullptr;
+    }
+    mCompiledPorts.clear();
+    mPlans.clear();
+    for (FlowGraphPortFloatOutput *port : mSharedPorts) {
+        port->mActiveBuffer = port->mBuffer.get();
+    }
+    mSharedPorts.clear();
+}
+
+int32_t FlowGraph::getNodeCount() const {
+    int32_t count = 0;
+    for (const auto &plan : mPlans) {
+        count += plan->getNodeCount();
+    }
+    return count;
+}
+
+void FlowGraph::compilePort(FlowGraphPortFloatInput &port) {
+    FlowGraphPortFloatOutput *connected = port.mConnected;
+    if (connected == nullptr) return; // The port uses its own buffer, loaded by setValue().
+    if (std::find(mCompiledPorts.begin(), mCompiledPorts.end(), &port) != mCompiledPorts.end()) {
+        return; // Already compiled from another path.
+    }
+
+    auto plan = std::make_unique<FlowGraphExecutionPlan>();
+    std::vector<FlowGraphNode *> visiting;
+    std::vector<FlowGraphPortFloatInput *> boundaryPorts;
+    addNode(*plan, connected->mContainingNode, connected->getFramesPerBuffer(),
+            visiting, boundaryPorts);
+
+    port.mExecutionPlan = plan.get();
+    mCompiledPorts.push_back(&port);
+    mPlans.push_back(std::move(plan));
+
+    // Nodes like the SampleRateConverter pull from their inputs when they need more data.
+    for (FlowGraphPortFloatInput *boundaryPort : boundaryPorts) {
+        compilePort(*boundaryPort);
+    }
+}
+
+int32_t FlowGraph::addNode(FlowGraphExecutionPlan &plan,
+                           FlowGraphNode &node,
+                           int32_t maxFrames,
+                           std::vector<FlowGraphNode *> &visiting,
+                           std::vector<FlowGraphPortFloatInput *> &boundaryPorts) {
+    if (std::find(visiting.begin(), visiting.end(), &node) != visiting.end()) {
+        return -1; // Cycle. The node will use the frames from its previous call.
+    }
+
+    // The node may already be in the plan if its output goes to more than one node.
+    auto &steps = plan.mSteps;
+    for (size_t i = 0; i < steps.size(); i++) {
+        if (steps[i].node == &node) {
+            if (maxFrames < steps[i].maxFrames) {
+                // Request fewer frames from this node and everything upstream.
+                steps[i].maxFrames = maxFrames;
+                if (node.isDataPulledAutomatically()) {
+                    visiting.push_back(&node);
+                    for (auto &port : node.mInputPorts) {
+                        FlowGraphPortFloatOutput *connected = port.get().mConnected;
+                        if (connected == nullptr) continue;
+                        addNode(plan, connected->mContainingNode,
+                                std::min(maxFrames, connected->getFramesPerBuffer()),
+                                visiting, boundaryPorts);
+                    }
+                    visiting.pop_back();
+                }
+            }
+            return static_cast<int32_t>(i);
+        }
+    }
+
+    FlowGraphExecutionPlan::Step step;
+    step.node = &node;
+    step.maxFrames = maxFrames;
+    std::vector<int32_t> inputSteps;
+    if (node.isDataPulledAutomatically()) {
+        visiting.push_back(&node);
+        for (auto &port : node.mInputPorts) {
+            FlowGraphPortFloatInput &input = port.get();
+            FlowGraphPortFloatOutput *connected = input.mConnected;
+            if (connected == nullptr) {
+                step.maxFrames = std::min(step.maxFrames, input.getFramesPerBuffer());
+                continue;
+            }
+            int32_t inputStep = addNode(plan, connected->mContainingNode,
+                                        std::min(maxFrames, connected->getFramesPerBuffer()),
+                                        visiting, boundaryPorts);
+            if (inputStep >= 0) {
+                inputSteps.push_back(inputStep);
+            }
+        }
+        visiting.pop_back();
+    } else {
+        for (auto &port : node.mInputPorts) {
+            boundaryPorts.push_back(&port.get());
+        }
+    }
+
+    step.firstInputStep = static_cast<int32_t>(plan.mInputSteps.size());
+    step.numInputSteps = static_cast<int32_t>(inputSteps.size());
+    plan.mInputSteps.insert(plan.mInputSteps.end(), inputSteps.begin(), inputSteps.end());
+    steps.push_back(step);
+    return static_cast<int32_t>(steps.size() - 1);
+}
+
+void FlowGraph::planBuffers(FlowGraphNode &sink) {
+    // Find every connection in the compiled graph.
+    // An output that appears more than once has more than one reader.
+    std::vector<FlowGraphPortFloatOutput *> connectedOutputs;
+    auto addConnections = [&connectedOutputs](FlowGraphNode &node) {
+        for (auto &port : node.mInputPorts) {
+            FlowGraphPortFloatOutput *connected = port.get().mConnected;
+            if (connected != nullptr) {
+                connectedOutputs.push_back(connected);
+            }
+        }
+    };
+    addConnections(sink);
+    for (const auto &plan : mPlans) {
+        for (const auto &step : plan->mSteps) {
+            addConnections(*step.node);
+        }
+    }
+
+    std::vector<FlowGraphPortFloatOutput *> plannedOutputs;
+    for (FlowGraphPortFloatOutput *output : connectedOutputs) {
+        planBuffer(*output, connectedOutputs, plannedOutputs);
+    }
+}
+
+float *FlowGraph::planBuffer(FlowGraphPortFloatOutput &output,
+                             const std::vector<FlowGraphPortFloatOutput *> &connectedOutputs,
+                             std::vector<FlowGraphPortFloatOutput *> &plannedOutputs) {
+    if (std::find(plannedOutputs.begin(), plannedOutputs.end(), &output)
+            != plannedOutputs.end()) {
+        return output.getBuffer();
+    }
+    plannedOutputs.push_back(&output); // before recursing in case of a cycle
+
+    FlowGraphNode &node = output.mContainingNode;
+    if (!node.canProcessInPlace() || node.mInputPorts.size() != 1) {
+        return output.getBuffer();
+    }
+    FlowGraphPortFloatOutput *upstream = node.mInputPorts[0].get().mConnected;
+    if (upstream == nullptr
+            || std::count(connectedOutputs.begin(), connectedOutputs.end(), upstream) != 1
+            || upstream->getSamplesPerFrame() < output.getSamplesPerFrame()
+            || upstream->getFramesPerBuffer() < output.getFramesPerBuffer()) {
+        return output.getBuffer();
+    }
+    // Share the buffer that the upstream port writes to, which may itself be shared.
+    output.mActiveBuffer = planBuffer(*upstream, connectedOutputs, plannedOutputs);
+    mSharedPorts.push_back(&output);
+    return output.getBuffer();
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOWGRAPH_FLOW_GRAPH_H
+#define FLOWGRAPH_FLOW_GRAPH_H
+
+#include <memory>
+#include <sys/types.h>
+#include <vector>
+
+#include "FlowGraphNode.h"
+
+namespace FLOWGRAPH_OUTER_NAMESPACE {
+namespace flowgraph {
+
+/***************************************************************************/
+/**
+ * The nodes upstream of one input port, sorted so that every node comes after
+ * the nodes that feed it.
+ *
+ * Executing the plan calls onProcess() on each node in order, which gives the same
+ * result as pulling recursively through the ports but without the pointer chasing.
+ *
+ * A node that pulls its own data, eg. a SampleRateConverter, ends a plan.
+ * Each of its inputs gets a separate plan that runs when the node pulls on that input.
+ */
+class FlowGraphExecutionPlan {
+public:
+    /**
+     * Run every node in the plan once for this callCount.
+     *
+     * @param callCount same as the callCount passed to FlowGraphNode::pullData()
+     * @param numFrames maximum number of frames requested
+     * @return number of frames available from the last node
+     */
+    int32_t execute(int64_t callCount, int32_t numFrames);
+
+    int32_t getNodeCount() const {
+        return static_cast<int32_t>(mSteps.size());
+    }
+
+private:
+    friend class FlowGraph;
+
+    struct Step {
+        FlowGraphNode *node = nullptr;
+        int32_t maxFrames = 0;       // smallest port buffer between this node and the plan's port
+        int32_t firstInputStep = 0;  // index into mInputSteps
+        int32_t numInputSteps = 0;
+        int32_t framesProcessed = 0; // result of the last execute()
+    };
+
+    std::vector<Step>    mSteps;      // in topological order, the last step feeds the port
+    std::vector<int32_t> mInputSteps; // indices of the steps that feed each step
+};
+
+/***************************************************************************/
+/**
+ * Container that compiles the nodes upstream of a sink into flat execution plans.
+ *
+ * Compile the graph after it has been connected and before it is run.
+ * Compiling allocates memory so it should not be done in the audio thread.
+ * If the topology is changed then call compile() again, or clear() to go back
+ * to recursive pulling.
+ *
+ * The FlowGraph must be cleared or deleted before the nodes it has compiled.
+ *
+ * If in-place processing is enabled then compile() also plans the port buffers.
+ * A node that canProcessInPlace() writes its output into the buffer of the node
+ * that feeds it, so a chain of such nodes runs in one buffer.
+ * The upstream buffer is only shared when nothing else reads it.
+ * Only connections inside the compiled graph are considered.
+ */
+class FlowGraph {
+public:
+    FlowGraph() = default;
+
+    ~FlowGraph() {
+        clear();
+    }
+
+    FlowGraph(const FlowGraph&) = delete;
+    FlowGraph& operator=(const FlowGraph&) = delete;
+
+    /**
+     * Compile an execution plan for each input port of the sink.
+     * Any previous plans are discarded.
+     *
+     * @param sink node at the end of the graph, typically a FlowGraphSink
+     */
+    void compile(FlowGraphNode &sink);
+
+    /**
+     * Detach and delete all of the execution plans.
+     * Ports that were sharing buffers go back to their own buffers.
+     */
+    void clear();
+
+    /**
+     * Let nodes process in place when compile() is called. The default is false.
+     */
+    void setProcessInPlaceEnabled(bool enabled) {
+        mProcessInPlaceEnabled = enabled;
+    }
+
+    bool isProcessInPlaceEnabled() const {
+        return mProcessInPlaceEnabled;
+    }
+
+    /**
+     * @return number of output ports that write into an upstream buffer
+     */
+    int32_t getSharedBufferCount() const {
+        return static_cast<int32_t>(mSharedPorts.size());
+    }
+
+    /**
+     * @return total number of nodes in all of the execution plans
+     */
+    int32_t getNodeCount() const;
+
+private:
+    void compilePort(FlowGraphPortFloatInput &port);
+
+    /**
+     * Add the node, and everything upstream of it, to the plan in topological order.
+     * @return index of the node's step or -1 if it closes a cycle
+     */
+    int32_t addNode(FlowGraphExecutionPlan &plan,
+                    FlowGraphNode &node,
+                    int32_t maxFrames,
+                    std::vector<FlowGraphNode *> &visiting,
+                    std::vector<FlowGraphPortFloatInput *> &boundaryPorts);
+
+    void planBuffers(FlowGraphNode &sink);
+
+    float *planBuffer(FlowGraphPortFloatOutput &output,
+                      const std::vector<FlowGraphPortFloatOutput *> &connectedOutputs,
+                      std::vector<FlowGraphPortFloatOutput *> &plannedOutputs);
+
+    std::vector<std::unique_ptr<FlowGraphExecutionPlan>> mPlans;
+    std::vector<FlowGraphPortFloatInput *> mCompiledPorts;
+    std::vector<FlowGraphPortFloatOutput *> mSharedPorts;
+    bool mProcessInPlaceEnabled = false;
+};
+
+} /* namespace flowgraph */
+} /* namespace FLOWGRAPH_OUTER_NAMESPACE */
+
+#endif //FLOWGRAPH_FLOW_GRAPH_H
@@ -17,6 +17,7 @@
 #include "stdio.h"
 #include <algorithm>
 #include <sys/types.h>
+#include "FlowGraph.h"
 #include "FlowGraphNode.h"
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
@@ -70,6 +71,7 @@ FlowGraphPortFloat::FlowGraphPortFloat(FlowGraphNode &parent,
         , mBuffer(nullptr) {
     size_t numFloats = static_cast<size_t>(framesPerBuffer * getSamplesPerFrame());
     mBuffer = std::make_unique<float[]>(numFloats);
+    mActiveBuffer = mBuffer.get();
 }
 
 /***************************************************************************/
@@ -93,6 +95,9 @@ void FlowGraphPortFloatOutput::disconnect(FlowGraphPortFloatInput *port) {
 
 /***************************************************************************/
 int32_t FlowGraphPortFloatInput::pullData(int64_t callCount, int32_t numFrames) {
+    if (mExecutionPlan != nullptr) {
+        return mExecutionPlan->execute(callCount, numFrames);
+    }
     return (mConnected == nullptr)
             ? std::min(getFramesPerBuffer(), numFrames)
             : mConnected->pullData(callCount, numFrames);
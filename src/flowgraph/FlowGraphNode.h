@@ -59,8 +59,11 @@ namespace flowgraph {
 // Default block size that can be overridden when the FlowGraphPortFloat is created.
 // If it is too small then we will have too much overhead from switching between nodes.
 // If it is too high then we will thrash the caches.
+// A graph that knows its callback size, eg. DataConversionFlowGraph, should pass
+// that size to the nodes when they are constructed.
 constexpr int kDefaultBufferSize = 8; // arbitrary
 
+class FlowGraphExecutionPlan;
 class FlowGraphPort;
 class FlowGraphPortFloatInput;
 
@@ -107,7 +110,7 @@ public:
      */
     virtual void reset();
 
-    void addInputPort(FlowGraphPort &port) {
+    void addInputPort(FlowGraphPortFloatInput &port) {
         mInputPorts.push_back(port);
     }
 
@@ -128,6 +131,19 @@ public:
         mDataPulledAutomatically = automatic;
     }
 
+    /**
+     * Return true if onProcess() still works when the output buffer is the same memory
+     * as the input buffer. The node must have a single input with at least as many
+     * channels as its output. Each input frame must be read before the output frame
+     * at the same index is written.
+     *
+     * A FlowGraph can use this to share buffers between nodes.
+     * See FlowGraph::setProcessInPlaceEnabled().
+     */
+    virtual bool canProcessInPlace() const {
+        return false;
+    }
+
     virtual const char *getName() {
         return "FlowGraph";
     }
@@ -141,9 +157,12 @@ protected:
     static constexpr int64_t  kInitialCallCount = -1;
     int64_t  mLastCallCount = kInitialCallCount;
 
-    std::vector<std::reference_wrapper<FlowGraphPort>> mInputPorts;
+    std::vector<std::reference_wrapper<FlowGraphPortFloatInput>> mInputPorts;
 
 private:
+    friend class FlowGraph;
+    friend class FlowGraphExecutionPlan;
+
     bool     mDataPulledAutomatically = true;
     bool     mBlockRecursion = false;
     int32_t  mLastFrameCount = 0;
@@ -183,6 +202,8 @@ protected:
     FlowGraphNode &mContainingNode;
 
 private:
+    friend class FlowGraph;
+
     const int32_t    mSamplesPerFrame = 1;
 };
 
@@ -212,12 +233,15 @@ protected:
      * @return buffer internal to the port or from a connected port
      */
     virtual float *getBuffer() {
-        return mBuffer.get();
+        return mActiveBuffer;
     }
 
 private:
+    friend class FlowGraph;
+
     const int32_t    mFramesPerBuffer = 1;
     std::unique_ptr<float[]> mBuffer; // allocated in constructor
+    float           *mActiveBuffer = nullptr; // mBuffer or a buffer shared by a FlowGraph
 };
 
 /***************************************************************************/
@@ -226,8 +250,10 @@ private:
   */
 class FlowGraphPortFloatOutput : public FlowGraphPortFloat {
 public:
-    FlowGraphPortFloatOutput(FlowGraphNode &parent, int32_t samplesPerFrame)
-            : FlowGraphPortFloat(parent, samplesPerFrame) {
+    FlowGraphPortFloatOutput(FlowGraphNode &parent,
+                             int32_t samplesPerFrame,
+                             int32_t framesPerBuffer = kDefaultBufferSize)
+            : FlowGraphPortFloat(parent, samplesPerFrame, framesPerBuffer) {
     }
 
     virtual ~FlowGraphPortFloatOutput() = default;
@@ -274,8 +300,10 @@ public:
  */
 class FlowGraphPortFloatInput : public FlowGraphPortFloat {
 public:
-    FlowGraphPortFloatInput(FlowGraphNode &parent, int32_t samplesPerFrame)
-            : FlowGraphPortFloat(parent, samplesPerFrame) {
+    FlowGraphPortFloatInput(FlowGraphNode &parent,
+                            int32_t samplesPerFrame,
+                            int32_t framesPerBuffer = kDefaultBufferSize)
+            : FlowGraphPortFloat(parent, samplesPerFrame, framesPerBuffer) {
         // Add to parent so it can pull data from each input.
         parent.addInputPort(*this);
     }
@@ -296,7 +324,7 @@ public:
      * to this port.
      */
     void setValue(float value) {
-        int numFloats = kDefaultBufferSize * getSamplesPerFrame();
+        int numFloats = getFramesPerBuffer() * getSamplesPerFrame();
         float *buffer = getBuffer();
         for (int i = 0; i < numFloats; i++) {
             *buffer++ = value;
@@ -326,13 +354,18 @@ public:
 
     /**
      * Pull data from any output port that is connected.
+     * If an execution plan has been attached by a FlowGraph then the upstream
+     * nodes are run from that plan instead of being pulled recursively.
      */
     int32_t pullData(int64_t framePosition, int32_t numFrames) override;
 
     void pullReset() override;
 
 private:
+    friend class FlowGraph;
+
     FlowGraphPortFloatOutput *mConnected = nullptr;
+    FlowGraphExecutionPlan   *mExecutionPlan = nullptr; // owned by a FlowGraph
 };
 
 /***************************************************************************/
@@ -344,8 +377,9 @@ private:
  */
 class FlowGraphSource : public FlowGraphNode {
 public:
-    explicit FlowGraphSource(int32_t channelCount)
-            : output(*this, channelCount) {
+    explicit FlowGraphSource(int32_t channelCount,
+                             int32_t framesPerBuffer = kDefaultBufferSize)
+            : output(*this, channelCount, framesPerBuffer) {
     }
 
     virtual ~FlowGraphSource() = default;
@@ -362,8 +396,9 @@ public:
  */
 class FlowGraphSourceBuffered : public FlowGraphSource {
 public:
-    explicit FlowGraphSourceBuffered(int32_t channelCount)
-            : FlowGraphSource(channelCount) {}
+    explicit FlowGraphSourceBuffered(int32_t channelCount,
+                                     int32_t framesPerBuffer = kDefaultBufferSize)
+            : FlowGraphSource(channelCount, framesPerBuffer) {}
 
     virtual ~FlowGraphSourceBuffered() = default;
 
@@ -394,8 +429,9 @@ protected:
  */
 class FlowGraphSink : public FlowGraphNode {
 public:
-    explicit FlowGraphSink(int32_t channelCount)
-            : input(*this, channelCount) {
+    explicit FlowGraphSink(int32_t channelCount,
+                           int32_t framesPerBuffer = kDefaultBufferSize)
+            : input(*this, channelCount, framesPerBuffer) {
     }
 
     virtual ~FlowGraphSink() = default;
@@ -431,9 +467,10 @@ protected:
  */
 class FlowGraphFilter : public FlowGraphNode {
 public:
-    explicit FlowGraphFilter(int32_t channelCount)
-            : input(*this, channelCount)
-            , output(*this, channelCount) {
+    explicit FlowGraphFilter(int32_t channelCount,
+                             int32_t framesPerBuffer = kDefaultBufferSize)
+            : input(*this, channelCount, framesPerBuffer)
+            , output(*this, channelCount, framesPerBuffer) {
     }
 
     virtual ~FlowGraphFilter() = default;
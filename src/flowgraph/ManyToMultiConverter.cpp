@@ -20,11 +20,11 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-ManyToMultiConverter::ManyToMultiConverter(int32_t channelCount)
+ManyToMultiConverter::ManyToMultiConverter(int32_t channelCount, int32_t framesPerBuffer)
         : inputs(channelCount)
-        , output(*this, channelCount) {
+        , output(*this, channelCount, framesPerBuffer) {
     for (int i = 0; i < channelCount; i++) {
-        inputs[i] = std::make_unique<FlowGraphPortFloatInput>(*this, 1);
+        inputs[i] = std::make_unique<FlowGraphPortFloatInput>(*this, 1, framesPerBuffer);
     }
 }
 
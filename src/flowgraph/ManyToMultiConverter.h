@@ -31,7 +31,8 @@ namespace flowgraph {
  */
 class ManyToMultiConverter : public flowgraph::FlowGraphNode {
 public:
-    explicit ManyToMultiConverter(int32_t channelCount);
+    explicit ManyToMultiConverter(int32_t channelCount,
+                                  int32_t framesPerBuffer = kDefaultBufferSize);
 
     virtual ~ManyToMultiConverter() = default;
 
@@ -20,9 +20,10 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-MonoToMultiConverter::MonoToMultiConverter(int32_t outputChannelCount)
-        : input(*this, 1)
-        , output(*this, outputChannelCount) {
+MonoToMultiConverter::MonoToMultiConverter(int32_t outputChannelCount,
+                                           int32_t framesPerBuffer)
+        : input(*this, 1, framesPerBuffer)
+        , output(*this, outputChannelCount, framesPerBuffer) {
 }
 
 int32_t MonoToMultiConverter::onProcess(int32_t numFrames) {
@@ -31,7 +31,8 @@ namespace flowgraph {
  */
 class MonoToMultiConverter : public FlowGraphNode {
 public:
-    explicit MonoToMultiConverter(int32_t outputChannelCount);
+    explicit MonoToMultiConverter(int32_t outputChannelCount,
+                                  int32_t framesPerBuffer = kDefaultBufferSize);
 
     virtual ~MonoToMultiConverter() = default;
 
@@ -20,9 +20,10 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-MultiToMonoConverter::MultiToMonoConverter(int32_t inputChannelCount)
-        : input(*this, inputChannelCount)
-        , output(*this, 1) {
+MultiToMonoConverter::MultiToMonoConverter(int32_t inputChannelCount,
+                                           int32_t framesPerBuffer)
+        : input(*this, inputChannelCount, framesPerBuffer)
+        , output(*this, 1, framesPerBuffer) {
 }
 
 MultiToMonoConverter::~MultiToMonoConverter() { }
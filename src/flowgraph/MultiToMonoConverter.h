@@ -31,12 +31,17 @@ namespace flowgraph {
  */
     class MultiToMonoConverter : public FlowGraphNode {
     public:
-        explicit MultiToMonoConverter(int32_t inputChannelCount);
+        explicit MultiToMonoConverter(int32_t inputChannelCount,
+                                      int32_t framesPerBuffer = kDefaultBufferSize);
 
         virtual ~MultiToMonoConverter();
 
         int32_t onProcess(int32_t numFrames) override;
 
+        bool canProcessInPlace() const override {
+            return true; // The output frame is never ahead of the input frame.
+        }
+
         const char *getName() override {
             return "MultiToMonoConverter";
         }
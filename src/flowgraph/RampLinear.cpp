@@ -21,8 +21,8 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-RampLinear::RampLinear(int32_t channelCount)
-        : FlowGraphFilter(channelCount) {
+RampLinear::RampLinear(int32_t channelCount, int32_t framesPerBuffer)
+        : FlowGraphFilter(channelCount, framesPerBuffer) {
     mTarget.store(1.0f);
 }
 
@@ -36,12 +36,16 @@ namespace flowgraph {
  */
 class RampLinear : public FlowGraphFilter {
 public:
-    explicit RampLinear(int32_t channelCount);
+    explicit RampLinear(int32_t channelCount, int32_t framesPerBuffer = kDefaultBufferSize);
 
     virtual ~RampLinear() = default;
 
     int32_t onProcess(int32_t numFrames) override;
 
+    bool canProcessInPlace() const override {
+        return true;
+    }
+
     /**
      * This is used for the next ramp.
      * Calling this does not affect a ramp that is in progress.
@@ -0,0 +1,383 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <string.h>
+
+#include "FlowGraphNode.h"
+#include "FlowgraphUtilities.h"
+#include "SampleConversion.h"
+
+// Define FLOWGRAPH_DISABLE_SIMD to use the scalar code everywhere.
+#if !defined(FLOWGRAPH_DISABLE_SIMD)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FLOWGRAPH_USE_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FLOWGRAPH_USE_SSE2 1
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#define FLOWGRAPH_USE_SSSE3 1
+#endif
+#endif
+#endif
+
+using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
+
+// Clip in the float domain then truncate. This matches converting first and then clipping
+// the integer, but it is also defined for floats that do not fit in an int32_t.
+static constexpr float kI16Scale = 32768.0f;
+static constexpr float kI16Min = -32768.0f;
+static constexpr float kI16Max = 32767.0f;
+static constexpr float kI24Scale = 8388608.0f; // 0x00800000
+static constexpr float kI24Min = -8388608.0f;
+static constexpr float kI24Max = 8388607.0f;
+static constexpr float kI32Scale = 2147483648.0f; // 1 << 31
+
+const char *SampleConversion::getInstructionSetName() {
+#if FLOWGRAPH_USE_NEON
+    return "NEON";
+#elif FLOWGRAPH_USE_SSSE3
+    return "SSSE3";
+#elif FLOWGRAPH_USE_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+/***************************************************************************/
+void SampleConversion::floatToI16Scalar(int16_t *destination,
+                                        const float *source,
+                                        int32_t numSamples) {
+    for (int32_t i = 0; i < numSamples; i++) {
+        float sample = source[i] * kI16Scale;
+        sample = std::min(kI16Max, std::max(kI16Min, sample)); // clip
+        destination[i] = static_cast<int16_t>(sample);
+    }
+}
+
+void SampleConversion::floatToPackedI24Scalar(uint8_t *destination,
+                                              const float *source,
+                                              int32_t numSamples) {
+    for (int32_t i = 0; i < numSamples; i++) {
+        float sample = source[i] * kI24Scale;
+        sample = std::min(kI24Max, std::max(kI24Min, sample)); // clip
+        int32_t n = static_cast<int32_t>(sample);
+        // Write as a packed 24-bit integer in Little Endian format.
+        *destination++ = (uint8_t) n;
+        *destination++ = (uint8_t) (n >> 8);
+        *destination++ = (uint8_t) (n >> 16);
+    }
+}
+
+void SampleConversion::floatToI32Scalar(int32_t *destination,
+                                        const float *source,
+                                        int32_t numSamples) {
+    for (int32_t i = 0; i < numSamples; i++) {
+        destination[i] = FlowgraphUtilities::clamp32FromFloat(source[i]);
+    }
+}
+
+void SampleConversion::i16ToFloatScalar(float *destination,
+                                        const int16_t *source,
+                                        int32_t numSamples) {
+    for (int32_t i = 0; i < numSamples; i++) {
+        destination[i] = source[i] * (1.0f / kI16Scale);
+    }
+}
+
+void SampleConversion::packedI24ToFloatScalar(float *destination,
+                                              const uint8_t *source,
+                                              int32_t numSamples) {
+    for (int32_t i = 0; i < numSamples; i++) {
+        // Assemble the data assuming Little Endian format.
+        int32_t pad = source[2];
+        pad <<= 8;
+        pad |= source[1];
+        pad <<= 8;
+        pad |= source[0];
+        pad <<= 8; // Shift to 32 bit data so the sign is correct.
+        source += kBytesPerI24Packed;
+        destination[i] = pad * (1.0f / kI32Scale); // scale to range -1.0 to 1.0
+    }
+}
+
+void SampleConversion::i32ToFloatScalar(float *destination,
+                                        const int32_t *source,
+                                        int32_t numSamples) {
+    for (int32_t i = 0; i < numSamples; i++) {
+        destination[i] = source[i] * (1.0f / kI32Scale);
+    }
+}
+
+/***************************************************************************/
+#if FLOWGRAPH_USE_NEON
+
+// Same rounding as clamp32FromFloat(), round to nearest with ties away from zero.
+static inline int32x4_t floatToI32Neon(float32x4_t input) {
+    float32x4_t scaled = vmulq_n_f32(input, kI32Scale);
+    int32x4_t truncated = vcvtq_s32_f32(scaled); // rounds toward zero
+    float32x4_t fraction = vsubq_f32(scaled, vcvtq_f32_s32(truncated));
+    // The comparisons give -1 where true so subtract to round up.
+    truncated = vsubq_s32(truncated,
+            vreinterpretq_s32_u32(vcgeq_f32(fraction, vdupq_n_f32(0.5f))));
+    truncated = vaddq_s32(truncated,
+            vreinterpretq_s32_u32(vcleq_f32(fraction, vdupq_n_f32(-0.5f))));
+    truncated = vbslq_s32(vcgeq_f32(input, vdupq_n_f32(1.0f)),
+                          vdupq_n_s32(INT32_MAX), truncated);
+    truncated = vbslq_s32(vcleq_f32(input, vdupq_n_f32(-1.0f)),
+                          vdupq_n_s32(INT32_MIN), truncated);
+    return truncated;
+}
+
+static inline int32x4_t floatToClippedI32Neon(float32x4_t input, float scale,
+                                              float minimum, float maximum) {
+    float32x4_t scaled = vmulq_n_f32(input, scale);
+    scaled = vminq_f32(vdupq_n_f32(maximum), vmaxq_f32(vdupq_n_f32(minimum), scaled));
+    return vcvtq_s32_f32(scaled);
+}
+
+void SampleConversion::floatToI16(int16_t *destination, const float *source, int32_t numSamples) {
+    int32_t i = 0;
+    for (; i + 8 <= numSamples; i += 8) {
+        int32x4_t low = floatToClippedI32Neon(vld1q_f32(source + i), kI16Scale, kI16Min, kI16Max);
+        int32x4_t high = floatToClippedI32Neon(vld1q_f32(source + i + 4),
+                                               kI16Scale, kI16Min, kI16Max);
+        vst1q_s16(destination + i, vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+    }
+    floatToI16Scalar(destination + i, source + i, numSamples - i);
+}
+
+void SampleConversion::floatToPackedI24(uint8_t *destination,
+                                        const float *source,
+                                        int32_t numSamples) {
+    int32_t i = 0;
+    for (; i + 8 <= numSamples; i += 8) {
+        uint32x4_t low = vreinterpretq_u32_s32(floatToClippedI32Neon(
+                vld1q_f32(source + i), kI24Scale, kI24Min, kI24Max));
+        uint32x4_t high = vreinterpretq_u32_s32(floatToClippedI32Neon(
+                vld1q_f32(source + i + 4), kI24Scale, kI24Min, kI24Max));
+        uint8x8x3_t bytes;
+        bytes.val[0] = vmovn_u16(vcombine_u16(vmovn_u32(low), vmovn_u32(high)));
+        bytes.val[1] = vmovn_u16(vcombine_u16(vshrn_n_u32(low, 8), vshrn_n_u32(high, 8)));
+        bytes.val[2] = vmovn_u16(vcombine_u16(vshrn_n_u32(low, 16), vshrn_n_u32(high, 16)));
+        vst3_u8(destination + i * kBytesPerI24Packed, bytes); // interleave
+    }
+    floatToPackedI24Scalar(destination + i * kBytesPerI24Packed, source + i, numSamples - i);
+}
+
+void SampleConversion::floatToI32(int32_t *destination, const float *source, int32_t numSamples) {
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        vst1q_s32(destination + i, floatToI32Neon(vld1q_f32(source + i)));
+    }
+    floatToI32Scalar(destination + i, source + i, numSamples - i);
+}
+
+void SampleConversion::i16ToFloat(float *destination, const int16_t *source, int32_t numSamples) {
+    int32_t i = 0;
+    for (; i + 8 <= numSamples; i += 8) {
+        int16x8_t shorts = vld1q_s16(source + i);
+        vst1q_f32(destination + i,
+                  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(shorts))), 1.0f / kI16Scale));
+        vst1q_f32(destination + i + 4,
+                  vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(shorts))), 1.0f / kI16Scale));
+    }
+    i16ToFloatScalar(destination + i, source + i, numSamples - i);
+}
+
+void SampleConversion::packedI24ToFloat(float *destination,
+                                        const uint8_t *source,
+                                        int32_t numSamples) {
+    int32_t i = 0;
+    for (; i + 8 <= numSamples; i += 8) {
+        uint8x8x3_t bytes = vld3_u8(source + i * kBytesPerI24Packed); // de-interleave
+        // Put the 24 bits in the top of each 32-bit word so the sign is correct.
+        uint16x8_t lowHalves = vshll_n_u8(bytes.val[0], 8);
+        uint16x8_t highHalves = vorrq_u16(vshll_n_u8(bytes.val[2], 8), vmovl_u8(bytes.val[1]));
+        uint32x4_t low = vorrq_u32(vshll_n_u16(vget_low_u16(highHalves), 16),
+                                   vmovl_u16(vget_low_u16(lowHalves)));
+        uint32x4_t high = vorrq_u32(vshll_n_u16(vget_high_u16(highHalves), 16),
+                                    vmovl_u16(vget_high_u16(lowHalves)));
+        vst1q_f32(destination + i, vmulq_n_f32(
+                vcvtq_f32_s32(vreinterpretq_s32_u32(low)), 1.0f / kI32Scale));
+        vst1q_f32(destination + i + 4, vmulq_n_f32(
+                vcvtq_f32_s32(vreinterpretq_s32_u32(high)), 1.0f / kI32Scale));
+    }
+    packedI24ToFloatScalar(destination + i, source + i * kBytesPerI24Packed, numSamples - i);
+}
+
+void SampleConversion::i32ToFloat(float *destination, const int32_t *source, int32_t numSamples) {
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        vst1q_f32(destination + i,
+                  vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(source + i)), 1.0f / kI32Scale));
+    }
+    i32ToFloatScalar(destination + i, source + i, numSamples - i);
+}
+
+/***************************************************************************/
+#elif FLOWGRAPH_USE_SSE2
+
+static inline __m128i selectSse2(__m128i mask, __m128i ifTrue, __m128i ifFalse) {
+    return _mm_or_si128(_mm_and_si128(mask, ifTrue), _mm_andnot_si128(mask, ifFalse));
+}
+
+// Same rounding as clamp32FromFloat(), round to nearest with ties away from zero.
+static inline __m128i floatToI32Sse2(__m128 input) {
+    __m128 scaled = _mm_mul_ps(input, _mm_set1_ps(kI32Scale));
+    __m128i truncated = _mm_cvttps_epi32(scaled);
+    __m128 fraction = _mm_sub_ps(scaled, _mm_cvtepi32_ps(truncated));
+    // The comparisons give -1 where true so subtract to round up.
+    truncated = _mm_sub_epi32(truncated,
+            _mm_castps_si128(_mm_cmpge_ps(fraction, _mm_set1_ps(0.5f))));
+    truncated = _mm_add_epi32(truncated,
+            _mm_castps_si128(_mm_cmple_ps(fraction, _mm_set1_ps(-0.5f))));
+    truncated = selectSse2(_mm_castps_si128(_mm_cmpge_ps(input, _mm_set1_ps(1.0f))),
+                           _mm_set1_epi32(INT32_MAX), truncated);
+    truncated = selectSse2(_mm_castps_si128(_mm_cmple_ps(input, _mm_set1_ps(-1.0f))),
+                           _mm_set1_epi32(INT32_MIN), truncated);
+    return truncated;
+}
+
+static inline __m128i floatToClippedI32Sse2(__m128 input, float scale,
+                                            float minimum, float maximum) {
+    __m128 scaled = _mm_mul_ps(input, _mm_set1_ps(scale));
+    scaled = _mm_min_ps(_mm_max_ps(scaled, _mm_set1_ps(minimum)), _mm_set1_ps(maximum));
+    return _mm_cvttps_epi32(scaled);
+}
+
+void SampleConversion::floatToI16(int16_t *destination, const float *source, int32_t numSamples) {
+    int32_t i = 0;
+    for (; i + 8 <= numSamples; i += 8) {
+        __m128i low = floatToClippedI32Sse2(_mm_loadu_ps(source + i),
+                                            kI16Scale, kI16Min, kI16Max);
+        __m128i high = floatToClippedI32Sse2(_mm_loadu_ps(source + i + 4),
+                                             kI16Scale, kI16Min, kI16Max);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i),
+                         _mm_packs_epi32(low, high));
+    }
+    floatToI16Scalar(destination + i, source + i, numSamples - i);
+}
+
+void SampleConversion::floatToPackedI24(uint8_t *destination,
+                                        const float *source,
+                                        int32_t numSamples) {
+    int32_t i = 0;
+#if FLOWGRAPH_USE_SSSE3
+    // Gather the low three bytes of each word into the first 12 bytes.
+    const __m128i packMask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14,
+                                           -1, -1, -1, -1);
+    for (; i + 4 <= numSamples; i += 4) {
+        __m128i words = floatToClippedI32Sse2(_mm_loadu_ps(source + i),
+                                              kI24Scale, kI24Min, kI24Max);
+        __m128i packed = _mm_shuffle_epi8(words, packMask);
+        uint8_t *bytes = destination + i * kBytesPerI24Packed;
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(bytes), packed);
+        int32_t last = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+        memcpy(bytes + 8, &last, sizeof(last));
+    }
+#endif
+    floatToPackedI24Scalar(destination + i * kBytesPerI24Packed, source + i, numSamples - i);
+}
+
+void SampleConversion::floatToI32(int32_t *destination, const float *source, int32_t numSamples) {
+    int32_t i = 0;
+    for (; i + 4 <= numSamples; i += 4) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + i),
+                         floatToI32Sse2(_mm_loadu_ps(source + i)));
+    }
+    floatToI32Scalar(destination + i, source + i, numSamples - i);
+}
+
+void SampleConversion::i16ToFloat(float *destination, const int16_t *source, int32_t numSamples) {
+    int32_t i = 0;
+    const __m128 scale = _mm_set1_ps(1.0f / kI16Scale);
+    for (; i + 8 <= numSamples; i += 8) {
+        __m128i shorts = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+        // Put each short in the top of a word then shift down to sign extend.
+        __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(shorts, shorts), 16);
+        __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(shorts, shorts), 16);
+        _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_cvtepi32_ps(low), scale));
+        _mm_storeu_ps(destination + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scale));
+    }
+    i16ToFloatScalar(destination + i, source + i, numSamples - i);
+}
+
+void SampleConversion::packedI24ToFloat(float *destination,
+                                        const uint8_t *source,
+                                        int32_t numSamples) {
+    int32_t i = 0;
+#if FLOWGRAPH_USE_SSSE3
+    // Put the three bytes of each sample in the top of a word so the sign is correct.
+    const __m128i unpackMask = _mm_setr_epi8(-1, 0, 1, 2, -1, 3, 4, 5,
+                                             -1, 6, 7, 8, -1, 9, 10, 11);
+    const __m128 scale = _mm_set1_ps(1.0f / kI32Scale);
+    // Each load reads 16 bytes but only uses 12 so stay away from the end of the array.
+    for (; i + 6 <= numSamples; i += 4) {
+        __m128i bytes = _mm_loadu_si128(
+                reinterpret_cast<const __m128i *>(source + i * kBytesPerI24Packed));
+        __m128i words = _mm_shuffle_epi8(bytes, unpackMask);
+        _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_cvtepi32_ps(words), scale));
+    }
+#endif
+    packedI24ToFloatScalar(destination + i, source + i * kBytesPerI24Packed, numSamples - i);
+}
+
+void SampleConversion::i32ToFloat(float *destination, const int32_t *source, int32_t numSamples) {
+    int32_t i = 0;
+    const __m128 scale = _mm_set1_ps(1.0f / kI32Scale);
+    for (; i + 4 <= numSamples; i += 4) {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(source + i));
+        _mm_storeu_ps(destination + i, _mm_mul_ps(_mm_cvtepi32_ps(words), scale));
+    }
+    i32ToFloatScalar(destination + i, source + i, numSamples - i);
+}
+
+/***************************************************************************/
+#else
+
+void SampleConversion::floatToI16(int16_t *destination, const float *source, int32_t numSamples) {
+    floatToI16Scalar(destination, source, numSamples);
+}
+
+void SampleConversion::floatToPackedI24(uint8_t *destination,
+                                        const float *source,
+                                        int32_t numSamples) {
+    floatToPackedI24Scalar(destination, source, numSamples);
+}
+
+void SampleConversion::floatToI32(int32_t *destination, const float *source, int32_t numSamples) {
+    floatToI32Scalar(destination, source, numSamples);
+}
+
+void SampleConversion::i16ToFloat(float *destination, const int16_t *source, int32_t numSamples) {
+    i16ToFloatScalar(destination, source, numSamples);
+}
+
+void SampleConversion::packedI24ToFloat(float *destination,
+                                        const uint8_t *source,
+                                        int32_t numSamples) {
+    packedI24ToFloatScalar(destination, source, numSamples);
+}
+
+void SampleConversion::i32ToFloat(float *destination, const int32_t *source, int32_t numSamples) {
+    i32ToFloatScalar(destination, source, numSamples);
+}
+
+#endif
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOWGRAPH_SAMPLE_CONVERSION_H
+#define FLOWGRAPH_SAMPLE_CONVERSION_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "FlowGraphNode.h"
+
+namespace FLOWGRAPH_OUTER_NAMESPACE {
+namespace flowgraph {
+
+/**
+ * Convert arrays of samples between float and the integer PCM formats.
+ *
+ * The instruction set is selected when the code is compiled.
+ * NEON is used on ARM, SSE2 on x86, and SSSE3 for packed 24-bit data if available.
+ * Otherwise the portable scalar code is used.
+ * The vector code gives exactly the same results as the scalar code, except for NaN,
+ * which is undefined.
+ *
+ * Floats are clipped to the range of the integer format.
+ * Packed 24-bit data is Little Endian.
+ */
+class SampleConversion {
+public:
+    static void floatToI16(int16_t *destination, const float *source, int32_t numSamples);
+    static void floatToPackedI24(uint8_t *destination, const float *source, int32_t numSamples);
+    static void floatToI32(int32_t *destination, const float *source, int32_t numSamples);
+
+    static void i16ToFloat(float *destination, const int16_t *source, int32_t numSamples);
+    static void packedI24ToFloat(float *destination, const uint8_t *source, int32_t numSamples);
+    static void i32ToFloat(float *destination, const int32_t *source, int32_t numSamples);
+
+    // Portable versions. These are used for the samples at the end of an array
+    // that do not fill a vector. They are public so they can be used as a reference.
+    static void floatToI16Scalar(int16_t *destination, const float *source, int32_t numSamples);
+    static void floatToPackedI24Scalar(uint8_t *destination, const float *source,
+                                       int32_t numSamples);
+    static void floatToI32Scalar(int32_t *destination, const float *source, int32_t numSamples);
+
+    static void i16ToFloatScalar(float *destination, const int16_t *source, int32_t numSamples);
+    static void packedI24ToFloatScalar(float *destination, const uint8_t *source,
+                                       int32_t numSamples);
+    static void i32ToFloatScalar(float *destination, const int32_t *source, int32_t numSamples);
+
+    /**
+     * @return name of the instruction set used by the conversions, eg. "NEON"
+     */
+    static const char *getInstructionSetName();
+
+    static constexpr int kBytesPerI24Packed = 3;
+};
+
+} /* namespace flowgraph */
+} /* namespace FLOWGRAPH_OUTER_NAMESPACE */
+
+#endif //FLOWGRAPH_SAMPLE_CONVERSION_H
@@ -19,15 +19,20 @@
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 using namespace resampler;
 
-SampleRateConverter::SampleRateConverter(int32_t channelCount, MultiChannelResampler &resampler)
-        : FlowGraphFilter(channelCount)
+SampleRateConverter::SampleRateConverter(int32_t channelCount,
+                                         MultiChannelResampler &resampler,
+                                         int32_t framesPerBuffer)
+        : FlowGraphFilter(channelCount, framesPerBuffer)
         , mResampler(resampler) {
     setDataPulledAutomatically(false);
 }
 
 void SampleRateConverter::reset() {
     FlowGraphNode::reset();
-    mInputCursor = kInitialCallCount;
+    // Discard any input left over from before the reset.
+    mInputFramesConsumed += mNumValidInputFrames - mInputCursor;
+    mInputCursor = 0;
+    mNumValidInputFrames = 0;
 }
 
 // Return true if there is a sample available.
@@ -41,30 +46,24 @@ bool SampleRateConverter::isInputAvailable() {
     return (mInputCursor < mNumValidInputFrames);
 }
 
-const float *SampleRateConverter::getNextInputFrame() {
-    const float *inputBuffer = input.getBuffer();
-    return &inputBuffer[mInputCursor++ * input.getSamplesPerFrame()];
-}
-
 int32_t SampleRateConverter::onProcess(int32_t numFrames) {
     float *outputBuffer = output.getBuffer();
     int32_t channelCount = output.getSamplesPerFrame();
     int framesLeft = numFrames;
     while (framesLeft > 0) {
-        // Gather input samples as needed.
-        if(mResampler.isWriteNeeded()) {
-            if (isInputAvailable()) {
-                const float *frame = getNextInputFrame();
-                mResampler.writeNextFrame(frame);
-            } else {
-                break;
-            }
-        } else {
-            // Output frame is interpolated from input samples.
-            mResampler.readNextFrame(outputBuffer);
-            outputBuffer += channelCount;
-            framesLeft--;
+        // Only pull more input when the resampler needs it.
+        if (mResampler.isWriteNeeded() && !isInputAvailable()) {
+            break;
         }
+        const float *inputBuffer = &input.getBuffer()[mInputCursor * channelCount];
+        MultiChannelResampler::ProcessResult result = mResampler.process(
+                inputBuffer, mNumValidInputFrames - mInputCursor,
+                outputBuffer, framesLeft);
+        mInputCursor += result.framesConsumed;
+        mInputFramesConsumed += result.framesConsumed;
+        mOutputFramesProduced += result.framesProduced;
+        outputBuffer += result.framesProduced * channelCount;
+        framesLeft -= result.framesProduced;
     }
     return numFrames - framesLeft;
 }
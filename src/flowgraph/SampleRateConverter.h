@@ -28,7 +28,9 @@ namespace flowgraph {
 
 class SampleRateConverter : public FlowGraphFilter {
 public:
-    explicit SampleRateConverter(int32_t channelCount, resampler::MultiChannelResampler &mResampler);
+    explicit SampleRateConverter(int32_t channelCount,
+                                 resampler::MultiChannelResampler &mResampler,
+                                 int32_t framesPerBuffer = kDefaultBufferSize);
 
     virtual ~SampleRateConverter() = default;
 
@@ -40,14 +42,25 @@ public:
 
     void reset() override;
 
+    /**
+     * @return total number of input frames used by the resampler, or discarded by reset()
+     */
+    int64_t getInputFramesConsumed() const {
+        return mInputFramesConsumed;
+    }
+
+    /**
+     * @return total number of frames produced by the resampler
+     */
+    int64_t getOutputFramesProduced() const {
+        return mOutputFramesProduced;
+    }
+
 private:
 
     // Return true if there is a sample available.
     bool isInputAvailable();
 
-    // This assumes data is available. Only call after calling isInputAvailable().
-    const float *getNextInputFrame();
-
     resampler::MultiChannelResampler &mResampler;
 
     int32_t mInputCursor = 0;         // offset into the input port buffer
@@ -56,6 +69,10 @@ private:
     // This means we cannot have cyclic graphs or merges that contain an SRC.
     int64_t mInputCallCount = 0;
 
+    // Used to map frame positions across the converter.
+    int64_t mInputFramesConsumed = 0;
+    int64_t mOutputFramesProduced = 0;
+
 };
 
 } /* namespace flowgraph */
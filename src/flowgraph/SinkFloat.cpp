@@ -21,8 +21,8 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-SinkFloat::SinkFloat(int32_t channelCount)
-        : FlowGraphSink(channelCount) {
+SinkFloat::SinkFloat(int32_t channelCount, int32_t framesPerBuffer)
+        : FlowGraphSink(channelCount, framesPerBuffer) {
 }
 
 int32_t SinkFloat::read(void *data, int32_t numFrames) {
@@ -31,7 +31,7 @@ namespace flowgraph {
  */
 class SinkFloat : public FlowGraphSink {
 public:
-    explicit SinkFloat(int32_t channelCount);
+    explicit SinkFloat(int32_t channelCount, int32_t framesPerBuffer = kDefaultBufferSize);
     ~SinkFloat() override = default;
 
     int32_t read(void *data, int32_t numFrames) override;
@@ -17,6 +17,7 @@
 #include <algorithm>
 #include <unistd.h>
 
+#include "SampleConversion.h"
 #include "SinkI16.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -25,8 +26,8 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-SinkI16::SinkI16(int32_t channelCount)
-        : FlowGraphSink(channelCount) {}
+SinkI16::SinkI16(int32_t channelCount, int32_t framesPerBuffer)
+        : FlowGraphSink(channelCount, framesPerBuffer) {}
 
 int32_t SinkI16::read(void *data, int32_t numFrames) {
     int16_t *shortData = (int16_t *) data;
@@ -46,10 +47,8 @@ int32_t SinkI16::read(void *data, int32_t numFrames) {
         shortData += numSamples;
         signal += numSamples;
 #else
-        for (int i = 0; i < numSamples; i++) {
-            int32_t n = (int32_t) (*signal++ * 32768.0f);
-            *shortData++ = std::min(INT16_MAX, std::max(INT16_MIN, n)); // clip
-        }
+        SampleConversion::floatToI16(shortData, signal, numSamples);
+        shortData += numSamples;
 #endif
         framesLeft -= framesRead;
     }
@@ -30,7 +30,7 @@ namespace flowgraph {
  */
 class SinkI16 : public FlowGraphSink {
 public:
-    explicit SinkI16(int32_t channelCount);
+    explicit SinkI16(int32_t channelCount, int32_t framesPerBuffer = kDefaultBufferSize);
 
     int32_t read(void *data, int32_t numFrames) override;
 
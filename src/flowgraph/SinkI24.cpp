@@ -19,6 +19,7 @@
 
 
 #include "FlowGraphNode.h"
+#include "SampleConversion.h"
 #include "SinkI24.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -27,8 +28,8 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-SinkI24::SinkI24(int32_t channelCount)
-        : FlowGraphSink(channelCount) {}
+SinkI24::SinkI24(int32_t channelCount, int32_t framesPerBuffer)
+        : FlowGraphSink(channelCount, framesPerBuffer) {}
 
 int32_t SinkI24::read(void *data, int32_t numFrames) {
     uint8_t *byteData = (uint8_t *) data;
@@ -49,16 +50,8 @@ int32_t SinkI24::read(void *data, int32_t numFrames) {
         byteData += numSamples * kBytesPerI24Packed;
         floatData += numSamples;
 #else
-        const int32_t kI24PackedMax = 0x007FFFFF;
-        const int32_t kI24PackedMin = 0xFF800000;
-        for (int i = 0; i < numSamples; i++) {
-            int32_t n = (int32_t) (*floatData++ * 0x00800000);
-            n = std::min(kI24PackedMax, std::max(kI24PackedMin, n)); // clip
-            // Write as a packed 24-bit integer in Little Endian format.
-            *byteData++ = (uint8_t) n;
-            *byteData++ = (uint8_t) (n >> 8);
-            *byteData++ = (uint8_t) (n >> 16);
-        }
+        SampleConversion::floatToPackedI24(byteData, floatData, numSamples);
+        byteData += numSamples * SampleConversion::kBytesPerI24Packed;
 #endif
         framesLeft -= framesRead;
     }
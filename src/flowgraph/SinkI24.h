@@ -31,7 +31,7 @@ namespace flowgraph {
  */
 class SinkI24 : public FlowGraphSink {
 public:
-    explicit SinkI24(int32_t channelCount);
+    explicit SinkI24(int32_t channelCount, int32_t framesPerBuffer = kDefaultBufferSize);
 
     int32_t read(void *data, int32_t numFrames) override;
 
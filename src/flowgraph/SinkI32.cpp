@@ -19,13 +19,13 @@
 #endif
 
 #include "FlowGraphNode.h"
-#include "FlowgraphUtilities.h"
+#include "SampleConversion.h"
 #include "SinkI32.h"
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-SinkI32::SinkI32(int32_t channelCount)
-        : FlowGraphSink(channelCount) {}
+SinkI32::SinkI32(int32_t channelCount, int32_t framesPerBuffer)
+        : FlowGraphSink(channelCount, framesPerBuffer) {}
 
 int32_t SinkI32::read(void *data, int32_t numFrames) {
     int32_t *intData = (int32_t *) data;
@@ -45,9 +45,8 @@ int32_t SinkI32::read(void *data, int32_t numFrames) {
         intData += numSamples;
         signal += numSamples;
 #else
-        for (int i = 0; i < numSamples; i++) {
-            *intData++ = FlowgraphUtilities::clamp32FromFloat(*signal++);
-        }
+        SampleConversion::floatToI32(intData, signal, numSamples);
+        intData += numSamples;
 #endif
         framesLeft -= framesRead;
     }
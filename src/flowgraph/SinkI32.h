@@ -26,7 +26,7 @@ namespace flowgraph {
 
 class SinkI32 : public FlowGraphSink {
 public:
-    explicit SinkI32(int32_t channelCount);
+    explicit SinkI32(int32_t channelCount, int32_t framesPerBuffer = kDefaultBufferSize);
     ~SinkI32() override = default;
 
     int32_t read(void *data, int32_t numFrames) override;
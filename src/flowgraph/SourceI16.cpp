@@ -18,6 +18,7 @@
 #include <unistd.h>
 
 #include "FlowGraphNode.h"
+#include "SampleConversion.h"
 #include "SourceI16.h"
 
 #if FLOWGRAPH_ANDROID_INTERNAL
@@ -26,8 +27,8 @@
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-SourceI16::SourceI16(int32_t channelCount)
-        : FlowGraphSourceBuffered(channelCount) {
+SourceI16::SourceI16(int32_t channelCount, int32_t framesPerBuffer)
+        : FlowGraphSourceBuffered(channelCount, framesPerBuffer) {
 }
 
 int32_t SourceI16::onProcess(int32_t numFrames) {
@@ -44,9 +45,7 @@ int32_t SourceI16::onProcess(int32_t numFrames) {
 #if FLOWGRAPH_ANDROID_INTERNAL
     memcpy_to_float_from_i16(floatData, shortData, numSamples);
 #else
-    for (int i = 0; i < numSamples; i++) {
-        *floatData++ = *shortData++ * (1.0f / 32768);
-    }
+    SampleConversion::i16ToFloat(floatData, shortData, numSamples);
 #endif
 
     mFrameIndex += framesToProcess;
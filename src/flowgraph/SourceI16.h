@@ -29,7 +29,7 @@ namespace flowgraph {
  */
 class SourceI16 : public FlowGraphSourceBuffered {
 public:
-    explicit SourceI16(int32_t channelCount);
+    explicit SourceI16(int32_t channelCount, int32_t framesPerBuffer = kDefaultBufferSize);
 
     int32_t onProcess(int32_t numFrames) override;
 
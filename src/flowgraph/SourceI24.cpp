@@ -22,14 +22,15 @@
 #endif
 
 #include "FlowGraphNode.h"
+#include "SampleConversion.h"
 #include "SourceI24.h"
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
 constexpr int kBytesPerI24Packed = 3;
 
-SourceI24::SourceI24(int32_t channelCount)
-        : FlowGraphSourceBuffered(channelCount) {
+SourceI24::SourceI24(int32_t channelCount, int32_t framesPerBuffer)
+        : FlowGraphSourceBuffered(channelCount, framesPerBuffer) {
 }
 
 int32_t SourceI24::onProcess(int32_t numFrames) {
@@ -46,18 +47,7 @@ int32_t SourceI24::onProcess(int32_t numFrames) {
 #if FLOWGRAPH_ANDROID_INTERNAL
     memcpy_to_float_from_p24(floatData, byteData, numSamples);
 #else
-    static const float scale = 1. / (float)(1UL << 31);
-    for (int i = 0; i < numSamples; i++) {
-        // Assemble the data assuming Little Endian format.
-        int32_t pad = byteData[2];
-        pad <<= 8;
-        pad |= byteData[1];
-        pad <<= 8;
-        pad |= byteData[0];
-        pad <<= 8; // Shift to 32 bit data so the sign is correct.
-        byteData += kBytesPerI24Packed;
-        *floatData++ = pad * scale; // scale to range -1.0 to 1.0
-    }
+    SampleConversion::packedI24ToFloat(floatData, byteData, numSamples);
 #endif
 
     mFrameIndex += framesToProcess;
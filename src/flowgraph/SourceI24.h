@@ -30,7 +30,7 @@ namespace flowgraph {
  */
 class SourceI24 : public FlowGraphSourceBuffered {
 public:
-    explicit SourceI24(int32_t channelCount);
+    explicit SourceI24(int32_t channelCount, int32_t framesPerBuffer = kDefaultBufferSize);
 
     int32_t onProcess(int32_t numFrames) override;
 
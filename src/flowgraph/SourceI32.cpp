@@ -22,12 +22,13 @@
 #endif
 
 #include "FlowGraphNode.h"
+#include "SampleConversion.h"
 #include "SourceI32.h"
 
 using namespace FLOWGRAPH_OUTER_NAMESPACE::flowgraph;
 
-SourceI32::SourceI32(int32_t channelCount)
-        : FlowGraphSourceBuffered(channelCount) {
+SourceI32::SourceI32(int32_t channelCount, int32_t framesPerBuffer)
+        : FlowGraphSourceBuffered(channelCount, framesPerBuffer) {
 }
 
 int32_t SourceI32::onProcess(int32_t numFrames) {
@@ -44,9 +45,7 @@ int32_t SourceI32::onProcess(int32_t numFrames) {
 #if FLOWGRAPH_ANDROID_INTERNAL
     memcpy_to_float_from_i32(floatData, intData, numSamples);
 #else
-    for (int i = 0; i < numSamples; i++) {
-        *floatData++ = *intData++ * kScale;
-    }
+    SampleConversion::i32ToFloat(floatData, intData, numSamples);
 #endif
 
     mFrameIndex += framesToProcess;
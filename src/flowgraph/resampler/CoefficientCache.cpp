@@ -0,0 +1,84 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "CoefficientCache.h"
+
+using namespace resampler;
+
+constexpr int32_t CoefficientCache::kMaxTables; // needed before C++17
+
+CoefficientCache::Table CoefficientCache::get(const Key &key, const Generator &generator) {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        auto it = mTables.find(key);
+        if (it != mTables.end()) {
+            mHitCount++;
+            return it->second;
+        }
+        mMissCount++;
+    }
+
+    // Generate outside the lock so that other resamplers are not blocked.
+    auto coefficients = std::make_shared<std::vector<float>>();
+    generator(*coefficients);
+    Table table = std::move(coefficients);
+
+    std::lock_guard<std::mutex> lock(mLock);
+    // Another thread may have added the same table while we were generating.
+    auto it = mTables.find(key);
+    if (it != mTables.end()) {
+        return it->second;
+    }
+    if (static_cast<int32_t>(mTables.size()) >= kMaxTables) {
+        removeUnusedTables();
+    }
+    if (static_cast<int32_t>(mTables.size()) < kMaxTables) {
+        mTables[key] = table;
+    }
+    return table;
+}
+
+void CoefficientCache::removeUnusedTables() {
+    for (auto it = mTables.begin(); it != mTables.end();) {
+        if (it->second.use_count() == 1) {
+            it = mTables.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CoefficientCache::clear() {
+    std::lock_guard<std::mutex> lock(mLock);
+    mTables.clear();
+    mHitCount = 0;
+    mMissCount = 0;
+}
+
+int64_t CoefficientCache::getHitCount() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mHitCount;
+}
+
+int64_t CoefficientCache::getMissCount() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return mMissCount;
+}
+
+int32_t CoefficientCache::getTableCount() const {
+    std::lock_guard<std::mutex> lock(mLock);
+    return static_cast<int32_t>(mTables.size());
+}
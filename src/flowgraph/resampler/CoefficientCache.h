@@ -0,0 +1,124 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_COEFFICIENT_CACHE_H
+#define OBOE_COEFFICIENT_CACHE_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+#include <sys/types.h>
+
+namespace resampler {
+
+/**
+ * Process-wide cache of the filter coefficient tables used by the resamplers.
+ *
+ * Generating a table can take thousands of calls to sinf() and the window function.
+ * The tables never change once they have been generated so resamplers with the same
+ * parameters can share one table. This is useful when streams are closed and
+ * reopened, for example after a disconnect.
+ *
+ * This is thread safe. It should only be used when a resampler is constructed,
+ * not from a real-time thread, because it uses a mutex and allocates memory.
+ */
+class CoefficientCache {
+public:
+    /**
+     * The parameters that determine the contents of a table.
+     */
+    struct Key {
+        int32_t numTaps;
+        int32_t numerator;   // input rate, reduced
+        int32_t denominator; // output rate, reduced
+        int32_t numRows;
+        double  phaseIncrement;
+        float   normalizedCutoff;
+        int32_t window;      // identifies the window function
+        bool    hasGuardRow;
+
+        bool operator<(const Key &other) const {
+            return std::tie(numTaps, numerator, denominator, numRows,
+                            phaseIncrement, normalizedCutoff, window, hasGuardRow)
+                    < std::tie(other.numTaps, other.numerator, other.denominator, other.numRows,
+                               other.phaseIncrement, other.normalizedCutoff, other.window,
+                               other.hasGuardRow);
+        }
+    };
+
+    using Table = std::shared_ptr<const std::vector<float>>;
+    using Generator = std::function<void(std::vector<float> &coefficients)>;
+
+    static CoefficientCache &getInstance() {
+        static CoefficientCache instance; // singleton
+        return instance;
+    }
+
+    /**
+     * Return the table for the key.
+     * If it is not in the cache then call the generator to fill a new table.
+     *
+     * @param key parameters used to generate the table
+     * @param generator fills in the coefficients for the key
+     * @return shared table, never null
+     */
+    Table get(const Key &key, const Generator &generator);
+
+    /**
+     * Remove all of the tables and reset the statistics.
+     * Resamplers that are using a table will keep their own reference.
+     */
+    void clear();
+
+    /**
+     * @return number of calls to get() that found a table in the cache
+     */
+    int64_t getHitCount() const;
+
+    /**
+     * @return number of calls to get() that had to generate a table
+     */
+    int64_t getMissCount() const;
+
+    /**
+     * @return number of tables currently held by the cache
+     */
+    int32_t getTableCount() const;
+
+    /**
+     * Tables that are not being used by any resampler will be removed when
+     * the cache is full. If every table is in use then new tables are not cached.
+     */
+    static constexpr int32_t kMaxTables = 16; // arbitrary
+
+private:
+    CoefficientCache() = default;
+
+    // Remove tables that are only referenced by the cache.
+    void removeUnusedTables();
+
+    mutable std::mutex    mLock;
+    std::map<Key, Table>  mTables;
+    int64_t               mHitCount = 0;
+    int64_t               mMissCount = 0;
+};
+
+}
+
+#endif //OBOE_COEFFICIENT_CACHE_H
@@ -0,0 +1,49 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "FillLevelController.h"
+
+using namespace resampler;
+
+void FillLevelController::reset() {
+    mStarted = false;
+    mFillLevel = 0.0;
+    mIntegral = 0.0;
+    mRateScaler = 1.0;
+}
+
+double FillLevelController::update(int32_t fillLevel, int32_t numFrames) {
+    if (!mStarted) {
+        mFillLevel = fillLevel;
+        mStarted = true;
+    } else {
+        double coefficient = std::min(1.0, numFrames / kSmoothingFrames);
+        mFillLevel += coefficient * (fillLevel - mFillLevel);
+    }
+    const double error = mFillLevel - mTargetFrames;
+
+    // This is critically damped for a FIFO, which integrates the rate error.
+    mIntegral += error * numFrames / (4.0 * kCorrectionFrames * kCorrectionFrames);
+    mIntegral = std::max(-mMaxDeviation, std::min(mMaxDeviation, mIntegral));
+    double target = 1.0 + (error / kCorrectionFrames) + mIntegral;
+    target = std::max(1.0 - mMaxDeviation, std::min(1.0 + mMaxDeviation, target));
+
+    const double maxSlew = kMaxSlewPerFrame * numFrames;
+    mRateScaler += std::max(-maxSlew, std::min(maxSlew, target - mRateScaler));
+    return mRateScaler;
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_FILL_LEVEL_CONTROLLER_H
+#define OBOE_FILL_LEVEL_CONTROLLER_H
+
+#include <sys/types.h>
+
+namespace resampler {
+
+/**
+ * Steer a variable rate resampler so that the FIFO feeding it stays near a target fill level.
+ *
+ * This is used when the input and output are driven by different clocks, for example
+ * in a full duplex stream. Call update() once per callback with the number of frames
+ * waiting in the input FIFO, then pass the result to MultiChannelResampler::setRateScaler().
+ *
+ * The fill level is smoothed to remove the jitter caused by bursts.
+ * A proportional-integral loop then adjusts the rate. The integral term will settle
+ * at the drift between the two clocks.
+ * The rate is limited to 1.0 +/- getMaxDeviation() so the pitch change is not audible.
+ */
+class FillLevelController {
+public:
+    /**
+     * @param targetFrames fill level to steer toward
+     */
+    explicit FillLevelController(int32_t targetFrames = 0)
+            : mTargetFrames(targetFrames) {}
+
+    void setTargetFrames(int32_t targetFrames) {
+        mTargetFrames = targetFrames;
+    }
+
+    int32_t getTargetFrames() const {
+        return mTargetFrames;
+    }
+
+    /**
+     * @param maxDeviation largest allowed difference from a rate scaler of 1.0
+     */
+    void setMaxDeviation(double maxDeviation) {
+        mMaxDeviation = maxDeviation;
+    }
+
+    double getMaxDeviation() const {
+        return mMaxDeviation;
+    }
+
+    /**
+     * Forget the history. The next update() will start from its fill level.
+     */
+    void reset();
+
+    /**
+     * @param fillLevel number of frames waiting in the FIFO
+     * @param numFrames number of frames processed since the previous update
+     * @return rate scaler for MultiChannelResampler::setRateScaler()
+     */
+    double update(int32_t fillLevel, int32_t numFrames);
+
+    double getRateScaler() const {
+        return mRateScaler;
+    }
+
+    /**
+     * @return the smoothed fill level
+     */
+    double getFillLevel() const {
+        return mFillLevel;
+    }
+
+    // These time constants are in frames, so they do not depend on the callback size.
+    // Time constant for smoothing the fill level, about 0.1 seconds at 48000 Hz.
+    static constexpr double kSmoothingFrames = 4800.0; // arbitrary
+    // Time constant for correcting the fill level, about 2 seconds at 48000 Hz.
+    static constexpr double kCorrectionFrames = 96000.0; // arbitrary
+    // Largest change to the rate scaler per frame so that the pitch changes smoothly.
+    static constexpr double kMaxSlewPerFrame = 1.0e-7; // arbitrary
+    // Typical crystal oscillators are within 100 parts per million.
+    static constexpr double kDefaultMaxDeviation = 0.001; // arbitrary
+
+private:
+    int32_t mTargetFrames;
+    double  mMaxDeviation = kDefaultMaxDeviation;
+    bool    mStarted = false;
+    double  mFillLevel = 0.0;
+    double  mIntegral = 0.0;
+    double  mRateScaler = 1.0;
+};
+
+}
+
+#endif //OBOE_FILL_LEVEL_CONTROLLER_H
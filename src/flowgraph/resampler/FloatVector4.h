@@ -0,0 +1,175 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_FLOAT_VECTOR_4_H
+#define OBOE_FLOAT_VECTOR_4_H
+
+// Define RESAMPLER_DISABLE_SIMD to use the scalar code everywhere.
+#if !defined(RESAMPLER_DISABLE_SIMD)
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_USE_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RESAMPLER_USE_SSE2 1
+#endif
+#endif
+
+namespace resampler {
+
+/**
+ * Four floats that are processed together using NEON or SSE when available.
+ * Loads and stores do not need to be aligned.
+ *
+ * Multiply and add are separate operations, as in the scalar code,
+ * although the compiler may fuse them when allowed.
+ */
+class FloatVector4 {
+public:
+    static FloatVector4 zero() {
+#if RESAMPLER_USE_NEON
+        return FloatVector4(vdupq_n_f32(0.0f));
+#elif RESAMPLER_USE_SSE2
+        return FloatVector4(_mm_setzero_ps());
+#else
+        return FloatVector4(0.0f, 0.0f, 0.0f, 0.0f);
+#endif
+    }
+
+    static FloatVector4 load(const float *data) {
+#if RESAMPLER_USE_NEON
+        return FloatVector4(vld1q_f32(data));
+#elif RESAMPLER_USE_SSE2
+        return FloatVector4(_mm_loadu_ps(data));
+#else
+        return FloatVector4(data[0], data[1], data[2], data[3]);
+#endif
+    }
+
+    void store(float *data) const {
+#if RESAMPLER_USE_NEON
+        vst1q_f32(data, mValue);
+#elif RESAMPLER_USE_SSE2
+        _mm_storeu_ps(data, mValue);
+#else
+        for (int i = 0; i < 4; i++) data[i] = mValue[i];
+#endif
+    }
+
+    /**
+     * @return this + (a * b)
+     */
+    FloatVector4 multiplyAdd(const FloatVector4 &a, const FloatVector4 &b) const {
+#if RESAMPLER_USE_NEON
+        return FloatVector4(vaddq_f32(mValue, vmulq_f32(a.mValue, b.mValue)));
+#elif RESAMPLER_USE_SSE2
+        return FloatVector4(_mm_add_ps(mValue, _mm_mul_ps(a.mValue, b.mValue)));
+#else
+        return FloatVector4(mValue[0] + a.mValue[0] * b.mValue[0],
+                            mValue[1] + a.mValue[1] * b.mValue[1],
+                            mValue[2] + a.mValue[2] * b.mValue[2],
+                            mValue[3] + a.mValue[3] * b.mValue[3]);
+#endif
+    }
+
+    /**
+     * @return this + (a * scalar)
+     */
+    FloatVector4 multiplyAdd(const FloatVector4 &a, float scalar) const {
+#if RESAMPLER_USE_NEON
+        return FloatVector4(vaddq_f32(mValue, vmulq_n_f32(a.mValue, scalar)));
+#elif RESAMPLER_USE_SSE2
+        return FloatVector4(_mm_add_ps(mValue, _mm_mul_ps(a.mValue, _mm_set1_ps(scalar))));
+#else
+        return multiplyAdd(a, FloatVector4(scalar, scalar, scalar, scalar));
+#endif
+    }
+
+    FloatVector4 operator+(const FloatVector4 &other) const {
+#if RESAMPLER_USE_NEON
+        return FloatVector4(vaddq_f32(mValue, other.mValue));
+#elif RESAMPLER_USE_SSE2
+        return FloatVector4(_mm_add_ps(mValue, other.mValue));
+#else
+        return FloatVector4(mValue[0] + other.mValue[0], mValue[1] + other.mValue[1],
+                            mValue[2] + other.mValue[2], mValue[3] + other.mValue[3]);
+#endif
+    }
+
+    /**
+     * @return {a0, a0, a1, a1}, used to apply one coefficient to a stereo frame
+     */
+    FloatVector4 duplicateLow() const {
+#if RESAMPLER_USE_NEON
+        return FloatVector4(vzipq_f32(mValue, mValue).val[0]);
+#elif RESAMPLER_USE_SSE2
+        return FloatVector4(_mm_unpacklo_ps(mValue, mValue));
+#else
+        return FloatVector4(mValue[0], mValue[0], mValue[1], mValue[1]);
+#endif
+    }
+
+    /**
+     * @return {a2, a2, a3, a3}
+     */
+    FloatVector4 duplicateHigh() const {
+#if RESAMPLER_USE_NEON
+        return FloatVector4(vzipq_f32(mValue, mValue).val[1]);
+#elif RESAMPLER_USE_SSE2
+        return FloatVector4(_mm_unpackhi_ps(mValue, mValue));
+#else
+        return FloatVector4(mValue[2], mValue[2], mValue[3], mValue[3]);
+#endif
+    }
+
+    /**
+     * @return (a0 + a2) + (a1 + a3)
+     */
+    float sum() const {
+        float even;
+        float odd;
+        sumPairs(&even, &odd);
+        return even + odd;
+    }
+
+    /**
+     * Add the even and odd lanes separately, eg. left and right of two stereo frames.
+     * @param even receives a0 + a2
+     * @param odd receives a1 + a3
+     */
+    void sumPairs(float *even, float *odd) const {
+        float values[4];
+        store(values);
+        *even = values[0] + values[2];
+        *odd = values[1] + values[3];
+    }
+
+private:
+#if RESAMPLER_USE_NEON
+    explicit FloatVector4(float32x4_t value) : mValue(value) {}
+    float32x4_t mValue;
+#elif RESAMPLER_USE_SSE2
+    explicit FloatVector4(__m128 value) : mValue(value) {}
+    __m128 mValue;
+#else
+    FloatVector4(float a0, float a1, float a2, float a3) : mValue{a0, a1, a2, a3} {}
+    float mValue[4];
+#endif
+};
+
+}
+
+#endif //OBOE_FLOAT_VECTOR_4_H
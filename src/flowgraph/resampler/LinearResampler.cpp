@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <string.h>
+
 #include "LinearResampler.h"
 
 using namespace resampler;
@@ -40,3 +42,10 @@ void LinearResampler::readFrame(float *frame) {
         *frame++ = f0 + (phase * (f1 - f0));
     }
 }
+
+MultiChannelResampler::ProcessResult LinearResampler::process(const float *input,
+                                                              int32_t numInputFrames,
+                                                              float *output,
+                                                              int32_t maxOutputFrames) {
+    return processFrames(this, input, numInputFrames, output, maxOutputFrames);
+}
@@ -35,6 +35,11 @@ public:
 
     void readFrame(float *frame) override;
 
+    ProcessResult process(const float *input,
+                          int32_t numInputFrames,
+                          float *output,
+                          int32_t maxOutputFrames) override;
+
 private:
     std::unique_ptr<float[]> mPreviousFrame;
     std::unique_ptr<float[]> mCurrentFrame;
@@ -14,8 +14,12 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <math.h>
 
+#include "CoefficientCache.h"
 #include "IntegerRatio.h"
 #include "LinearResampler.h"
 #include "MultiChannelResampler.h"
@@ -23,6 +27,7 @@
 #include "PolyphaseResamplerMono.h"
 #include "PolyphaseResamplerStereo.h"
 #include "SincResampler.h"
+#include "SincResamplerMono.h"
 #include "SincResamplerStereo.h"
 
 using namespace resampler;
@@ -31,17 +36,49 @@ MultiChannelResampler::MultiChannelResampler(const MultiChannelResampler::Builde
         : mNumTaps(builder.getNumTaps())
         , mX(builder.getChannelCount() * builder.getNumTaps() * 2)
         , mSingleFrame(builder.getChannelCount())
+        , mVariableRate(builder.isVariableRate())
         , mChannelCount(builder.getChannelCount())
         {
-    // Reduce sample rates to the smallest ratio.
-    // For example 44100/48000 would become 147/160.
-    IntegerRatio ratio(builder.getInputRate(), builder.getOutputRate());
-    ratio.reduce();
-    mNumerator = ratio.getNumerator();
-    mDenominator = ratio.getDenominator();
+    if (mVariableRate) {
+        // Use a fixed denominator so that the numerator can be adjusted in small steps.
+        mDenominator = kVariableRateDenominator;
+        mNumerator = static_cast<int32_t>(llround(
+                (double) builder.getInputRate() * kVariableRateDenominator
+                / builder.getOutputRate()));
+    } else {
+        // Reduce sample rates to the smallest ratio.
+        // For example 44100/48000 would become 147/160.
+        IntegerRatio ratio(builder.getInputRate(), builder.getOutputRate());
+        ratio.reduce();
+        mNumerator = ratio.getNumerator();
+        mDenominator = ratio.getDenominator();
+    }
+    mNominalNumerator = mNumerator;
     mIntegerPhase = mDenominator;
 }
 
+// The library is built with -Ofast, which assumes that there are no NaNs or infinities,
+// so std::isfinite() would always be true. Check the exponent bits instead.
+static bool isFinite(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return ((bits >> 52) & 0x7FF) != 0x7FF;
+}
+
+bool MultiChannelResampler::setRateScaler(double rateScaler) {
+    if (!mVariableRate || !isFinite(rateScaler)) {
+        return false;
+    }
+    // The phase can reach mDenominator + mNumerator before it wraps, and must fit in an int32_t.
+    const double numerator = std::round(mNominalNumerator * rateScaler);
+    if (numerator < 1.0 || numerator > static_cast<double>(INT32_MAX - mDenominator)) {
+        return false;
+    }
+    mRateScaler = rateScaler;
+    mNumerator = static_cast<int32_t>(numerator);
+    return true;
+}
+
 // static factory method
 MultiChannelResampler *MultiChannelResampler::make(int32_t channelCount,
                                                    int32_t inputRate,
@@ -85,7 +122,9 @@ MultiChannelResampler *MultiChannelResampler::Builder::build() {
     }
     IntegerRatio ratio(getInputRate(), getOutputRate());
     ratio.reduce();
-    bool usePolyphase = (getNumTaps() * ratio.getDenominator()) <= kMaxCoefficients;
+    // The polyphase resamplers cannot change their ratio.
+    bool usePolyphase = !isVariableRate()
+            && (getNumTaps() * ratio.getDenominator()) <= kMaxCoefficients;
     if (usePolyphase) {
         if (getChannelCount() == 1) {
             return new PolyphaseResamplerMono(*this);
@@ -96,8 +135,9 @@ MultiChannelResampler *MultiChannelResampler::Builder::build() {
         }
     } else {
         // Use less optimized resampler that uses a float phaseIncrement.
-        // TODO mono resampler
-        if (getChannelCount() == 2) {
+        if (getChannelCount() == 1) {
+            return new SincResamplerMono(*this);
+        } else if (getChannelCount() == 2) {
             return new SincResamplerStereo(*this);
         } else {
             return new SincResampler(*this);
@@ -118,19 +158,81 @@ void MultiChannelResampler::writeFrame(const float *frame) {
     }
 }
 
+void MultiChannelResampler::primeDelayLine(const float *history, int32_t numFrames) {
+    // Zeros stand in for the frames from before the history.
+    std::fill(mSingleFrame.begin(), mSingleFrame.end(), 0.0f);
+    for (int32_t i = numFrames; i < getNumTaps(); i++) {
+        writeFrame(mSingleFrame.data());
+    }
+    for (int32_t i = std::max(0, numFrames - getNumTaps()); i < numFrames; i++) {
+        writeFrame(&history[i * getChannelCount()]);
+    }
+}
+
+MultiChannelResampler::ProcessResult MultiChannelResampler::process(const float *input,
+                                                                   int32_t numInputFrames,
+                                                                   float *output,
+                                                                   int32_t maxOutputFrames) {
+    // Generic version that calls the virtual methods for each frame.
+    ProcessResult result;
+    while (result.framesProduced < maxOutputFrames) {
+        if (isWriteNeeded()) {
+            if (result.framesConsumed >= numInputFrames) {
+                break;
+            }
+            writeNextFrame(input);
+            input += getChannelCount();
+            result.framesConsumed++;
+        } else {
+            readNextFrame(output);
+            output += getChannelCount();
+            result.framesProduced++;
+        }
+    }
+    return result;
+}
+
 float MultiChannelResampler::sinc(float radians) {
     if (abs(radians) < 1.0e-9) return 1.0f;   // avoid divide by zero
     return sinf(radians) / radians;   // Sinc function
 }
 
-// Generate coefficients in the order they will be used by readFrame().
-// This is more complicated but readFrame() is called repeatedly and should be optimized.
 void MultiChannelResampler::generateCoefficients(int32_t inputRate,
                                               int32_t outputRate,
                                               int32_t numRows,
                                               double phaseIncrement,
-                                              float normalizedCutoff) {
-    mCoefficients.resize(getNumTaps() * numRows);
+                                              float normalizedCutoff,
+                                              bool hasGuardRow) {
+    IntegerRatio ratio(inputRate, outputRate);
+    ratio.reduce();
+    CoefficientCache::Key key;
+    key.numTaps = getNumTaps();
+    key.numerator = ratio.getNumerator();
+    key.denominator = ratio.getDenominator();
+    key.numRows = numRows;
+    key.phaseIncrement = phaseIncrement;
+    key.normalizedCutoff = normalizedCutoff;
+    key.window = MCR_USE_KAISER;
+    key.hasGuardRow = hasGuardRow;
+    mCoefficientTable = CoefficientCache::getInstance().get(key,
+            [&](std::vector<float> &coefficients) {
+                computeCoefficients(coefficients, inputRate, outputRate,
+                                    numRows, phaseIncrement, normalizedCutoff, hasGuardRow);
+            });
+    mCoefficients = mCoefficientTable->data();
+    mNumCoefficients = static_cast<int32_t>(mCoefficientTable->size());
+}
+
+// Generate coefficients in the order they will be used by readFrame().
+// This is more complicated but readFrame() is called repeatedly and should be optimized.
+void MultiChannelResampler::computeCoefficients(std::vector<float> &coefficients,
+                                                int32_t inputRate,
+                                                int32_t outputRate,
+                                                int32_t numRows,
+                                                double phaseIncrement,
+                                                float normalizedCutoff,
+                                                bool hasGuardRow) {
+    coefficients.resize(getNumTaps() * numRows);
     int coefficientIndex = 0;
     double phase = 0.0; // ranges from 0.0 to 1.0, fraction between samples
     // Stretch the sinc function for low pass filtering.
@@ -153,19 +255,19 @@ void MultiChannelResampler::generateCoefficients(int32_t inputRate,
             float window = mCoshWindow(tapPhase * numTapsHalfInverse);
 #endif
             float coefficient = sinc(radians * cutoffScaler) * window;
-            mCoefficients.at(coefficientIndex++) = coefficient;
+            coefficients.at(coefficientIndex++) = coefficient;
             gain += coefficient;
             tapPhase += 1.0;
         }
         phase += phaseIncrement;
-        while (phase >= 1.0) {
+        while (!hasGuardRow && phase >= 1.0) {
             phase -= 1.0;
         }
 
         // Correct for gain variations.
         float gainCorrection = 1.0 / gain; // normalize the gain
         for (int tap = 0; tap < getNumTaps(); tap++) {
-            mCoefficients.at(gainCursor + tap) *= gainCorrection;
+            coefficients.at(gainCursor + tap) *= gainCorrection;
         }
     }
 }
@@ -117,6 +117,20 @@ public:
             return this;
         }
 
+        /**
+         * Allow the ratio of the rates to be adjusted while running by calling
+         * setRateScaler(). This can be used to follow a clock that drifts.
+         * The resampler will interpolate between rows of coefficients instead of using
+         * a polyphase filter, which uses more CPU. Default is false.
+         *
+         * @param variableRate true to allow the rate to be changed
+         * @return address of this builder for chaining calls
+         */
+        Builder *setVariableRate(bool variableRate) {
+            mVariableRate = variableRate;
+            return this;
+        }
+
         int32_t getNumTaps() const {
             return mNumTaps;
         }
@@ -137,12 +151,17 @@ public:
             return mNormalizedCutoff;
         }
 
+        bool isVariableRate() const {
+            return mVariableRate;
+        }
+
     protected:
         int32_t mChannelCount = 1;
         int32_t mNumTaps = 16;
         int32_t mInputRate = 48000;
         int32_t mOutputRate = 48000;
         float   mNormalizedCutoff = kDefaultNormalizedCutoff;
+        bool    mVariableRate = false;
     };
 
     virtual ~MultiChannelResampler() = default;
@@ -185,6 +204,81 @@ public:
         advanceRead();
     }
 
+    /**
+     * Number of frames used and generated by process().
+     */
+    struct ProcessResult {
+        int32_t framesConsumed = 0;
+        int32_t framesProduced = 0;
+    };
+
+    /**
+     * Resample a block of interleaved frames.
+     *
+     * Input frames are written and output frames are read until either the output is full
+     * or another input frame is needed and the input is empty.
+     * Any input frames that were not consumed should be passed to the next call.
+     *
+     * This gives the same result, within float rounding, as calling writeNextFrame()
+     * and readNextFrame() but the loop runs inside the resampler so the per frame calls
+     * are not virtual.
+     *
+     * @param input interleaved input frames
+     * @param numInputFrames number of frames in the input
+     * @param output buffer for interleaved output frames
+     * @param maxOutputFrames capacity of the output in frames
+     * @return the number of frames consumed and produced
+     */
+    virtual ProcessResult process(const float *input,
+                                  int32_t numInputFrames,
+                                  float *output,
+                                  int32_t maxOutputFrames);
+
+    /**
+     * Scale the ratio of the input rate to the output rate.
+     * A value above 1.0 consumes input faster, which is useful when the input has
+     * more data than expected, for example because its clock is slightly fast.
+     *
+     * The new ratio is used starting with the next output frame.
+     * The resolution is about 0.06 parts per million of the input rate.
+     * This is not thread safe so call it from the thread that is resampling.
+     *
+     * @param rateScaler ratio relative to the rates passed to the Builder, typically near 1.0
+     * @return false if the resampler was not built with setVariableRate(true),
+     *         or if rateScaler is not finite or would make the ratio zero or above about 127,
+     *         in which case the ratio is not changed
+     */
+    bool setRateScaler(double rateScaler);
+
+    double getRateScaler() const {
+        return mRateScaler;
+    }
+
+    bool isVariableRate() const {
+        return mVariableRate;
+    }
+
+    /**
+     * Fill the delay line with the most recent input frames, so that this resampler
+     * can take over from another one that has been reading the same input.
+     * Call copyPhase() as well so the output continues from the same position.
+     *
+     * @param history interleaved input frames, oldest first
+     * @param numFrames number of frames in the history, only the last getNumTaps() are used,
+     *                  and zeros are used if there are fewer
+     */
+    void primeDelayLine(const float *history, int32_t numFrames);
+
+    /**
+     * Continue from the same phase as another resampler.
+     * Both must have been built with the same rates and must not be variable rate.
+     * They may have different numbers of taps.
+     */
+    void copyPhase(const MultiChannelResampler &other) {
+        mIntegerPhase = other.mIntegerPhase;
+        onPhaseCopied();
+    }
+
     int getNumTaps() const {
         return mNumTaps;
     }
@@ -215,6 +309,11 @@ protected:
      */
     virtual void readFrame(float *frame) = 0;
 
+    /**
+     * Called by copyPhase() so that a subclass can update anything that follows the phase.
+     */
+    virtual void onPhaseCopied() {}
+
     void advanceWrite() {
         mIntegerPhase -= mDenominator;
     }
@@ -224,18 +323,58 @@ protected:
     }
 
     /**
-     * Generate the filter coefficients in optimal order.
+     * The phase loop used by process().
+     *
+     * The frames are read and written by calling T::readFrame() and T::writeFrame()
+     * directly so that a subclass can have them inlined by passing itself as T.
+     * A subclass that overrides readFrame() or writeFrame() must also override process().
+     */
+    template <class T>
+    static ProcessResult processFrames(T *resampler,
+                                       const float *input,
+                                       int32_t numInputFrames,
+                                       float *output,
+                                       int32_t maxOutputFrames) {
+        const int32_t channelCount = resampler->getChannelCount();
+        ProcessResult result;
+        while (result.framesProduced < maxOutputFrames) {
+            if (resampler->isWriteNeeded()) {
+                if (result.framesConsumed >= numInputFrames) {
+                    break;
+                }
+                resampler->T::writeFrame(input);
+                resampler->advanceWrite();
+                input += channelCount;
+                result.framesConsumed++;
+            } else {
+                resampler->T::readFrame(output);
+                resampler->advanceRead();
+                output += channelCount;
+                result.framesProduced++;
+            }
+        }
+        return result;
+    }
+
+    /**
+     * Get the filter coefficients in optimal order.
+     * The table is shared with other resamplers that use the same parameters
+     * so it is only generated the first time. See CoefficientCache.
      * @param inputRate sample rate of the input stream
      * @param outputRate  sample rate of the output stream
      * @param numRows number of rows in the array that contain a set of tap coefficients
      * @param phaseIncrement how much to increment the phase between rows
      * @param normalizedCutoff filter cutoff frequency normalized to Nyquist rate of output
+     * @param hasGuardRow if true then the phase is not wrapped so the last row can be
+     *                    for a phase of 1.0, which lets readFrame() interpolate past the
+     *                    previous row without wrapping
      */
     void generateCoefficients(int32_t inputRate,
                               int32_t outputRate,
                               int32_t numRows,
                               double phaseIncrement,
-                              float normalizedCutoff);
+                              float normalizedCutoff,
+                              bool hasGuardRow = false);
 
 
     int32_t getIntegerPhase() {
@@ -243,7 +382,13 @@ protected:
     }
 
     static constexpr int kMaxCoefficients = 8 * 1024;
-    std::vector<float>   mCoefficients;
+    // Phase resolution used by variable rate resamplers. The phase is an int32_t so
+    // this supports ratios up to about 127.
+    static constexpr int32_t kVariableRateDenominator = 1 << 24;
+    // The table may be shared by other resamplers so it must not be modified.
+    std::shared_ptr<const std::vector<float>> mCoefficientTable;
+    const float         *mCoefficients = nullptr; // data in mCoefficientTable
+    int32_t              mNumCoefficients = 0;
 
     const int            mNumTaps;
     int                  mCursor = 0;
@@ -252,10 +397,21 @@ protected:
     int32_t              mIntegerPhase = 0;
     int32_t              mNumerator = 0;
     int32_t              mDenominator = 0;
+    int32_t              mNominalNumerator = 0; // before applying mRateScaler
+    double               mRateScaler = 1.0;
+    const bool           mVariableRate;
 
 
 private:
 
+    void computeCoefficients(std::vector<float> &coefficients,
+                             int32_t inputRate,
+                             int32_t outputRate,
+                             int32_t numRows,
+                             double phaseIncrement,
+                             float normalizedCutoff,
+                             bool hasGuardRow);
+
 #if MCR_USE_KAISER
     KaiserWindow           mKaiserWindow;
 #else
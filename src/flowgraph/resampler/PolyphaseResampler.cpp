@@ -18,13 +18,33 @@
 #include <math.h>
 #include "IntegerRatio.h"
 #include "PolyphaseResampler.h"
+#include "ResamplerKernels.h"
 
 using namespace resampler;
 
+// @return x such that (value * x) % modulus == 1, value and modulus must be coprime
+static int64_t calculateModularInverse(int64_t value, int64_t modulus) {
+    // Extended Euclidean algorithm.
+    int64_t oldRemainder = value % modulus;
+    int64_t remainder = modulus;
+    int64_t oldCoefficient = 1;
+    int64_t coefficient = 0;
+    while (remainder != 0) {
+        int64_t quotient = oldRemainder / remainder;
+        int64_t temp = oldRemainder - (quotient * remainder);
+        oldRemainder = remainder;
+        remainder = temp;
+        temp = oldCoefficient - (quotient * coefficient);
+        oldCoefficient = coefficient;
+        coefficient = temp;
+    }
+    return ((oldCoefficient % modulus) + modulus) % modulus;
+}
+
 PolyphaseResampler::PolyphaseResampler(const MultiChannelResampler::Builder &builder)
         : MultiChannelResampler(builder)
         {
-    assert((getNumTaps() % 4) == 0); // Required for loop unrolling.
+    assert((getNumTaps() % 4) == 0); // Required by the vector loops in the subclasses.
 
     int32_t inputRate = builder.getInputRate();
     int32_t outputRate = builder.getOutputRate();
@@ -34,29 +54,46 @@ PolyphaseResampler::PolyphaseResampler(const MultiChannelResampler::Builder &bui
     generateCoefficients(inputRate, outputRate,
                          numRows, phaseIncrement,
                          builder.getNormalizedCutoff());
+    mInverseNumerator = calculateModularInverse(mNumerator, mDenominator);
 }
 
-void PolyphaseResampler::readFrame(float *frame) {
-    // Clear accumulator for mixing.
-    std::fill(mSingleFrame.begin(), mSingleFrame.end(), 0.0);
+void PolyphaseResampler::onPhaseCopied() {
+    // Row r is used for the r'th read, modulo the number of rows. Before that read the
+    // phase is (r * mNumerator) % mDenominator, so the row can be found from the phase.
+    int64_t phase = ((getIntegerPhase() % mDenominator) + mDenominator) % mDenominator;
+    int64_t row = (phase * mInverseNumerator) % mDenominator;
+    mCoefficientCursor = static_cast<int32_t>(row) * mNumTaps;
+}
 
-//    printf("PolyphaseResampler: mCoefficientCursor = %4d\n", mCoefficientCursor);
+void PolyphaseResampler::readFrame(float *frame) {
     // Multiply input times windowed sinc function.
-    float *coefficients = &mCoefficients[mCoefficientCursor];
-    float *xFrame = &mX[mCursor * getChannelCount()];
-    for (int i = 0; i < mNumTaps; i++) {
-        float coefficient = *coefficients++;
-//        printf("PolyphaseResampler: coeff = %10.6f, xFrame[0] = %10.6f\n", coefficient, xFrame[0]);
-        for (int channel = 0; channel < getChannelCount(); channel++) {
-            mSingleFrame[channel] += *xFrame++ * coefficient;
-        }
+    const float *coefficients = &mCoefficients[mCoefficientCursor];
+    const float *xFrame = &mX[mCursor * getChannelCount()];
+    const int32_t channelCount = getChannelCount();
+    switch (mNumTaps) {
+        case 8:
+            ResamplerKernels::convolveChannels<8>(frame, xFrame, coefficients, channelCount, 8);
+            break;
+        case 16:
+            ResamplerKernels::convolveChannels<16>(frame, xFrame, coefficients, channelCount, 16);
+            break;
+        case 32:
+            ResamplerKernels::convolveChannels<32>(frame, xFrame, coefficients, channelCount, 32);
+            break;
+        default:
+            ResamplerKernels::convolveChannels<0>(frame, xFrame, coefficients, channelCount,
+                                                  mNumTaps);
+            break;
     }
 
     // Advance and wrap through coefficients.
-    mCoefficientCursor = (mCoefficientCursor + mNumTaps) % mCoefficients.size();
+    mCoefficientCursor = (mCoefficientCursor + mNumTaps) % mNumCoefficients;
+}
 
-    // Copy accumulator to output.
-    for (int channel = 0; channel < getChannelCount(); channel++) {
-        frame[channel] = mSingleFrame[channel];
-    }
+// Defined here so that readFrame() can be inlined into the loop.
+MultiChannelResampler::ProcessResult PolyphaseResampler::process(const float *input,
+                                                                 int32_t numInputFrames,
+                                                                 float *output,
+                                                                 int32_t maxOutputFrames) {
+    return processFrames(this, input, numInputFrames, output, maxOutputFrames);
 }
@@ -40,9 +40,18 @@ public:
 
     void readFrame(float *frame) override;
 
+    ProcessResult process(const float *input,
+                          int32_t numInputFrames,
+                          float *output,
+                          int32_t maxOutputFrames) override;
+
 protected:
 
+    void onPhaseCopied() override;
+
     int32_t                mCoefficientCursor = 0;
+    // (mNumerator * mInverseNumerator) % mDenominator == 1, used to find the row for a phase.
+    int64_t                mInverseNumerator = 1;
 
 };
 
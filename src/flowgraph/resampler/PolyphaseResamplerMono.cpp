@@ -16,6 +16,7 @@
 
 #include <cassert>
 #include "PolyphaseResamplerMono.h"
+#include "ResamplerKernels.h"
 
 using namespace resampler;
 
@@ -41,23 +42,30 @@ void PolyphaseResamplerMono::writeFrame(const float *frame) {
 }
 
 void PolyphaseResamplerMono::readFrame(float *frame) {
-    // Clear accumulator.
-    float sum = 0.0;
-
     // Multiply input times precomputed windowed sinc function.
     const float *coefficients = &mCoefficients[mCoefficientCursor];
-    float *xFrame = &mX[mCursor * MONO];
-    const int numLoops = mNumTaps >> 2; // n/4
-    for (int i = 0; i < numLoops; i++) {
-        // Manual loop unrolling, might get converted to SIMD.
-        sum += *xFrame++ * *coefficients++;
-        sum += *xFrame++ * *coefficients++;
-        sum += *xFrame++ * *coefficients++;
-        sum += *xFrame++ * *coefficients++;
+    const float *xFrame = &mX[mCursor * MONO];
+    switch (mNumTaps) {
+        case 8:
+            frame[0] = ResamplerKernels::convolveMono<8>(xFrame, coefficients, 8);
+            break;
+        case 16:
+            frame[0] = ResamplerKernels::convolveMono<16>(xFrame, coefficients, 16);
+            break;
+        case 32:
+            frame[0] = ResamplerKernels::convolveMono<32>(xFrame, coefficients, 32);
+            break;
+        default:
+            frame[0] = ResamplerKernels::convolveMono<0>(xFrame, coefficients, mNumTaps);
+            break;
     }
 
-    mCoefficientCursor = (mCoefficientCursor + mNumTaps) % mCoefficients.size();
+    mCoefficientCursor = (mCoefficientCursor + mNumTaps) % mNumCoefficients;
+}
 
-    // Copy accumulator to output.
-    frame[0] = sum;
+MultiChannelResampler::ProcessResult PolyphaseResamplerMono::process(const float *input,
+                                                                     int32_t numInputFrames,
+                                                                     float *output,
+                                                                     int32_t maxOutputFrames) {
+    return processFrames(this, input, numInputFrames, output, maxOutputFrames);
 }
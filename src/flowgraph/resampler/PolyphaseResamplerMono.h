@@ -32,6 +32,11 @@ public:
     void writeFrame(const float *frame) override;
 
     void readFrame(float *frame) override;
+
+    ProcessResult process(const float *input,
+                          int32_t numInputFrames,
+                          float *output,
+                          int32_t maxOutputFrames) override;
 };
 
 }
@@ -16,6 +16,7 @@
 
 #include <cassert>
 #include "PolyphaseResamplerStereo.h"
+#include "ResamplerKernels.h"
 
 using namespace resampler;
 
@@ -44,36 +45,30 @@ void PolyphaseResamplerStereo::writeFrame(const float *frame) {
 }
 
 void PolyphaseResamplerStereo::readFrame(float *frame) {
-    // Clear accumulators.
-    float left = 0.0;
-    float right = 0.0;
-
     // Multiply input times precomputed windowed sinc function.
     const float *coefficients = &mCoefficients[mCoefficientCursor];
-    float *xFrame = &mX[mCursor * STEREO];
-    const int numLoops = mNumTaps >> 2; // n/4
-    for (int i = 0; i < numLoops; i++) {
-        // Manual loop unrolling, might get converted to SIMD.
-        float coefficient = *coefficients++;
-        left += *xFrame++ * coefficient;
-        right += *xFrame++ * coefficient;
-
-        coefficient = *coefficients++; // next tap
-        left += *xFrame++ * coefficient;
-        right += *xFrame++ * coefficient;
-
-        coefficient = *coefficients++;  // next tap
-        left += *xFrame++ * coefficient;
-        right += *xFrame++ * coefficient;
-
-        coefficient = *coefficients++;  // next tap
-        left += *xFrame++ * coefficient;
-        right += *xFrame++ * coefficient;
+    const float *xFrame = &mX[mCursor * STEREO];
+    switch (mNumTaps) {
+        case 8:
+            ResamplerKernels::convolveStereo<8>(frame, xFrame, coefficients, 8);
+            break;
+        case 16:
+            ResamplerKernels::convolveStereo<16>(frame, xFrame, coefficients, 16);
+            break;
+        case 32:
+            ResamplerKernels::convolveStereo<32>(frame, xFrame, coefficients, 32);
+            break;
+        default:
+            ResamplerKernels::convolveStereo<0>(frame, xFrame, coefficients, mNumTaps);
+            break;
     }
 
-    mCoefficientCursor = (mCoefficientCursor + mNumTaps) % mCoefficients.size();
+    mCoefficientCursor = (mCoefficientCursor + mNumTaps) % mNumCoefficients;
+}
 
-    // Copy accumulators to output.
-    frame[0] = left;
-    frame[1] = right;
+MultiChannelResampler::ProcessResult PolyphaseResamplerStereo::process(const float *input,
+                                                                       int32_t numInputFrames,
+                                                                       float *output,
+                                                                       int32_t maxOutputFrames) {
+    return processFrames(this, input, numInputFrames, output, maxOutputFrames);
 }
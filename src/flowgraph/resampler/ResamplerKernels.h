@@ -0,0 +1,175 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef OBOE_RESAMPLER_KERNELS_H
+#define OBOE_RESAMPLER_KERNELS_H
+
+#include <sys/types.h>
+
+#include "FloatVector4.h"
+
+namespace resampler {
+
+/**
+ * FIR kernels shared by the polyphase and sinc resamplers.
+ *
+ * Each kernel multiplies numTaps frames from the delay line by the coefficients.
+ * If kNumTaps is not zero then it is used instead of numTaps, which lets the compiler
+ * unroll the loops completely. The resamplers use this for 8, 16 and 32 taps,
+ * which are the sizes used by MultiChannelResampler::make().
+ */
+class ResamplerKernels {
+public:
+    /**
+     * numTaps must be a multiple of 4.
+     * @return sum of x[i] * coefficients[i]
+     */
+    template <int kNumTaps>
+    static inline float convolveMono(const float *x,
+                                     const float *coefficients,
+                                     int32_t numTaps) {
+        if (kNumTaps > 0) numTaps = kNumTaps;
+        // Use two accumulators so the additions do not all wait on each other.
+        FloatVector4 sum0 = FloatVector4::zero();
+        FloatVector4 sum1 = FloatVector4::zero();
+        int32_t tap = 0;
+        for (; tap + 8 <= numTaps; tap += 8) {
+            sum0 = sum0.multiplyAdd(FloatVector4::load(x + tap),
+                                    FloatVector4::load(coefficients + tap));
+            sum1 = sum1.multiplyAdd(FloatVector4::load(x + tap + 4),
+                                    FloatVector4::load(coefficients + tap + 4));
+        }
+        if (tap < numTaps) {
+            sum0 = sum0.multiplyAdd(FloatVector4::load(x + tap),
+                                    FloatVector4::load(coefficients + tap));
+        }
+        return (sum0 + sum1).sum();
+    }
+
+    /**
+     * x contains interleaved stereo frames. numTaps must be a multiple of 4.
+     */
+    template <int kNumTaps>
+    static inline void convolveStereo(float *frame,
+                                      const float *x,
+                                      const float *coefficients,
+                                      int32_t numTaps) {
+        if (kNumTaps > 0) numTaps = kNumTaps;
+        FloatVector4 sum0 = FloatVector4::zero(); // left, right, left, right
+        FloatVector4 sum1 = FloatVector4::zero();
+        for (int32_t tap = 0; tap < numTaps; tap += 4) {
+            FloatVector4 coefficient4 = FloatVector4::load(coefficients + tap);
+            sum0 = sum0.multiplyAdd(FloatVector4::load(x), coefficient4.duplicateLow());
+            sum1 = sum1.multiplyAdd(FloatVector4::load(x + 4), coefficient4.duplicateHigh());
+            x += 8;
+        }
+        (sum0 + sum1).sumPairs(&frame[0], &frame[1]);
+    }
+
+    /**
+     * Convolve with two adjacent rows of coefficients and interpolate between the results.
+     * This is used by the sinc resamplers. numTaps must be a multiple of 4.
+     * @param fraction position between the rows, 0.0 gives the result for coefficients1
+     */
+    template <int kNumTaps>
+    static inline float convolveMonoInterpolated(const float *x,
+                                                 const float *coefficients1,
+                                                 const float *coefficients2,
+                                                 float fraction,
+                                                 int32_t numTaps) {
+        if (kNumTaps > 0) numTaps = kNumTaps;
+        FloatVector4 sum1 = FloatVector4::zero();
+        FloatVector4 sum2 = FloatVector4::zero();
+        for (int32_t tap = 0; tap < numTaps; tap += 4) {
+            FloatVector4 x4 = FloatVector4::load(x + tap);
+            sum1 = sum1.multiplyAdd(x4, FloatVector4::load(coefficients1 + tap));
+            sum2 = sum2.multiplyAdd(x4, FloatVector4::load(coefficients2 + tap));
+        }
+        const float low = sum1.sum();
+        const float high = sum2.sum();
+        return low + (fraction * (high - low));
+    }
+
+    /**
+     * Stereo version of convolveMonoInterpolated().
+     * x contains interleaved stereo frames.
+     */
+    template <int kNumTaps>
+    static inline void convolveStereoInterpolated(float *frame,
+                                                  const float *x,
+                                                  const float *coefficients1,
+                                                  const float *coefficients2,
+                                                  float fraction,
+                                                  int32_t numTaps) {
+        if (kNumTaps > 0) numTaps = kNumTaps;
+        FloatVector4 sum1 = FloatVector4::zero(); // left, right, left, right
+        FloatVector4 sum2 = FloatVector4::zero();
+        for (int32_t tap = 0; tap < numTaps; tap += 4) {
+            FloatVector4 x0 = FloatVector4::load(x);
+            FloatVector4 x1 = FloatVector4::load(x + 4);
+            FloatVector4 coefficient1 = FloatVector4::load(coefficients1 + tap);
+            FloatVector4 coefficient2 = FloatVector4::load(coefficients2 + tap);
+            sum1 = sum1.multiplyAdd(x0, coefficient1.duplicateLow())
+                    .multiplyAdd(x1, coefficient1.duplicateHigh());
+            sum2 = sum2.multiplyAdd(x0, coefficient2.duplicateLow())
+                    .multiplyAdd(x1, coefficient2.duplicateHigh());
+            x += 8;
+        }
+        float lowLeft, lowRight;
+        float highLeft, highRight;
+        sum1.sumPairs(&lowLeft, &lowRight);
+        sum2.sumPairs(&highLeft, &highRight);
+        frame[0] = lowLeft + (fraction * (highLeft - lowLeft));
+        frame[1] = lowRight + (fraction * (highRight - lowRight));
+    }
+
+    /**
+     * x contains interleaved frames with any number of channels.
+     * Four channels are processed at a time.
+     * The taps are added in order so the result is the same as the scalar loop.
+     */
+    template <int kNumTaps>
+    static inline void convolveChannels(float *frame,
+                                        const float *x,
+                                        const float *coefficients,
+                                        int32_t channelCount,
+                                        int32_t numTaps) {
+        if (kNumTaps > 0) numTaps = kNumTaps;
+        int32_t channel = 0;
+        for (; channel + 4 <= channelCount; channel += 4) {
+            FloatVector4 sum = FloatVector4::zero();
+            const float *xChannel = x + channel;
+            for (int32_t tap = 0; tap < numTaps; tap++) {
+                sum = sum.multiplyAdd(FloatVector4::load(xChannel), coefficients[tap]);
+                xChannel += channelCount;
+            }
+            sum.store(frame + channel);
+        }
+        for (; channel < channelCount; channel++) {
+            float sum = 0.0f;
+            const float *xChannel = x + channel;
+            for (int32_t tap = 0; tap < numTaps; tap++) {
+                sum += *xChannel * coefficients[tap];
+                xChannel += channelCount;
+            }
+            frame[channel] = sum;
+        }
+    }
+};
+
+}
+
+#endif //OBOE_RESAMPLER_KERNELS_H
@@ -24,15 +24,17 @@ SincResampler::SincResampler(const MultiChannelResampler::Builder &builder)
         : MultiChannelResampler(builder)
         , mSingleFrame2(builder.getChannelCount()) {
     assert((getNumTaps() % 4) == 0); // Required for loop unrolling.
-    mNumRows = kMaxCoefficients / getNumTaps(); // no guard row needed
-//    printf("SincResampler: numRows = %d\n", mNumRows);
-    mPhaseScaler = (double) mNumRows / mDenominator;
-    double phaseIncrement = 1.0 / mNumRows;
+    mNumRows = kMaxCoefficients / getNumTaps(); // includes guard row
+    // The guard row is for a phase of 1.0 so we can interpolate from the last real row.
+    const int32_t numRowsNoGuard = mNumRows - 1;
+    mPhaseScaler = (double) numRowsNoGuard / mDenominator;
+    double phaseIncrement = 1.0 / numRowsNoGuard;
     generateCoefficients(builder.getInputRate(),
                          builder.getOutputRate(),
                          mNumRows,
                          phaseIncrement,
-                         builder.getNormalizedCutoff());
+                         builder.getNormalizedCutoff(),
+                         true /* hasGuardRow */);
 }
 
 void SincResampler::readFrame(float *frame) {
@@ -41,20 +43,9 @@ void SincResampler::readFrame(float *frame) {
     std::fill(mSingleFrame2.begin(), mSingleFrame2.end(), 0.0);
 
     // Determine indices into coefficients table.
-    double tablePhase = getIntegerPhase() * mPhaseScaler;
-    int index1 = static_cast<int>(floor(tablePhase));
-    if (index1 >= mNumRows) { // no guard row needed because we wrap the indices
-        tablePhase -= mNumRows;
-        index1 -= mNumRows;
-    }
-
-    int index2 = index1 + 1;
-    if (index2 >= mNumRows) { // no guard row needed because we wrap the indices
-        index2 -= mNumRows;
-    }
-
-    float *coefficients1 = &mCoefficients[index1 * getNumTaps()];
-    float *coefficients2 = &mCoefficients[index2 * getNumTaps()];
+    const float *coefficients1;
+    const float *coefficients2;
+    const float fraction = findCoefficientRows(&coefficients1, &coefficients2);
 
     float *xFrame = &mX[mCursor * getChannelCount()];
     for (int i = 0; i < mNumTaps; i++) {
@@ -68,10 +59,16 @@ void SincResampler::readFrame(float *frame) {
     }
 
     // Interpolate and copy to output.
-    float fraction = tablePhase - index1;
     for (int channel = 0; channel < getChannelCount(); channel++) {
         float low = mSingleFrame[channel];
         float high = mSingleFrame2[channel];
         frame[channel] = low + (fraction * (high - low));
     }
 }
+
+MultiChannelResampler::ProcessResult SincResampler::process(const float *input,
+                                                            int32_t numInputFrames,
+                                                            float *output,
+                                                            int32_t maxOutputFrames) {
+    return processFrames(this, input, numInputFrames, output, maxOutputFrames);
+}
@@ -17,6 +17,7 @@
 #ifndef OBOE_SINC_RESAMPLER_H
 #define OBOE_SINC_RESAMPLER_H
 
+#include <math.h>
 #include <memory>
 #include <sys/types.h>
 #include <unistd.h>
@@ -36,10 +37,34 @@ public:
 
     void readFrame(float *frame) override;
 
+    ProcessResult process(const float *input,
+                          int32_t numInputFrames,
+                          float *output,
+                          int32_t maxOutputFrames) override;
+
 protected:
 
+    /**
+     * Find the two rows of coefficients on either side of the current phase.
+     *
+     * @param coefficients1 receives the row at or below the phase
+     * @param coefficients2 receives the next row, which may be the guard row
+     * @return fraction of the way from coefficients1 to coefficients2
+     */
+    float findCoefficientRows(const float **coefficients1, const float **coefficients2) {
+        double tablePhase = getIntegerPhase() * mPhaseScaler;
+        int index1 = static_cast<int>(floor(tablePhase));
+        // Rounding can put us on the guard row, which is the last row.
+        if (index1 >= mNumRows - 1) {
+            index1 = mNumRows - 2;
+        }
+        *coefficients1 = &mCoefficients[index1 * getNumTaps()];
+        *coefficients2 = &mCoefficients[(index1 + 1) * getNumTaps()];
+        return tablePhase - index1;
+    }
+
     std::vector<float> mSingleFrame2; // for interpolation
-    int32_t            mNumRows = 0;
+    int32_t            mNumRows = 0; // includes a guard row
     double             mPhaseScaler = 1.0;
 };
 
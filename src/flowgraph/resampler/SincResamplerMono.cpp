@@ -0,0 +1,75 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cassert>
+
+#include "ResamplerKernels.h"
+#include "SincResamplerMono.h"
+
+using namespace resampler;
+
+#define MONO  1
+
+SincResamplerMono::SincResamplerMono(const MultiChannelResampler::Builder &builder)
+        : SincResampler(builder) {
+    assert(builder.getChannelCount() == MONO);
+}
+
+void SincResamplerMono::writeFrame(const float *frame) {
+    // Move cursor before write so that cursor points to last written frame in read.
+    if (--mCursor < 0) {
+        mCursor = getNumTaps() - 1;
+    }
+    float *dest = &mX[mCursor * MONO];
+    const int offset = mNumTaps * MONO;
+    // Write each sample twice so we avoid having to wrap when running the FIR.
+    const float sample = frame[0];
+    dest[0] = sample;
+    dest[offset] = sample;
+}
+
+// Multiply input times windowed sinc function.
+void SincResamplerMono::readFrame(float *frame) {
+    const float *coefficients1;
+    const float *coefficients2;
+    const float fraction = findCoefficientRows(&coefficients1, &coefficients2);
+    const float *xFrame = &mX[mCursor * MONO];
+    switch (mNumTaps) {
+        case 8:
+            frame[0] = ResamplerKernels::convolveMonoInterpolated<8>(
+                    xFrame, coefficients1, coefficients2, fraction, 8);
+            break;
+        case 16:
+            frame[0] = ResamplerKernels::convolveMonoInterpolated<16>(
+                    xFrame, coefficients1, coefficients2, fraction, 16);
+            break;
+        case 32:
+            frame[0] = ResamplerKernels::convolveMonoInterpolated<32>(
+                    xFrame, coefficients1, coefficients2, fraction, 32);
+            break;
+        default:
+            frame[0] = ResamplerKernels::convolveMonoInterpolated<0>(
+                    xFrame, coefficients1, coefficients2, fraction, mNumTaps);
+            break;
+    }
+}
+
+MultiChannelResampler::ProcessResult SincResamplerMono::process(const float *input,
+                                                                int32_t numInputFrames,
+                                                                float *output,
+                                                                int32_t maxOutputFrames) {
+    return processFrames(this, input, numInputFrames, output, maxOutputFrames);
+}
@@ -17,6 +17,7 @@
 #include <cassert>
 #include <math.h>
 
+#include "ResamplerKernels.h"
 #include "SincResamplerStereo.h"
 
 using namespace resampler;
@@ -47,35 +48,33 @@ void SincResamplerStereo::writeFrame(const float *frame) {
 
 // Multiply input times windowed sinc function.
 void SincResamplerStereo::readFrame(float *frame) {
-    // Clear accumulator for mixing.
-    std::fill(mSingleFrame.begin(), mSingleFrame.end(), 0.0);
-    std::fill(mSingleFrame2.begin(), mSingleFrame2.end(), 0.0);
-
-    // Determine indices into coefficients table.
-    double tablePhase = getIntegerPhase() * mPhaseScaler;
-    int index1 = static_cast<int>(floor(tablePhase));
-    float *coefficients1 = &mCoefficients[index1 * getNumTaps()];
-    int index2 = (index1 + 1);
-    if (index2 >= mNumRows) { // no guard row needed because we wrap the indices
-        index2 = 0;
-    }
-    float *coefficients2 = &mCoefficients[index2 * getNumTaps()];
-    float *xFrame = &mX[mCursor * getChannelCount()];
-    for (int i = 0; i < mNumTaps; i++) {
-        float coefficient1 = *coefficients1++;
-        float coefficient2 = *coefficients2++;
-        for (int channel = 0; channel < getChannelCount(); channel++) {
-            float sample = *xFrame++;
-            mSingleFrame[channel] +=  sample * coefficient1;
-            mSingleFrame2[channel] += sample * coefficient2;
-        }
+    const float *coefficients1;
+    const float *coefficients2;
+    const float fraction = findCoefficientRows(&coefficients1, &coefficients2);
+    const float *xFrame = &mX[mCursor * STEREO];
+    switch (mNumTaps) {
+        case 8:
+            ResamplerKernels::convolveStereoInterpolated<8>(
+                    frame, xFrame, coefficients1, coefficients2, fraction, 8);
+            break;
+        case 16:
+            ResamplerKernels::convolveStereoInterpolated<16>(
+                    frame, xFrame, coefficients1, coefficients2, fraction, 16);
+            break;
+        case 32:
+            ResamplerKernels::convolveStereoInterpolated<32>(
+                    frame, xFrame, coefficients1, coefficients2, fraction, 32);
+            break;
+        default:
+            ResamplerKernels::convolveStereoInterpolated<0>(
+                    frame, xFrame, coefficients1, coefficients2, fraction, mNumTaps);
+            break;
     }
+}
 
-    // Interpolate and copy to output.
-    float fraction = tablePhase - index1;
-    for (int channel = 0; channel < getChannelCount(); channel++) {
-        float low = mSingleFrame[channel];
-        float high = mSingleFrame2[channel];
-        frame[channel] = low + (fraction * (high - low));
-    }
+MultiChannelResampler::ProcessResult SincResamplerStereo::process(const float *input,
+                                                                  int32_t numInputFrames,
+                                                                  float *output,
+                                                                  int32_t maxOutputFrames) {
+    return processFrames(this, input, numInputFrames, output, maxOutputFrames);
 }
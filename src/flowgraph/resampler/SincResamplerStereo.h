@@ -33,6 +33,11 @@ public:
 
     void readFrame(float *frame) override;
 
+    ProcessResult process(const float *input,
+                          int32_t numInputFrames,
+                          float *output,
+                          int32_t maxOutputFrames) override;
+
 };
 
 }
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <string.h>
+
+#include "TieredResampler.h"
+
+using namespace resampler;
+
+// The delay line of the base class is not used, so keep it small.
+static MultiChannelResampler::Builder makeBuilder(int32_t channelCount,
+                                                  int32_t inputRate,
+                                                  int32_t outputRate) {
+    MultiChannelResampler::Builder builder;
+    builder.setChannelCount(channelCount)
+            ->setInputRate(inputRate)
+            ->setOutputRate(outputRate)
+            ->setNumTaps(2);
+    return builder;
+}
+
+// Output of the next tier is made in blocks of this many frames during a crossfade.
+constexpr int32_t kMaxCrossfadeBlockFrames = 256; // arbitrary
+
+TieredResampler::TieredResampler(int32_t channelCount,
+                                 int32_t inputRate,
+                                 int32_t outputRate,
+                                 const std::vector<Quality> &qualities,
+                                 int32_t crossfadeFrames)
+        : MultiChannelResampler(makeBuilder(channelCount, inputRate, outputRate))
+        , mCrossfadeFrames(std::max(0, crossfadeFrames)) {
+    int32_t maxTaps = 0;
+    for (Quality quality : qualities) {
+        mTiers.emplace_back(make(channelCount, inputRate, outputRate, quality));
+        maxTaps = std::max(maxTaps, mTiers.back()->getNumTaps());
+    }
+    mActiveTier = mNextTier = mRequestedTier = getNumTiers() - 1;
+    mHistoryCapacity = maxTaps;
+    mHistory.resize(mHistoryCapacity * channelCount);
+    mOrderedHistory.resize(mHistoryCapacity * channelCount);
+    mNextOutputCapacity = std::max(1, std::min(mCrossfadeFrames, kMaxCrossfadeBlockFrames));
+    mNextOutput.resize(mNextOutputCapacity * channelCount);
+}
+
+void TieredResampler::setTier(int32_t tier) {
+    if (tier >= 0 && tier < getNumTiers()) {
+        mRequestedTier = tier;
+    }
+}
+
+void TieredResampler::appendHistory(const float *frames, int32_t numFrames) {
+    const int32_t channelCount = getChannelCount();
+    // Only the last mHistoryCapacity frames are kept.
+    if (numFrames > mHistoryCapacity) {
+        frames += (numFrames - mHistoryCapacity) * channelCount;
+        numFrames = mHistoryCapacity;
+    }
+    mHistoryCount = std::min(mHistoryCapacity, mHistoryCount + numFrames);
+    while (numFrames > 0) {
+        int32_t numToCopy = std::min(numFrames, mHistoryCapacity - mHistoryCursor);
+        memcpy(&mHistory[mHistoryCursor * channelCount], frames,
+               numToCopy * channelCount * sizeof(float));
+        frames += numToCopy * channelCount;
+        numFrames -= numToCopy;
+        mHistoryCursor = (mHistoryCursor + numToCopy) % mHistoryCapacity;
+    }
+}
+
+void TieredResampler::startCrossfade() {
+    const int32_t channelCount = getChannelCount();
+    // Copy the history oldest first.
+    int32_t oldest = (mHistoryCursor - mHistoryCount + mHistoryCapacity) % mHistoryCapacity;
+    for (int32_t i = 0; i < mHistoryCount; i++) {
+        int32_t index = (oldest + i) % mHistoryCapacity;
+        memcpy(&mOrderedHistory[i * channelCount], &mHistory[index * channelCount],
+               channelCount * sizeof(float));
+    }
+    mNextTier = mRequestedTier;
+    MultiChannelResampler *next = mTiers[mNextTier].get();
+    next->primeDelayLine(mOrderedHistory.data(), mHistoryCount);
+    next->copyPhase(*mTiers[mActiveTier]);
+    if (mCrossfadeFrames == 0) {
+        mActiveTier = mNextTier;
+    } else {
+        mCrossfadeFramesLeft = mCrossfadeFrames;
+    }
+}
+
+void TieredResampler::crossfade(float *output, const float *next, int32_t numFrames) {
+    const int32_t channelCount = getChannelCount();
+    const float increment = 1.0f / mCrossfadeFrames;
+    float gain = (mCrossfadeFrames - mCrossfadeFramesLeft + 1) * increment;
+    for (int32_t frame = 0; frame < numFrames; frame++) {
+        for (int32_t channel = 0; channel < channelCount; channel++) {
+            *output += gain * (*next++ - *output);
+            output++;
+        }
+        gain += increment;
+    }
+    mCrossfadeFramesLeft -= numFrames;
+    if (mCrossfadeFramesLeft <= 0) {
+        mCrossfadeFramesLeft = 0;
+        mActiveTier = mNextTier;
+    }
+}
+
+MultiChannelResampler::ProcessResult TieredResampler::process(const float *input,
+                                                              int32_t numInputFrames,
+                                                              float *output,
+                                                              int32_t maxOutputFrames) {
+    const int32_t channelCount = getChannelCount();
+    ProcessResult total;
+    while (total.framesProduced < maxOutputFrames) {
+        if (mCrossfadeFramesLeft == 0 && mRequestedTier != mActiveTier) {
+            startCrossfade();
+        }
+        const float *tierInput = input + (total.framesConsumed * channelCount);
+        const int32_t numTierInputFrames = numInputFrames - total.framesConsumed;
+        float *tierOutput = output + (total.framesProduced * channelCount);
+        int32_t maxFrames = maxOutputFrames - total.framesProduced;
+        ProcessResult result;
+        if (mCrossfadeFramesLeft > 0) {
+            maxFrames = std::min(maxFrames, std::min(mCrossfadeFramesLeft, mNextOutputCapacity));
+            result = mTiers[mActiveTier]->process(tierInput, numTierInputFrames,
+                                                  tierOutput, maxFrames);
+            // The tiers have the same phase so this consumes and produces the same frames.
+            mTiers[mNextTier]->process(tierInput, numTierInputFrames,
+                                       mNextOutput.data(), maxFrames);
+            crossfade(tierOutput, mNextOutput.data(), result.framesProduced);
+        } else {
+            result = mTiers[mActiveTier]->process(tierInput, numTierInputFrames,
+                                                  tierOutput, maxFrames);
+        }
+        appendHistory(tierInput, result.framesConsumed);
+        total.framesConsumed += result.framesConsumed;
+        total.framesProduced += result.framesProduced;
+        if (result.framesProduced < maxFrames) {
+            break; // more input is needed
+        }
+    }
+    // Keep isWriteNeeded() in step with the tiers.
+    copyPhase(*mTiers[mActiveTier]);
+    return total;
+}
+
+void TieredResampler::writeFrame(const float *frame) {
+    mTiers[mActiveTier]->writeNextFrame(frame);
+    if (mCrossfadeFramesLeft > 0) {
+        mTiers[mNextTier]->writeNextFrame(frame);
+    }
+    appendHistory(frame, 1);
+}
+
+void TieredResampler::readFrame(float *frame) {
+    if (mCrossfadeFramesLeft == 0 && mRequestedTier != mActiveTier) {
+        startCrossfade();
+    }
+    if (mCrossfadeFramesLeft > 0) {
+        mTiers[mActiveTier]->readNextFrame(frame);
+        mTiers[mNextTier]->readNextFrame(mNextOutput.data());
+        crossfade(frame, mNextOutput.data(), 1);
+    } else {
+        mTiers[mActiveTier]->readNextFrame(frame);
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef OBOE_TIERED_RESAMPLER_H
+#define OBOE_TIERED_RESAMPLER_H
+
+#include <memory>
+#include <sys/types.h>
+#include <vector>
+
+#include "MultiChannelResampler.h"
+
+namespace resampler {
+
+/**
+ * A resampler that holds one resampler for each of several quality tiers, and uses
+ * one of them at a time. This lets the quality be lowered when the CPU is too busy,
+ * and raised again later.
+ *
+ * All of the resamplers are built when this is constructed, so changing tier does not
+ * allocate memory. The new resampler is filled with the most recent input and starts at
+ * the same phase. Resamplers with more taps have more delay, so the output would jump
+ * if the tiers were switched directly. Instead both resamplers run for crossfadeFrames
+ * while the output fades from the old one to the new one.
+ *
+ * The tiers have fixed rates, so setRateScaler() is not supported.
+ */
+class TieredResampler : public MultiChannelResampler {
+public:
+    /**
+     * @param channelCount number of channels, 2 for stereo
+     * @param inputRate sample rate of the input stream
+     * @param outputRate sample rate of the output stream
+     * @param qualities one for each tier, from the lowest to the highest quality
+     * @param crossfadeFrames number of output frames to fade over when changing tier
+     */
+    TieredResampler(int32_t channelCount,
+                    int32_t inputRate,
+                    int32_t outputRate,
+                    const std::vector<Quality> &qualities,
+                    int32_t crossfadeFrames);
+
+    ProcessResult process(const float *input,
+                          int32_t numInputFrames,
+                          float *output,
+                          int32_t maxOutputFrames) override;
+
+    /**
+     * Request a tier. The change starts with the next output frame.
+     * If a crossfade is in progress then it finishes first.
+     * This is not thread safe so call it from the thread that is resampling.
+     *
+     * @param tier index into the qualities passed to the constructor
+     */
+    void setTier(int32_t tier);
+
+    /**
+     * @return the requested tier
+     */
+    int32_t getTier() const {
+        return mRequestedTier;
+    }
+
+    /**
+     * @return the tier whose output is being used, or faded out of
+     */
+    int32_t getActiveTier() const {
+        return mActiveTier;
+    }
+
+    int32_t getNumTiers() const {
+        return static_cast<int32_t>(mTiers.size());
+    }
+
+    bool isCrossfading() const {
+        return mCrossfadeFramesLeft > 0;
+    }
+
+protected:
+    void writeFrame(const float *frame) override;
+
+    void readFrame(float *frame) override;
+
+private:
+    void startCrossfade();
+
+    void appendHistory(const float *frames, int32_t numFrames);
+
+    /**
+     * Fade the output of the active tier toward the output of the next tier.
+     */
+    void crossfade(float *output, const float *next, int32_t numFrames);
+
+    std::vector<std::unique_ptr<MultiChannelResampler>> mTiers;
+    const int32_t      mCrossfadeFrames;
+    int32_t            mCrossfadeFramesLeft = 0;
+    int32_t            mActiveTier;
+    int32_t            mNextTier;
+    int32_t            mRequestedTier;
+
+    // The last input frames, so a new tier can start with a full delay line.
+    std::vector<float> mHistory;
+    std::vector<float> mOrderedHistory; // mHistory copied oldest first
+    int32_t            mHistoryCapacity = 0;
+    int32_t            mHistoryCursor = 0; // where the next frame will be written
+    int32_t            mHistoryCount = 0;
+
+    std::vector<float> mNextOutput; // output of the next tier during a crossfade
+    int32_t            mNextOutputCapacity = 0;
+};
+
+} // namespace resampler
+
+#endif //OBOE_TIERED_RESAMPLER_H
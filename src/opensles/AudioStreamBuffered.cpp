@@ -15,6 +15,7 @@
  */
 
 #include <memory>
+#include <thread>
 
 #include "oboe/Oboe.h"
 
@@ -25,7 +26,9 @@ namespace oboe {
 
 constexpr int kDefaultBurstsPerBuffer = 16;  // arbitrary, allows dynamic latency tuning
 constexpr int kMinBurstsPerBuffer     = 4;  // arbitrary, allows dynamic latency tuning
+constexpr int kMaxBurstsPerBuffer     = 64; // arbitrary, the FIFO can grow to this when tuning
 constexpr int kMinFramesPerBuffer     = 48 * 32; // arbitrary
+constexpr int kTimestampsPerBurst     = 2;  // arbitrary, more than one callback per burst is rare
 
 /*
  * AudioStream with a FifoBuffer
@@ -34,6 +37,41 @@ AudioStreamBuffered::AudioStreamBuffered(const AudioStreamBuilder &builder)
         : AudioStream(builder) {
 }
 
+AudioStreamBuffered::~AudioStreamBuffered() {
+    delete mPendingFifo.exchange(nullptr);
+    delete mRetiredFifo.exchange(nullptr);
+}
+
+AudioStreamBuffered::FifoUser::FifoUser(std::atomic<int32_t> &users)
+        : mUsers(users) {
+    int32_t numUsers = mUsers.load(std::memory_order_relaxed);
+    // Acquire so that we see the FIFO that the callback swapped in.
+    while (numUsers == kFifoSwapping
+            || !mUsers.compare_exchange_weak(numUsers, numUsers + 1,
+                                             std::memory_order_acquire)) {
+        if (numUsers == kFifoSwapping) {
+            // The callback is copying the data, which should only take a few microseconds.
+            std::this_thread::yield();
+            numUsers = mUsers.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+AudioStreamBuffered::FifoUser::~FifoUser() {
+    mUsers.fetch_sub(1, std::memory_order_release);
+}
+
+// The FIFO is configured with the same format and channels as the stream.
+static FifoBuffer *createFifo(int32_t bytesPerFrame, int32_t capacityFrames,
+                              int32_t framesPerBurst) {
+    // The app thread and the OpenSL ES callback are the only reader and writer.
+    FifoBuffer *fifo = new FifoBuffer(bytesPerFrame, capacityFrames,
+                                      FifoBuffer::Mode::SingleProducerSingleConsumer);
+    // Keep a timestamp for every burst that can be in the FIFO.
+    fifo->enableTimestamps(kTimestampsPerBurst * capacityFrames / framesPerBurst);
+    return fifo;
+}
+
 void AudioStreamBuffered::allocateFifo() {
     // If the caller does not provide a callback use our own internal
     // callback that reads data from the FIFO.
@@ -54,32 +92,91 @@ void AudioStreamBuffered::allocateFifo() {
                 capacityFrames = numBursts * getFramesPerBurst();
             }
         }
-        // TODO consider using std::make_unique if we require c++14
-        mFifoBuffer.reset(new FifoBuffer(getBytesPerFrame(), capacityFrames));
-        mBufferCapacityInFrames = capacityFrames;
+        mFifoBuffer.reset(createFifo(getBytesPerFrame(), capacityFrames, getFramesPerBurst()));
+        mAllocatedCapacityInFrames = capacityFrames;
+        mCallbackBufferSizeInFrames.store(getBufferSizeInFrames(), std::memory_order_relaxed);
+        // Only allocate the rest of the capacity if the latency has to be raised.
+        mBufferCapacityInFrames = std::max(capacityFrames,
+                                           kMaxBurstsPerBuffer * getFramesPerBurst());
+    }
+}
+
+// Move the unread data into the larger FIFO that was allocated by setBufferSizeInFrames().
+void AudioStreamBuffered::swapInPendingFifo() {
+    if (mPendingFifo.load(std::memory_order_relaxed) == nullptr
+            || mRetiredFifo.load(std::memory_order_acquire) != nullptr) {
+        return; // nothing to do or the last FIFO has not been deleted yet
+    }
+    int32_t numUsers = 0;
+    if (!mFifoUsers.compare_exchange_strong(numUsers, kFifoSwapping,
+                                            std::memory_order_acquire)) {
+        return; // in use, try again in the next callback
+    }
+    FifoBuffer *newFifo = mPendingFifo.exchange(nullptr, std::memory_order_acquire);
+    if (newFifo != nullptr) {
+        // Keep the counters so that the frame positions and timestamps do not jump.
+        uint64_t readCounter = mFifoBuffer->getReadCounter();
+        newFifo->setReadCounter(readCounter);
+        newFifo->setWriteCounter(readCounter);
+        FifoBuffer::Region region = mFifoBuffer->acquireReadRegion(
+                static_cast<int32_t>(mFifoBuffer->getFullFramesAvailable()));
+        for (int part = 0; part < 2; part++) {
+            newFifo->write(region.data[part], region.numFrames[part]);
+        }
+        mRetiredFifo.store(mFifoBuffer.release(), std::memory_order_release);
+        mFifoBuffer.reset(newFifo);
+    }
+    mFifoUsers.store(0, std::memory_order_release);
+}
+
+void AudioStreamBuffered::deleteRetiredFifo() {
+    if (mRetiredFifo.load(std::memory_order_relaxed) != nullptr) {
+        delete mRetiredFifo.exchange(nullptr, std::memory_order_acquire);
     }
 }
 
 void AudioStreamBuffered::updateFramesWritten() {
-    if (mFifoBuffer) {
-        mFramesWritten = static_cast<int64_t>(mFifoBuffer->getWriteCounter());
+    if (usingFIFO()) {
+        FifoUser fifoUser(mFifoUsers);
+        if (mFifoBuffer) {
+            mFramesWritten = static_cast<int64_t>(mFifoBuffer->getWriteCounter());
+        }
     } // or else it will get updated by processBufferCallback()
 }
 
 void AudioStreamBuffered::updateFramesRead() {
-    if (mFifoBuffer) {
-        mFramesRead = static_cast<int64_t>(mFifoBuffer->getReadCounter());
+    if (usingFIFO()) {
+        FifoUser fifoUser(mFifoUsers);
+        if (mFifoBuffer) {
+            mFramesRead = static_cast<int64_t>(mFifoBuffer->getReadCounter());
+        }
     } // or else it will get updated by processBufferCallback()
 }
 
 // This is called by the OpenSL ES callback to read or write the back end of the FIFO.
 DataCallbackResult AudioStreamBuffered::onDefaultCallback(void *audioData, int numFrames) {
+    swapInPendingFifo();
     int32_t framesTransferred  = 0;
+    int32_t framesFull = static_cast<int32_t>(mFifoBuffer->getFullFramesAvailable());
 
+    // The timestamps are keyed by the FIFO counters, which only count frames
+    // that the app wrote or read. So they stay with the data when there is an xrun.
+    int64_t timeNanos = AudioClock::getNanoseconds();
     if (getDirection() == oboe::Direction::Output) {
+        // The app writes up to the buffer size so measure the fill level against that.
+        mTelemetry.recordFillLevel(framesFull,
+                                   mCallbackBufferSizeInFrames.load(std::memory_order_relaxed),
+                                   framesFull - numFrames);
+        // The frame at the head of the FIFO is passed to OpenSL ES now.
+        mFifoBuffer->writeTimestamp(mFifoBuffer->getReadCounter(), timeNanos);
         // Read from the FIFO and write to audioData, clear part of buffer if not enough data.
         framesTransferred = mFifoBuffer->readNow(audioData, numFrames);
     } else {
+        int32_t capacity = static_cast<int32_t>(mFifoBuffer->getBufferCapacityInFrames());
+        mTelemetry.recordFillLevel(framesFull, capacity, capacity - framesFull - numFrames);
+        // The first frame of audioData was captured about one buffer ago.
+        int64_t bufferNanos = numFrames * kNanosPerSecond / getSampleRate();
+        mFifoBuffer->writeTimestamp(mFifoBuffer->getWriteCounter(), timeNanos - bufferNanos);
         // Read from audioData and write to the FIFO
         framesTransferred = mFifoBuffer->write(audioData, numFrames); // There is no writeNow()
     }
@@ -87,27 +184,24 @@ DataCallbackResult AudioStreamBuffered::onDefaultCallback(void *audioData, int n
     if (framesTransferred < numFrames) {
         LOGD("AudioStreamBuffered::%s(): xrun! framesTransferred = %d, numFrames = %d",
                 __func__, framesTransferred, numFrames);
-        // TODO If we do not allow FIFO to wrap then our timestamps will drift when there is an XRun!
         incrementXRunCount();
+        // Note where the missing frames would have been.
+        if (getDirection() == oboe::Direction::Output) {
+            mTelemetry.recordXRun(StreamTelemetry::XRunType::Underrun,
+                                  mFifoBuffer->getReadCounter(),
+                                  numFrames - framesTransferred, timeNanos);
+        } else {
+            mTelemetry.recordXRun(StreamTelemetry::XRunType::Overrun,
+                                  mFifoBuffer->getWriteCounter(),
+                                  numFrames - framesTransferred, timeNanos);
+        }
     }
-    markCallbackTime(static_cast<int32_t>(numFrames)); // so foreground knows how long to wait.
+    // Wake any app thread that is blocked in read() or write().
+    // Each callback moves a whole buffer so there is always enough to be worth waking for.
+    mCallbackEvent.signal();
     return DataCallbackResult::Continue;
 }
 
-void AudioStreamBuffered::markCallbackTime(int32_t numFrames) {
-    mLastBackgroundSize = numFrames;
-    mBackgroundRanAtNanoseconds = AudioClock::getNanoseconds();
-}
-
-int64_t AudioStreamBuffered::predictNextCallbackTime() {
-    if (mBackgroundRanAtNanoseconds == 0) {
-        return 0;
-    }
-    int64_t nanosPerBuffer = (kNanosPerSecond * mLastBackgroundSize) / getSampleRate();
-    const int64_t margin = 200 * kNanosPerMicrosecond; // arbitrary delay so we wake up just after
-    return mBackgroundRanAtNanoseconds + nanosPerBuffer + margin;
-}
-
 // Common code for read/write.
 // @return Result::OK with frames read/written, or Result::Error*
 ResultWithValue<int32_t> AudioStreamBuffered::transfer(
@@ -139,6 +233,8 @@ ResultWithValue<int32_t> AudioStreamBuffered::transfer(
         return ResultWithValue<int32_t>(Result::ErrorOutOfRange);
     }
 
+    deleteRetiredFifo();
+
     int32_t result = 0;
     uint8_t *readData = reinterpret_cast<uint8_t *>(readBuffer);
     const uint8_t *writeData = reinterpret_cast<const uint8_t *>(writeBuffer);
@@ -153,23 +249,29 @@ ResultWithValue<int32_t> AudioStreamBuffered::transfer(
 
     // Loop until we get the data, or we have an error, or we timeout.
     do {
+        // Read this before looking at the FIFO so that we cannot miss a callback.
+        int32_t callbackSequence = mCallbackEvent.getSequence();
+
         // read or write
-        if (getDirection() == Direction::Input) {
-            result = mFifoBuffer->read(readData, framesLeft);
-            if (result > 0) {
-                readData += mFifoBuffer->convertFramesToBytes(result);
-                framesLeft -= result;
-            }
-        } else {
-            // between zero and capacity
-            uint32_t fullFrames = mFifoBuffer->getFullFramesAvailable();
-            // Do not write above threshold size.
-            int32_t emptyFrames = getBufferSizeInFrames() - static_cast<int32_t>(fullFrames);
-            int32_t framesToWrite = std::max(0, std::min(framesLeft, emptyFrames));
-            result = mFifoBuffer->write(writeData, framesToWrite);
-            if (result > 0) {
-                writeData += mFifoBuffer->convertFramesToBytes(result);
-                framesLeft -= result;
+        {
+            FifoUser fifoUser(mFifoUsers);
+            if (getDirection() == Direction::Input) {
+                result = mFifoBuffer->read(readData, framesLeft);
+                if (result > 0) {
+                    readData += mFifoBuffer->convertFramesToBytes(result);
+                    framesLeft -= result;
+                }
+            } else {
+                // between zero and capacity
+                uint32_t fullFrames = mFifoBuffer->getFullFramesAvailable();
+                // Do not write above threshold size.
+                int32_t emptyFrames = getBufferSizeInFrames() - static_cast<int32_t>(fullFrames);
+                int32_t framesToWrite = std::max(0, std::min(framesLeft, emptyFrames));
+                result = mFifoBuffer->write(writeData, framesToWrite);
+                if (result > 0) {
+                    writeData += mFifoBuffer->convertFramesToBytes(result);
+                    framesLeft -= result;
+                }
             }
         }
 
@@ -180,26 +282,8 @@ ResultWithValue<int32_t> AudioStreamBuffered::transfer(
                 LOGE("AudioStreamBuffered::%s(): TIMEOUT", __func__);
                 repeat = false; // TIMEOUT
             } else {
-                // Figure out how long to sleep.
-                int64_t sleepForNanos;
-                int64_t wakeTimeNanos = predictNextCallbackTime();
-                if (wakeTimeNanos <= 0) {
-                    // No estimate available. Sleep for one burst.
-                    sleepForNanos = (getFramesPerBurst() * kNanosPerSecond) / getSampleRate();
-                } else {
-                    // Don't sleep past timeout.
-                    if (wakeTimeNanos > timeToQuit) {
-                        wakeTimeNanos = timeToQuit;
-                    }
-                    sleepForNanos = wakeTimeNanos - timeNow;
-                    // Avoid rapid loop with no sleep.
-                    const int64_t minSleepTime = kNanosPerMillisecond; // arbitrary
-                    if (sleepForNanos < minSleepTime) {
-                        sleepForNanos = minSleepTime;
-                    }
-                }
-
-                AudioClock::sleepForNanos(sleepForNanos);
+                // Sleep until the callback has moved some data through the FIFO.
+                mCallbackEvent.wait(callbackSequence, timeToQuit - timeNow);
             }
 
         } else {
@@ -254,25 +338,69 @@ ResultWithValue<int32_t> AudioStreamBuffered::setBufferSizeInFrames(int32_t requ
         return ResultWithValue<int32_t>(Result::ErrorClosed);
     }
 
-    if (!mFifoBuffer) {
+    if (!usingFIFO() || mAllocatedCapacityInFrames == 0) {
         return ResultWithValue<int32_t>(Result::ErrorUnimplemented);
     }
 
-    if (requestedFrames > mFifoBuffer->getBufferCapacityInFrames()) {
-        requestedFrames = mFifoBuffer->getBufferCapacityInFrames();
+    if (requestedFrames > getBufferCapacityInFrames()) {
+        requestedFrames = getBufferCapacityInFrames();
     } else if (requestedFrames < getFramesPerBurst()) {
         requestedFrames = getFramesPerBurst();
     }
+
+    deleteRetiredFifo();
+    if (requestedFrames > mAllocatedCapacityInFrames) {
+        // Double the size so that a slowly rising buffer size does not copy the data every time.
+        int32_t capacityFrames = std::max(requestedFrames, 2 * mAllocatedCapacityInFrames);
+        // round up to nearest burst
+        int32_t numBursts = (capacityFrames + getFramesPerBurst() - 1) / getFramesPerBurst();
+        capacityFrames = std::min(numBursts * getFramesPerBurst(), getBufferCapacityInFrames());
+        FifoBuffer *newFifo = createFifo(getBytesPerFrame(), capacityFrames, getFramesPerBurst());
+        // Replace any FIFO that the callback has not swapped in yet.
+        delete mPendingFifo.exchange(newFifo, std::memory_order_release);
+        mAllocatedCapacityInFrames = capacityFrames;
+    }
     mBufferSizeInFrames = requestedFrames;
+    mCallbackBufferSizeInFrames.store(requestedFrames, std::memory_order_relaxed);
     return ResultWithValue<int32_t>(requestedFrames);
 }
 
-int32_t AudioStreamBuffered::getBufferCapacityInFrames() const {
-    if (mFifoBuffer) {
-        return mFifoBuffer->getBufferCapacityInFrames();
-    } else {
-        return AudioStream::getBufferCapacityInFrames();
+int32_t AudioStreamBuffered::getAllocatedCapacityInFrames() const {
+    if (!usingFIFO() || mAllocatedCapacityInFrames == 0) {
+        return AudioStream::getAllocatedCapacityInFrames();
+    }
+    return mAllocatedCapacityInFrames;
+}
+
+Result AudioStreamBuffered::getTimestamp(clockid_t clockId,
+                                         int64_t *framePosition,
+                                         int64_t *timeNanoseconds) {
+    if (!usingFIFO()) {
+        return AudioStream::getTimestamp(clockId, framePosition, timeNanoseconds);
+    }
+    FrameTimestamp timestamp;
+    Result result = Result::ErrorUnavailable;
+    {
+        FifoUser fifoUser(mFifoUsers);
+        if (mFifoBuffer) {
+            result = mFifoBuffer->getLatestTimestamp(&timestamp);
+        }
+    }
+    if (result != Result::OK) {
+        return result;
+    }
+    // The timestamps were recorded using CLOCK_MONOTONIC.
+    if (clockId != CLOCK_MONOTONIC) {
+        timestamp.timestamp += AudioClock::getNanoseconds(clockId) - AudioClock::getNanoseconds();
+    }
+    // It is OK if framePosition is null.
+    if (framePosition) {
+        *framePosition = timestamp.position;
+    }
+    if (timeNanoseconds) {
+        *timeNanoseconds = timestamp.timestamp;
     }
+    return Result::OK;
 }
 
 bool AudioStreamBuffered::isXRunCountSupported() const {
@@ -17,8 +17,10 @@
 #ifndef OBOE_STREAM_BUFFERED_H
 #define OBOE_STREAM_BUFFERED_H
 
+#include <atomic>
 #include <cstring>
 #include <cassert>
+#include "common/FutexEvent.h"
 #include "common/OboeDebug.h"
 #include "oboe/AudioStream.h"
 #include "oboe/AudioStreamCallback.h"
@@ -34,6 +36,8 @@ public:
     AudioStreamBuffered();
     explicit AudioStreamBuffered(const AudioStreamBuilder &builder);
 
+    virtual ~AudioStreamBuffered();
+
     void allocateFifo();
 
 
@@ -45,9 +49,18 @@ public:
                  int32_t numFrames,
                  int64_t timeoutNanoseconds) override;
 
+    /**
+     * When using the FIFO, the capacity is the largest size that the FIFO can grow to.
+     * If the buffer size is set higher than the FIFO storage then larger storage is
+     * allocated by this thread, and the callback moves the data into it the next time it runs.
+     */
     ResultWithValue<int32_t> setBufferSizeInFrames(int32_t requestedFrames) override;
 
-    int32_t getBufferCapacityInFrames() const override;
+    /**
+     * When using the FIFO, this is the capacity of the FIFO storage, which is smaller than
+     * getBufferCapacityInFrames() until the buffer size is raised.
+     */
+    int32_t getAllocatedCapacityInFrames() const override;
 
     ResultWithValue<int32_t> getXRunCount() override {
         return ResultWithValue<int32_t>(mXRunCount);
@@ -55,6 +68,15 @@ public:
 
     bool isXRunCountSupported() const override;
 
+    /**
+     * When using the FIFO, this returns the time at which a frame was passed to or from
+     * OpenSL ES by the callback. OpenSL ES does not report the latency inside the device
+     * so that is not included.
+     */
+    Result getTimestamp(clockid_t clockId,
+                        int64_t *framePosition,
+                        int64_t *timeNanoseconds) override;
+
 protected:
 
     DataCallbackResult onDefaultCallback(void *audioData, int numFrames) override;
@@ -69,10 +91,6 @@ protected:
 
 private:
 
-    int64_t predictNextCallbackTime();
-
-    void markCallbackTime(int32_t numFrames);
-
     // Read or write to the FIFO.
     // Only pass one pointer and set the other to nullptr.
     ResultWithValue<int32_t> transfer(void *readBuffer,
@@ -84,10 +102,44 @@ private:
         ++mXRunCount;
     }
 
-    std::unique_ptr<FifoBuffer>   mFifoBuffer{};
+    /**
+     * Prevents the callback from replacing mFifoBuffer while another thread is using it.
+     * The callback never waits for this. It just tries again in its next call.
+     * This must not be held while waiting for the callback.
+     */
+    class FifoUser {
+    public:
+        explicit FifoUser(std::atomic<int32_t> &users);
+        ~FifoUser();
+    private:
+        std::atomic<int32_t> &mUsers;
+    };
 
-    int64_t mBackgroundRanAtNanoseconds = 0;
-    int32_t mLastBackgroundSize = 0;
+    // Called by the callback.
+    void swapInPendingFifo();
+
+    // Called by the app thread.
+    void deleteRetiredFifo();
+
+    static constexpr int32_t kFifoSwapping = -1;
+
+    // Only replaced by the callback, when mFifoUsers is kFifoSwapping.
+    std::unique_ptr<FifoBuffer>   mFifoBuffer{};
+    // Number of threads other than the callback that are using mFifoBuffer, or kFifoSwapping.
+    std::atomic<int32_t> mFifoUsers{0};
+    // Larger FIFO allocated by setBufferSizeInFrames() that the callback has not swapped in yet.
+    std::atomic<FifoBuffer *> mPendingFifo{nullptr};
+    // FIFO that was swapped out by the callback. It is deleted by the app thread
+    // so that the callback never frees memory.
+    std::atomic<FifoBuffer *> mRetiredFifo{nullptr};
+    // Capacity of the newest FIFO that was allocated, which may still be pending.
+    // Only used by the thread that calls setBufferSizeInFrames() or opens the stream.
+    int32_t mAllocatedCapacityInFrames = 0;
+    // Copy of mBufferSizeInFrames for the callback, which may run while
+    // setBufferSizeInFrames() changes it.
+    std::atomic<int32_t> mCallbackBufferSizeInFrames{0};
+
+    FutexEvent mCallbackEvent;
     int32_t mXRunCount = 0;
 };
 
@@ -0,0 +1,481 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <pthread.h>
+#include <cstring>
+#include <random>
+
+#include "common/AudioClock.h"
+#include "common/OboeDebug.h"
+#include "oboe/VirtualDevice.h"
+#include "virtual/AudioStreamVirtual.h"
+
+using namespace oboe;
+
+// This runs in its own thread so that it can stop, close and delete the stream.
+static void oboe_virtual_error_thread_proc(AudioStreamVirtual *oboeStream,
+                                           Result error) {
+    LOGD("%s(,%d) - entering >>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>", __func__, error);
+    AudioStreamErrorCallback *errorCallback = oboeStream->getErrorCallback();
+    if (errorCallback == nullptr) return; // should be impossible
+    bool isErrorHandled = errorCallback->onError(oboeStream, error);
+
+    if (!isErrorHandled) {
+        oboeStream->requestStop();
+        errorCallback->onErrorBeforeClose(oboeStream, error);
+        oboeStream->close();
+        // Warning, oboeStream may get deleted by this callback.
+        errorCallback->onErrorAfterClose(oboeStream, error);
+    }
+    LOGD("%s() - exiting <<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<", __func__);
+}
+
+// Prevents deletion of the stream if the app is using AudioStreamBuilder::openStream(shared_ptr)
+static void oboe_virtual_error_thread_proc_shared(std::shared_ptr<AudioStream> sharedStream,
+                                                  Result error) {
+    AudioStreamVirtual *oboeStream = reinterpret_cast<AudioStreamVirtual*>(sharedStream.get());
+    oboe_virtual_error_thread_proc(oboeStream, error);
+}
+
+namespace oboe {
+
+// Like the OpenSL ES buffer queue, so the timer may be one burst late when using the FIFO.
+constexpr int kFifoModeBurstsPerDeviceBuffer = 2;
+
+AudioStreamVirtual::AudioStreamVirtual(const AudioStreamBuilder &builder)
+        : AudioStreamBuffered(builder) {
+}
+
+AudioStreamVirtual::~AudioStreamVirtual() {
+    if (mTimerThread.joinable()) {
+        mTimerThreadEnabled.store(false, std::memory_order_release);
+        if (mTimerThread.get_id() == std::this_thread::get_id()) {
+            mTimerThread.detach(); // deleted by its own callback
+        } else {
+            mTimerThread.join();
+        }
+    }
+}
+
+Result AudioStreamVirtual::open() {
+    if (mState.load() != StreamState::Uninitialized) {
+        return Result::ErrorInvalidState;
+    }
+    Result result = AudioStreamBuffered::open();
+    if (result != Result::OK) {
+        return result;
+    }
+
+    // Use the device configuration for anything that the app did not ask for.
+    VirtualDevice &device = VirtualDevice::getInstance();
+    if (mSampleRate == kUnspecified) {
+        mSampleRate = device.getSampleRate();
+    }
+    if (mChannelCount == kUnspecified) {
+        mChannelCount = device.getChannelCount();
+    }
+    if (mFormat == AudioFormat::Unspecified) {
+        mFormat = device.getFormat();
+    }
+    if (mSampleRate <= 0 || mChannelCount <= 0) {
+        return Result::ErrorInvalidRate;
+    }
+    if (getBytesPerFrame() <= 0) {
+        return Result::ErrorInvalidFormat;
+    }
+
+    // Like OpenSL ES, the requested callback size is used as the burst size.
+    if (mFramesPerCallback != kUnspecified) {
+        mFramesPerBurst = mFramesPerCallback;
+    } else {
+        // Keep the burst duration of the device if the stream runs at a different rate.
+        int64_t framesPerBurst = static_cast<int64_t>(device.getFramesPerBurst())
+                * mSampleRate / device.getSampleRate();
+        mFramesPerBurst = std::max(1, static_cast<int32_t>(framesPerBurst));
+    }
+    mCallbackBuffer = std::make_unique<uint8_t[]>(mFramesPerBurst * getBytesPerFrame());
+
+    if (usingFIFO()) {
+        allocateFifo();
+        mDeviceBufferSizeInFrames.store(kFifoModeBurstsPerDeviceBuffer * mFramesPerBurst);
+        ResultWithValue<int32_t> sizeResult = AudioStreamBuffered::setBufferSizeInFrames(
+                device.getBurstsPerBuffer() * mFramesPerBurst);
+        if (!sizeResult) {
+            return sizeResult.error();
+        }
+    } else {
+        int32_t numBursts = device.getBurstsPerBuffer();
+        if (mBufferCapacityInFrames != kUnspecified) {
+            // round up to nearest burst
+            numBursts = (mBufferCapacityInFrames + mFramesPerBurst - 1) / mFramesPerBurst;
+        }
+        mBufferCapacityInFrames = std::max(1, numBursts) * mFramesPerBurst;
+        mBufferSizeInFrames = mBufferCapacityInFrames;
+        mDeviceBufferSizeInFrames.store(mBufferSizeInFrames);
+        if (!isErrorCallbackSpecified()) {
+            // The app did not specify a callback so we should specify
+            // our own so the stream gets closed and stopped.
+            mErrorCallback = &mDefaultErrorCallback;
+        }
+    }
+
+    mDisconnectSequence = device.getDisconnectSequence();
+    mState.store(StreamState::Open);
+    LOGD("AudioStreamVirtual::%s() rate = %d, channels = %d, burst = %d, capacity = %d",
+         __func__, mSampleRate, mChannelCount, mFramesPerBurst, mBufferCapacityInFrames);
+    return Result::OK;
+}
+
+Result AudioStreamVirtual::close() {
+    joinTimerThread();
+    std::lock_guard<std::mutex> lock(mLock);
+    if (mState.load() == StreamState::Closed) {
+        return Result::ErrorClosed;
+    }
+    AudioStreamBuffered::close();
+    mState.store(StreamState::Closed);
+    return Result::OK;
+}
+
+void AudioStreamVirtual::joinTimerThread() {
+    std::thread timerThread;
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        mTimerThreadEnabled.store(false, std::memory_order_release);
+        // A callback that stops the stream cannot wait for itself.
+        // The thread exits when the callback returns and is joined later.
+        if (mTimerThread.joinable() && mTimerThread.get_id() != std::this_thread::get_id()) {
+            timerThread = std::move(mTimerThread);
+        }
+    }
+    // Do not hold the lock here because the callback may be trying to stop the stream.
+    if (timerThread.joinable()) {
+        timerThread.join();
+    }
+}
+
+Result AudioStreamVirtual::requestStart() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        switch (mState.load()) {
+            case StreamState::Closed:
+                return Result::ErrorClosed;
+            case StreamState::Disconnected:
+                return Result::ErrorDisconnected;
+            case StreamState::Starting:
+            case StreamState::Started:
+                return Result::OK;
+            default:
+                break;
+        }
+    }
+    // The last thread may still be running if the callback stopped the stream.
+    joinTimerThread();
+
+    std::lock_guard<std::mutex> lock(mLock);
+    mState.store(StreamState::Starting);
+    setDataCallbackEnabled(true);
+    mTimerThreadEnabled.store(true, std::memory_order_release);
+    mTimerThread = std::thread(&AudioStreamVirtual::runTimerLoop, this);
+    mState.store(StreamState::Started);
+    return Result::OK;
+}
+
+Result AudioStreamVirtual::requestPause() {
+    if (getDirection() == Direction::Input) {
+        return Result::ErrorUnimplemented;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        switch (mState.load()) {
+            case StreamState::Closed:
+                return Result::ErrorClosed;
+            case StreamState::Disconnected:
+                return Result::ErrorDisconnected;
+            case StreamState::Paused:
+                return Result::OK;
+            default:
+                mState.store(StreamState::Pausing);
+                break;
+        }
+    }
+    joinTimerThread();
+    StreamState expected = StreamState::Pausing;
+    mState.compare_exchange_strong(expected, StreamState::Paused);
+    return Result::OK;
+}
+
+// There is no data in the device to discard. The FIFO is not cleared, like in OpenSL ES.
+Result AudioStreamVirtual::requestFlush() {
+    if (getDirection() == Direction::Input) {
+        return Result::ErrorUnimplemented;
+    }
+    std::lock_guard<std::mutex> lock(mLock);
+    switch (mState.load()) {
+        case StreamState::Closed:
+            return Result::ErrorClosed;
+        case StreamState::Disconnected:
+            return Result::ErrorDisconnected;
+        case StreamState::Open:
+        case StreamState::Paused:
+        case StreamState::Stopped:
+        case StreamState::Flushed:
+            mState.store(StreamState::Flushed);
+            return Result::OK;
+        default:
+            return Result::ErrorInvalidState;
+    }
+}
+
+Result AudioStreamVirtual::requestStop() {
+    {
+        std::lock_guard<std::mutex> lock(mLock);
+        switch (mState.load()) {
+            case StreamState::Closed:
+                return Result::ErrorClosed;
+            case StreamState::Disconnected:
+                break; // stop the thread but stay disconnected
+            default:
+                mState.store(StreamState::Stopping);
+                break;
+        }
+    }
+    joinTimerThread();
+    StreamState expected = StreamState::Stopping;
+    mState.compare_exchange_strong(expected, StreamState::Stopped);
+    return Result::OK;
+}
+
+Result AudioStreamVirtual::waitForStateChange(StreamState currentState,
+                                              StreamState *nextState,
+                                              int64_t timeoutNanoseconds) {
+    Result oboeResult = Result::ErrorTimeout;
+    int64_t sleepTimeNanos = 2 * kNanosPerMillisecond; // arbitrary
+    int64_t timeLeftNanos = timeoutNanoseconds;
+
+    while (true) {
+        const StreamState state = getState(); // this does not require a lock
+        if (nextState != nullptr) {
+            *nextState = state;
+        }
+        if (currentState != state) { // state changed?
+            oboeResult = Result::OK;
+            break;
+        }
+
+        // Did we timeout or did user ask for non-blocking?
+        if (timeLeftNanos <= 0) {
+            break;
+        }
+
+        if (sleepTimeNanos > timeLeftNanos){
+            sleepTimeNanos = timeLeftNanos;
+        }
+        AudioClock::sleepForNanos(sleepTimeNanos);
+        timeLeftNanos -= sleepTimeNanos;
+    }
+
+    return oboeResult;
+}
+
+ResultWithValue<int32_t> AudioStreamVirtual::write(const void *buffer,
+                                                   int32_t numFrames,
+                                                   int64_t timeoutNanoseconds) {
+    if (getState() == StreamState::Disconnected) {
+        return ResultWithValue<int32_t>(Result::ErrorDisconnected);
+    }
+    return AudioStreamBuffered::write(buffer, numFrames, timeoutNanoseconds);
+}
+
+ResultWithValue<int32_t> AudioStreamVirtual::read(void *buffer,
+                                                  int32_t numFrames,
+                                                  int64_t timeoutNanoseconds) {
+    if (getState() == StreamState::Disconnected) {
+        return ResultWithValue<int32_t>(Result::ErrorDisconnected);
+    }
+    return AudioStreamBuffered::read(buffer, numFrames, timeoutNanoseconds);
+}
+
+ResultWithValue<int32_t> AudioStreamVirtual::setBufferSizeInFrames(int32_t requestedFrames) {
+    if (usingFIFO()) {
+        return AudioStreamBuffered::setBufferSizeInFrames(requestedFrames);
+    }
+    if (getState() == StreamState::Closed) {
+        return ResultWithValue<int32_t>(Result::ErrorClosed);
+    }
+    int32_t adjustedFrames = std::max(getFramesPerBurst(),
+                                      std::min(requestedFrames, getBufferCapacityInFrames()));
+    mDeviceBufferSizeInFrames.store(adjustedFrames);
+    mBufferSizeInFrames = adjustedFrames;
+    return ResultWithValue<int32_t>(adjustedFrames);
+}
+
+ResultWithValue<int32_t> AudioStreamVirtual::getXRunCount() {
+    int32_t xRunCount = mDeviceXRunCount.load();
+    if (usingFIFO()) {
+        xRunCount += AudioStreamBuffered::getXRunCount().value();
+    }
+    return ResultWithValue<int32_t>(xRunCount);
+}
+
+Result AudioStreamVirtual::getTimestamp(clockid_t clockId,
+                                        int64_t *framePosition,
+                                        int64_t *timeNanoseconds) {
+    if (usingFIFO()) {
+        return AudioStreamBuffered::getTimestamp(clockId, framePosition, timeNanoseconds);
+    }
+    TimestampRing::Entry entry;
+    if (!mTimestamps.getLatest(&entry)) {
+        return Result::ErrorUnavailable;
+    }
+    // The timestamps were recorded using CLOCK_MONOTONIC.
+    if (clockId != CLOCK_MONOTONIC) {
+        entry.value += AudioClock::getNanoseconds(clockId) - AudioClock::getNanoseconds();
+    }
+    // It is OK if framePosition is null.
+    if (framePosition) {
+        *framePosition = entry.position;
+    }
+    if (timeNanoseconds) {
+        *timeNanoseconds = entry.value;
+    }
+    return Result::OK;
+}
+
+void AudioStreamVirtual::disconnect() {
+    LOGW("AudioStreamVirtual::%s() device was disconnected", __func__);
+    mState.store(StreamState::Disconnected);
+    mTimerThreadEnabled.store(false, std::memory_order_release);
+    // Blocking streams get the error from read() or write().
+    if (getErrorCallback() == nullptr || !isDataCallbackSpecified()) {
+        return;
+    }
+    mErrorCallbackResult = Result::ErrorDisconnected;
+    if (wasErrorCallbackCalled()) { // block extra error callbacks
+        LOGE("%s() multiple error callbacks called!", __func__);
+        return;
+    }
+    std::shared_ptr<AudioStream> sharedStream = lockWeakThis();
+    if (sharedStream) {
+        // Handle error on a separate thread using shared pointer.
+        std::thread t(oboe_virtual_error_thread_proc_shared, sharedStream,
+                      Result::ErrorDisconnected);
+        t.detach();
+    } else {
+        // Handle error on a separate thread.
+        std::thread t(oboe_virtual_error_thread_proc, this, Result::ErrorDisconnected);
+        t.detach();
+    }
+}
+
+bool AudioStreamVirtual::processBurst(int64_t timeNanos) {
+    const bool isOutput = getDirection() == Direction::Output;
+    mTimestamps.write(mDevicePosition.load(std::memory_order_relaxed), timeNanos);
+
+    bool keepGoing = true;
+    if (isDataCallbackEnabled()) {
+        if (!isOutput) {
+            // The virtual microphone only hears silence.
+            memset(mCallbackBuffer.get(), 0, mFramesPerBurst * getBytesPerFrame());
+        }
+        keepGoing = fireDataCallback(mCallbackBuffer.get(), mFramesPerBurst)
+                == DataCallbackResult::Continue;
+        // When using the FIFO the app side counter comes from the FIFO.
+        if (isDataCallbackSpecified()) {
+            if (isOutput) {
+                mFramesWritten += mFramesPerBurst;
+            } else {
+                mFramesRead += mFramesPerBurst;
+            }
+        }
+    }
+
+    int64_t devicePosition = mDevicePosition.load(std::memory_order_relaxed) + mFramesPerBurst;
+    mDevicePosition.store(devicePosition, std::memory_order_relaxed);
+    if (isDataCallbackSpecified()) {
+        if (isOutput) {
+            mFramesRead = devicePosition;
+        } else {
+            mFramesWritten = devicePosition;
+        }
+    }
+    return keepGoing;
+}
+
+// This is the clock of the virtual device. It runs at the stream's sample rate.
+void AudioStreamVirtual::runTimerLoop() {
+    pthread_setname_np(pthread_self(), "oboe_virtual");
+    VirtualDevice &device = VirtualDevice::getInstance();
+    const bool isOutput = getDirection() == Direction::Output;
+    const int64_t burstNanos = static_cast<int64_t>(mFramesPerBurst) * kNanosPerSecond
+            / mSampleRate;
+    std::minstd_rand random(static_cast<uint32_t>(AudioClock::getNanoseconds()));
+    int32_t stallSequence = device.getStallSequence();
+    int64_t burstTimeNanos = AudioClock::getNanoseconds(); // the first burst is due now
+
+    while (mTimerThreadEnabled.load(std::memory_order_acquire)) {
+        int64_t wakeUpNanos = burstTimeNanos;
+        int64_t jitterNanos = device.getJitterNanoseconds();
+        if (jitterNanos > 0) {
+            wakeUpNanos += std::uniform_int_distribution<int64_t>(0, jitterNanos)(random);
+        }
+        AudioClock::sleepUntilNanoTime(wakeUpNanos);
+        if (!mTimerThreadEnabled.load(std::memory_order_acquire)) {
+            break;
+        }
+        if (device.getDisconnectSequence() != mDisconnectSequence) {
+            disconnect();
+            break;
+        }
+        int32_t latestStallSequence = device.getStallSequence();
+        if (latestStallSequence != stallSequence) {
+            stallSequence = latestStallSequence;
+            AudioClock::sleepForNanos(device.getStallNanoseconds(), CLOCK_MONOTONIC);
+        }
+
+        // The device can wait until the rest of its buffer has been played or filled.
+        int64_t nowNanos = AudioClock::getNanoseconds();
+        int64_t marginFrames = mDeviceBufferSizeInFrames.load() - mFramesPerBurst;
+        int64_t marginNanos = marginFrames * kNanosPerSecond / mSampleRate;
+        int64_t lateNanos = nowNanos - burstTimeNanos;
+        if (lateNanos > marginNanos) {
+            // The device ran out, so whole bursts were played as silence or were not captured.
+            int64_t missedBursts = (lateNanos - marginNanos + burstNanos - 1) / burstNanos;
+            int64_t missedFrames = missedBursts * mFramesPerBurst;
+            int64_t devicePosition = mDevicePosition.load(std::memory_order_relaxed);
+            mDeviceXRunCount++;
+            mTelemetry.recordXRun(isOutput ? StreamTelemetry::XRunType::Underrun
+                                           : StreamTelemetry::XRunType::Overrun,
+                                  devicePosition,
+                                  static_cast<int32_t>(std::min<int64_t>(missedFrames, INT32_MAX)),
+                                  nowNanos);
+            mDevicePosition.store(devicePosition + missedFrames, std::memory_order_relaxed);
+            burstTimeNanos += missedBursts * burstNanos;
+        }
+
+        if (!processBurst(nowNanos)) {
+            // The callback returned Stop.
+            mTimerThreadEnabled.store(false, std::memory_order_release);
+            StreamState expected = StreamState::Started;
+            mState.compare_exchange_strong(expected, StreamState::Stopped);
+            break;
+        }
+        burstTimeNanos += burstNanos;
+    }
+}
+
+} // namespace oboe
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef OBOE_AUDIO_STREAM_VIRTUAL_H
+#define OBOE_AUDIO_STREAM_VIRTUAL_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "oboe/AudioStreamBuilder.h"
+#include "oboe/AudioStreamCallback.h"
+#include "fifo/TimestampRing.h"
+#include "opensles/AudioStreamBuffered.h"
+
+namespace oboe {
+
+/**
+ * A stream that is driven by a timer thread instead of an audio device. See VirtualDevice.
+ *
+ * The timer thread wakes up once per burst and calls the data callback,
+ * or moves a burst through the FIFO of AudioStreamBuffered when the app uses
+ * blocking reads and writes. If the thread wakes up later than the buffer allows
+ * then the device has missed whole bursts, which are counted as xruns.
+ */
+class AudioStreamVirtual : public AudioStreamBuffered {
+public:
+    explicit AudioStreamVirtual(const AudioStreamBuilder &builder);
+
+    virtual ~AudioStreamVirtual();
+
+    Result open() override;
+    Result close() override;
+
+    Result requestStart() override;
+    Result requestPause() override;
+    Result requestFlush() override;
+    Result requestStop() override;
+
+    StreamState getState() override {
+        return mState.load();
+    }
+
+    Result waitForStateChange(StreamState inputState,
+                              StreamState *nextState,
+                              int64_t timeoutNanoseconds) override;
+
+    ResultWithValue<int32_t> write(const void *buffer,
+                                   int32_t numFrames,
+                                   int64_t timeoutNanoseconds) override;
+
+    ResultWithValue<int32_t> read(void *buffer,
+                                  int32_t numFrames,
+                                  int64_t timeoutNanoseconds) override;
+
+    /**
+     * With a data callback this sets how late the timer thread may be before the device
+     * runs out of data. Otherwise it sets the size of the FIFO, as in AudioStreamBuffered.
+     */
+    ResultWithValue<int32_t> setBufferSizeInFrames(int32_t requestedFrames) override;
+
+    /**
+     * @return bursts missed by the device plus, when using the FIFO, FIFO underruns or overruns
+     */
+    ResultWithValue<int32_t> getXRunCount() override;
+
+    bool isXRunCountSupported() const override {
+        return true;
+    }
+
+    Result getTimestamp(clockid_t clockId,
+                        int64_t *framePosition,
+                        int64_t *timeNanoseconds) override;
+
+    AudioApi getAudioApi() const override {
+        return AudioApi::Virtual;
+    }
+
+protected:
+
+    Result updateServiceFrameCounter() override {
+        return Result::OK; // the counters are updated by the timer thread
+    }
+
+private:
+
+    // Runs in the timer thread.
+    void runTimerLoop();
+
+    // Play or capture one burst. Called by the timer thread.
+    // @return false if the data callback asked to stop
+    bool processBurst(int64_t timeNanos);
+
+    // Called by the timer thread when VirtualDevice::injectDisconnect() was called.
+    void disconnect();
+
+    // Stop the timer thread and wait for it unless this is called by the timer thread.
+    void joinTimerThread();
+
+    static constexpr int kTimestampsPerRing = 16; // arbitrary
+
+    std::atomic<StreamState> mState{StreamState::Uninitialized};
+
+    std::thread              mTimerThread;
+    std::atomic<bool>        mTimerThreadEnabled{false};
+
+    // Size of the buffer in the simulated device. It sets how late the timer thread may be.
+    std::atomic<int32_t>     mDeviceBufferSizeInFrames{0};
+    std::atomic<int32_t>     mDeviceXRunCount{0};
+    // Frames played or captured by the device, including the ones lost in xruns.
+    // Only written by the timer thread.
+    std::atomic<int64_t>     mDevicePosition{0};
+    // Device positions and the times they were reached.
+    TimestampRing            mTimestamps{kTimestampsPerRing};
+
+    std::unique_ptr<uint8_t[]> mCallbackBuffer;
+    int32_t                  mDisconnectSequence = 0;
+
+    // We may not use this but it is so small that it is not worth allocating dynamically.
+    AudioStreamErrorCallback mDefaultErrorCallback;
+};
+
+} // namespace oboe
+
+#endif //OBOE_AUDIO_STREAM_VIRTUAL_H
@@ -1,5 +1,5 @@
 /*
- * Copyright 2018 The Android Open Source Project
+ * Copyright 2022 The Android Open Source Project
  *
  * Licensed under the Apache License, Version 2.0 (the "License");
  * you may not use this file except in compliance with the License.
@@ -14,18 +14,14 @@
  * limitations under the License.
  */
 
-#ifndef OBOE_TRACE_H
-#define OBOE_TRACE_H
 
-class Trace {
+#include "oboe/VirtualDevice.h"
 
-public:
-    static void beginSection(const char *format, ...);
-    static void endSection();
-    static void initialize();
+namespace oboe {
 
-private:
-    static bool mIsTracingSupported;
-};
+VirtualDevice &VirtualDevice::getInstance() {
+    static VirtualDevice instance;
+    return instance;
+}
 
-#endif //OBOE_TRACE_H
\ No newline at end of file
+} // namespace oboe
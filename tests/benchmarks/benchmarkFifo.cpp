@@ -0,0 +1,263 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measure a FifoBuffer shared by a writing thread and a reading thread,
+ * in each FifoBuffer::Mode, with power of two and other capacities.
+ *
+ * Throughput is measured by moving frames as fast as possible in fixed size blocks.
+ * Latency is measured by writing one block at a time and timing how long
+ * it takes the spinning reader to receive it.
+ *
+ * Then the writer renders samples and the reader sums them, either through a block
+ * that is copied with write() and read(), or in place using the FIFO regions.
+ *
+ * The threads yield when they cannot make progress, so that the benchmark also runs on a
+ * single core, but the results are only meaningful when each thread has its own core.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "common/AudioClock.h"
+#include "oboe/FifoBuffer.h"
+
+using namespace oboe;
+
+constexpr int kSamplesPerFrame = 2; // stereo
+constexpr int kBytesPerFrame = kSamplesPerFrame * sizeof(float);
+constexpr int64_t kThroughputFrames = 10 * 1000 * 1000;
+constexpr int kLatencyBlocks = 20000;
+
+static const char *modeToText(FifoBuffer::Mode mode) {
+    switch (mode) {
+        case FifoBuffer::Mode::Default: return "Default";
+        case FifoBuffer::Mode::SingleProducerSingleConsumer: return "SPSC";
+    }
+    return "?";
+}
+
+/**
+ * @return millions of frames per second
+ */
+static double measureThroughput(FifoBuffer::Mode mode, uint32_t capacity, int32_t framesPerBlock) {
+    FifoBuffer fifo(kBytesPerFrame, capacity, mode);
+    int64_t startNanos = AudioClock::getNanoseconds();
+    std::thread writer([&fifo, framesPerBlock]() {
+        std::vector<uint8_t> block(framesPerBlock * kBytesPerFrame);
+        int64_t framesLeft = kThroughputFrames;
+        while (framesLeft > 0) {
+            int32_t framesToWrite = static_cast<int32_t>(
+                    std::min(static_cast<int64_t>(framesPerBlock), framesLeft));
+            int32_t framesWritten = fifo.write(block.data(), framesToWrite);
+            if (framesWritten == 0) {
+                std::this_thread::yield();
+            }
+            framesLeft -= framesWritten;
+        }
+    });
+    std::vector<uint8_t> block(framesPerBlock * kBytesPerFrame);
+    int64_t framesLeft = kThroughputFrames;
+    while (framesLeft > 0) {
+        int32_t framesRead = fifo.read(block.data(), framesPerBlock);
+        if (framesRead == 0) {
+            std::this_thread::yield();
+        }
+        framesLeft -= framesRead;
+    }
+    writer.join();
+    int64_t endNanos = AudioClock::getNanoseconds();
+    return kThroughputFrames * 1000.0 / (endNanos - startNanos);
+}
+
+struct Latency {
+    double median;
+    double percentile99;
+};
+
+/**
+ * The writer stores the time in the first frame of each block.
+ * It waits until the block has been read before writing the next one.
+ */
+static Latency measureLatency(FifoBuffer::Mode mode, uint32_t capacity, int32_t framesPerBlock) {
+    FifoBuffer fifo(kBytesPerFrame, capacity, mode);
+    std::atomic<bool> done{false};
+    std::vector<int64_t> latencies;
+    latencies.reserve(kLatencyBlocks);
+    std::thread reader([&]() {
+        std::vector<uint8_t> block(framesPerBlock * kBytesPerFrame);
+        int32_t framesRead = 0;
+        while (!done.load()) {
+            int32_t result = fifo.read(block.data() + framesRead * kBytesPerFrame,
+                                       framesPerBlock - framesRead);
+            if (result == 0) {
+                std::this_thread::yield();
+            }
+            framesRead += result;
+            if (framesRead == framesPerBlock) {
+                int64_t nowNanos = AudioClock::getNanoseconds();
+                int64_t writeNanos;
+                memcpy(&writeNanos, block.data(), sizeof(writeNanos));
+                latencies.push_back(nowNanos - writeNanos);
+                framesRead = 0;
+            }
+        }
+    });
+    std::vector<uint8_t> block(framesPerBlock * kBytesPerFrame);
+    for (int i = 0; i < kLatencyBlocks; i++) {
+        int64_t nowNanos = AudioClock::getNanoseconds();
+        memcpy(block.data(), &nowNanos, sizeof(nowNanos));
+        int32_t framesWritten = 0;
+        while (framesWritten < framesPerBlock) {
+            framesWritten += fifo.write(block.data() + framesWritten * kBytesPerFrame,
+                                        framesPerBlock - framesWritten);
+        }
+        while (fifo.getFullFramesAvailable() > 0) {
+            std::this_thread::yield(); // wait for the reader
+        }
+    }
+    done.store(true);
+    reader.join();
+    std::sort(latencies.begin(), latencies.end());
+    Latency result;
+    result.median = latencies[latencies.size() / 2];
+    result.percentile99 = latencies[latencies.size() * 99 / 100];
+    return result;
+}
+
+static void render(float *samples, int32_t numFrames, float *phase) {
+    for (int32_t i = 0; i < numFrames * kSamplesPerFrame; i++) {
+        samples[i] = *phase;
+        *phase += 0.001f; // arbitrary
+    }
+}
+
+static float consume(const float *samples, int32_t numFrames) {
+    float sum = 0.0f;
+    for (int32_t i = 0; i < numFrames * kSamplesPerFrame; i++) {
+        sum += samples[i];
+    }
+    return sum;
+}
+
+/**
+ * Render and consume samples in SingleProducerSingleConsumer mode.
+ * @return millions of frames per second
+ */
+static double measureRenderThroughput(bool useRegions, uint32_t capacity, int32_t framesPerBlock) {
+    FifoBuffer fifo(kBytesPerFrame, capacity, FifoBuffer::Mode::SingleProducerSingleConsumer);
+    int64_t startNanos = AudioClock::getNanoseconds();
+    std::thread writer([&fifo, useRegions, framesPerBlock]() {
+        std::vector<float> block(framesPerBlock * kSamplesPerFrame);
+        int32_t blockFramesWritten = framesPerBlock; // so the first block gets rendered
+        float phase = 0.0f;
+        int64_t framesLeft = kThroughputFrames;
+        while (framesLeft > 0) {
+            int32_t framesToWrite = static_cast<int32_t>(
+                    std::min(static_cast<int64_t>(framesPerBlock), framesLeft));
+            int32_t framesWritten = 0;
+            if (useRegions) {
+                FifoBuffer::Region region = fifo.acquireWriteRegion(framesToWrite);
+                for (int part = 0; part < 2; part++) {
+                    render(reinterpret_cast<float *>(region.data[part]), region.numFrames[part],
+                           &phase);
+                }
+                framesWritten = region.getTotalFrames();
+                fifo.commitWrite(framesWritten);
+            } else {
+                if (blockFramesWritten == framesPerBlock) {
+                    render(block.data(), framesPerBlock, &phase);
+                    blockFramesWritten = 0;
+                }
+                framesToWrite = std::min(framesToWrite, framesPerBlock - blockFramesWritten);
+                framesWritten = fifo.write(&block[blockFramesWritten * kSamplesPerFrame],
+                                           framesToWrite);
+                blockFramesWritten += framesWritten;
+            }
+            if (framesWritten == 0) {
+                std::this_thread::yield();
+            }
+            framesLeft -= framesWritten;
+        }
+    });
+    std::vector<float> block(framesPerBlock * kSamplesPerFrame);
+    float sum = 0.0f;
+    int64_t framesLeft = kThroughputFrames;
+    while (framesLeft > 0) {
+        int32_t framesRead = 0;
+        if (useRegions) {
+            FifoBuffer::Region region = fifo.acquireReadRegion(framesPerBlock);
+            for (int part = 0; part < 2; part++) {
+                sum += consume(reinterpret_cast<const float *>(region.data[part]),
+                               region.numFrames[part]);
+            }
+            framesRead = region.getTotalFrames();
+            fifo.commitRead(framesRead);
+        } else {
+            framesRead = fifo.read(block.data(), framesPerBlock);
+            sum += consume(block.data(), framesRead);
+        }
+        if (framesRead == 0) {
+            std::this_thread::yield();
+        }
+        framesLeft -= framesRead;
+    }
+    writer.join();
+    int64_t endNanos = AudioClock::getNanoseconds();
+    if (sum == 1.0f) {
+        printf("unlikely\n"); // so the sum is not optimized away
+    }
+    return kThroughputFrames * 1000.0 / (endNanos - startNanos);
+}
+
+int main() {
+    const FifoBuffer::Mode modes[] = {
+        FifoBuffer::Mode::Default,
+        FifoBuffer::Mode::SingleProducerSingleConsumer,
+    };
+    const uint32_t capacities[] = {1024, 1000};
+    const int32_t blockSizes[] = {1, 16, 192};
+
+    printf("mode, capacity, frames_per_block, mframes_per_second, "
+           "latency_median_ns, latency_p99_ns\n");
+    for (uint32_t capacity : capacities) {
+        for (int32_t framesPerBlock : blockSizes) {
+            for (FifoBuffer::Mode mode : modes) {
+                double throughput = measureThroughput(mode, capacity, framesPerBlock);
+                Latency latency = measureLatency(mode, capacity, framesPerBlock);
+                printf("%s, %u, %d, %.1f, %.0f, %.0f\n", modeToText(mode), capacity,
+                       framesPerBlock, throughput, latency.median, latency.percentile99);
+                fflush(stdout);
+            }
+        }
+    }
+
+    printf("\ncapacity, frames_per_block, mframes_per_second_copy, mframes_per_second_regions\n");
+    for (uint32_t capacity : capacities) {
+        for (int32_t framesPerBlock : blockSizes) {
+            double copyThroughput = measureRenderThroughput(false, capacity, framesPerBlock);
+            double regionThroughput = measureRenderThroughput(true, capacity, framesPerBlock);
+            printf("%u, %d, %.1f, %.1f\n", capacity, framesPerBlock,
+                   copyThroughput, regionThroughput);
+            fflush(stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measure the cost of running a typical conversion graph,
+ * Float => 44100 to 48000 Hz => I16, at different block sizes.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "common/AudioClock.h"
+#include "flowgraph/FlowGraph.h"
+#include "flowgraph/SampleRateConverter.h"
+#include "flowgraph/SinkI16.h"
+#include "flowgraph/SourceFloat.h"
+#include "flowgraph/resampler/MultiChannelResampler.h"
+
+using namespace oboe;
+using namespace oboe::flowgraph;
+using namespace resampler;
+
+constexpr int kChannelCount = 2;
+constexpr int kInputRate = 44100;
+constexpr int kOutputRate = 48000;
+constexpr int kFramesPerCallback = 192;
+constexpr int kNumCallbacks = 20000;
+constexpr int kNumWarmupCallbacks = 1000;
+
+/**
+ * @param compiled if true then run the graph from a FlowGraph execution plan
+ * @return average nanoseconds per callback
+ */
+static double measureBlockSize(int32_t framesPerBuffer,
+                               bool compiled,
+                               const std::vector<float> &sourceData) {
+    const int32_t numSourceFrames = static_cast<int32_t>(sourceData.size()) / kChannelCount;
+    std::unique_ptr<MultiChannelResampler> resampler(
+            MultiChannelResampler::make(kChannelCount, kInputRate, kOutputRate,
+                                        MultiChannelResampler::Quality::Medium));
+    SourceFloat source(kChannelCount, framesPerBuffer);
+    SampleRateConverter converter(kChannelCount, *resampler, framesPerBuffer);
+    SinkI16 sink(kChannelCount, framesPerBuffer);
+    source.output.connect(&converter.input);
+    converter.output.connect(&sink.input);
+    FlowGraph graph;
+    if (compiled) {
+        graph.compile(sink);
+    }
+
+    std::vector<int16_t> callbackData(kFramesPerCallback * kChannelCount);
+    int64_t elapsedNanos = 0;
+    for (int i = 0; i < kNumWarmupCallbacks + kNumCallbacks; i++) {
+        // Rewind the source so that the graph never runs dry.
+        source.setData(sourceData.data(), numSourceFrames);
+        int64_t startNanos = AudioClock::getNanoseconds();
+        int32_t framesRead = sink.read(callbackData.data(), kFramesPerCallback);
+        int64_t endNanos = AudioClock::getNanoseconds();
+        if (framesRead != kFramesPerCallback) {
+            fprintf(stderr, "ERROR - read %d frames, expected %d\n",
+                    framesRead, kFramesPerCallback);
+            return -1.0;
+        }
+        if (i >= kNumWarmupCallbacks) {
+            elapsedNanos += endNanos - startNanos;
+        }
+    }
+    return static_cast<double>(elapsedNanos) / kNumCallbacks;
+}
+
+int main() {
+    // Enough sine wave for several callbacks.
+    const int32_t numSourceFrames = 4 * kFramesPerCallback;
+    std::vector<float> sourceData(numSourceFrames * kChannelCount);
+    for (int32_t frame = 0; frame < numSourceFrames; frame++) {
+        float sample = 0.5f * sinf(frame * 2.0f * static_cast<float>(M_PI) * 440.0f / kInputRate);
+        for (int channel = 0; channel < kChannelCount; channel++) {
+            sourceData[frame * kChannelCount + channel] = sample;
+        }
+    }
+
+    printf("Float => %d to %d Hz => I16, %d channels, %d frames per callback\n",
+           kInputRate, kOutputRate, kChannelCount, kFramesPerCallback);
+    printf("block_size, compiled, ns_per_callback, ns_per_frame\n");
+    const int32_t blockSizes[] = {8, 16, 32, 64, 96, 192};
+    for (int32_t framesPerBuffer : blockSizes) {
+        for (bool compiled : {false, true}) {
+            double nanos = measureBlockSize(framesPerBuffer, compiled, sourceData);
+            if (nanos < 0) return 1;
+            printf("%10d, %8d, %15.1f, %12.2f\n", framesPerBuffer, compiled ? 1 : 0,
+                   nanos, nanos / kFramesPerCallback);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measure the sample format conversions, first the raw kernels,
+ * then every source and sink format pair running in a flowgraph.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "common/AudioClock.h"
+#include "flowgraph/SampleConversion.h"
+#include "flowgraph/SinkFloat.h"
+#include "flowgraph/SinkI16.h"
+#include "flowgraph/SinkI24.h"
+#include "flowgraph/SinkI32.h"
+#include "flowgraph/SourceFloat.h"
+#include "flowgraph/SourceI16.h"
+#include "flowgraph/SourceI24.h"
+#include "flowgraph/SourceI32.h"
+
+using namespace oboe;
+using namespace oboe::flowgraph;
+
+constexpr int kChannelCount = 2;
+constexpr int kFramesPerCallback = 192;
+constexpr int kNumSamples = kChannelCount * kFramesPerCallback;
+constexpr int kNumIterations = 100000;
+
+enum class Format {
+    Float,
+    I16,
+    I24,
+    I32,
+};
+
+static const char *formatToText(Format format) {
+    switch (format) {
+        case Format::Float: return "Float";
+        case Format::I16: return "I16";
+        case Format::I24: return "I24";
+        case Format::I32: return "I32";
+    }
+    return "?";
+}
+
+/**
+ * @return average nanoseconds per call
+ */
+static double measure(const std::function<void()> &function) {
+    for (int i = 0; i < kNumIterations / 10; i++) {
+        function(); // warm up
+    }
+    int64_t startNanos = AudioClock::getNanoseconds();
+    for (int i = 0; i < kNumIterations; i++) {
+        function();
+    }
+    int64_t endNanos = AudioClock::getNanoseconds();
+    return static_cast<double>(endNanos - startNanos) / kNumIterations;
+}
+
+static std::unique_ptr<FlowGraphSourceBuffered> makeSource(Format format) {
+    switch (format) {
+        case Format::I16: return std::make_unique<SourceI16>(kChannelCount, kFramesPerCallback);
+        case Format::I24: return std::make_unique<SourceI24>(kChannelCount, kFramesPerCallback);
+        case Format::I32: return std::make_unique<SourceI32>(kChannelCount, kFramesPerCallback);
+        case Format::Float:
+        default: return std::make_unique<SourceFloat>(kChannelCount, kFramesPerCallback);
+    }
+}
+
+static std::unique_ptr<FlowGraphSink> makeSink(Format format) {
+    switch (format) {
+        case Format::I16: return std::make_unique<SinkI16>(kChannelCount, kFramesPerCallback);
+        case Format::I24: return std::make_unique<SinkI24>(kChannelCount, kFramesPerCallback);
+        case Format::I32: return std::make_unique<SinkI32>(kChannelCount, kFramesPerCallback);
+        case Format::Float:
+        default: return std::make_unique<SinkFloat>(kChannelCount, kFramesPerCallback);
+    }
+}
+
+int main() {
+    std::vector<float> floats(kNumSamples);
+    for (int i = 0; i < kNumSamples; i++) {
+        floats[i] = 1.1f * sinf(i * 0.05f); // some samples will clip
+    }
+    std::vector<int16_t> shorts(kNumSamples);
+    std::vector<uint8_t> packed(kNumSamples * SampleConversion::kBytesPerI24Packed);
+    std::vector<int32_t> ints(kNumSamples);
+    std::vector<float> result(kNumSamples);
+    SampleConversion::floatToI16(shorts.data(), floats.data(), kNumSamples);
+    SampleConversion::floatToPackedI24(packed.data(), floats.data(), kNumSamples);
+    SampleConversion::floatToI32(ints.data(), floats.data(), kNumSamples);
+
+    printf("Instruction set = %s, %d samples per call\n",
+           SampleConversion::getInstructionSetName(), kNumSamples);
+    printf("kernel, ns_per_sample_vector, ns_per_sample_scalar, speedup\n");
+    struct Kernel {
+        const char *name;
+        std::function<void()> vector;
+        std::function<void()> scalar;
+    };
+    const Kernel kernels[] = {
+        {"floatToI16",
+            [&]() { SampleConversion::floatToI16(shorts.data(), floats.data(), kNumSamples); },
+            [&]() { SampleConversion::floatToI16Scalar(shorts.data(), floats.data(), kNumSamples); }},
+        {"floatToPackedI24",
+            [&]() { SampleConversion::floatToPackedI24(packed.data(), floats.data(), kNumSamples); },
+            [&]() { SampleConversion::floatToPackedI24Scalar(packed.data(), floats.data(),
+                                                             kNumSamples); }},
+        {"floatToI32",
+            [&]() { SampleConversion::floatToI32(ints.data(), floats.data(), kNumSamples); },
+            [&]() { SampleConversion::floatToI32Scalar(ints.data(), floats.data(), kNumSamples); }},
+        {"i16ToFloat",
+            [&]() { SampleConversion::i16ToFloat(result.data(), shorts.data(), kNumSamples); },
+            [&]() { SampleConversion::i16ToFloatScalar(result.data(), shorts.data(), kNumSamples); }},
+        {"packedI24ToFloat",
+            [&]() { SampleConversion::packedI24ToFloat(result.data(), packed.data(), kNumSamples); },
+            [&]() { SampleConversion::packedI24ToFloatScalar(result.data(), packed.data(),
+                                                             kNumSamples); }},
+        {"i32ToFloat",
+            [&]() { SampleConversion::i32ToFloat(result.data(), ints.data(), kNumSamples); },
+            [&]() { SampleConversion::i32ToFloatScalar(result.data(), ints.data(), kNumSamples); }},
+    };
+    for (const Kernel &kernel : kernels) {
+        double vectorNanos = measure(kernel.vector) / kNumSamples;
+        double scalarNanos = measure(kernel.scalar) / kNumSamples;
+        printf("%s, %.3f, %.3f, %.2f\n", kernel.name, vectorNanos, scalarNanos,
+               scalarNanos / vectorNanos);
+    }
+
+    // Run every pair of formats through a Source and a Sink.
+    printf("\nsource, sink, ns_per_frame\n");
+    const Format formats[] = {Format::Float, Format::I16, Format::I24, Format::I32};
+    std::vector<uint8_t> output(kNumSamples * sizeof(float));
+    for (Format sourceFormat : formats) {
+        const void *sourceData = nullptr;
+        switch (sourceFormat) {
+            case Format::Float: sourceData = floats.data(); break;
+            case Format::I16: sourceData = shorts.data(); break;
+            case Format::I24: sourceData = packed.data(); break;
+            case Format::I32: sourceData = ints.data(); break;
+        }
+        for (Format sinkFormat : formats) {
+            std::unique_ptr<FlowGraphSourceBuffered> source = makeSource(sourceFormat);
+            std::unique_ptr<FlowGraphSink> sink = makeSink(sinkFormat);
+            source->output.connect(&sink->input);
+            double nanos = measure([&]() {
+                source->setData(sourceData, kFramesPerCallback);
+                sink->read(output.data(), kFramesPerCallback);
+            });
+            printf("%s, %s, %.3f\n", formatToText(sourceFormat), formatToText(sinkFormat),
+                   nanos / kFramesPerCallback);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,313 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measure the cost and the quality of the resamplers for each
+ * MultiChannelResampler::Quality, at several common pairs of rates.
+ *
+ * The CPU cost is measured for several channel counts.
+ * The quality is measured once for each rate pair using a mono resampler,
+ * because every channel is filtered the same way.
+ *
+ * The quality measurements use a windowed FFT of the output:
+ *   THD+N is everything except the test tone, relative to the tone, for a 1 kHz tone.
+ *   Passband ripple is the range of the gain in dB for tones up to half of the lower Nyquist rate.
+ *   Stopband rejection is the worst case level of aliases and images, relative to the input.
+ *   It is measured for the passband tones, where any other output is an alias or an image.
+ *   When downsampling it also includes tones between the two Nyquist rates,
+ *   which should not appear in the output at all.
+ *
+ * The window limits the measurements to about -90 dB.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "common/AudioClock.h"
+#include "flowgraph/resampler/MultiChannelResampler.h"
+
+using namespace oboe;
+using namespace resampler;
+
+constexpr int kFramesPerBlock = 192;
+constexpr int kTimingBlocks = 4000;
+constexpr int kFftSize = 8192;
+constexpr int kSettleFrames = 1024; // more than the longest filter
+constexpr double kAmplitude = 0.5;
+constexpr double kPassbandEdge = 0.5; // fraction of the lower Nyquist rate
+constexpr int kSignalBins = 5; // half width of the main lobe of the window, plus one
+constexpr double kMinimumLevel = 1.0e-20; // avoid log(0)
+
+struct Ratio {
+    int32_t inputRate;
+    int32_t outputRate;
+};
+
+static const char *qualityToText(MultiChannelResampler::Quality quality) {
+    switch (quality) {
+        case MultiChannelResampler::Quality::Fastest: return "Fastest";
+        case MultiChannelResampler::Quality::Low: return "Low";
+        case MultiChannelResampler::Quality::Medium: return "Medium";
+        case MultiChannelResampler::Quality::High: return "High";
+        case MultiChannelResampler::Quality::Best: return "Best";
+    }
+    return "?";
+}
+
+static double toDecibels(double powerRatio) {
+    return 10.0 * log10(std::max(powerRatio, kMinimumLevel));
+}
+
+/**
+ * In place radix-2 FFT. The size must be a power of two.
+ */
+static void fft(std::vector<std::complex<double>> &data) {
+    const size_t n = data.size();
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+    for (size_t length = 2; length <= n; length <<= 1) {
+        const double angle = -2.0 * M_PI / length;
+        const std::complex<double> step(cos(angle), sin(angle));
+        for (size_t start = 0; start < n; start += length) {
+            std::complex<double> w(1.0, 0.0);
+            for (size_t k = 0; k < length / 2; k++) {
+                std::complex<double> even = data[start + k];
+                std::complex<double> odd = data[start + k + length / 2] * w;
+                data[start + k] = even + odd;
+                data[start + k + length / 2] = even - odd;
+                w *= step;
+            }
+        }
+    }
+}
+
+/**
+ * Power spectrum of the signal using a 4 term Blackman-Harris window.
+ * It is scaled so that a full scale sine gives a peak bin power of about 1.
+ */
+static std::vector<double> powerSpectrum(const std::vector<float> &signal) {
+    std::vector<std::complex<double>> data(kFftSize);
+    double windowSum = 0.0;
+    for (int i = 0; i < kFftSize; i++) {
+        const double x = 2.0 * M_PI * i / kFftSize;
+        const double window = 0.35875 - 0.48829 * cos(x) + 0.14128 * cos(2 * x)
+                - 0.01168 * cos(3 * x);
+        windowSum += window;
+        data[i] = signal[i] * window;
+    }
+    fft(data);
+    std::vector<double> power(kFftSize / 2);
+    const double scale = 2.0 / windowSum;
+    for (int i = 0; i < kFftSize / 2; i++) {
+        power[i] = std::norm(data[i] * scale);
+    }
+    return power;
+}
+
+/**
+ * Resample a sine wave and return kFftSize output frames after the filter has settled.
+ */
+static std::vector<float> resampleSine(const Ratio &ratio,
+                                       MultiChannelResampler::Quality quality,
+                                       double frequency) {
+    std::unique_ptr<MultiChannelResampler> resampler(MultiChannelResampler::make(
+            1, ratio.inputRate, ratio.outputRate, quality));
+    std::vector<float> output(kSettleFrames + kFftSize);
+    const double phaseIncrement = 2.0 * M_PI * frequency / ratio.inputRate;
+    int64_t inputFrameIndex = 0;
+    for (float &sample : output) {
+        while (resampler->isWriteNeeded()) {
+            float inputSample = static_cast<float>(
+                    kAmplitude * sin(phaseIncrement * inputFrameIndex++));
+            resampler->writeNextFrame(&inputSample);
+        }
+        resampler->readNextFrame(&sample);
+    }
+    return std::vector<float>(output.begin() + kSettleFrames, output.end());
+}
+
+static int frequencyToBin(double frequency, int32_t sampleRate) {
+    return static_cast<int>(lround(frequency * kFftSize / sampleRate));
+}
+
+// Choose a frequency in the middle of an output bin to reduce leakage.
+static double snapToBin(double frequency, int32_t sampleRate) {
+    return static_cast<double>(frequencyToBin(frequency, sampleRate)) * sampleRate / kFftSize;
+}
+
+static double sumPower(const std::vector<double> &power, int firstBin, int lastBin) {
+    double sum = 0.0;
+    for (int bin = std::max(firstBin, 0); bin <= std::min(lastBin, (int) power.size() - 1); bin++) {
+        sum += power[bin];
+    }
+    return sum;
+}
+
+// Everything except DC and the test tone.
+static double spuriousPower(const std::vector<double> &power, int signalBin) {
+    return sumPower(power, kSignalBins, signalBin - kSignalBins - 1)
+            + sumPower(power, signalBin + kSignalBins + 1, (int) power.size() - 1);
+}
+
+struct QualityResult {
+    double thdPlusNoiseDecibels;
+    double passbandRippleDecibels;
+    double stopbandRejectionDecibels;
+};
+
+static QualityResult measureQuality(const Ratio &ratio, MultiChannelResampler::Quality quality) {
+    QualityResult result;
+    const int32_t outputRate = ratio.outputRate;
+    const double inputPower = kAmplitude * kAmplitude;
+    const double lowerNyquist = std::min(ratio.inputRate, ratio.outputRate) / 2.0;
+
+    // THD+N for a 1 kHz tone.
+    {
+        const double frequency = snapToBin(1000.0, outputRate);
+        std::vector<double> power = powerSpectrum(resampleSine(ratio, quality, frequency));
+        const int bin = frequencyToBin(frequency, outputRate);
+        double signal = sumPower(power, bin - kSignalBins, bin + kSignalBins);
+        result.thdPlusNoiseDecibels = toDecibels(spuriousPower(power, bin) / signal);
+    }
+
+    // Sweep tones across the passband. The resampler is linear, so anything
+    // other than the tone is an alias or an image, which may have folded back into the passband.
+    double minGain = 1.0e9;
+    double maxGain = -1.0e9;
+    double worstSpurious = kMinimumLevel;
+    constexpr int kNumPassbandTones = 16;
+    for (int i = 0; i < kNumPassbandTones; i++) {
+        double frequency = 100.0 + (lowerNyquist * kPassbandEdge - 100.0) * i
+                / (kNumPassbandTones - 1);
+        frequency = snapToBin(frequency, outputRate);
+        std::vector<double> power = powerSpectrum(resampleSine(ratio, quality, frequency));
+        const int bin = frequencyToBin(frequency, outputRate);
+        double gain = toDecibels(sumPower(power, bin - kSignalBins, bin + kSignalBins)
+                / inputPower);
+        minGain = std::min(minGain, gain);
+        maxGain = std::max(maxGain, gain);
+        worstSpurious = std::max(worstSpurious, spuriousPower(power, bin) / inputPower);
+    }
+    result.passbandRippleDecibels = maxGain - minGain;
+
+    // When downsampling, tones between the two Nyquist rates should not appear at all.
+    if (ratio.inputRate > ratio.outputRate) {
+        const double inputNyquist = ratio.inputRate / 2.0;
+        const double outputNyquist = ratio.outputRate / 2.0;
+        constexpr int kNumStopbandTones = 8;
+        for (int i = 0; i < kNumStopbandTones; i++) {
+            double frequency = outputNyquist * 1.1
+                    + (inputNyquist * 0.95 - outputNyquist * 1.1) * i / (kNumStopbandTones - 1);
+            std::vector<double> power = powerSpectrum(resampleSine(ratio, quality, frequency));
+            worstSpurious = std::max(worstSpurious,
+                    sumPower(power, kSignalBins, (int) power.size() - 1) / inputPower);
+        }
+    }
+    result.stopbandRejectionDecibels = -toDecibels(worstSpurious);
+    return result;
+}
+
+/**
+ * @return average nanoseconds per output frame
+ */
+static double measureTime(const Ratio &ratio,
+                          MultiChannelResampler::Quality quality,
+                          int32_t channelCount) {
+    std::unique_ptr<MultiChannelResampler> resampler(MultiChannelResampler::make(
+            channelCount, ratio.inputRate, ratio.outputRate, quality));
+    std::vector<float> input(kFramesPerBlock * channelCount);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = 0.5f * sinf(i * 0.01f);
+    }
+    // Leave room for upsampling.
+    const int32_t maxOutputFrames = kFramesPerBlock * ratio.outputRate / ratio.inputRate + 2;
+    std::vector<float> output(maxOutputFrames * channelCount);
+    int64_t framesProduced = 0;
+    int64_t startNanos = 0;
+    for (int block = -(kTimingBlocks / 10); block < kTimingBlocks; block++) {
+        if (block == 0) { // warm up before timing
+            startNanos = AudioClock::getNanoseconds();
+            framesProduced = 0;
+        }
+        const float *inputFrame = input.data();
+        int32_t framesLeft = kFramesPerBlock;
+        while (framesLeft > 0) {
+            MultiChannelResampler::ProcessResult result = resampler->process(
+                    inputFrame, framesLeft, output.data(), maxOutputFrames);
+            inputFrame += result.framesConsumed * channelCount;
+            framesLeft -= result.framesConsumed;
+            framesProduced += result.framesProduced;
+        }
+    }
+    int64_t endNanos = AudioClock::getNanoseconds();
+    return static_cast<double>(endNanos - startNanos) / framesProduced;
+}
+
+int main(int argc, char **argv) {
+    // Pass --quick to skip the quality measurements.
+    const bool quick = (argc > 1) && (strcmp(argv[1], "--quick") == 0);
+    const MultiChannelResampler::Quality qualities[] = {
+        MultiChannelResampler::Quality::Fastest,
+        MultiChannelResampler::Quality::Low,
+        MultiChannelResampler::Quality::Medium,
+        MultiChannelResampler::Quality::High,
+        MultiChannelResampler::Quality::Best,
+    };
+    const Ratio ratios[] = {
+        {44100, 48000},
+        {48000, 44100},
+        {16000, 48000},
+        {48000, 16000},
+        {96000, 48000},
+        {48000, 96000},
+    };
+    const int32_t channelCounts[] = {1, 2, 6};
+
+    printf("quality, input_rate, output_rate, channels, ns_per_frame, "
+           "thd_n_db, passband_ripple_db, stopband_rejection_db\n");
+    for (MultiChannelResampler::Quality quality : qualities) {
+        for (const Ratio &ratio : ratios) {
+            QualityResult qualityResult = {0.0, 0.0, 0.0};
+            if (!quick) {
+                qualityResult = measureQuality(ratio, quality);
+            }
+            for (int32_t channelCount : channelCounts) {
+                double nanos = measureTime(ratio, quality, channelCount);
+                printf("%s, %d, %d, %d, %.2f, %.1f, %.2f, %.1f\n",
+                       qualityToText(quality), ratio.inputRate, ratio.outputRate, channelCount,
+                       nanos,
+                       qualityResult.thdPlusNoiseDecibels,
+                       qualityResult.passbandRippleDecibels,
+                       qualityResult.stopbandRejectionDecibels);
+                fflush(stdout);
+            }
+        }
+    }
+    return 0;
+}
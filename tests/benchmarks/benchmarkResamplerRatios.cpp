@@ -0,0 +1,105 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measure the resamplers at rate ratios that cannot be reduced enough for a
+ * polyphase table, as used by some Bluetooth and USB devices.
+ * These use the sinc resamplers, which interpolate between rows of coefficients.
+ * Each optimized resampler is compared with the generic SincResampler.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "common/AudioClock.h"
+#include "flowgraph/resampler/MultiChannelResampler.h"
+#include "flowgraph/resampler/SincResampler.h"
+
+using namespace oboe;
+using namespace resampler;
+
+constexpr int kFramesPerBlock = 192;
+constexpr int kNumBlocks = 5000;
+
+/**
+ * @return average nanoseconds per output frame
+ */
+static double measure(MultiChannelResampler &resampler) {
+    const int channelCount = resampler.getChannelCount();
+    std::vector<float> input(kFramesPerBlock * channelCount);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = 0.5f * sinf(i * 0.01f);
+    }
+    // Leave room for the extra frames when upsampling.
+    std::vector<float> output(kFramesPerBlock * 2 * channelCount);
+    int64_t framesProduced = 0;
+    int64_t startNanos = 0;
+    for (int block = -(kNumBlocks / 10); block < kNumBlocks; block++) {
+        if (block == 0) { // warm up before timing
+            startNanos = AudioClock::getNanoseconds();
+            framesProduced = 0;
+        }
+        const float *inputFrame = input.data();
+        int32_t framesLeft = kFramesPerBlock;
+        while (framesLeft > 0) {
+            MultiChannelResampler::ProcessResult result = resampler.process(
+                    inputFrame, framesLeft, output.data(), kFramesPerBlock * 2);
+            inputFrame += result.framesConsumed * channelCount;
+            framesLeft -= result.framesConsumed;
+            framesProduced += result.framesProduced;
+        }
+    }
+    int64_t endNanos = AudioClock::getNanoseconds();
+    return static_cast<double>(endNanos - startNanos) / framesProduced;
+}
+
+int main() {
+    struct Ratio {
+        int32_t inputRate;
+        int32_t outputRate;
+    };
+    const Ratio ratios[] = {
+        {44100, 48001},
+        {44056, 48000},
+        {48000, 44056},
+        {47999, 48000},
+        {48000, 48003},
+        {44100, 47981},
+    };
+    printf("input_rate, output_rate, channels, taps, ns_per_frame_optimized, "
+           "ns_per_frame_generic, speedup\n");
+    for (const Ratio &ratio : ratios) {
+        for (int32_t channelCount : {1, 2}) {
+            for (int32_t numTaps : {8, 16, 32}) {
+                MultiChannelResampler::Builder builder;
+                builder.setChannelCount(channelCount)
+                        ->setNumTaps(numTaps)
+                        ->setInputRate(ratio.inputRate)
+                        ->setOutputRate(ratio.outputRate);
+                std::unique_ptr<MultiChannelResampler> optimized(builder.build());
+                SincResampler generic(builder);
+                double optimizedNanos = measure(*optimized);
+                double genericNanos = measure(generic);
+                printf("%d, %d, %d, %d, %.2f, %.2f, %.2f\n",
+                       ratio.inputRate, ratio.outputRate, channelCount, numTaps,
+                       optimizedNanos, genericNanos, genericNanos / optimizedNanos);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,308 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Run the whole stream stack on a Linux host using the virtual device.
+ *
+ * Streams are opened with AudioStreamBuilder and AudioApi::Virtual, so they go through
+ * the QuirksManager, the FilterAudioStream and its DataConversionFlowGraph, and
+ * AudioStreamBuffered for blocking writes, just like streams on a phone.
+ * The virtual device wakes up once per burst on a timer thread.
+ *
+ * Usage: benchmarkVirtualStream [--quick] [--trace=FILE]
+ * With --trace the callbacks are recorded by the TraceRecorder and written to FILE
+ * as Chrome JSON, which can be opened in ui.perfetto.dev.
+ * The exit status is non-zero if a stream cannot be opened or started.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "common/AudioClock.h"
+#include "oboe/Oboe.h"
+
+using namespace oboe;
+
+constexpr int64_t kRunNanos = 3 * kNanosPerSecond;
+constexpr int64_t kQuickRunNanos = 300 * kNanosPerMillisecond;
+constexpr int64_t kTimeoutNanos = 500 * kNanosPerMillisecond;
+
+static bool sQuick = false;
+static const char *sTracePath = nullptr;
+
+static int64_t getRunNanos() {
+    return sQuick ? kQuickRunNanos : kRunNanos;
+}
+
+/**
+ * Renders a sine wave in the format of the stream, as a simple app would.
+ */
+class SineCallback : public AudioStreamDataCallback {
+public:
+    DataCallbackResult onAudioReady(AudioStream *audioStream,
+                                    void *audioData,
+                                    int32_t numFrames) override {
+        const int32_t channelCount = audioStream->getChannelCount();
+        const float phaseIncrement = 2.0f * static_cast<float>(M_PI) * 440.0f
+                / audioStream->getSampleRate();
+        float *floats = static_cast<float *>(audioData);
+        int16_t *shorts = static_cast<int16_t *>(audioData);
+        for (int32_t frame = 0; frame < numFrames; frame++) {
+            float sample = 0.5f * sinf(mPhase);
+            mPhase += phaseIncrement;
+            if (mPhase > static_cast<float>(M_PI)) mPhase -= 2.0f * static_cast<float>(M_PI);
+            for (int32_t channel = 0; channel < channelCount; channel++) {
+                if (audioStream->getFormat() == AudioFormat::I16) {
+                    *shorts++ = static_cast<int16_t>(sample * 32767.0f);
+                } else {
+                    *floats++ = sample;
+                }
+            }
+        }
+        return DataCallbackResult::Continue;
+    }
+
+private:
+    float mPhase = 0.0f;
+};
+
+struct StreamConfig {
+    const char *name;
+    AudioFormat format;
+    int32_t sampleRate;
+    int32_t channelCount;
+    int32_t framesPerCallback;
+    SampleRateConversionQuality quality;
+};
+
+static void setUpBuilder(AudioStreamBuilder &builder, const StreamConfig &config) {
+    builder.setAudioApi(AudioApi::Virtual)
+            ->setPerformanceMode(PerformanceMode::LowLatency)
+            ->setFormat(config.format)
+            ->setSampleRate(config.sampleRate)
+            ->setChannelCount(config.channelCount)
+            ->setFramesPerCallback(config.framesPerCallback)
+            ->setSampleRateConversionQuality(config.quality);
+}
+
+/**
+ * Measure the callback of streams that need more and more conversion to reach the device,
+ * which is 48000 Hz float stereo.
+ * @return number of failures
+ */
+static int measureConversion() {
+    printf("config, callbacks, callback_ns_50, callback_ns_99, callback_ns_max, xruns\n");
+    const StreamConfig configs[] = {
+        {"native", AudioFormat::Float, kUnspecified, kUnspecified, kUnspecified,
+                SampleRateConversionQuality::None},
+        {"i16", AudioFormat::I16, kUnspecified, kUnspecified, kUnspecified,
+                SampleRateConversionQuality::None},
+        {"i16_mono", AudioFormat::I16, kUnspecified, 1, kUnspecified,
+                SampleRateConversionQuality::None},
+        {"44100_medium", AudioFormat::Float, 44100, kUnspecified, kUnspecified,
+                SampleRateConversionQuality::Medium},
+        {"44100_best", AudioFormat::Float, 44100, kUnspecified, kUnspecified,
+                SampleRateConversionQuality::Best},
+        {"44100_best_i16_mono_cb100", AudioFormat::I16, 44100, 1, 100,
+                SampleRateConversionQuality::Best},
+    };
+    int numFailures = 0;
+    for (const StreamConfig &config : configs) {
+        SineCallback callback;
+        AudioStreamBuilder builder;
+        setUpBuilder(builder, config);
+        builder.setDataCallback(&callback);
+        AudioStream *stream = nullptr;
+        if (builder.openStream(&stream) != Result::OK
+                || stream->start(kTimeoutNanos) != Result::OK) {
+            printf("%s, FAILED to start\n", config.name);
+            numFailures++;
+            delete stream;
+            continue;
+        }
+        AudioClock::sleepForNanos(getRunNanos());
+        stream->stop(kTimeoutNanos);
+        // The telemetry of a FilterAudioStream includes the conversion.
+        StreamTelemetry::Snapshot snapshot;
+        stream->getTelemetry().getSnapshot(&snapshot);
+        printf("%s, %lld, %lld, %lld, %lld, %d\n", config.name,
+               static_cast<long long>(snapshot.callbackCount),
+               static_cast<long long>(snapshot.callbackNanos50),
+               static_cast<long long>(snapshot.callbackNanos99),
+               static_cast<long long>(snapshot.callbackNanosMax),
+               stream->getXRunCount().value());
+        stream->close();
+        delete stream;
+    }
+    return numFailures;
+}
+
+/**
+ * Count the xruns of a callback stream with a two burst buffer as the timer jitter rises.
+ * @return number of failures
+ */
+static int measureJitter() {
+    printf("\njitter_us, bursts, xruns, frames_underrun\n");
+    const int64_t jitterMicros[] = {0, 500, 2000, 5000};
+    int numFailures = 0;
+    for (int64_t jitter : jitterMicros) {
+        VirtualDevice::getInstance().setJitterNanoseconds(jitter * kNanosPerMicrosecond);
+        SineCallback callback;
+        AudioStreamBuilder builder;
+        builder.setAudioApi(AudioApi::Virtual)
+                ->setPerformanceMode(PerformanceMode::LowLatency)
+                ->setDataCallback(&callback);
+        AudioStream *stream = nullptr;
+        if (builder.openStream(&stream) != Result::OK
+                || stream->start(kTimeoutNanos) != Result::OK) {
+            printf("%lld, FAILED to start\n", static_cast<long long>(jitter));
+            numFailures++;
+            delete stream;
+            continue;
+        }
+        AudioClock::sleepForNanos(getRunNanos());
+        stream->stop(kTimeoutNanos);
+        StreamTelemetry::Snapshot snapshot;
+        stream->getTelemetry().getSnapshot(&snapshot);
+        printf("%lld, %lld, %d, %lld\n", static_cast<long long>(jitter),
+               static_cast<long long>(snapshot.callbackCount),
+               stream->getXRunCount().value(),
+               static_cast<long long>(snapshot.framesUnderrun));
+        stream->close();
+        delete stream;
+    }
+    VirtualDevice::getInstance().setJitterNanoseconds(0);
+    return numFailures;
+}
+
+/**
+ * Write to a blocking stream with a LatencyTuner while the device has jitter and stalls,
+ * and report how far the tuner raised the buffer size, and lowered it in Mode::Bidirectional.
+ * @return number of failures
+ */
+static int measureLatencyTuner(LatencyTuner::Mode mode) {
+    const bool isBidirectional = mode == LatencyTuner::Mode::Bidirectional;
+    VirtualDevice::getInstance().setJitterNanoseconds(1 * kNanosPerMillisecond);
+    AudioStreamBuilder builder;
+    builder.setAudioApi(AudioApi::Virtual)
+            ->setPerformanceMode(PerformanceMode::LowLatency);
+    AudioStream *stream = nullptr;
+    if (builder.openStream(&stream) != Result::OK
+            || stream->start(kTimeoutNanos) != Result::OK) {
+        printf("FAILED to start\n");
+        delete stream;
+        return 1;
+    }
+    LatencyTuner latencyTuner(*stream);
+    latencyTuner.setMode(mode);
+    LatencyTuner::DecreasePolicy policy;
+    policy.windowMillis = 50; // so that the quick run can see it lower the buffer size
+    policy.stableWindows = 4;
+    latencyTuner.setDecreasePolicy(policy);
+    const int32_t framesPerBurst = stream->getFramesPerBurst();
+    const int32_t initialBufferSize = stream->getBufferSizeInFrames();
+    std::vector<float> buffer(framesPerBurst * stream->getChannelCount());
+    const int32_t numStalls = sQuick ? 2 : 10;
+    const int64_t stallPeriodNanos = getRunNanos() / numStalls;
+    int64_t nextStallNanos = AudioClock::getNanoseconds() + stallPeriodNanos;
+    int numFailures = 0;
+    for (int stall = 0; stall < numStalls; ) {
+        latencyTuner.tune();
+        ResultWithValue<int32_t> result = stream->write(buffer.data(), framesPerBurst,
+                                                        kTimeoutNanos);
+        if (!result) {
+            printf("write() FAILED, %s\n", convertToText(result.error()));
+            numFailures++;
+            break;
+        }
+        if (AudioClock::getNanoseconds() >= nextStallNanos) {
+            // Longer than the two bursts that the virtual device buffers when using the FIFO.
+            VirtualDevice::getInstance().injectStall(3 * framesPerBurst * kNanosPerSecond
+                                                     / stream->getSampleRate());
+            nextStallNanos += stallPeriodNanos;
+            stall++;
+        }
+    }
+    // Give the tuner time to lower the buffer size after the last stall.
+    const int64_t tailNanos = std::max(getRunNanos() / 2, 2 * policy.stableWindows
+                                       * policy.windowMillis * kNanosPerMillisecond);
+    const int64_t endNanos = AudioClock::getNanoseconds() + tailNanos;
+    while (numFailures == 0 && AudioClock::getNanoseconds() < endNanos) {
+        latencyTuner.tune();
+        if (!stream->write(buffer.data(), framesPerBurst, kTimeoutNanos)) {
+            numFailures++;
+        }
+    }
+    LatencyTuner::Decision decisions[LatencyTuner::kMaxDecisions];
+    int32_t numDecisions = latencyTuner.getDecisions(decisions, LatencyTuner::kMaxDecisions);
+    int32_t peakBufferSize = initialBufferSize;
+    for (int32_t i = 0; i < numDecisions; i++) {
+        peakBufferSize = std::max(peakBufferSize, decisions[i].newBufferSize);
+    }
+    printf("%s, %d, %d, %d, %d, %d, %lld\n", isBidirectional ? "Bidirectional" : "IncreaseOnly",
+           numStalls, initialBufferSize, peakBufferSize, stream->getBufferSizeInFrames(),
+           stream->getXRunCount().value(),
+           static_cast<long long>(latencyTuner.getDecisionCount()));
+    stream->stop(kTimeoutNanos);
+    stream->close();
+    delete stream;
+    VirtualDevice::getInstance().setJitterNanoseconds(0);
+    return numFailures;
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            sQuick = true;
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            sTracePath = argv[i] + 8;
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--trace=FILE]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    VirtualDevice::getInstance().reset();
+    TraceRecorder::setEnabled(sTracePath != nullptr);
+    int numFailures = 0;
+    numFailures += measureConversion();
+    numFailures += measureJitter();
+    printf("\nmode, stalls, initial_buffer_frames, peak_buffer_frames, final_buffer_frames, "
+           "xruns, decisions\n");
+    numFailures += measureLatencyTuner(LatencyTuner::Mode::IncreaseOnly);
+    numFailures += measureLatencyTuner(LatencyTuner::Mode::Bidirectional);
+    if (sTracePath != nullptr) {
+        TraceRecorder::setEnabled(false);
+        FILE *file = fopen(sTracePath, "w");
+        int32_t numEvents = (file != nullptr) ? TraceRecorder::writeChromeJson(file) : -1;
+        if (file != nullptr) fclose(file);
+        if (numEvents < 0) {
+            printf("FAILED to write %s\n", sTracePath);
+            numFailures++;
+        } else {
+            printf("\nwrote %d trace events to %s\n", numEvents, sTracePath);
+        }
+    }
+    if (numFailures > 0) {
+        printf("%d measurements FAILED\n", numFailures);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Render a MegaDrone with many more voices, splitting each callback across cores
+ * with an AudioWorkerPool.
+ *
+ * The voices are the Oscillator and Mixer from the samples. They are split into groups
+ * of kVoicesPerGroup, each mixed by its own Mixer into its own buffer. The groups are the
+ * jobs of the pool, then the calling thread adds up the group buffers in order, so the
+ * output is the same for any number of workers.
+ *
+ * The callbacks are paced at the burst rate, as they would be on a device, so the workers
+ * have to be woken up for every callback.
+ *
+ * Usage: benchmarkWorkerPool [--quick] [--pin] [--voices=N]
+ * With --pin the calling thread runs on CPU 0 and worker i on CPU i + 1,
+ * wrapping around if there are more workers than cores.
+ * The exit status is non-zero if the output depends on the number of workers.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+#include "common/AudioClock.h"
+#include "oboe/AudioWorkerPool.h"
+
+#include "Mixer.h"
+#include "MonoToStereo.h"
+#include "Oscillator.h"
+
+using namespace oboe;
+
+constexpr int32_t kSampleRate = 48000;
+constexpr int32_t kFramesPerCallback = 192;
+constexpr int64_t kCallbackPeriodNanos = kFramesPerCallback * kNanosPerSecond / kSampleRate;
+constexpr int32_t kVoicesPerGroup = 64; // a Mixer holds at most kMaxTracks
+constexpr int32_t kMaxWorkers = 7;
+constexpr int32_t kNumCallbacks = 1000;
+constexpr int32_t kQuickNumCallbacks = 50;
+
+// Same as the MegaDrone Synth.
+constexpr float kOscBaseFrequency = 116.0;
+constexpr float kOscDivisor = 33;
+constexpr float kOscAmplitude = 0.009;
+constexpr int32_t kMegaDroneVoices = 100;
+
+static bool sQuick = false;
+static bool sPin = false;
+static int32_t sNumVoices = 1024;
+static int32_t sNumCores = 1;
+
+/**
+ * MegaDrone with any number of voices, mixed in groups on an AudioWorkerPool.
+ */
+class PooledDrone : public IRenderableAudio {
+public:
+    PooledDrone(int32_t numVoices, AudioWorkerPool *pool)
+            : mNumGroups((numVoices + kVoicesPerGroup - 1) / kVoicesPerGroup)
+            , mOscillators(std::make_unique<Oscillator[]>(numVoices))
+            , mMixers(std::make_unique<Mixer[]>(mNumGroups))
+            , mGroupBuffers(mNumGroups * kFramesPerCallback)
+            , mPool(pool) {
+        // Keep the level of the 100 voice MegaDrone.
+        const float amplitude = kOscAmplitude * kMegaDroneVoices / numVoices;
+        for (int32_t i = 0; i < numVoices; i++) {
+            Oscillator &oscillator = mOscillators[i];
+            oscillator.setSampleRate(kSampleRate);
+            oscillator.setFrequency(kOscBaseFrequency + (static_cast<float>(i) / kOscDivisor));
+            oscillator.setAmplitude(amplitude);
+            oscillator.setWaveOn(true);
+            mMixers[i / kVoicesPerGroup].addTrack(&oscillator);
+        }
+    }
+
+    void renderAudio(float *audioData, int32_t numFrames) override {
+        mPool->run(mNumGroups, [this, numFrames](int32_t group) {
+            mMixers[group].renderAudio(&mGroupBuffers[group * kFramesPerCallback], numFrames);
+        });
+        memset(audioData, 0, sizeof(float) * numFrames);
+        for (int32_t group = 0; group < mNumGroups; group++) {
+            const float *groupBuffer = &mGroupBuffers[group * kFramesPerCallback];
+            for (int32_t i = 0; i < numFrames; i++) {
+                audioData[i] += groupBuffer[i];
+            }
+        }
+    }
+
+    int32_t getNumGroups() const {
+        return mNumGroups;
+    }
+
+private:
+    const int32_t mNumGroups;
+    std::unique_ptr<Oscillator[]> mOscillators;
+    std::unique_ptr<Mixer[]> mMixers;
+    std::vector<float> mGroupBuffers;
+    AudioWorkerPool *mPool;
+};
+
+static void pinToCpu(int32_t cpu) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+        fprintf(stderr, "could not pin to CPU %d\n", cpu);
+    }
+}
+
+/**
+ * Render paced callbacks and print the callback times.
+ * @param firstCallback receives the stereo output of the first callback
+ * @return average callback time in nanoseconds
+ */
+static double measure(int32_t numWorkers, std::vector<float> &firstCallback,
+                      double singleThreadNanos) {
+    AudioWorkerPool pool(numWorkers);
+    if (sPin) {
+        std::vector<int32_t> cpuIds;
+        for (int32_t i = 0; i < numWorkers; i++) {
+            cpuIds.push_back((i + 1) % sNumCores);
+        }
+        pool.setCpuIds(cpuIds);
+    }
+    pool.start();
+    PooledDrone drone(sNumVoices, &pool);
+    MonoToStereo output(&drone);
+    std::vector<float> stereo(kFramesPerCallback * 2);
+
+    const int32_t numCallbacks = sQuick ? kQuickNumCallbacks : kNumCallbacks;
+    std::vector<int64_t> durations(numCallbacks);
+    int64_t nextCallbackNanos = AudioClock::getNanoseconds();
+    for (int32_t i = 0; i < numCallbacks; i++) {
+        AudioClock::sleepUntilNanoTime(nextCallbackNanos);
+        nextCallbackNanos += kCallbackPeriodNanos;
+        int64_t startNanos = AudioClock::getNanoseconds();
+        output.renderAudio(stereo.data(), kFramesPerCallback);
+        durations[i] = AudioClock::getNanoseconds() - startNanos;
+        if (i == 0) {
+            firstCallback = stereo;
+        }
+    }
+    pool.stop();
+
+    int64_t totalNanos = 0;
+    for (int64_t duration : durations) totalNanos += duration;
+    const double averageNanos = static_cast<double>(totalNanos) / numCallbacks;
+    std::sort(durations.begin(), durations.end());
+    const int64_t nanos99 = durations[(numCallbacks * 99) / 100];
+    const double speedup = (singleThreadNanos > 0.0) ? singleThreadNanos / averageNanos : 1.0;
+    const double workerShare = static_cast<double>(pool.getWorkerJobCount())
+            / std::max<int64_t>(1, pool.getJobCount());
+    printf("%d, %d, %d, %.0f, %lld, %lld, %.2f, %.1f, %.2f\n",
+           sNumVoices, drone.getNumGroups(), numWorkers, averageNanos,
+           (long long) nanos99, (long long) durations.back(), speedup,
+           100.0 * averageNanos / kCallbackPeriodNanos, workerShare);
+    return averageNanos;
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            sQuick = true;
+        } else if (strcmp(argv[i], "--pin") == 0) {
+            sPin = true;
+        } else if (strncmp(argv[i], "--voices=", 9) == 0) {
+            sNumVoices = std::max(1, atoi(argv[i] + 9));
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--pin] [--voices=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if (sPin) {
+        pinToCpu(0);
+    }
+    // Always try at least one worker so the pool is exercised on a single core.
+    sNumCores = std::max(1, static_cast<int32_t>(std::thread::hardware_concurrency()));
+    const int32_t maxWorkers = std::min(kMaxWorkers, std::max(1, sNumCores - 1));
+
+    printf("cores = %d, %d frames per callback, budget = %lld ns\n",
+           sNumCores, kFramesPerCallback, (long long) kCallbackPeriodNanos);
+    printf("voices, jobs, workers, callback_ns_mean, callback_ns_99, callback_ns_max,"
+           " speedup, budget_percent, worker_share\n");
+    std::vector<float> reference;
+    const double singleThreadNanos = measure(0, reference, 0.0);
+    int numFailures = 0;
+    for (int32_t numWorkers = 1; numWorkers <= maxWorkers; numWorkers++) {
+        std::vector<float> firstCallback;
+        measure(numWorkers, firstCallback, singleThreadNanos);
+        if (firstCallback != reference) {
+            printf("FAILED, output with %d workers does not match\n", numWorkers);
+            numFailures++;
+        }
+    }
+    return (numFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
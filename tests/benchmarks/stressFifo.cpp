@@ -0,0 +1,541 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stress test the FIFOs and block adapters on a Linux host, then measure their throughput.
+ *
+ * Each check moves numbered frames or bytes between threads in randomly sized pieces,
+ * mixing the copying and the in place methods, and verifies every frame that arrives.
+ * The counters are started just below 2^32 so that they cross it while the data moves.
+ * The checks can be run under ThreadSanitizer by building with -DOBOE_SANITIZE=thread.
+ *
+ * Usage: stressFifo [--quick] [--seed=N]
+ * The exit status is non-zero if any check fails.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "common/AudioClock.h"
+#include "common/FixedBlockReader.h"
+#include "common/FixedBlockWriter.h"
+#include "common/MonotonicCounter.h"
+#include "fifo/FifoController.h"
+#include "oboe/FifoBuffer.h"
+
+using namespace oboe;
+
+constexpr uint64_t kCounterStart = (1ULL << 32) - 5000; // arbitrary, crosses 2^32 soon
+constexpr int64_t kStressFrames = 4 * 1000 * 1000;
+constexpr int64_t kQuickStressFrames = 200 * 1000;
+constexpr int64_t kThroughputBytes = 2000LL * 1000 * 1000;
+constexpr int64_t kQuickThroughputBytes = 100LL * 1000 * 1000;
+
+static bool sQuick = false;
+static uint32_t sSeed = 1234; // arbitrary
+
+/**
+ * Four byte samples that identify the frame and the channel.
+ */
+static uint32_t makeSample(uint64_t frame, int32_t channel) {
+    return static_cast<uint32_t>(frame * 7 + channel); // arbitrary
+}
+
+static void fillFrames(uint8_t *data, uint64_t firstFrame, int32_t numFrames,
+                       int32_t channelCount) {
+    uint32_t *samples = reinterpret_cast<uint32_t *>(data);
+    for (int32_t frame = 0; frame < numFrames; frame++) {
+        for (int32_t channel = 0; channel < channelCount; channel++) {
+            *samples++ = makeSample(firstFrame + frame, channel);
+        }
+    }
+}
+
+/**
+ * @return number of samples that are not the expected ones
+ */
+static int32_t checkFrames(const uint8_t *data, uint64_t firstFrame, int32_t numFrames,
+                           int32_t channelCount) {
+    const uint32_t *samples = reinterpret_cast<const uint32_t *>(data);
+    int32_t numErrors = 0;
+    for (int32_t frame = 0; frame < numFrames; frame++) {
+        for (int32_t channel = 0; channel < channelCount; channel++) {
+            if (*samples++ != makeSample(firstFrame + frame, channel)) numErrors++;
+        }
+    }
+    return numErrors;
+}
+
+static int reportCheck(const char *name, int32_t numErrors) {
+    printf("%s, %s", name, (numErrors == 0) ? "PASS" : "FAIL");
+    if (numErrors != 0) printf(", %d errors", numErrors);
+    printf("\n");
+    fflush(stdout);
+    return (numErrors == 0) ? 0 : 1;
+}
+
+/**
+ * Write and read numbered frames from two threads.
+ * Each side randomly chooses between the copying and the in place methods,
+ * and uses sizes from one frame to more than the capacity.
+ *
+ * @return number of errors
+ */
+static int32_t stressFifo(FifoBuffer &fifo, int32_t channelCount) {
+    const int64_t numFrames = sQuick ? kQuickStressFrames : kStressFrames;
+    const int32_t maxFrames = static_cast<int32_t>(fifo.getBufferCapacityInFrames()) * 2;
+    const uint64_t startCounter = fifo.getReadCounter();
+    std::atomic<int32_t> numErrors{0};
+
+    std::thread writer([&]() {
+        std::mt19937 random(sSeed + 1);
+        std::uniform_int_distribution<int32_t> sizes(1, maxFrames);
+        std::vector<uint8_t> buffer(maxFrames * fifo.getBytesPerFrame());
+        int64_t framesWritten = 0;
+        while (framesWritten < numFrames && numErrors.load() == 0) {
+            int32_t framesToWrite = static_cast<int32_t>(
+                    std::min(static_cast<int64_t>(sizes(random)), numFrames - framesWritten));
+            int32_t result = 0;
+            if (random() & 1) {
+                fillFrames(buffer.data(), framesWritten, framesToWrite, channelCount);
+                result = fifo.write(buffer.data(), framesToWrite);
+            } else {
+                FifoBuffer::Region region = fifo.acquireWriteRegion(framesToWrite);
+                fillFrames(region.data[0], framesWritten, region.numFrames[0], channelCount);
+                fillFrames(region.data[1], framesWritten + region.numFrames[0],
+                           region.numFrames[1], channelCount);
+                result = region.getTotalFrames();
+                fifo.commitWrite(result);
+            }
+            if (result < 0 || result > framesToWrite) {
+                numErrors++;
+                return;
+            } else if (result == 0) {
+                std::this_thread::yield();
+            }
+            framesWritten += result;
+        }
+    });
+
+    std::mt19937 random(sSeed + 2);
+    std::uniform_int_distribution<int32_t> sizes(1, maxFrames);
+    std::vector<uint8_t> buffer(maxFrames * fifo.getBytesPerFrame());
+    int64_t framesRead = 0;
+    while (framesRead < numFrames && numErrors.load() == 0) {
+        int32_t framesToRead = sizes(random);
+        int32_t result = 0;
+        if (random() & 1) {
+            result = fifo.read(buffer.data(), framesToRead);
+            if (result > 0) {
+                numErrors += checkFrames(buffer.data(), framesRead, result, channelCount);
+            }
+        } else {
+            FifoBuffer::Region region = fifo.acquireReadRegion(framesToRead);
+            numErrors += checkFrames(region.data[0], framesRead, region.numFrames[0],
+                                     channelCount);
+            numErrors += checkFrames(region.data[1], framesRead + region.numFrames[0],
+                                     region.numFrames[1], channelCount);
+            result = region.getTotalFrames();
+            fifo.commitRead(result);
+        }
+        if (result < 0 || result > framesToRead) {
+            numErrors++;
+        } else if (result == 0) {
+            std::this_thread::yield();
+        }
+        framesRead += result;
+    }
+    writer.join();
+    if (fifo.getReadCounter() != startCounter + numFrames
+            || fifo.getWriteCounter() != startCounter + numFrames) {
+        numErrors++;
+    }
+    return numErrors.load();
+}
+
+static int checkFifoBuffers() {
+    int numFailures = 0;
+    const FifoBuffer::Mode modes[] = {
+        FifoBuffer::Mode::Default,
+        FifoBuffer::Mode::SingleProducerSingleConsumer,
+    };
+    const uint32_t capacities[] = {1, 7, 1024, 1000};
+    const int32_t channelCounts[] = {1, 3};
+    char name[128];
+    for (FifoBuffer::Mode mode : modes) {
+        for (uint32_t capacity : capacities) {
+            for (int32_t channelCount : channelCounts) {
+                FifoBuffer fifo(channelCount * sizeof(uint32_t), capacity, mode);
+                fifo.setReadCounter(kCounterStart);
+                fifo.setWriteCounter(kCounterStart);
+                snprintf(name, sizeof(name), "FifoBuffer %s capacity %u channels %d",
+                         (mode == FifoBuffer::Mode::Default) ? "Default" : "SPSC",
+                         capacity, channelCount);
+                numFailures += reportCheck(name, stressFifo(fifo, channelCount));
+            }
+        }
+    }
+
+    // Storage and counters outside of the FifoBuffer, as in shared memory.
+    for (uint32_t capacity : capacities) {
+        constexpr int32_t kChannelCount = 2;
+        std::atomic<uint64_t> readCounter{kCounterStart};
+        std::atomic<uint64_t> writeCounter{kCounterStart};
+        std::vector<uint8_t> storage(capacity * kChannelCount * sizeof(uint32_t));
+        FifoBuffer fifo(kChannelCount * sizeof(uint32_t), capacity,
+                        &readCounter, &writeCounter, storage.data());
+        snprintf(name, sizeof(name), "FifoBuffer Indirect capacity %u channels %d",
+                 capacity, kChannelCount);
+        numFailures += reportCheck(name, stressFifo(fifo, kChannelCount));
+    }
+    return numFailures;
+}
+
+/**
+ * Move the counters of the largest allowed FIFO in random steps and compare them
+ * with a simple model. No storage is needed because only the controller is checked.
+ */
+static int checkLargeCapacity() {
+    const uint32_t capacity = UINT32_MAX / 4;
+    const uint64_t starts[] = {0, kCounterStart, (1ULL << 33) + 5, 1ULL << 62};
+    const int numSteps = sQuick ? 10000 : 1000000;
+    std::mt19937_64 random(sSeed + 3);
+    int32_t numErrors = 0;
+    for (uint64_t start : starts) {
+        FifoController controller(capacity);
+        controller.setReadCounter(start);
+        controller.setWriteCounter(start);
+        uint64_t readCounter = start;
+        uint64_t writeCounter = start;
+        for (int i = 0; i < numSteps; i++) {
+            uint64_t full = writeCounter - readCounter;
+            if (random() & 1) {
+                uint64_t empty = capacity - full;
+                uint32_t step = static_cast<uint32_t>(random() % (empty + 1));
+                controller.advanceWriteIndex(step);
+                writeCounter += step;
+            } else {
+                uint32_t step = static_cast<uint32_t>(random() % (full + 1));
+                controller.advanceReadIndex(step);
+                readCounter += step;
+            }
+            full = writeCounter - readCounter;
+            if (controller.getFullFramesAvailable() != full) numErrors++;
+            if (controller.getEmptyFramesAvailable() != capacity - full) numErrors++;
+            if (controller.getReadIndex() != readCounter % capacity) numErrors++;
+            if (controller.getWriteIndex() != writeCounter % capacity) numErrors++;
+        }
+        // An overrun is clipped to the capacity.
+        controller.advanceWriteIndex(capacity);
+        if (controller.getFullFramesAvailable() != capacity) numErrors++;
+        if (controller.getEmptyFramesAvailable() != 0) numErrors++;
+    }
+    return reportCheck("FifoController capacity UINT32_MAX / 4", numErrors);
+}
+
+/**
+ * Passes each fixed size block through a FIFO that holds one block per frame.
+ * It gives up if the other thread has found an error.
+ */
+class BlockFifoProcessor : public FixedBlockProcessor {
+public:
+    BlockFifoProcessor(FifoBuffer &fifo, bool isWriter, const std::atomic<int32_t> &numErrors)
+            : mFifo(fifo)
+            , mIsWriter(isWriter)
+            , mNumErrors(numErrors) {}
+
+    int32_t onProcessFixedBlock(uint8_t *buffer, int32_t numBytes) override {
+        if (numBytes != static_cast<int32_t>(mFifo.getBytesPerFrame())) {
+            return -1;
+        }
+        while ((mIsWriter ? mFifo.write(buffer, 1) : mFifo.read(buffer, 1)) == 0) {
+            if (mNumErrors.load() != 0) {
+                return -1;
+            }
+            std::this_thread::yield();
+        }
+        return numBytes;
+    }
+
+private:
+    FifoBuffer &mFifo;
+    const bool mIsWriter;
+    const std::atomic<int32_t> &mNumErrors;
+};
+
+static uint8_t makeByte(int64_t position) {
+    return static_cast<uint8_t>(position ^ (position >> 8));
+}
+
+/**
+ * A FixedBlockWriter on one thread passes blocks through a FIFO to a FixedBlockReader
+ * on another thread. Each side randomly chooses between copying and working in place.
+ *
+ * @return number of errors
+ */
+static int32_t stressFixedBlocks(int32_t bytesPerBlock) {
+    const int64_t numBytes = (sQuick ? kQuickStressFrames : kStressFrames) / bytesPerBlock
+            * bytesPerBlock; // whole blocks so that the writer passes on all of the data
+    const int32_t maxBytes = bytesPerBlock * 3;
+    FifoBuffer fifo(bytesPerBlock, 4, FifoBuffer::Mode::SingleProducerSingleConsumer);
+    std::atomic<int32_t> numErrors{0};
+
+    std::thread writerThread([&]() {
+        BlockFifoProcessor processor(fifo, true, numErrors);
+        FixedBlockWriter writer(processor);
+        writer.open(bytesPerBlock);
+        std::mt19937 random(sSeed + 4);
+        std::uniform_int_distribution<int32_t> sizes(1, maxBytes);
+        std::vector<uint8_t> buffer(maxBytes);
+        int64_t position = 0;
+        while (position < numBytes) {
+            int32_t bytesToWrite = static_cast<int32_t>(
+                    std::min(static_cast<int64_t>(sizes(random)), numBytes - position));
+            int32_t result = 0;
+            if (random() & 1) {
+                for (int32_t i = 0; i < bytesToWrite; i++) {
+                    buffer[i] = makeByte(position + i);
+                }
+                result = writer.write(buffer.data(), bytesToWrite);
+            } else {
+                int32_t bytesAvailable = 0;
+                uint8_t *data = writer.acquireWrite(&bytesAvailable);
+                bytesToWrite = std::min(bytesToWrite, bytesAvailable);
+                for (int32_t i = 0; i < bytesToWrite; i++) {
+                    data[i] = makeByte(position + i);
+                }
+                result = writer.commitWrite(bytesToWrite);
+            }
+            if (result != bytesToWrite) {
+                numErrors++;
+                return;
+            }
+            position += result;
+        }
+    });
+
+    BlockFifoProcessor processor(fifo, false, numErrors);
+    FixedBlockReader reader(processor);
+    reader.open(bytesPerBlock);
+    std::mt19937 random(sSeed + 5);
+    std::uniform_int_distribution<int32_t> sizes(1, maxBytes);
+    std::vector<uint8_t> buffer(maxBytes);
+    int64_t position = 0;
+    while (position < numBytes && numErrors.load() == 0) {
+        int32_t bytesToRead = static_cast<int32_t>(
+                std::min(static_cast<int64_t>(sizes(random)), numBytes - position));
+        const uint8_t *data = buffer.data();
+        int32_t result = 0;
+        bool inPlace = random() & 1;
+        if (inPlace) {
+            data = reader.acquireRead(bytesToRead, &result);
+        } else {
+            result = reader.read(buffer.data(), bytesToRead);
+        }
+        if (result <= 0 || result > bytesToRead) {
+            numErrors++;
+            break;
+        }
+        for (int32_t i = 0; i < result; i++) {
+            if (data[i] != makeByte(position + i)) numErrors++;
+        }
+        if (inPlace) {
+            reader.commitRead(result);
+        }
+        position += result;
+    }
+    writerThread.join();
+    return numErrors.load();
+}
+
+static int checkFixedBlocks() {
+    int numFailures = 0;
+    const int32_t blockSizes[] = {1, 12, 1024};
+    char name[128];
+    for (int32_t bytesPerBlock : blockSizes) {
+        snprintf(name, sizeof(name), "FixedBlockWriter to FixedBlockReader block %d",
+                 bytesPerBlock);
+        numFailures += reportCheck(name, stressFixedBlocks(bytesPerBlock));
+    }
+    return numFailures;
+}
+
+/**
+ * Feed MonotonicCounter::update32() a 32-bit counter that wraps many times.
+ */
+static int checkMonotonicCounter() {
+    const int numSteps = sQuick ? 10000 : 1000000;
+    std::mt19937 random(sSeed + 6);
+    int32_t numErrors = 0;
+    MonotonicCounter counter;
+    int64_t expected = 0;
+    uint32_t counter32 = 0;
+    for (int i = 0; i < numSteps; i++) {
+        // Small steps, large steps up to the limit, and steps backwards that must be ignored.
+        int32_t step = 0;
+        switch (random() % 3) {
+            case 0: step = static_cast<int32_t>(random() % 1000); break;
+            case 1: step = static_cast<int32_t>(random() % 0x7FFFFFFF); break;
+            default: step = -static_cast<int32_t>(random() % 1000); break;
+        }
+        const uint32_t newCounter32 = counter32 + static_cast<uint32_t>(step);
+        if (step > 0) {
+            expected += step;
+            counter32 = newCounter32;
+        }
+        // Converting to int32_t wraps, as it would for a counter read from a device.
+        if (counter.update32(static_cast<int32_t>(newCounter32)) != expected) numErrors++;
+    }
+    // A reset counter starts again from zero without moving the 64-bit counter backwards.
+    counter.reset32();
+    if (counter.update32(100) != expected + 100) numErrors++;
+    counter.set(1001);
+    counter.roundUp64(1000);
+    if (counter.get() != 2000) numErrors++;
+    return reportCheck("MonotonicCounter update32 wrapping", numErrors);
+}
+
+/**
+ * @return gigabytes per second through the FIFO
+ */
+static double measureFifoThroughput(FifoBuffer &fifo, int32_t framesPerBlock) {
+    const int64_t numFrames = (sQuick ? kQuickThroughputBytes : kThroughputBytes)
+            / fifo.getBytesPerFrame();
+    const size_t bytesPerBlock = framesPerBlock * fifo.getBytesPerFrame();
+    int64_t startNanos = AudioClock::getNanoseconds();
+    std::thread writer([&fifo, framesPerBlock, numFrames, bytesPerBlock]() {
+        std::vector<uint8_t> block(bytesPerBlock);
+        int64_t framesLeft = numFrames;
+        while (framesLeft > 0) {
+            int32_t framesWritten = fifo.write(block.data(), static_cast<int32_t>(
+                    std::min(static_cast<int64_t>(framesPerBlock), framesLeft)));
+            if (framesWritten == 0) {
+                std::this_thread::yield();
+            }
+            framesLeft -= framesWritten;
+        }
+    });
+    std::vector<uint8_t> block(bytesPerBlock);
+    int64_t framesLeft = numFrames;
+    while (framesLeft > 0) {
+        int32_t framesRead = fifo.read(block.data(), framesPerBlock);
+        if (framesRead == 0) {
+            std::this_thread::yield();
+        }
+        framesLeft -= framesRead;
+    }
+    writer.join();
+    int64_t endNanos = AudioClock::getNanoseconds();
+    return static_cast<double>(numFrames * fifo.getBytesPerFrame()) / (endNanos - startNanos);
+}
+
+/**
+ * Pass blocks through a FixedBlockWriter and a FixedBlockReader on one thread,
+ * using an odd variable block size so that most blocks are split.
+ *
+ * @return gigabytes per second through each adapter
+ */
+static double measureFixedBlockThroughput(int32_t bytesPerBlock) {
+    class NullProcessor : public FixedBlockProcessor {
+    public:
+        int32_t onProcessFixedBlock(uint8_t * /* buffer */, int32_t numBytes) override {
+            return numBytes;
+        }
+    } processor;
+    FixedBlockWriter writer(processor);
+    FixedBlockReader reader(processor);
+    writer.open(bytesPerBlock);
+    reader.open(bytesPerBlock);
+    const int64_t numBytes = sQuick ? kQuickThroughputBytes : kThroughputBytes;
+    const int32_t bytesPerWrite = bytesPerBlock * 3 / 4 + 1; // arbitrary
+    std::vector<uint8_t> buffer(bytesPerWrite);
+    int64_t startNanos = AudioClock::getNanoseconds();
+    for (int64_t position = 0; position < numBytes; position += 2 * bytesPerWrite) {
+        writer.write(buffer.data(), bytesPerWrite);
+        reader.read(buffer.data(), bytesPerWrite);
+    }
+    int64_t endNanos = AudioClock::getNanoseconds();
+    return static_cast<double>(numBytes) / (endNanos - startNanos);
+}
+
+static void measureThroughput() {
+    printf("\nfifo, capacity_bytes, bytes_per_block, gigabytes_per_second\n");
+    constexpr int32_t kBytesPerFrame = 8; // stereo float
+    constexpr uint32_t kCapacityFrames = 8192;
+    const int32_t blockSizes[] = {8, 128, 2048};
+    for (int32_t framesPerBlock : blockSizes) {
+        FifoBuffer fifo(kBytesPerFrame, kCapacityFrames);
+        double defaultRate = measureFifoThroughput(fifo, framesPerBlock);
+        FifoBuffer fifoSpsc(kBytesPerFrame, kCapacityFrames,
+                            FifoBuffer::Mode::SingleProducerSingleConsumer);
+        double spscRate = measureFifoThroughput(fifoSpsc, framesPerBlock);
+        std::atomic<uint64_t> readCounter{0};
+        std::atomic<uint64_t> writeCounter{0};
+        std::vector<uint8_t> storage(kCapacityFrames * kBytesPerFrame);
+        FifoBuffer fifoIndirect(kBytesPerFrame, kCapacityFrames,
+                                &readCounter, &writeCounter, storage.data());
+        double indirectRate = measureFifoThroughput(fifoIndirect, framesPerBlock);
+        const int32_t bytesPerBlock = framesPerBlock * kBytesPerFrame;
+        const uint32_t capacityBytes = kCapacityFrames * kBytesPerFrame;
+        printf("Default, %u, %d, %.2f\n", capacityBytes, bytesPerBlock, defaultRate);
+        printf("SPSC, %u, %d, %.2f\n", capacityBytes, bytesPerBlock, spscRate);
+        printf("Indirect, %u, %d, %.2f\n", capacityBytes, bytesPerBlock, indirectRate);
+        fflush(stdout);
+    }
+
+    printf("\nadapter, bytes_per_block, gigabytes_per_second\n");
+    for (int32_t framesPerBlock : blockSizes) {
+        const int32_t bytesPerBlock = framesPerBlock * kBytesPerFrame;
+        printf("FixedBlockWriter+Reader, %d, %.2f\n", bytesPerBlock,
+               measureFixedBlockThroughput(bytesPerBlock));
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            sQuick = true;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            sSeed = static_cast<uint32_t>(strtoul(argv[i] + 7, nullptr, 10));
+        } else {
+            fprintf(stderr, "usage: %s [--quick] [--seed=N]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    printf("seed = %u\n", sSeed);
+    printf("check, result\n");
+    int numFailures = 0;
+    numFailures += checkFifoBuffers();
+    numFailures += checkLargeCapacity();
+    numFailures += checkFixedBlocks();
+    numFailures += checkMonotonicCounter();
+    if (numFailures > 0) {
+        printf("%d checks FAILED\n", numFailures);
+        return EXIT_FAILURE;
+    }
+    measureThroughput();
+    return EXIT_SUCCESS;
+}
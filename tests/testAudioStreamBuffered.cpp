@@ -0,0 +1,315 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the blocking read() and write() of AudioStreamBuffered without OpenSL ES.
+ * A timer thread plays the part of the OpenSL ES callback and calls onDefaultCallback().
+ * The tests measure how long a blocked app thread takes to wake up after the callback.
+ * They also check the timestamps that the callback records in the FIFO,
+ * and that no data is lost when the FIFO grows.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/AudioClock.h"
+#include "opensles/AudioStreamBuffered.h"
+
+using namespace oboe;
+
+constexpr int32_t kSampleRate = 48000;
+constexpr int32_t kChannelCount = 2;
+constexpr int32_t kFramesPerBurst = 96; // 2 msec
+constexpr int kNumBursts = 200;
+constexpr int64_t kTimeoutNanos = 500 * kNanosPerMillisecond;
+// Sleeping until a predicted callback time plus a margin took about 300 usec.
+constexpr int64_t kMaxMedianWakeNanos = 200 * kNanosPerMicrosecond; // arbitrary
+
+/**
+ * An AudioStreamBuffered that is not connected to any audio device.
+ */
+class FakeBufferedStream : public AudioStreamBuffered {
+public:
+    explicit FakeBufferedStream(const AudioStreamBuilder &builder)
+            : AudioStreamBuffered(builder) {
+        mFramesPerBurst = kFramesPerBurst;
+        allocateFifo();
+        setBufferSizeInFrames(2 * kFramesPerBurst);
+    }
+
+    Result requestStart() override { return Result::OK; }
+    Result requestPause() override { return Result::OK; }
+    Result requestFlush() override { return Result::OK; }
+    Result requestStop() override { return Result::OK; }
+    StreamState getState() override { return StreamState::Started; }
+    Result waitForStateChange(StreamState /* inputState */,
+                              StreamState *nextState,
+                              int64_t /* timeoutNanoseconds */) override {
+        if (nextState != nullptr) *nextState = StreamState::Started;
+        return Result::OK;
+    }
+    AudioApi getAudioApi() const override { return AudioApi::OpenSLES; }
+
+    // Called by the timer thread in place of the OpenSL ES callback.
+    void fireCallback(void *audioData, int numFrames) {
+        onDefaultCallback(audioData, numFrames);
+    }
+
+protected:
+    Result updateServiceFrameCounter() override { return Result::OK; }
+};
+
+class TestAudioStreamBuffered : public ::testing::Test {
+protected:
+    void openStream(Direction direction) {
+        AudioStreamBuilder builder;
+        builder.setDirection(direction)
+                ->setSampleRate(kSampleRate)
+                ->setChannelCount(kChannelCount)
+                ->setFormat(AudioFormat::Float);
+        mStream = std::make_unique<FakeBufferedStream>(builder);
+        mBurst.resize(2 * kFramesPerBurst * kChannelCount); // some tests write two bursts
+    }
+
+    // Call the stream once per burst period and note the time of the latest call.
+    void startTimer() {
+        mTimerThread = std::thread([this]() {
+            int64_t nextCallbackNanos = AudioClock::getNanoseconds();
+            std::vector<float> buffer(kFramesPerBurst * kChannelCount);
+            for (int i = 0; i < kNumBursts && !mStopTimer.load(); i++) {
+                nextCallbackNanos += kFramesPerBurst * kNanosPerSecond / kSampleRate;
+                AudioClock::sleepUntilNanoTime(nextCallbackNanos);
+                mLastCallbackNanos.store(AudioClock::getNanoseconds());
+                mStream->fireCallback(buffer.data(), kFramesPerBurst);
+            }
+        });
+    }
+
+    void stopTimer() {
+        mStopTimer.store(true);
+        mTimerThread.join();
+    }
+
+    // An ASSERT that fails while the timer is running returns before stopTimer().
+    void TearDown() override {
+        if (mTimerThread.joinable()) {
+            stopTimer();
+        }
+    }
+
+    // Transfer one burst at a time and measure the time from the callback to the return.
+    void measureWakeLatency() {
+        std::vector<int64_t> latencies;
+        for (int i = 0; i < kNumBursts / 2; i++) {
+            ResultWithValue<int32_t> result = (mStream->getDirection() == Direction::Output)
+                    ? mStream->write(mBurst.data(), kFramesPerBurst, kTimeoutNanos)
+                    : mStream->read(mBurst.data(), kFramesPerBurst, kTimeoutNanos);
+            int64_t nowNanos = AudioClock::getNanoseconds();
+            ASSERT_EQ(kFramesPerBurst, result.value());
+            if (i > 0) { // the first one may not have blocked
+                latencies.push_back(nowNanos - mLastCallbackNanos.load());
+            }
+        }
+        std::sort(latencies.begin(), latencies.end());
+        int64_t median = latencies[latencies.size() / 2];
+        printf("wake latency: median = %d usec, max = %d usec\n",
+               static_cast<int>(median / kNanosPerMicrosecond),
+               static_cast<int>(latencies.back() / kNanosPerMicrosecond));
+        EXPECT_LT(median, kMaxMedianWakeNanos);
+    }
+
+    std::unique_ptr<FakeBufferedStream> mStream;
+    std::vector<float> mBurst;
+    std::thread mTimerThread;
+    std::atomic<bool> mStopTimer{false};
+    std::atomic<int64_t> mLastCallbackNanos{0};
+};
+
+TEST_F(TestAudioStreamBuffered, BlockingWriteWakesAfterCallback) {
+    openStream(Direction::Output);
+    // Fill the buffer so that each write has to wait for a callback.
+    ASSERT_EQ(2 * kFramesPerBurst, mStream->write(mBurst.data(), 2 * kFramesPerBurst, 0).value());
+    startTimer();
+    measureWakeLatency();
+    stopTimer();
+}
+
+TEST_F(TestAudioStreamBuffered, BlockingReadWakesAfterCallback) {
+    openStream(Direction::Input);
+    startTimer();
+    measureWakeLatency();
+    stopTimer();
+}
+
+TEST_F(TestAudioStreamBuffered, BlockingWriteTimesOut) {
+    openStream(Direction::Output);
+    ASSERT_EQ(2 * kFramesPerBurst, mStream->write(mBurst.data(), 2 * kFramesPerBurst, 0).value());
+    constexpr int64_t kShortTimeoutNanos = 20 * kNanosPerMillisecond;
+    int64_t startNanos = AudioClock::getNanoseconds();
+    ResultWithValue<int32_t> result = mStream->write(mBurst.data(), kFramesPerBurst,
+                                                     kShortTimeoutNanos);
+    int64_t elapsedNanos = AudioClock::getNanoseconds() - startNanos;
+    EXPECT_EQ(0, result.value());
+    EXPECT_GE(elapsedNanos, kShortTimeoutNanos);
+    EXPECT_LT(elapsedNanos, kTimeoutNanos);
+}
+
+TEST_F(TestAudioStreamBuffered, TimestampFollowsDataAfterUnderrun) {
+    openStream(Direction::Output);
+    std::vector<float> buffer(kFramesPerBurst * kChannelCount);
+    int64_t framePosition = 0;
+    int64_t timeNanos = 0;
+    EXPECT_EQ(Result::ErrorUnavailable,
+              mStream->getTimestamp(CLOCK_MONOTONIC, &framePosition, &timeNanos));
+
+    // Only write half a burst so that the first callback underruns.
+    ASSERT_EQ(kFramesPerBurst / 2, mStream->write(mBurst.data(), kFramesPerBurst / 2, 0).value());
+    mStream->fireCallback(buffer.data(), kFramesPerBurst);
+    EXPECT_EQ(1, mStream->getXRunCount().value());
+
+    ASSERT_EQ(kFramesPerBurst, mStream->write(mBurst.data(), kFramesPerBurst, 0).value());
+    int64_t beforeNanos = AudioClock::getNanoseconds();
+    mStream->fireCallback(buffer.data(), kFramesPerBurst);
+    int64_t afterNanos = AudioClock::getNanoseconds();
+
+    // The second callback started with the first frame written after the underrun,
+    // not with the frame that a count of the callback frames would give.
+    ASSERT_EQ(Result::OK, mStream->getTimestamp(CLOCK_MONOTONIC, &framePosition, &timeNanos));
+    EXPECT_EQ(kFramesPerBurst / 2, framePosition);
+    EXPECT_GE(timeNanos, beforeNanos);
+    EXPECT_LE(timeNanos, afterNanos);
+}
+
+TEST_F(TestAudioStreamBuffered, TelemetryRecordsUnderrun) {
+    openStream(Direction::Output);
+    std::vector<float> buffer(kFramesPerBurst * kChannelCount);
+    ASSERT_EQ(2 * kFramesPerBurst, mStream->write(mBurst.data(), 2 * kFramesPerBurst, 0).value());
+    mStream->fireCallback(buffer.data(), kFramesPerBurst);
+    mStream->fireCallback(buffer.data(), kFramesPerBurst);
+    mStream->fireCallback(buffer.data(), kFramesPerBurst); // underrun
+
+    StreamTelemetry::Snapshot snapshot;
+    mStream->getTelemetry().getSnapshot(&snapshot);
+    EXPECT_EQ(3, snapshot.fillLevelCount);
+    EXPECT_EQ(1, snapshot.fillLevelHistogram[StreamTelemetry::kNumFillLevelBins - 1]); // full
+    EXPECT_EQ(1, snapshot.fillLevelHistogram[0]); // empty
+    EXPECT_EQ(-kFramesPerBurst, snapshot.minHeadroomFrames);
+    EXPECT_EQ(kFramesPerBurst, snapshot.maxHeadroomFrames);
+    EXPECT_EQ(1, snapshot.underrunCount);
+    EXPECT_EQ(kFramesPerBurst, snapshot.framesUnderrun);
+    ASSERT_EQ(1, snapshot.numEvents);
+    EXPECT_EQ(2 * kFramesPerBurst, snapshot.events[0].framePosition);
+}
+
+// Fill the buffer with frames that contain their position plus one, so that silence is zero.
+static void fillRamp(float *buffer, int32_t numFrames, int32_t *nextFrame) {
+    for (int32_t i = 0; i < numFrames; i++) {
+        const float value = static_cast<float>(++(*nextFrame));
+        for (int32_t channel = 0; channel < kChannelCount; channel++) {
+            *buffer++ = value;
+        }
+    }
+}
+
+// @return number of frames that do not continue the ramp, skipping silence
+static int32_t countRampErrors(const float *buffer, int32_t numFrames, int32_t *nextFrame) {
+    int32_t numErrors = 0;
+    for (int32_t i = 0; i < numFrames; i++) {
+        const float value = buffer[i * kChannelCount];
+        if (value != 0.0f) {
+            if (value != static_cast<float>(*nextFrame + 1)) numErrors++;
+            *nextFrame = static_cast<int32_t>(value);
+        }
+    }
+    return numErrors;
+}
+
+TEST_F(TestAudioStreamBuffered, GrowingFifoKeepsUnreadData) {
+    openStream(Direction::Output);
+    // The FIFO starts smaller than the capacity.
+    const int32_t capacity = mStream->getBufferCapacityInFrames();
+    ASSERT_GE(capacity, 32 * kFramesPerBurst);
+    const int32_t initialSize = 16 * kFramesPerBurst; // default for AudioStreamBuffered
+    ASSERT_EQ(initialSize, mStream->setBufferSizeInFrames(initialSize).value());
+
+    std::vector<float> data(capacity * kChannelCount);
+    int32_t framesWritten = 0;
+    fillRamp(data.data(), initialSize, &framesWritten);
+    ASSERT_EQ(initialSize, mStream->write(data.data(), initialSize, 0).value());
+
+    // The larger FIFO is not used until the next callback.
+    const int32_t largerSize = 24 * kFramesPerBurst;
+    ASSERT_EQ(largerSize, mStream->setBufferSizeInFrames(largerSize).value());
+    EXPECT_EQ(largerSize, mStream->getBufferSizeInFrames());
+    EXPECT_EQ(0, mStream->write(data.data(), kFramesPerBurst, 0).value());
+
+    std::vector<float> buffer(kFramesPerBurst * kChannelCount);
+    int32_t framesPlayed = 0;
+    mStream->fireCallback(buffer.data(), kFramesPerBurst);
+    EXPECT_EQ(0, countRampErrors(buffer.data(), kFramesPerBurst, &framesPlayed));
+
+    // Now the rest of the larger buffer can be filled.
+    const int32_t framesToWrite = largerSize - initialSize + kFramesPerBurst;
+    fillRamp(data.data(), framesToWrite, &framesWritten);
+    ASSERT_EQ(framesToWrite, mStream->write(data.data(), framesToWrite, 0).value());
+    EXPECT_EQ(0, mStream->write(data.data(), kFramesPerBurst, 0).value());
+
+    for (int i = 0; i < largerSize / kFramesPerBurst; i++) {
+        mStream->fireCallback(buffer.data(), kFramesPerBurst);
+        EXPECT_EQ(0, countRampErrors(buffer.data(), kFramesPerBurst, &framesPlayed));
+    }
+    EXPECT_EQ(framesWritten, framesPlayed);
+    EXPECT_EQ(0, mStream->getXRunCount().value());
+    EXPECT_EQ(framesWritten, mStream->getFramesRead());
+}
+
+TEST_F(TestAudioStreamBuffered, GrowingFifoWhileCallbackRuns) {
+    openStream(Direction::Output);
+    std::atomic<int32_t> numErrors{0};
+    std::thread callbackThread([this, &numErrors]() {
+        std::vector<float> buffer(kFramesPerBurst * kChannelCount);
+        int32_t framesPlayed = 0;
+        int64_t nextCallbackNanos = AudioClock::getNanoseconds();
+        for (int i = 0; i < kNumBursts && !mStopTimer.load(); i++) {
+            nextCallbackNanos += kFramesPerBurst * kNanosPerSecond / kSampleRate;
+            AudioClock::sleepUntilNanoTime(nextCallbackNanos);
+            mStream->fireCallback(buffer.data(), kFramesPerBurst);
+            numErrors += countRampErrors(buffer.data(), kFramesPerBurst, &framesPlayed);
+        }
+    });
+
+    // Raise the buffer size while writing, as the LatencyTuner would.
+    int32_t framesWritten = 0;
+    for (int i = 0; i < kNumBursts / 2; i++) {
+        if (i % 4 == 0) {
+            mStream->setBufferSizeInFrames(mStream->getBufferSizeInFrames() + kFramesPerBurst);
+        }
+        fillRamp(mBurst.data(), kFramesPerBurst, &framesWritten);
+        int32_t result = mStream->write(mBurst.data(), kFramesPerBurst, kTimeoutNanos).value();
+        // Do not return while the callback thread is still running.
+        EXPECT_EQ(kFramesPerBurst, result);
+        if (result != kFramesPerBurst) break;
+    }
+    mStopTimer.store(true);
+    callbackThread.join();
+    EXPECT_EQ(0, numErrors.load());
+    EXPECT_GT(mStream->getBufferSizeInFrames(), 16 * kFramesPerBurst);
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the AudioWorkerPool that splits the jobs of one callback across threads.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "oboe/AudioWorkerPool.h"
+
+using namespace oboe;
+
+constexpr int32_t kNumJobs = 37; // not a multiple of the number of threads
+constexpr int32_t kNumRounds = 2000;
+
+// Check that every job of every round runs exactly once.
+static void runRounds(AudioWorkerPool &pool) {
+    std::vector<int32_t> counts(kNumJobs, 0);
+    for (int32_t round = 0; round < kNumRounds; round++) {
+        pool.run(kNumJobs, [&](int32_t jobIndex) {
+            counts[jobIndex]++; // each job writes only its own element
+        });
+        // run() has joined so the results can be read without a lock.
+        for (int32_t i = 0; i < kNumJobs; i++) {
+            ASSERT_EQ(round + 1, counts[i]) << "job " << i;
+        }
+    }
+    EXPECT_EQ(static_cast<int64_t>(kNumRounds) * kNumJobs, pool.getJobCount());
+}
+
+TEST(test_audio_worker_pool, runs_every_job_once) {
+    AudioWorkerPool pool(3);
+    ASSERT_EQ(Result::OK, pool.start());
+    EXPECT_EQ(3, pool.getNumWorkers());
+    runRounds(pool);
+}
+
+TEST(test_audio_worker_pool, runs_on_caller_without_workers) {
+    AudioWorkerPool notStarted(2);
+    runRounds(notStarted);
+    EXPECT_EQ(0, notStarted.getWorkerJobCount());
+
+    AudioWorkerPool noWorkers(0);
+    ASSERT_EQ(Result::OK, noWorkers.start());
+    runRounds(noWorkers);
+    EXPECT_EQ(0, noWorkers.getWorkerJobCount());
+}
+
+TEST(test_audio_worker_pool, workers_sleep_between_rounds) {
+    AudioWorkerPool pool(2);
+    pool.setSpinNanos(0); // so every round has to wake the workers from the futex
+    ASSERT_EQ(Result::OK, pool.start());
+    runRounds(pool);
+}
+
+// The workers take jobs while the caller is busy with one.
+TEST(test_audio_worker_pool, workers_share_the_jobs) {
+    AudioWorkerPool pool(2);
+    ASSERT_EQ(Result::OK, pool.start());
+    std::atomic<int32_t> numJobsRun{0};
+    pool.run(kNumJobs, [&](int32_t jobIndex) {
+        if (jobIndex == 0) {
+            // Keep this job running until the others have all been taken.
+            while (numJobsRun.load() < kNumJobs - 1) {
+                std::this_thread::yield();
+            }
+        } else {
+            numJobsRun++;
+        }
+    });
+    EXPECT_EQ(kNumJobs - 1, numJobsRun.load());
+    EXPECT_GT(pool.getWorkerJobCount(), 0);
+}
+
+TEST(test_audio_worker_pool, restarts) {
+    AudioWorkerPool pool(2);
+    ASSERT_EQ(Result::OK, pool.start());
+    EXPECT_EQ(Result::ErrorInvalidState, pool.start());
+    pool.stop();
+    ASSERT_EQ(Result::OK, pool.start());
+    runRounds(pool);
+    pool.stop();
+    pool.stop(); // harmless
+}
+
+TEST(test_audio_worker_pool, pins_workers_to_cpu) {
+    AudioWorkerPool pool(2);
+    pool.setCpuIds({0}); // every machine has CPU 0
+    ASSERT_EQ(Result::OK, pool.start());
+    runRounds(pool);
+}
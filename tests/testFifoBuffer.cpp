@@ -0,0 +1,260 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the FifoBuffer in each of its modes.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "fifo/SequencedRing.h"
+#include "oboe/FifoBuffer.h"
+
+using namespace oboe;
+
+static const FifoBuffer::Mode kModes[] = {
+    FifoBuffer::Mode::Default,
+    FifoBuffer::Mode::SingleProducerSingleConsumer,
+};
+
+// Use a power of two capacity and one that is not.
+static const uint32_t kCapacities[] = {64, 100};
+
+static void checkReadWriteWraps(FifoBuffer::Mode mode, uint32_t capacity) {
+    FifoBuffer fifo(sizeof(int32_t), capacity, mode);
+    std::vector<int32_t> data(capacity);
+    int32_t nextWrite = 0;
+    int32_t nextRead = 0;
+    // Odd sizes so that the reads and writes wrap at different places.
+    for (int32_t i = 0; i < 200; i++) {
+        int32_t framesToWrite = (i * 7) % 23 + 1;
+        for (int32_t frame = 0; frame < framesToWrite; frame++) {
+            data[frame] = nextWrite + frame;
+        }
+        int32_t framesWritten = fifo.write(data.data(), framesToWrite);
+        int32_t expected = std::min(framesToWrite,
+                static_cast<int32_t>(capacity) - (nextWrite - nextRead));
+        ASSERT_EQ(expected, framesWritten);
+        nextWrite += framesWritten;
+        ASSERT_EQ(static_cast<uint32_t>(nextWrite - nextRead), fifo.getFullFramesAvailable());
+
+        int32_t framesToRead = (i * 5) % 19 + 1;
+        int32_t framesRead = fifo.read(data.data(), framesToRead);
+        ASSERT_EQ(std::min(framesToRead, nextWrite - nextRead), framesRead);
+        for (int32_t frame = 0; frame < framesRead; frame++) {
+            ASSERT_EQ(nextRead + frame, data[frame]);
+        }
+        nextRead += framesRead;
+    }
+    EXPECT_EQ(static_cast<uint64_t>(nextWrite), fifo.getWriteCounter());
+    EXPECT_EQ(static_cast<uint64_t>(nextRead), fifo.getReadCounter());
+}
+
+TEST(test_fifo_buffer, read_write_wraps) {
+    for (FifoBuffer::Mode mode : kModes) {
+        for (uint32_t capacity : kCapacities) {
+            SCOPED_TRACE(testing::Message() << "mode = " << static_cast<int>(mode)
+                    << ", capacity = " << capacity);
+            checkReadWriteWraps(mode, capacity);
+        }
+    }
+}
+
+TEST(test_fifo_buffer, read_now_and_flush) {
+    for (FifoBuffer::Mode mode : kModes) {
+        SCOPED_TRACE(testing::Message() << "mode = " << static_cast<int>(mode));
+        FifoBuffer fifo(sizeof(int32_t), 64, mode);
+        int32_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+        ASSERT_EQ(4, fifo.write(data, 4));
+        int32_t result[8];
+        ASSERT_EQ(4, fifo.readNow(result, 8));
+        EXPECT_EQ(4, result[3]);
+        EXPECT_EQ(0, result[4]); // zero filled
+        EXPECT_EQ(0, result[7]);
+
+        // The reader discards everything that has been written.
+        ASSERT_EQ(8, fifo.write(data, 8));
+        fifo.setReadCounter(fifo.getWriteCounter());
+        EXPECT_EQ(0u, fifo.getFullFramesAvailable());
+        EXPECT_EQ(0, fifo.read(result, 8));
+        ASSERT_EQ(8, fifo.write(data, 8));
+        ASSERT_EQ(8, fifo.read(result, 8));
+        EXPECT_EQ(8, result[7]);
+    }
+}
+
+TEST(test_fifo_buffer, timestamps_follow_counter) {
+    constexpr int32_t kSampleRate = 40000; // so that a frame is a whole number of nanoseconds
+    constexpr int64_t kNanosPerFrame = kNanosPerSecond / kSampleRate;
+    FifoBuffer fifo(sizeof(int32_t), 64);
+    int64_t timeNanos = 0;
+    EXPECT_EQ(Result::ErrorUnavailable, fifo.getTimestamp(0, kSampleRate, &timeNanos));
+    fifo.enableTimestamps(8);
+    EXPECT_EQ(Result::ErrorUnavailable, fifo.getTimestamp(0, kSampleRate, &timeNanos));
+
+    // The reader takes 16 frames from a burst of 32, then underruns for the rest.
+    int32_t data[32] = {};
+    ASSERT_EQ(16, fifo.write(data, 16));
+    fifo.writeTimestamp(fifo.getReadCounter(), 1000000);
+    ASSERT_EQ(16, fifo.readNow(data, 32));
+    ASSERT_EQ(32, fifo.write(data, 32));
+    // The next burst started 32 frames later, so frame 16 was late by 16 frames.
+    int64_t nextBurstNanos = 1000000 + 32 * kNanosPerFrame;
+    fifo.writeTimestamp(fifo.getReadCounter(), nextBurstNanos);
+    ASSERT_EQ(32, fifo.readNow(data, 32));
+
+    ASSERT_EQ(Result::OK, fifo.getTimestamp(10, kSampleRate, &timeNanos));
+    EXPECT_EQ(1000000 + 10 * kNanosPerFrame, timeNanos);
+    ASSERT_EQ(Result::OK, fifo.getTimestamp(16, kSampleRate, &timeNanos));
+    EXPECT_EQ(nextBurstNanos, timeNanos);
+    ASSERT_EQ(Result::OK, fifo.getTimestamp(40, kSampleRate, &timeNanos));
+    EXPECT_EQ(nextBurstNanos + 24 * kNanosPerFrame, timeNanos);
+
+    FrameTimestamp latest;
+    ASSERT_EQ(Result::OK, fifo.getLatestTimestamp(&latest));
+    EXPECT_EQ(16, latest.position);
+    EXPECT_EQ(nextBurstNanos, latest.timestamp);
+}
+
+TEST(test_fifo_buffer, timestamps_overwrite_oldest) {
+    FifoBuffer fifo(sizeof(int32_t), 64);
+    fifo.enableTimestamps(4);
+    for (int i = 0; i < 10; i++) {
+        fifo.writeTimestamp(i * 100, i * 1000);
+    }
+    // Only the last four are kept, so older positions are calculated from the oldest one.
+    int64_t timeNanos = 0;
+    ASSERT_EQ(Result::OK, fifo.getTimestamp(650, 100, &timeNanos));
+    EXPECT_EQ(6000 + 50 * (kNanosPerSecond / 100), timeNanos);
+    ASSERT_EQ(Result::OK, fifo.getTimestamp(0, 100, &timeNanos));
+    EXPECT_EQ(6000 - 600 * (kNanosPerSecond / 100), timeNanos);
+}
+
+// A record that has been overwritten is not returned in place of the one asked for.
+TEST(test_fifo_buffer, sequenced_ring_rejects_overwritten_records) {
+    SequencedRing<int64_t> ring(3); // rounded up to 4
+    ASSERT_EQ(4, ring.getCapacity());
+    for (int64_t i = 0; i < 6; i++) {
+        ring.write(i * 10);
+    }
+    int64_t record = -1;
+    EXPECT_FALSE(ring.read(1, &record)); // the slot now holds record 5
+    EXPECT_EQ(-1, record);
+    for (uint64_t index = 2; index < 6; index++) {
+        ASSERT_TRUE(ring.read(index, &record));
+        EXPECT_EQ(static_cast<int64_t>(index * 10), record);
+    }
+    int64_t latest[8] = {};
+    ASSERT_EQ(4, ring.readLatest(latest, 8));
+    EXPECT_EQ(20, latest[0]);
+    EXPECT_EQ(50, latest[3]);
+}
+
+TEST(test_fifo_buffer, regions_wrap) {
+    for (FifoBuffer::Mode mode : kModes) {
+        SCOPED_TRACE(testing::Message() << "mode = " << static_cast<int>(mode));
+        FifoBuffer fifo(sizeof(int32_t), 64, mode);
+        std::vector<int32_t> data(50);
+        ASSERT_EQ(50, fifo.write(data.data(), 50));
+        ASSERT_EQ(50, fifo.read(data.data(), 50));
+
+        // 14 frames fit before the end of the storage.
+        FifoBuffer::Region region = fifo.acquireWriteRegion(40);
+        ASSERT_EQ(14, region.numFrames[0]);
+        ASSERT_EQ(26, region.numFrames[1]);
+        int32_t value = 0;
+        for (int part = 0; part < 2; part++) {
+            int32_t *frames = reinterpret_cast<int32_t *>(region.data[part]);
+            for (int32_t i = 0; i < region.numFrames[part]; i++) {
+                frames[i] = value++;
+            }
+        }
+        EXPECT_EQ(0u, fifo.getFullFramesAvailable()); // nothing visible until committed
+        fifo.commitWrite(region.getTotalFrames());
+
+        // Read some in place then the rest with read().
+        region = fifo.acquireReadRegion(100);
+        ASSERT_EQ(14, region.numFrames[0]);
+        ASSERT_EQ(26, region.numFrames[1]);
+        const int32_t *frames = reinterpret_cast<const int32_t *>(region.data[0]);
+        EXPECT_EQ(0, frames[0]);
+        EXPECT_EQ(9, frames[9]);
+        fifo.commitRead(10);
+        ASSERT_EQ(30, fifo.read(data.data(), 50));
+        for (int32_t i = 0; i < 30; i++) {
+            ASSERT_EQ(10 + i, data[i]);
+        }
+
+        // Empty regions.
+        EXPECT_EQ(0, fifo.acquireReadRegion(10).getTotalFrames());
+        EXPECT_EQ(0, fifo.acquireWriteRegion(0).getTotalFrames());
+        EXPECT_EQ(64, fifo.acquireWriteRegion(100).getTotalFrames());
+    }
+}
+
+// Move a counting sequence between two threads and check that nothing is lost or reordered.
+static void checkThreadsTransferInOrder(FifoBuffer::Mode mode, uint32_t capacity) {
+    constexpr int32_t kNumFrames = 200000;
+    FifoBuffer fifo(sizeof(int32_t), capacity, mode);
+    std::thread writer([&fifo]() {
+        int32_t block[32];
+        int32_t next = 0;
+        int32_t blockSize = 1;
+        while (next < kNumFrames) {
+            blockSize = (blockSize % 31) + 1;
+            int32_t framesToWrite = std::min(blockSize, kNumFrames - next);
+            for (int32_t i = 0; i < framesToWrite; i++) {
+                block[i] = next + i;
+            }
+            int32_t framesWritten = fifo.write(block, framesToWrite);
+            if (framesWritten > 0) {
+                next += framesWritten;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    int32_t block[32];
+    int32_t expected = 0;
+    int32_t errors = 0;
+    int32_t blockSize = 1;
+    while (expected < kNumFrames) {
+        blockSize = (blockSize % 29) + 1;
+        int32_t framesRead = fifo.read(block, blockSize);
+        if (framesRead == 0) {
+            std::this_thread::yield();
+        }
+        for (int32_t i = 0; i < framesRead; i++) {
+            if (block[i] != expected++) errors++;
+        }
+    }
+    writer.join();
+    EXPECT_EQ(0, errors);
+    EXPECT_EQ(static_cast<uint64_t>(kNumFrames), fifo.getReadCounter());
+}
+
+TEST(test_fifo_buffer, threads_transfer_in_order) {
+    for (FifoBuffer::Mode mode : kModes) {
+        for (uint32_t capacity : kCapacities) {
+            SCOPED_TRACE(testing::Message() << "mode = " << static_cast<int>(mode)
+                    << ", capacity = " << capacity);
+            checkThreadsTransferInOrder(mode, capacity);
+        }
+    }
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test FilterAudioStream and its DataConversionFlowGraph using a child stream
+ * that is not connected to any audio device. The test calls the callback of
+ * the FilterAudioStream in place of the child stream.
+ */
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/DataConversionFlowGraph.h"
+#include "common/FilterAudioStream.h"
+
+using namespace oboe;
+
+constexpr int32_t kChannelCount = 2;
+constexpr int32_t kFramesPerBurst = 96;
+
+class FakeChildStream : public AudioStream {
+public:
+    explicit FakeChildStream(const AudioStreamBuilder &builder)
+            : AudioStream(builder) {
+        mFramesPerBurst = kFramesPerBurst;
+    }
+
+    Result requestStart() override { return Result::OK; }
+    Result requestPause() override { return Result::OK; }
+    Result requestFlush() override { return Result::OK; }
+    Result requestStop() override { return Result::OK; }
+    StreamState getState() override { return StreamState::Started; }
+    Result waitForStateChange(StreamState /* inputState */,
+                              StreamState *nextState,
+                              int64_t /* timeoutNanoseconds */) override {
+        if (nextState != nullptr) *nextState = StreamState::Started;
+        return Result::OK;
+    }
+    bool isXRunCountSupported() const override { return false; }
+    AudioApi getAudioApi() const override { return AudioApi::AAudio; }
+    void updateFramesWritten() override {}
+    void updateFramesRead() override {}
+};
+
+// Renders a ramp in blocks, and returns Stop after a number of blocks.
+class RampCallback : public AudioStreamDataCallback {
+public:
+    DataCallbackResult onAudioReady(AudioStream * /* audioStream */,
+                                    void *audioData,
+                                    int32_t numFrames) override {
+        int16_t *shorts = static_cast<int16_t *>(audioData);
+        for (int32_t i = 0; i < numFrames * kChannelCount; i++) {
+            shorts[i] = static_cast<int16_t>(++sampleCount);
+        }
+        callCount++;
+        return (callCount < stopAfter) ? DataCallbackResult::Continue : DataCallbackResult::Stop;
+    }
+
+    int32_t callCount = 0;
+    int32_t stopAfter = 0;
+    int32_t sampleCount = 0;
+};
+
+// The app returns Stop in the middle of a child burst, and then returns Continue if it is
+// called again. Every frame it rendered should reach the child, followed by silence.
+TEST(test_filter_audio_stream, output_plays_data_rendered_before_stop) {
+    constexpr int32_t kAppFramesPerCallback = 160; // does not divide into the bursts
+    RampCallback callback;
+    callback.stopAfter = 3;
+    AudioStreamBuilder builder;
+    builder.setDirection(Direction::Output)
+            ->setChannelCount(kChannelCount)
+            ->setFormat(AudioFormat::I16)
+            ->setSampleRate(48000)
+            ->setFramesPerDataCallback(kAppFramesPerCallback)
+            ->setDataCallback(&callback);
+    AudioStreamBuilder childBuilder = builder;
+    childBuilder.setFormat(AudioFormat::I16)->setFramesPerDataCallback(kUnspecified);
+    FakeChildStream *child = new FakeChildStream(childBuilder);
+    FilterAudioStream stream(builder, child);
+    ASSERT_EQ(Result::OK, stream.configureFlowGraph());
+
+    std::vector<int16_t> burst(kFramesPerBurst * kChannelCount);
+    std::vector<int16_t> played;
+    DataCallbackResult result = DataCallbackResult::Continue;
+    for (int i = 0; i < 20 && result == DataCallbackResult::Continue; i++) {
+        result = stream.onAudioReady(child, burst.data(), kFramesPerBurst);
+        if (result == DataCallbackResult::Continue) {
+            played.insert(played.end(), burst.begin(), burst.end());
+        }
+    }
+    EXPECT_EQ(DataCallbackResult::Stop, result);
+    EXPECT_EQ(3, callback.callCount);
+    const int32_t numRendered = 3 * kAppFramesPerCallback * kChannelCount;
+    ASSERT_GE(static_cast<int32_t>(played.size()), numRendered);
+    for (int32_t i = 0; i < numRendered; i++) {
+        ASSERT_EQ(static_cast<int16_t>(i + 1), played[i]);
+    }
+    for (size_t i = numRendered; i < played.size(); i++) {
+        ASSERT_EQ(0, played[i]);
+    }
+}
+
+// Stop from the app ends the input callbacks without calling the app again.
+TEST(test_filter_audio_stream, input_stops_calling_app) {
+    constexpr int32_t kAppFramesPerCallback = 64;
+    RampCallback callback; // only counts the calls
+    callback.stopAfter = 2;
+    AudioStreamBuilder builder;
+    builder.setDirection(Direction::Input)
+            ->setChannelCount(kChannelCount)
+            ->setFormat(AudioFormat::I16)
+            ->setSampleRate(48000)
+            ->setFramesPerDataCallback(kAppFramesPerCallback)
+            ->setDataCallback(&callback);
+    AudioStreamBuilder childBuilder = builder;
+    childBuilder.setFramesPerDataCallback(kUnspecified);
+    FakeChildStream *child = new FakeChildStream(childBuilder);
+    FilterAudioStream stream(builder, child);
+    ASSERT_EQ(Result::OK, stream.configureFlowGraph());
+
+    // One burst holds one and a half app blocks.
+    std::vector<int16_t> burst(kFramesPerBurst * kChannelCount);
+    EXPECT_EQ(DataCallbackResult::Continue,
+              stream.onAudioReady(child, burst.data(), kFramesPerBurst));
+    EXPECT_EQ(1, callback.callCount);
+    EXPECT_EQ(DataCallbackResult::Stop,
+              stream.onAudioReady(child, burst.data(), kFramesPerBurst));
+    EXPECT_EQ(2, callback.callCount); // not called for the third block in the burst
+}
+
+// Downmixing to a mono child converts in the buffer of the source node.
+TEST(test_filter_audio_stream, downmix_processes_in_place) {
+    RampCallback callback;
+    callback.stopAfter = 100;
+    AudioStreamBuilder builder;
+    builder.setDirection(Direction::Output)
+            ->setChannelCount(kChannelCount)
+            ->setFormat(AudioFormat::I16)
+            ->setSampleRate(48000)
+            ->setDataCallback(&callback);
+    AudioStreamBuilder childBuilder = builder;
+    childBuilder.setChannelCount(1);
+    FakeChildStream appStream(builder);
+    FakeChildStream child(childBuilder);
+    DataConversionFlowGraph flowGraph;
+    ASSERT_EQ(Result::OK, flowGraph.configure(&appStream, &child));
+    EXPECT_EQ(1, flowGraph.getSharedBufferCount());
+
+    // The child gets the first channel of each frame.
+    std::vector<int16_t> burst(kFramesPerBurst);
+    for (int i = 0; i < 3; i++) {
+        ASSERT_EQ(kFramesPerBurst, flowGraph.read(burst.data(), kFramesPerBurst, 0));
+        for (int32_t frame = 0; frame < kFramesPerBurst; frame++) {
+            int32_t sampleIndex = ((i * kFramesPerBurst) + frame) * kChannelCount;
+            ASSERT_EQ(static_cast<int16_t>(sampleIndex + 1), burst[frame]);
+        }
+    }
+}
+
+// Renders silence slowly enough to overload a callback of kFramesPerBurst frames.
+class SlowCallback : public AudioStreamDataCallback {
+public:
+    DataCallbackResult onAudioReady(AudioStream * /* audioStream */,
+                                    void *audioData,
+                                    int32_t numFrames) override {
+        memset(audioData, 0, static_cast<size_t>(numFrames * kChannelCount * sizeof(int16_t)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(4)); // one burst is 2 msec
+        return DataCallbackResult::Continue;
+    }
+};
+
+// An overloaded callback lowers the resampler quality, one tier at a time.
+TEST(test_filter_audio_stream, adaptive_quality_lowers_when_overloaded) {
+    SlowCallback callback;
+    AudioStreamBuilder builder;
+    builder.setDirection(Direction::Output)
+            ->setChannelCount(kChannelCount)
+            ->setFormat(AudioFormat::I16)
+            ->setSampleRate(44100)
+            ->setSampleRateConversionQuality(SampleRateConversionQuality::Best)
+            ->setSampleRateConversionQualityAdaptive(true)
+            ->setDataCallback(&callback);
+    AudioStreamBuilder childBuilder = builder;
+    childBuilder.setSampleRate(48000);
+    FakeChildStream *child = new FakeChildStream(childBuilder);
+    FilterAudioStream stream(builder, child);
+    ASSERT_EQ(Result::OK, stream.configureFlowGraph());
+    EXPECT_EQ(SampleRateConversionQuality::Best, stream.getCurrentSampleRateConversionQuality());
+
+    std::vector<int16_t> burst(kFramesPerBurst * kChannelCount);
+    for (int i = 0; i < 200 && stream.getCurrentSampleRateConversionQuality()
+            != SampleRateConversionQuality::Medium; i++) {
+        ASSERT_EQ(DataCallbackResult::Continue,
+                  stream.onAudioReady(child, burst.data(), kFramesPerBurst));
+    }
+    ASSERT_EQ(SampleRateConversionQuality::Medium, stream.getCurrentSampleRateConversionQuality());
+    // Never lowered by more than two tiers.
+    for (int i = 0; i < 60; i++) {
+        stream.onAudioReady(child, burst.data(), kFramesPerBurst);
+    }
+    EXPECT_EQ(SampleRateConversionQuality::Medium, stream.getCurrentSampleRateConversionQuality());
+    int64_t numLowered = 0;
+    int64_t numRaised = 0;
+    stream.getSampleRateConversionQualityChanges(&numLowered, &numRaised);
+    EXPECT_EQ(2, numLowered);
+    EXPECT_EQ(0, numRaised);
+}
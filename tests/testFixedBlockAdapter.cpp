@@ -0,0 +1,107 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the FixedBlockReader and FixedBlockWriter, including their zero copy methods.
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "common/FixedBlockReader.h"
+#include "common/FixedBlockWriter.h"
+
+constexpr int32_t kBlockSize = 12;
+
+// Fills each block with a counting pattern, or checks that each block continues it.
+class CountingProcessor : public FixedBlockProcessor {
+public:
+    int32_t onProcessFixedBlock(uint8_t *buffer, int32_t numBytes) override {
+        EXPECT_EQ(kBlockSize, numBytes);
+        for (int32_t i = 0; i < numBytes; i++) {
+            if (checkData) {
+                EXPECT_EQ(static_cast<uint8_t>(counter), buffer[i]);
+            } else {
+                buffer[i] = static_cast<uint8_t>(counter);
+            }
+            counter++;
+        }
+        blockCount++;
+        return numBytes;
+    }
+
+    bool checkData = false;
+    int32_t counter = 0;
+    int32_t blockCount = 0;
+};
+
+TEST(test_fixed_block_adapter, reader_acquire_read) {
+    CountingProcessor processor;
+    FixedBlockReader reader(processor);
+    reader.open(kBlockSize);
+    int32_t expected = 0;
+    // Odd sizes so that the reads cross the block boundaries at different places.
+    for (int i = 0; i < 50; i++) {
+        int32_t maxBytes = (i % 7) + 1;
+        int32_t numBytes = 0;
+        const uint8_t *data = reader.acquireRead(maxBytes, &numBytes);
+        ASSERT_GT(numBytes, 0);
+        ASSERT_LE(numBytes, maxBytes);
+        for (int32_t j = 0; j < numBytes; j++) {
+            ASSERT_EQ(static_cast<uint8_t>(expected + j), data[j]);
+        }
+        reader.commitRead(numBytes);
+        expected += numBytes;
+    }
+    // The processor was only called when a block had been used up.
+    EXPECT_EQ((expected + kBlockSize - 1) / kBlockSize, processor.blockCount);
+
+    // read() continues from the same position.
+    uint8_t buffer[kBlockSize * 2];
+    ASSERT_EQ(kBlockSize * 2, reader.read(buffer, kBlockSize * 2));
+    EXPECT_EQ(static_cast<uint8_t>(expected), buffer[0]);
+}
+
+TEST(test_fixed_block_adapter, writer_acquire_write) {
+    CountingProcessor processor;
+    processor.checkData = true;
+    FixedBlockWriter writer(processor);
+    writer.open(kBlockSize);
+    int32_t counter = 0;
+    for (int i = 0; i < 50; i++) {
+        int32_t numBytes = 0;
+        uint8_t *data = writer.acquireWrite(&numBytes);
+        ASSERT_GT(numBytes, 0);
+        ASSERT_LE(numBytes, kBlockSize);
+        int32_t bytesToWrite = std::min(numBytes, (i % 5) + 1);
+        for (int32_t j = 0; j < bytesToWrite; j++) {
+            data[j] = static_cast<uint8_t>(counter++);
+        }
+        ASSERT_EQ(bytesToWrite, writer.commitWrite(bytesToWrite));
+        // Each block is passed on as soon as it is full.
+        ASSERT_EQ(counter / kBlockSize, processor.blockCount);
+    }
+}
+
+TEST(test_fixed_block_adapter, writer_passes_whole_block_immediately) {
+    CountingProcessor processor;
+    FixedBlockWriter writer(processor);
+    writer.open(kBlockSize);
+    std::vector<uint8_t> data(kBlockSize);
+    ASSERT_EQ(kBlockSize, writer.write(data.data(), kBlockSize));
+    EXPECT_EQ(1, processor.blockCount);
+}
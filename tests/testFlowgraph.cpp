@@ -21,14 +21,20 @@
 #include "stdio.h"
 
 #include <iostream>
+#include <vector>
 
 #include <gtest/gtest.h>
 #include <oboe/Oboe.h>
 
+#include "flowgraph/ChannelCountConverter.h"
 #include "flowgraph/ClipToRange.h"
+#include "flowgraph/FlowGraph.h"
+#include "flowgraph/ManyToMultiConverter.h"
 #include "flowgraph/MonoToMultiConverter.h"
+#include "flowgraph/MultiToMonoConverter.h"
 #include "flowgraph/SourceFloat.h"
 #include "flowgraph/RampLinear.h"
+#include "flowgraph/SampleConversion.h"
 #include "flowgraph/SampleRateConverter.h"
 #include "flowgraph/SinkFloat.h"
 #include "flowgraph/SinkI16.h"
@@ -37,6 +43,7 @@
 #include "flowgraph/SourceI24.h"
 
 using namespace oboe::flowgraph;
+using namespace resampler;
 
 constexpr int kBytesPerI24Packed = 3;
 
@@ -169,3 +176,300 @@ TEST(test_flowgraph, module_clip_to_range) {
     }
 }
 
+
+TEST(test_flowgraph, graph_compiled_matches_pull) {
+    constexpr int kNumInputFrames = 300;
+    constexpr int kNumOutputFrames = 200;
+    constexpr int kFramesPerRead = 7; // not a multiple of the block size
+    float input[kNumInputFrames];
+    for (int i = 0; i < kNumInputFrames; i++) {
+        input[i] = sinf(i * 0.1f) * 1.5f; // some of it will be clipped
+    }
+
+    // Build two identical graphs and only compile one of them.
+    float outputs[2][kNumOutputFrames] = {};
+    for (int graphIndex = 0; graphIndex < 2; graphIndex++) {
+        std::unique_ptr<MultiChannelResampler> resampler(MultiChannelResampler::make(
+                1, 44100, 48000, MultiChannelResampler::Quality::Medium));
+        SourceFloat sourceFloat{1};
+        ClipToRange clipper{1};
+        SampleRateConverter rateConverter{1, *resampler};
+        SinkFloat sinkFloat{1};
+        FlowGraph graph;
+
+        sourceFloat.setData(input, kNumInputFrames);
+        sourceFloat.output.connect(&clipper.input);
+        clipper.output.connect(&rateConverter.input);
+        rateConverter.output.connect(&sinkFloat.input);
+        if (graphIndex == 1) {
+            graph.compile(sinkFloat);
+            // The source and clipper are in the plan that feeds the rate converter.
+            ASSERT_EQ(3, graph.getNodeCount());
+        }
+
+        for (int i = 0; i < kNumOutputFrames; i += kFramesPerRead) {
+            int32_t numFrames = std::min(kFramesPerRead, kNumOutputFrames - i);
+            ASSERT_EQ(numFrames, sinkFloat.read(&outputs[graphIndex][i], numFrames));
+        }
+    }
+    for (int i = 0; i < kNumOutputFrames; i++) {
+        EXPECT_EQ(outputs[0][i], outputs[1][i]);
+    }
+}
+
+TEST(test_flowgraph, sample_rate_converter_counts_frames) {
+    constexpr int kNumInputFrames = 4000;
+    constexpr int kNumOutputFrames = 3000;
+    constexpr int kFramesPerRead = 37; // arbitrary
+    std::vector<float> input(kNumInputFrames);
+    std::vector<float> output(kFramesPerRead);
+    std::unique_ptr<MultiChannelResampler> resampler(MultiChannelResampler::make(
+            1, 48000, 44100, MultiChannelResampler::Quality::Medium));
+    SourceFloat sourceFloat{1};
+    SampleRateConverter rateConverter{1, *resampler};
+    SinkFloat sinkFloat{1};
+    sourceFloat.setData(input.data(), kNumInputFrames);
+    sourceFloat.output.connect(&rateConverter.input);
+    rateConverter.output.connect(&sinkFloat.input);
+
+    int64_t framesRead = 0;
+    while (framesRead < kNumOutputFrames) {
+        framesRead += sinkFloat.read(output.data(), kFramesPerRead);
+        ASSERT_EQ(framesRead, rateConverter.getOutputFramesProduced());
+        // The input used follows the rate closely, even though more has been pulled.
+        // The resampler may be one frame ahead or behind, depending on its phase.
+        double expected = framesRead * 48000.0 / 44100.0;
+        EXPECT_NEAR(expected, rateConverter.getInputFramesConsumed(), 2.0);
+    }
+}
+
+TEST(test_flowgraph, graph_compiled_fan_in) {
+    static const float left[] = {1.0f, 2.0f, 3.0f};
+    static const float right[] = {-1.0f, -2.0f, -3.0f, -4.0f};
+    float output[20] = {};
+    SourceFloat leftSource{1};
+    SourceFloat rightSource{1};
+    ManyToMultiConverter combiner{2};
+    SinkFloat sinkFloat{2};
+    FlowGraph graph;
+
+    leftSource.setData(left, 3);
+    rightSource.setData(right, 4);
+    leftSource.output.connect(combiner.inputs[0].get());
+    rightSource.output.connect(combiner.inputs[1].get());
+    combiner.output.connect(&sinkFloat.input);
+    graph.compile(sinkFloat);
+    ASSERT_EQ(3, graph.getNodeCount());
+
+    // Limited by the shortest input.
+    int32_t numRead = sinkFloat.read(output, 10);
+    ASSERT_EQ(3, numRead);
+    for (int i = 0; i < numRead; i++) {
+        EXPECT_EQ(left[i], output[i * 2]);
+        EXPECT_EQ(right[i], output[i * 2 + 1]);
+    }
+
+    // Clearing the graph goes back to pulling recursively.
+    graph.clear();
+    ASSERT_EQ(0, graph.getNodeCount());
+    leftSource.setData(left, 3);
+    rightSource.setData(right, 4);
+    EXPECT_EQ(3, sinkFloat.read(output, 10));
+}
+
+TEST(test_flowgraph, graph_compiled_ramp_linear) {
+    constexpr float value = 0.5f;
+    constexpr float target = 4.0f;
+    float output[16] = {};
+    RampLinear rampLinear{1};
+    SinkFloat sinkFloat{1};
+    FlowGraph graph;
+
+    rampLinear.input.setValue(value);
+    rampLinear.output.connect(&sinkFloat.input);
+    graph.compile(sinkFloat);
+
+    // The ramp must still see that it has not been run yet.
+    rampLinear.setTarget(target);
+    int32_t numRead = sinkFloat.read(output, 16);
+    ASSERT_EQ(16, numRead);
+    for (int i = 0; i < numRead; i++) {
+        EXPECT_EQ(value * target, output[i]);
+    }
+}
+
+TEST(test_flowgraph, graph_process_in_place) {
+    static const float input[] = {-3.0f, -0.5f, 0.25f, 1.0f, 2.5f};
+    static const float expected[] = {-2.0f, -1.0f, 0.5f, 2.0f, 2.0f};
+    float output[20] = {};
+    SourceFloat sourceFloat{1};
+    ClipToRange clipper{1};
+    RampLinear ramp{1};
+    SinkFloat sinkFloat{1};
+    FlowGraph graph;
+
+    int numInputFrames = sizeof(input) / sizeof(input[0]);
+    sourceFloat.setData(input, numInputFrames);
+    clipper.setMinimum(-1.0f);
+    clipper.setMaximum(1.0f);
+    ramp.setTarget(2.0f);
+    sourceFloat.output.connect(&clipper.input);
+    clipper.output.connect(&ramp.input);
+    ramp.output.connect(&sinkFloat.input);
+
+    graph.setProcessInPlaceEnabled(true);
+    graph.compile(sinkFloat);
+    ASSERT_EQ(2, graph.getSharedBufferCount());
+    EXPECT_EQ(sourceFloat.output.getBuffer(), clipper.output.getBuffer());
+    EXPECT_EQ(sourceFloat.output.getBuffer(), ramp.output.getBuffer());
+
+    int32_t numRead = sinkFloat.read(output, 20);
+    ASSERT_EQ(numInputFrames, numRead);
+    for (int i = 0; i < numRead; i++) {
+        EXPECT_EQ(expected[i], output[i]);
+    }
+
+    graph.clear();
+    EXPECT_NE(sourceFloat.output.getBuffer(), clipper.output.getBuffer());
+}
+
+TEST(test_flowgraph, graph_process_in_place_fan_out) {
+    static const float input[] = {-3.0f, 0.5f, 3.0f};
+    float output[20] = {};
+    SourceFloat sourceFloat{1};
+    ClipToRange clipper{1};
+    ManyToMultiConverter combiner{2};
+    SinkFloat sinkFloat{2};
+    FlowGraph graph;
+
+    sourceFloat.setData(input, 3);
+    clipper.setMinimum(-1.0f);
+    clipper.setMaximum(1.0f);
+    // The source feeds the clipper and the combiner so the clipper must not overwrite it.
+    sourceFloat.output.connect(&clipper.input);
+    clipper.output.connect(combiner.inputs[0].get());
+    sourceFloat.output.connect(combiner.inputs[1].get());
+    combiner.output.connect(&sinkFloat.input);
+
+    graph.setProcessInPlaceEnabled(true);
+    graph.compile(sinkFloat);
+    ASSERT_EQ(0, graph.getSharedBufferCount());
+
+    int32_t numRead = sinkFloat.read(output, 10);
+    ASSERT_EQ(3, numRead);
+    for (int i = 0; i < numRead; i++) {
+        EXPECT_EQ(std::min(1.0f, std::max(-1.0f, input[i])), output[i * 2]);
+        EXPECT_EQ(input[i], output[i * 2 + 1]);
+    }
+}
+
+TEST(test_flowgraph, graph_process_in_place_drops_channels) {
+    static const float input[] = {1.0f, 2.0f, 3.0f,
+                                  4.0f, 5.0f, 6.0f,
+                                  7.0f, 8.0f, 9.0f};
+    float output[20] = {};
+    float monoOutput[20] = {};
+    SourceFloat sourceFloat{3};
+    ChannelCountConverter converter{3, 2};
+    SinkFloat sinkFloat{2};
+    SourceFloat monoSource{3};
+    MultiToMonoConverter monoConverter{3};
+    SinkFloat monoSink{1};
+    FlowGraph graph;
+
+    sourceFloat.setData(input, 3);
+    sourceFloat.output.connect(&converter.input);
+    converter.output.connect(&sinkFloat.input);
+    graph.setProcessInPlaceEnabled(true);
+    graph.compile(sinkFloat);
+    ASSERT_EQ(1, graph.getSharedBufferCount());
+    EXPECT_EQ(sourceFloat.output.getBuffer(), converter.output.getBuffer());
+
+    int32_t numRead = sinkFloat.read(output, 10);
+    ASSERT_EQ(3, numRead);
+    for (int i = 0; i < numRead; i++) {
+        EXPECT_EQ(input[i * 3], output[i * 2]);
+        EXPECT_EQ(input[i * 3 + 1], output[i * 2 + 1]);
+    }
+
+    monoSource.setData(input, 3);
+    monoSource.output.connect(&monoConverter.input);
+    monoConverter.output.connect(&monoSink.input);
+    graph.compile(monoSink);
+    ASSERT_EQ(1, graph.getSharedBufferCount());
+
+    numRead = monoSink.read(monoOutput, 10);
+    ASSERT_EQ(3, numRead);
+    for (int i = 0; i < numRead; i++) {
+        EXPECT_EQ(input[i * 3], monoOutput[i]);
+    }
+}
+
+// The vector conversions must match the scalar code exactly.
+TEST(test_flowgraph, sample_conversion_matches_scalar) {
+    constexpr int kNumSamples = 1000 + 7; // include a partial vector
+    static const float edges[] = {0.0f, -0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 53.9f, -87.2f,
+                                  1.0e10f, -1.0e10f, 0.99999994f, -0.99999994f,
+                                  1.0f / 65536, -1.0f / 65536, 1.5f / 65536, -1.5f / 65536,
+                                  0.5f / 32768, -0.5f / 32768, 0.5f / 8388608, 2.5f / 2147483648.0f};
+    const int numEdges = sizeof(edges) / sizeof(edges[0]);
+    float floats[kNumSamples];
+    srand(12345);
+    for (int i = 0; i < kNumSamples; i++) {
+        floats[i] = (i < numEdges) ? edges[i]
+                : ((rand() / (float) RAND_MAX) * 2.4f) - 1.2f; // some will clip
+    }
+    SCOPED_TRACE(SampleConversion::getInstructionSetName());
+
+    for (int numSamples : {0, 1, 3, 4, 7, 8, 9, 16, 17, kNumSamples}) {
+        int16_t shorts[kNumSamples];
+        int16_t shortsScalar[kNumSamples];
+        SampleConversion::floatToI16(shorts, floats, numSamples);
+        SampleConversion::floatToI16Scalar(shortsScalar, floats, numSamples);
+        ASSERT_EQ(0, memcmp(shorts, shortsScalar, numSamples * sizeof(int16_t)));
+
+        uint8_t packed[kNumSamples * 3];
+        uint8_t packedScalar[kNumSamples * 3];
+        SampleConversion::floatToPackedI24(packed, floats, numSamples);
+        SampleConversion::floatToPackedI24Scalar(packedScalar, floats, numSamples);
+        ASSERT_EQ(0, memcmp(packed, packedScalar, numSamples * 3));
+
+        int32_t ints[kNumSamples];
+        int32_t intsScalar[kNumSamples];
+        SampleConversion::floatToI32(ints, floats, numSamples);
+        SampleConversion::floatToI32Scalar(intsScalar, floats, numSamples);
+        ASSERT_EQ(0, memcmp(ints, intsScalar, numSamples * sizeof(int32_t)));
+
+        float result[kNumSamples];
+        float resultScalar[kNumSamples];
+        SampleConversion::i16ToFloat(result, shorts, numSamples);
+        SampleConversion::i16ToFloatScalar(resultScalar, shorts, numSamples);
+        ASSERT_EQ(0, memcmp(result, resultScalar, numSamples * sizeof(float)));
+
+        SampleConversion::packedI24ToFloat(result, packed, numSamples);
+        SampleConversion::packedI24ToFloatScalar(resultScalar, packed, numSamples);
+        ASSERT_EQ(0, memcmp(result, resultScalar, numSamples * sizeof(float)));
+
+        SampleConversion::i32ToFloat(result, ints, numSamples);
+        SampleConversion::i32ToFloatScalar(resultScalar, ints, numSamples);
+        ASSERT_EQ(0, memcmp(result, resultScalar, numSamples * sizeof(float)));
+    }
+}
+
+TEST(test_flowgraph, sample_conversion_clips) {
+    static const float input[] = {1.0f, -1.0f, 2.0f, -2.0f, 0.5f};
+    int16_t shorts[5];
+    SampleConversion::floatToI16Scalar(shorts, input, 5);
+    EXPECT_EQ(32767, shorts[0]);
+    EXPECT_EQ(-32768, shorts[1]);
+    EXPECT_EQ(32767, shorts[2]);
+    EXPECT_EQ(-32768, shorts[3]);
+    EXPECT_EQ(16384, shorts[4]);
+    int32_t ints[5];
+    SampleConversion::floatToI32Scalar(ints, input, 5);
+    EXPECT_EQ(INT32_MAX, ints[0]);
+    EXPECT_EQ(INT32_MIN, ints[1]);
+    EXPECT_EQ(INT32_MAX, ints[2]);
+    EXPECT_EQ(INT32_MIN, ints[3]);
+    EXPECT_EQ(0x40000000, ints[4]);
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Test the LatencyTuner using a stream that is not connected to any audio device.
+ * The test sets the xrun count and the data in the buffer before each call to tune().
+ */
+
+#include <gtest/gtest.h>
+
+#include "oboe/Oboe.h"
+
+using namespace oboe;
+
+constexpr int32_t kFramesPerBurst = 96;
+constexpr int32_t kBufferCapacity = 16 * kFramesPerBurst;
+constexpr int32_t kSampleRate = 48000;
+constexpr int32_t kWindowMillis = 10; // 5 bursts
+constexpr int32_t kCallsPerWindow = 5;
+constexpr int32_t kStableWindows = 4;
+
+class FakeTunedStream : public AudioStream {
+public:
+    explicit FakeTunedStream(const AudioStreamBuilder &builder)
+            : AudioStream(builder) {
+        mFramesPerBurst = kFramesPerBurst;
+        mBufferSizeInFrames = kBufferCapacity;
+    }
+
+    Result requestStart() override { return Result::OK; }
+    Result requestPause() override { return Result::OK; }
+    Result requestFlush() override { return Result::OK; }
+    Result requestStop() override { return Result::OK; }
+    StreamState getState() override { return StreamState::Started; }
+    Result waitForStateChange(StreamState /* inputState */,
+                              StreamState *nextState,
+                              int64_t /* timeoutNanoseconds */) override {
+        if (nextState != nullptr) *nextState = StreamState::Started;
+        return Result::OK;
+    }
+    ResultWithValue<int32_t> setBufferSizeInFrames(int32_t requestedFrames) override {
+        // Quantize to bursts like AAudio.
+        int32_t numBursts = (requestedFrames + kFramesPerBurst - 1) / kFramesPerBurst;
+        numBursts = (numBursts < 1) ? 1 : numBursts;
+        mBufferSizeInFrames = std::min(numBursts * kFramesPerBurst, kBufferCapacity);
+        return ResultWithValue<int32_t>(mBufferSizeInFrames);
+    }
+    ResultWithValue<int32_t> getXRunCount() override {
+        return ResultWithValue<int32_t>(xRunCount);
+    }
+    bool isXRunCountSupported() const override { return true; }
+    AudioApi getAudioApi() const override { return AudioApi::Unspecified; }
+    void updateFramesWritten() override {}
+    void updateFramesRead() override {}
+
+    /**
+     * Play one burst, leaving the given number of frames in the buffer.
+     */
+    void playBurst(int32_t framesLeft) {
+        mFramesRead += kFramesPerBurst;
+        mFramesWritten = mFramesRead + framesLeft;
+    }
+
+    int32_t xRunCount = 0;
+};
+
+class LatencyTunerTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        AudioStreamBuilder builder;
+        builder.setDirection(Direction::Output)
+                ->setSampleRate(kSampleRate)
+                ->setChannelCount(2)
+                ->setFormat(AudioFormat::Float)
+                ->setBufferCapacityInFrames(kBufferCapacity);
+        mStream = std::make_unique<FakeTunedStream>(builder);
+        mTuner = std::make_unique<LatencyTuner>(*mStream);
+        LatencyTuner::DecreasePolicy policy;
+        policy.windowMillis = kWindowMillis;
+        policy.stableWindows = kStableWindows;
+        policy.maxStableWindows = 4 * kStableWindows;
+        mTuner->setDecreasePolicy(policy);
+    }
+
+    // Call tune() once per burst, leaving all but one burst of the buffer full.
+    void runWindows(int32_t numWindows) {
+        for (int32_t i = 0; i < numWindows * kCallsPerWindow; i++) {
+            mStream->playBurst(mStream->getBufferSizeInFrames() - kFramesPerBurst);
+            ASSERT_EQ(Result::OK, mTuner->tune());
+        }
+    }
+
+    // Cause an xrun and let the tuner raise the buffer size.
+    void causeXRun() {
+        mStream->xRunCount++;
+        mStream->playBurst(0);
+        ASSERT_EQ(Result::OK, mTuner->tune());
+    }
+
+    // Run stable windows until the buffer size drops.
+    int32_t countWindowsUntilDecrease(int32_t maxWindows) {
+        const int32_t bufferSize = mStream->getBufferSizeInFrames();
+        for (int32_t window = 1; window <= maxWindows; window++) {
+            runWindows(1);
+            if (mStream->getBufferSizeInFrames() < bufferSize) return window;
+        }
+        return -1;
+    }
+
+    std::unique_ptr<FakeTunedStream> mStream;
+    std::unique_ptr<LatencyTuner> mTuner;
+};
+
+TEST_F(LatencyTunerTest, IncreaseOnlyNeverLowers) {
+    runWindows(2); // wait for the tuner to become active
+    const int32_t minimum = mStream->getBufferSizeInFrames();
+    EXPECT_EQ(mTuner->getMinimumBufferSize(), minimum);
+    causeXRun();
+    causeXRun();
+    EXPECT_EQ(minimum + 2 * kFramesPerBurst, mStream->getBufferSizeInFrames());
+    runWindows(10 * kStableWindows);
+    EXPECT_EQ(minimum + 2 * kFramesPerBurst, mStream->getBufferSizeInFrames());
+}
+
+TEST_F(LatencyTunerTest, BidirectionalLowersAfterStableWindows) {
+    mTuner->setMode(LatencyTuner::Mode::Bidirectional);
+    runWindows(2);
+    const int32_t minimum = mStream->getBufferSizeInFrames();
+    causeXRun();
+    causeXRun();
+    ASSERT_EQ(minimum + 2 * kFramesPerBurst, mStream->getBufferSizeInFrames());
+
+    // The first window may be partial.
+    int32_t numWindows = countWindowsUntilDecrease(2 * kStableWindows);
+    EXPECT_GE(numWindows, kStableWindows);
+    EXPECT_LE(numWindows, kStableWindows + 1);
+    EXPECT_EQ(minimum + kFramesPerBurst, mStream->getBufferSizeInFrames());
+    EXPECT_EQ(kStableWindows, countWindowsUntilDecrease(2 * kStableWindows));
+    EXPECT_EQ(minimum, mStream->getBufferSizeInFrames());
+
+    // Never below the minimum.
+    runWindows(4 * kStableWindows);
+    EXPECT_EQ(minimum, mStream->getBufferSizeInFrames());
+
+    LatencyTuner::Decision decisions[LatencyTuner::kMaxDecisions];
+    ASSERT_EQ(4, mTuner->getDecisions(decisions, LatencyTuner::kMaxDecisions));
+    EXPECT_EQ(4, mTuner->getDecisionCount());
+    EXPECT_EQ(LatencyTuner::Action::Increase, decisions[0].action);
+    EXPECT_EQ(minimum, decisions[0].oldBufferSize);
+    EXPECT_EQ(minimum + kFramesPerBurst, decisions[0].newBufferSize);
+    EXPECT_EQ(1, decisions[0].xRunCount);
+    EXPECT_EQ(LatencyTuner::Action::Increase, decisions[1].action);
+    EXPECT_EQ(2, decisions[1].xRunCount);
+    EXPECT_EQ(LatencyTuner::Action::Decrease, decisions[2].action);
+    EXPECT_EQ(minimum + 2 * kFramesPerBurst, decisions[2].oldBufferSize);
+    EXPECT_EQ(minimum + kFramesPerBurst, decisions[2].newBufferSize);
+    EXPECT_EQ(minimum + kFramesPerBurst, decisions[2].minHeadroomFrames);
+    EXPECT_EQ(LatencyTuner::Action::Decrease, decisions[3].action);
+    EXPECT_EQ(minimum, decisions[3].newBufferSize);
+    EXPECT_LE(decisions[2].timeNanos, decisions[3].timeNanos);
+
+    // Ask for fewer than are available and get the newest.
+    ASSERT_EQ(1, mTuner->getDecisions(decisions, 1));
+    EXPECT_EQ(minimum, decisions[0].newBufferSize);
+}
+
+TEST_F(LatencyTunerTest, DoesNotLowerWithoutHeadroom) {
+    mTuner->setMode(LatencyTuner::Mode::Bidirectional);
+    runWindows(2);
+    causeXRun();
+    const int32_t bufferSize = mStream->getBufferSizeInFrames();
+    // Leave less than the increment plus a burst of margin in the buffer.
+    for (int32_t i = 0; i < 10 * kStableWindows * kCallsPerWindow; i++) {
+        mStream->playBurst(2 * kFramesPerBurst - 1);
+        ASSERT_EQ(Result::OK, mTuner->tune());
+    }
+    EXPECT_EQ(bufferSize, mStream->getBufferSizeInFrames());
+}
+
+TEST_F(LatencyTunerTest, BacksOffAfterXRunFollowingDecrease) {
+    mTuner->setMode(LatencyTuner::Mode::Bidirectional);
+    runWindows(2);
+    causeXRun();
+    causeXRun();
+    ASSERT_GT(countWindowsUntilDecrease(2 * kStableWindows), 0);
+
+    // The lower size glitched, so the tuner should wait twice as long before lowering again.
+    causeXRun();
+    int32_t numWindows = countWindowsUntilDecrease(8 * kStableWindows);
+    EXPECT_GE(numWindows, 2 * kStableWindows);
+    EXPECT_LE(numWindows, 2 * kStableWindows + 1);
+
+    causeXRun();
+    numWindows = countWindowsUntilDecrease(8 * kStableWindows);
+    EXPECT_GE(numWindows, 4 * kStableWindows);
+    EXPECT_LE(numWindows, 4 * kStableWindows + 1);
+
+    // Limited by maxStableWindows.
+    causeXRun();
+    numWindows = countWindowsUntilDecrease(8 * kStableWindows);
+    EXPECT_GE(numWindows, 4 * kStableWindows);
+    EXPECT_LE(numWindows, 4 * kStableWindows + 1);
+}
+
+TEST_F(LatencyTunerTest, ResetIsRecorded) {
+    mTuner->setMode(LatencyTuner::Mode::Bidirectional);
+    runWindows(2);
+    const int32_t minimum = mStream->getBufferSizeInFrames();
+    causeXRun();
+    mTuner->requestReset();
+    runWindows(2);
+    EXPECT_EQ(minimum, mStream->getBufferSizeInFrames());
+    LatencyTuner::Decision decisions[LatencyTuner::kMaxDecisions];
+    ASSERT_EQ(2, mTuner->getDecisions(decisions, LatencyTuner::kMaxDecisions));
+    EXPECT_EQ(LatencyTuner::Action::Reset, decisions[1].action);
+    EXPECT_EQ(minimum + kFramesPerBurst, decisions[1].oldBufferSize);
+    EXPECT_EQ(minimum, decisions[1].newBufferSize);
+}
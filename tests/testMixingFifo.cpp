@@ -0,0 +1,146 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test mixing several producer threads through a MixingFifo.
+ */
+
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "oboe/MixingFifo.h"
+
+using namespace oboe;
+
+constexpr int32_t kChannelCount = 2;
+constexpr int32_t kCapacityInFrames = 128;
+
+TEST(test_mixing_fifo, mix_with_gain) {
+    MixingFifo mixer(kChannelCount, kCapacityInFrames, 4);
+    int32_t lane0 = mixer.openLane().value();
+    int32_t lane1 = mixer.openLane().value();
+    ASSERT_NE(lane0, lane1);
+    mixer.setGain(lane1, 0.5f);
+
+    std::vector<float> ones(8 * kChannelCount, 1.0f);
+    ASSERT_EQ(8, mixer.write(lane0, ones.data(), 8));
+    ASSERT_EQ(4, mixer.write(lane1, ones.data(), 4));
+    EXPECT_EQ(kCapacityInFrames - 4, mixer.getEmptyFramesAvailable(lane1));
+
+    std::vector<float> output(8 * kChannelCount);
+    EXPECT_EQ(2, mixer.mix(output.data(), 8));
+    EXPECT_EQ(1.5f, output[0]);
+    EXPECT_EQ(1.5f, output[4 * kChannelCount - 1]);
+    EXPECT_EQ(1.0f, output[4 * kChannelCount]); // lane1 ran out
+    EXPECT_EQ(0, mixer.getUnderrunCount(lane0));
+    EXPECT_EQ(1, mixer.getUnderrunCount(lane1));
+
+    // Both lanes are empty now but only count underruns once per mix.
+    EXPECT_EQ(0, mixer.mix(output.data(), 8));
+    EXPECT_EQ(0.0f, output[0]);
+    EXPECT_EQ(1, mixer.getUnderrunCount(lane0));
+    EXPECT_EQ(2, mixer.getUnderrunCount(lane1));
+}
+
+TEST(test_mixing_fifo, unstarted_lane_is_not_an_underrun) {
+    MixingFifo mixer(kChannelCount, kCapacityInFrames, 2);
+    int32_t lane = mixer.openLane().value();
+    std::vector<float> output(8 * kChannelCount);
+    mixer.mix(output.data(), 8);
+    EXPECT_EQ(0, mixer.getUnderrunCount(lane));
+}
+
+TEST(test_mixing_fifo, closed_lane_drains_then_frees) {
+    MixingFifo mixer(kChannelCount, kCapacityInFrames, 2);
+    ASSERT_EQ(0, mixer.openLane().value());
+    ASSERT_EQ(1, mixer.openLane().value());
+    EXPECT_EQ(Result::ErrorNoFreeHandles, mixer.openLane().error());
+
+    std::vector<float> ones(16 * kChannelCount, 1.0f);
+    ASSERT_EQ(16, mixer.write(0, ones.data(), 16));
+    mixer.closeLane(0);
+    EXPECT_EQ(Result::ErrorNoFreeHandles, mixer.openLane().error()); // still draining
+
+    std::vector<float> output(8 * kChannelCount);
+    EXPECT_EQ(1, mixer.mix(output.data(), 8));
+    EXPECT_EQ(1.0f, output[8 * kChannelCount - 1]);
+    EXPECT_EQ(1, mixer.mix(output.data(), 8)); // all of the remaining data, not freed yet
+    EXPECT_EQ(0, mixer.mix(output.data(), 8)); // now empty so it is freed
+    EXPECT_EQ(0, mixer.getUnderrunCount(0));
+
+    ResultWithValue<int32_t> reopened = mixer.openLane();
+    ASSERT_TRUE(bool(reopened));
+    EXPECT_EQ(0, reopened.value());
+    EXPECT_EQ(0, mixer.getUnderrunCount(0));
+}
+
+// Each producer writes the value (1 << lane), so the bits of each mixed sample
+// show which lanes contributed to it. Every lane must be mixed exactly kNumFrames times.
+TEST(test_mixing_fifo, producer_threads) {
+    constexpr int32_t kNumLanes = 4;
+    constexpr int32_t kNumFrames = 50000;
+    constexpr int32_t kFramesPerMix = 32;
+    MixingFifo mixer(1, kCapacityInFrames, kNumLanes);
+    std::vector<int32_t> lanes;
+    for (int32_t i = 0; i < kNumLanes; i++) {
+        lanes.push_back(mixer.openLane().value());
+    }
+    std::vector<std::thread> producers;
+    for (int32_t lane : lanes) {
+        producers.emplace_back([&mixer, lane]() {
+            std::vector<float> block(16, static_cast<float>(1 << lane));
+            int32_t framesLeft = kNumFrames;
+            while (framesLeft > 0) {
+                int32_t framesWritten = mixer.write(lane, block.data(),
+                                                    std::min(framesLeft, 16));
+                if (framesWritten == 0) {
+                    std::this_thread::yield();
+                }
+                framesLeft -= framesWritten;
+            }
+            mixer.closeLane(lane);
+        });
+    }
+
+    std::vector<int32_t> framesMixed(kNumLanes);
+    std::vector<float> output(kFramesPerMix);
+    int32_t errors = 0;
+    bool done = false;
+    while (!done) {
+        mixer.mix(output.data(), kFramesPerMix);
+        for (float sample : output) {
+            int32_t bits = static_cast<int32_t>(sample);
+            if (sample != bits || bits >= (1 << kNumLanes)) errors++;
+            for (int32_t lane = 0; lane < kNumLanes; lane++) {
+                if (bits & (1 << lane)) framesMixed[lane]++;
+            }
+        }
+        done = true;
+        for (int32_t lane = 0; lane < kNumLanes; lane++) {
+            if (framesMixed[lane] < kNumFrames) done = false;
+        }
+        std::this_thread::yield();
+    }
+    for (std::thread &producer : producers) {
+        producer.join();
+    }
+    EXPECT_EQ(0, errors);
+    for (int32_t lane = 0; lane < kNumLanes; lane++) {
+        EXPECT_EQ(kNumFrames, framesMixed[lane]);
+    }
+}
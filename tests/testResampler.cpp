@@ -0,0 +1,651 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the resamplers in the flowgraph/resampler folder.
+ */
+
+#include <algorithm>
+#include <limits>
+#include <math.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "flowgraph/resampler/CoefficientCache.h"
+#include "flowgraph/resampler/FillLevelController.h"
+#include "flowgraph/resampler/MultiChannelResampler.h"
+#include "flowgraph/resampler/PolyphaseResampler.h"
+#include "flowgraph/resampler/SincResampler.h"
+#include "flowgraph/resampler/TieredResampler.h"
+
+using namespace resampler;
+
+// The vector code adds the taps in a different order so allow for rounding.
+constexpr float kTolerance = 0.00001f; // arbitrary
+
+/**
+ * The original scalar implementation of readFrame(), used as a reference.
+ */
+class ReferencePolyphaseResampler : public PolyphaseResampler {
+public:
+    explicit ReferencePolyphaseResampler(const MultiChannelResampler::Builder &builder)
+            : PolyphaseResampler(builder) {}
+
+protected:
+    void readFrame(float *frame) override {
+        std::fill(mSingleFrame.begin(), mSingleFrame.end(), 0.0);
+        const float *coefficients = &mCoefficients[mCoefficientCursor];
+        const float *xFrame = &mX[mCursor * getChannelCount()];
+        for (int i = 0; i < mNumTaps; i++) {
+            float coefficient = *coefficients++;
+            for (int channel = 0; channel < getChannelCount(); channel++) {
+                mSingleFrame[channel] += *xFrame++ * coefficient;
+            }
+        }
+        mCoefficientCursor = (mCoefficientCursor + mNumTaps) % mNumCoefficients;
+        for (int channel = 0; channel < getChannelCount(); channel++) {
+            frame[channel] = mSingleFrame[channel];
+        }
+    }
+};
+
+/**
+ * Run the resampler until it has generated numOutputFrames.
+ * Each channel gets a sine wave at a different frequency.
+ */
+static std::vector<float> runResampler(MultiChannelResampler &resampler,
+                                       int32_t numOutputFrames) {
+    const int32_t channelCount = resampler.getChannelCount();
+    std::vector<float> output(numOutputFrames * channelCount);
+    std::vector<float> frame(channelCount);
+    int32_t inputFrameIndex = 0;
+    float *outputFrame = output.data();
+    int32_t framesLeft = numOutputFrames;
+    while (framesLeft > 0) {
+        if (resampler.isWriteNeeded()) {
+            for (int channel = 0; channel < channelCount; channel++) {
+                frame[channel] = 0.9f * sinf(inputFrameIndex * 0.02f * (channel + 1));
+            }
+            resampler.writeNextFrame(frame.data());
+            inputFrameIndex++;
+        } else {
+            resampler.readNextFrame(outputFrame);
+            outputFrame += channelCount;
+            framesLeft--;
+        }
+    }
+    return output;
+}
+
+static void checkPolyphaseMatchesReference(int32_t channelCount,
+                                           int32_t numTaps,
+                                           int32_t inputRate,
+                                           int32_t outputRate) {
+    SCOPED_TRACE(testing::Message() << "channels = " << channelCount
+            << ", taps = " << numTaps << ", " << inputRate << " => " << outputRate);
+    constexpr int32_t kNumOutputFrames = 1000;
+    MultiChannelResampler::Builder builder;
+    builder.setChannelCount(channelCount)
+            ->setNumTaps(numTaps)
+            ->setInputRate(inputRate)
+            ->setOutputRate(outputRate);
+    std::unique_ptr<MultiChannelResampler> resampler(builder.build());
+    ReferencePolyphaseResampler reference(builder);
+
+    std::vector<float> actual = runResampler(*resampler, kNumOutputFrames);
+    std::vector<float> expected = runResampler(reference, kNumOutputFrames);
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_NEAR(expected[i], actual[i], kTolerance) << "at sample " << i;
+    }
+}
+
+TEST(test_resampler, polyphase_matches_reference) {
+    for (int32_t channelCount : {1, 2, 3, 6, 8}) {
+        for (int32_t numTaps : {4, 8, 16, 24, 32}) {
+            checkPolyphaseMatchesReference(channelCount, numTaps, 44100, 48000);
+            checkPolyphaseMatchesReference(channelCount, numTaps, 48000, 44100);
+        }
+    }
+}
+
+TEST(test_resampler, polyphase_unity_gain) {
+    // A DC input should come out at the same level after the filter settles.
+    constexpr int32_t kNumOutputFrames = 200;
+    for (int32_t channelCount : {1, 2, 6}) {
+        std::unique_ptr<MultiChannelResampler> resampler(MultiChannelResampler::make(
+                channelCount, 44100, 48000, MultiChannelResampler::Quality::High));
+        std::vector<float> frame(channelCount, 0.5f);
+        std::vector<float> output(channelCount);
+        for (int32_t i = 0; i < kNumOutputFrames;) {
+            if (resampler->isWriteNeeded()) {
+                resampler->writeNextFrame(frame.data());
+            } else {
+                resampler->readNextFrame(output.data());
+                i++;
+            }
+        }
+        for (int32_t channel = 0; channel < channelCount; channel++) {
+            EXPECT_NEAR(0.5f, output[channel], 0.001f);
+        }
+    }
+}
+
+static void checkSincMatchesGeneric(int32_t channelCount,
+                                    int32_t numTaps,
+                                    int32_t inputRate,
+                                    int32_t outputRate) {
+    SCOPED_TRACE(testing::Message() << "channels = " << channelCount
+            << ", taps = " << numTaps << ", " << inputRate << " => " << outputRate);
+    constexpr int32_t kNumOutputFrames = 1000;
+    MultiChannelResampler::Builder builder;
+    builder.setChannelCount(channelCount)
+            ->setNumTaps(numTaps)
+            ->setInputRate(inputRate)
+            ->setOutputRate(outputRate);
+    // The ratio cannot be reduced enough for a polyphase table so build() picks a
+    // sinc resampler that is optimized for the channel count.
+    std::unique_ptr<MultiChannelResampler> resampler(builder.build());
+    ASSERT_EQ(nullptr, dynamic_cast<PolyphaseResampler *>(resampler.get()));
+    SincResampler reference(builder);
+
+    std::vector<float> actual = runResampler(*resampler, kNumOutputFrames);
+    std::vector<float> expected = runResampler(reference, kNumOutputFrames);
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_NEAR(expected[i], actual[i], kTolerance) << "at sample " << i;
+    }
+}
+
+TEST(test_resampler, sinc_matches_generic) {
+    for (int32_t channelCount : {1, 2}) {
+        for (int32_t numTaps : {8, 16, 24, 32}) {
+            checkSincMatchesGeneric(channelCount, numTaps, 44100, 48001);
+            checkSincMatchesGeneric(channelCount, numTaps, 48000, 44056);
+            checkSincMatchesGeneric(channelCount, numTaps, 44056, 48000);
+        }
+    }
+}
+
+/**
+ * Feed the resampler through process() using blocks of varying sizes
+ * until it has generated numOutputFrames.
+ * The input matches runResampler().
+ */
+static std::vector<float> runResamplerBlocks(MultiChannelResampler &resampler,
+                                             int32_t numOutputFrames) {
+    const int32_t channelCount = resampler.getChannelCount();
+    constexpr int32_t kMaxBlockFrames = 37; // arbitrary, prime so the sizes vary
+    std::vector<float> input(kMaxBlockFrames * channelCount);
+    std::vector<float> output(numOutputFrames * channelCount);
+    int32_t inputFrameIndex = 0;
+    int32_t numValidFrames = 0;
+    int32_t framesProduced = 0;
+    int32_t blockFrames = 1;
+    int32_t callCount = 0;
+    while (framesProduced < numOutputFrames) {
+        // Top up the input after it has been consumed.
+        if (numValidFrames == 0) {
+            numValidFrames = blockFrames;
+            for (int32_t i = 0; i < numValidFrames; i++) {
+                for (int channel = 0; channel < channelCount; channel++) {
+                    input[i * channelCount + channel] =
+                            0.9f * sinf((inputFrameIndex + i) * 0.02f * (channel + 1));
+                }
+            }
+        }
+        const int32_t inputOffset = blockFrames - numValidFrames;
+        // Sometimes zero so that we check an empty output.
+        int32_t maxOutputFrames = std::min(numOutputFrames - framesProduced,
+                                           (callCount++ * 5) % kMaxBlockFrames);
+        MultiChannelResampler::ProcessResult result = resampler.process(
+                &input[inputOffset * channelCount], numValidFrames,
+                &output[framesProduced * channelCount], maxOutputFrames);
+        EXPECT_LE(result.framesConsumed, numValidFrames);
+        EXPECT_LE(result.framesProduced, maxOutputFrames);
+        numValidFrames -= result.framesConsumed;
+        inputFrameIndex += result.framesConsumed;
+        framesProduced += result.framesProduced;
+        if (numValidFrames == 0) {
+            blockFrames = (blockFrames % kMaxBlockFrames) + 1;
+        }
+    }
+    return output;
+}
+
+static void checkProcessMatchesFrames(int32_t channelCount,
+                                      int32_t numTaps,
+                                      int32_t inputRate,
+                                      int32_t outputRate) {
+    SCOPED_TRACE(testing::Message() << "channels = " << channelCount
+            << ", taps = " << numTaps << ", " << inputRate << " => " << outputRate);
+    constexpr int32_t kNumOutputFrames = 1000;
+    MultiChannelResampler::Builder builder;
+    builder.setChannelCount(channelCount)
+            ->setNumTaps(numTaps)
+            ->setInputRate(inputRate)
+            ->setOutputRate(outputRate);
+    std::unique_ptr<MultiChannelResampler> frameResampler(builder.build());
+    std::unique_ptr<MultiChannelResampler> blockResampler(builder.build());
+
+    std::vector<float> expected = runResampler(*frameResampler, kNumOutputFrames);
+    std::vector<float> actual = runResamplerBlocks(*blockResampler, kNumOutputFrames);
+    // The library is built with -Ofast so the compiler may round differently
+    // when the kernels are inlined into process().
+    for (size_t i = 0; i < expected.size(); i++) {
+        ASSERT_NEAR(expected[i], actual[i], kTolerance) << "at sample " << i;
+    }
+}
+
+TEST(test_resampler, process_matches_frames) {
+    for (int32_t channelCount : {1, 2, 3}) {
+        // Linear, then polyphase from Fastest to Best.
+        for (int32_t numTaps : {2, 8, 16, 24, 32}) {
+            checkProcessMatchesFrames(channelCount, numTaps, 44100, 48000);
+            checkProcessMatchesFrames(channelCount, numTaps, 48000, 44100);
+        }
+        // A ratio that is too large for a polyphase table so it uses a sinc resampler.
+        checkProcessMatchesFrames(channelCount, 16, 44101, 48000);
+    }
+}
+
+TEST(test_resampler, process_empty_blocks) {
+    std::unique_ptr<MultiChannelResampler> resampler(MultiChannelResampler::make(
+            2, 44100, 48000, MultiChannelResampler::Quality::Medium));
+    float input[2] = {0.5f, 0.5f};
+    float output[2] = {};
+
+    // A new resampler needs input before it can produce anything.
+    MultiChannelResampler::ProcessResult result = resampler->process(input, 0, output, 1);
+    EXPECT_EQ(0, result.framesConsumed);
+    EXPECT_EQ(0, result.framesProduced);
+
+    // Nothing happens when there is no room for output.
+    result = resampler->process(input, 1, output, 0);
+    EXPECT_EQ(0, result.framesConsumed);
+    EXPECT_EQ(0, result.framesProduced);
+
+    result = resampler->process(input, 1, output, 1);
+    EXPECT_EQ(1, result.framesConsumed);
+    EXPECT_EQ(1, result.framesProduced);
+}
+
+TEST(test_resampler, coefficient_cache_shares_tables) {
+    CoefficientCache &cache = CoefficientCache::getInstance();
+    cache.clear();
+    MultiChannelResampler::Builder builder;
+    builder.setChannelCount(2)
+            ->setNumTaps(16)
+            ->setInputRate(44100)
+            ->setOutputRate(48000);
+    std::unique_ptr<MultiChannelResampler> resampler1(builder.build());
+    EXPECT_EQ(0, cache.getHitCount());
+    EXPECT_EQ(1, cache.getMissCount());
+
+    // The table does not depend on the channel count.
+    builder.setChannelCount(1);
+    std::unique_ptr<MultiChannelResampler> resampler2(builder.build());
+    EXPECT_EQ(1, cache.getHitCount());
+    EXPECT_EQ(1, cache.getMissCount());
+    EXPECT_EQ(1, cache.getTableCount());
+
+    // The same ratio gives the same table.
+    builder.setInputRate(88200)->setOutputRate(96000);
+    std::unique_ptr<MultiChannelResampler> resampler3(builder.build());
+    EXPECT_EQ(2, cache.getHitCount());
+
+    // A different cutoff needs a new table.
+    builder.setNormalizedCutoff(0.5f);
+    std::unique_ptr<MultiChannelResampler> resampler4(builder.build());
+    EXPECT_EQ(2, cache.getHitCount());
+    EXPECT_EQ(2, cache.getMissCount());
+    EXPECT_EQ(2, cache.getTableCount());
+
+    // Tables can be reused after the resamplers are deleted.
+    resampler1.reset();
+    resampler2.reset();
+    builder.setNormalizedCutoff(0.5f);
+    std::unique_ptr<MultiChannelResampler> resampler5(builder.build());
+    EXPECT_EQ(3, cache.getHitCount());
+    cache.clear();
+}
+
+TEST(test_resampler, coefficient_cache_matches_generated) {
+    // A resampler that gets its table from the cache should sound the same.
+    CoefficientCache::getInstance().clear();
+    for (int32_t channelCount : {1, 2}) {
+        MultiChannelResampler::Builder builder;
+        builder.setChannelCount(channelCount)
+                ->setNumTaps(16)
+                ->setInputRate(44100)
+                ->setOutputRate(48001); // sinc
+        std::unique_ptr<MultiChannelResampler> first(builder.build());
+        std::vector<float> expected = runResampler(*first, 500);
+        std::unique_ptr<MultiChannelResampler> second(builder.build());
+        std::vector<float> actual = runResampler(*second, 500);
+        EXPECT_EQ(expected, actual);
+    }
+    EXPECT_EQ(1, CoefficientCache::getInstance().getMissCount());
+    CoefficientCache::getInstance().clear();
+}
+
+TEST(test_resampler, coefficient_cache_threads) {
+    CoefficientCache &cache = CoefficientCache::getInstance();
+    cache.clear();
+    constexpr int kNumThreads = 4;
+    constexpr int kNumResamplersPerThread = 20;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kNumThreads; i++) {
+        threads.emplace_back([]() {
+            for (int j = 0; j < kNumResamplersPerThread; j++) {
+                // Use a few different tables.
+                std::unique_ptr<MultiChannelResampler> resampler(MultiChannelResampler::make(
+                        2, 44100, 48000 + (j % 3), MultiChannelResampler::Quality::Medium));
+                float frame[2] = {0.5f, 0.5f};
+                resampler->writeNextFrame(frame);
+                resampler->readNextFrame(frame);
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(kNumThreads * kNumResamplersPerThread,
+              cache.getHitCount() + cache.getMissCount());
+    EXPECT_EQ(3, cache.getTableCount());
+    cache.clear();
+}
+
+TEST(test_resampler, coefficient_cache_limit) {
+    CoefficientCache &cache = CoefficientCache::getInstance();
+    cache.clear();
+    // Keep more resamplers alive than the cache can hold.
+    std::vector<std::unique_ptr<MultiChannelResampler>> resamplers;
+    for (int i = 0; i < CoefficientCache::kMaxTables + 4; i++) {
+        resamplers.emplace_back(MultiChannelResampler::make(
+                1, 44100, 48000 + i, MultiChannelResampler::Quality::Medium));
+    }
+    EXPECT_EQ(CoefficientCache::kMaxTables, cache.getTableCount());
+
+    // Once they are deleted their tables can be replaced.
+    resamplers.clear();
+    std::unique_ptr<MultiChannelResampler> resampler(MultiChannelResampler::make(
+            1, 44100, 32000, MultiChannelResampler::Quality::Medium));
+    EXPECT_EQ(1, cache.getTableCount());
+    cache.clear();
+}
+
+TEST(test_resampler, variable_rate_scaler) {
+    std::unique_ptr<MultiChannelResampler> fixed(MultiChannelResampler::make(
+            2, 48000, 48000, MultiChannelResampler::Quality::Medium));
+    EXPECT_FALSE(fixed->setRateScaler(1.001));
+
+    for (int32_t numTaps : {2, 16}) {
+        MultiChannelResampler::Builder builder;
+        builder.setChannelCount(2)
+                ->setNumTaps(numTaps)
+                ->setInputRate(48000)
+                ->setOutputRate(48000)
+                ->setVariableRate(true);
+        std::unique_ptr<MultiChannelResampler> resampler(builder.build());
+        ASSERT_TRUE(resampler->setRateScaler(1.01));
+        EXPECT_EQ(1.01, resampler->getRateScaler());
+
+        // Consuming input 1% faster should produce 1% fewer frames.
+        constexpr int32_t kNumInputFrames = 10000;
+        std::vector<float> input(kNumInputFrames * 2, 0.25f);
+        std::vector<float> output(kNumInputFrames * 2);
+        MultiChannelResampler::ProcessResult result = resampler->process(
+                input.data(), kNumInputFrames, output.data(), kNumInputFrames);
+        EXPECT_EQ(kNumInputFrames, result.framesConsumed);
+        EXPECT_NEAR(kNumInputFrames / 1.01, result.framesProduced, 2.0);
+    }
+}
+
+TEST(test_resampler, variable_rate_scaler_rejects_bad_values) {
+    MultiChannelResampler::Builder builder;
+    builder.setChannelCount(1)
+            ->setNumTaps(16)
+            ->setInputRate(48000)
+            ->setOutputRate(48000)
+            ->setVariableRate(true);
+    std::unique_ptr<MultiChannelResampler> resampler(builder.build());
+    ASSERT_TRUE(resampler->setRateScaler(1.5));
+    for (double rateScaler : {0.0, -1.0, 1.0e-9, 200.0,
+                              std::numeric_limits<double>::quiet_NaN(),
+                              std::numeric_limits<double>::infinity()}) {
+        SCOPED_TRACE(testing::Message() << "rateScaler = " << rateScaler);
+        EXPECT_FALSE(resampler->setRateScaler(rateScaler));
+        EXPECT_EQ(1.5, resampler->getRateScaler()); // unchanged
+    }
+    // The phase holds ratios up to about 127.
+    EXPECT_TRUE(resampler->setRateScaler(100.0));
+}
+
+/**
+ * Resample a sine wave and return the largest step between output samples.
+ * A click would show up as a step that is larger than the sine wave can make.
+ * @param sweepRate if true then keep changing the rate scaler
+ */
+static float measureLargestStep(MultiChannelResampler &resampler,
+                                float phaseIncrement,
+                                bool sweepRate) {
+    float maxStep = 0.0f;
+    float previous = 0.0f;
+    int32_t inputFrameIndex = 0;
+    for (int32_t i = 0; i < 20000; i++) {
+        if (sweepRate) {
+            resampler.setRateScaler(1.0 + 0.002 * sin(i * 0.001));
+        }
+        float sample;
+        while (resampler.isWriteNeeded()) {
+            sample = sinf(inputFrameIndex++ * phaseIncrement);
+            resampler.writeNextFrame(&sample);
+        }
+        resampler.readNextFrame(&sample);
+        if (i > 100) { // skip the start of the filter
+            maxStep = std::max(maxStep, fabsf(sample - previous));
+        }
+        previous = sample;
+    }
+    return maxStep;
+}
+
+TEST(test_resampler, sinc_is_smooth) {
+    constexpr float kPhaseIncrement = 0.05f; // arbitrary, well below Nyquist
+    for (bool variableRate : {false, true}) {
+        SCOPED_TRACE(testing::Message() << "variableRate = " << variableRate);
+        MultiChannelResampler::Builder builder;
+        builder.setChannelCount(1)
+                ->setNumTaps(16)
+                ->setInputRate(44100)
+                ->setOutputRate(48001) // sinc
+                ->setVariableRate(variableRate);
+        std::unique_ptr<MultiChannelResampler> resampler(builder.build());
+        float maxStep = measureLargestStep(*resampler, kPhaseIncrement, variableRate);
+        // The largest step for a sine at this rate, plus some margin for the sweep.
+        EXPECT_LT(maxStep, kPhaseIncrement * 44100 / 48001 * 1.01f);
+    }
+}
+
+/**
+ * Simulate an input device that writes bursts into a FIFO using a clock with some drift,
+ * and an output callback that reads the FIFO through a variable rate resampler.
+ * The bursts make the measured fill level jump so the rate will wander a little
+ * but it should follow the drift on average and the FIFO should never run dry.
+ */
+static void checkControllerTracksDrift(double driftPartsPerMillion, int32_t initialFrames) {
+    SCOPED_TRACE(testing::Message() << "drift = " << driftPartsPerMillion
+            << ", initial = " << initialFrames);
+    constexpr int32_t kFramesPerBurst = 96;
+    constexpr int32_t kTargetFrames = 2 * kFramesPerBurst;
+    constexpr int32_t kNumCallbacks = 60 * 48000 / kFramesPerBurst; // one minute
+    constexpr int32_t kSettledCallbacks = kNumCallbacks / 2;
+    const double inputRateScaler = 1.0 + (driftPartsPerMillion * 1.0e-6);
+
+    FillLevelController controller(kTargetFrames);
+    double framesWritten = initialFrames;
+    double inputPosition = 0.0;
+    double framesRead = 0.0;
+    double minFillLevel = framesWritten;
+    double maxError = 0.0;
+    double sumRateScalers = 0.0;
+    for (int32_t callback = 0; callback < kNumCallbacks; callback++) {
+        // The input writes whole bursts.
+        inputPosition += kFramesPerBurst * inputRateScaler;
+        while (inputPosition >= kFramesPerBurst) {
+            inputPosition -= kFramesPerBurst;
+            framesWritten += kFramesPerBurst;
+        }
+        const double fillLevel = framesWritten - framesRead;
+        minFillLevel = std::min(minFillLevel, fillLevel);
+        double rateScaler = controller.update(static_cast<int32_t>(fillLevel), kFramesPerBurst);
+        framesRead += kFramesPerBurst * rateScaler;
+        if (callback >= kSettledCallbacks) {
+            maxError = std::max(maxError, fabs(controller.getFillLevel() - kTargetFrames));
+            sumRateScalers += rateScaler;
+        }
+    }
+    EXPECT_GT(minFillLevel, 0.0);
+    EXPECT_LT(maxError, kFramesPerBurst);
+    EXPECT_NEAR(inputRateScaler, sumRateScalers / (kNumCallbacks - kSettledCallbacks),
+                50.0e-6);
+}
+
+TEST(test_resampler, fill_level_controller_tracks_drift) {
+    for (double drift : {-300.0, -50.0, 0.0, 50.0, 300.0}) {
+        for (int32_t initialFrames : {96, 192, 600}) {
+            checkControllerTracksDrift(drift, initialFrames);
+        }
+    }
+}
+
+TEST(test_resampler, fill_level_controller_limits) {
+    FillLevelController controller(100);
+    controller.setMaxDeviation(0.0005);
+    double rateScaler = 1.0;
+    double previous = 1.0;
+    for (int i = 0; i < 100000; i++) {
+        // A FIFO that is always too full should not push the rate past the limit.
+        rateScaler = controller.update(10000, 100);
+        EXPECT_LE(rateScaler - previous, FillLevelController::kMaxSlewPerFrame * 100 + 1.0e-12);
+        previous = rateScaler;
+    }
+    EXPECT_NEAR(1.0005, rateScaler, 1.0e-9);
+    controller.reset();
+    EXPECT_EQ(1.0, controller.getRateScaler());
+}
+
+TEST(test_resampler, tiered_matches_single_tier) {
+    constexpr int32_t kNumOutputFrames = 1000;
+    for (int32_t channelCount : {1, 2, 3}) {
+        SCOPED_TRACE(testing::Message() << "channels = " << channelCount);
+        const std::vector<MultiChannelResampler::Quality> qualities = {
+                MultiChannelResampler::Quality::Medium, MultiChannelResampler::Quality::Best};
+        std::unique_ptr<MultiChannelResampler> single(MultiChannelResampler::make(
+                channelCount, 44100, 48000, MultiChannelResampler::Quality::Best));
+        TieredResampler frameResampler(channelCount, 44100, 48000, qualities, 64);
+        TieredResampler blockResampler(channelCount, 44100, 48000, qualities, 64);
+        std::vector<float> expected = runResampler(*single, kNumOutputFrames);
+        std::vector<float> frames = runResampler(frameResampler, kNumOutputFrames);
+        std::vector<float> blocks = runResamplerBlocks(blockResampler, kNumOutputFrames);
+        // Within a tolerance because -Ofast may round differently in each path.
+        for (size_t i = 0; i < expected.size(); i++) {
+            ASSERT_NEAR(expected[i], frames[i], kTolerance) << "at sample " << i;
+            ASSERT_NEAR(expected[i], blocks[i], kTolerance) << "at sample " << i;
+        }
+    }
+}
+
+/**
+ * Resample a mono sine wave in blocks, changing between the first and last tier
+ * every switchFrames output frames.
+ */
+static std::vector<float> runTieredSine(TieredResampler &resampler,
+                                        float phaseIncrement,
+                                        int32_t numOutputFrames,
+                                        int32_t switchFrames) {
+    constexpr int32_t kBlockFrames = 32;
+    std::vector<float> input(numOutputFrames * 2);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = sinf(i * phaseIncrement);
+    }
+    std::vector<float> output(numOutputFrames);
+    int32_t framesConsumed = 0;
+    int32_t framesProduced = 0;
+    while (framesProduced < numOutputFrames) {
+        if (switchFrames > 0 && framesProduced > 0 && (framesProduced % switchFrames) == 0) {
+            resampler.setTier(resampler.getTier() == 0 ? resampler.getNumTiers() - 1 : 0);
+        }
+        MultiChannelResampler::ProcessResult result = resampler.process(
+                &input[framesConsumed], static_cast<int32_t>(input.size()) - framesConsumed,
+                &output[framesProduced], std::min(kBlockFrames, numOutputFrames - framesProduced));
+        framesConsumed += result.framesConsumed;
+        framesProduced += result.framesProduced;
+    }
+    return output;
+}
+
+// After a change of tier without a crossfade the output is the same as a resampler
+// of the new quality that had been running all along.
+TEST(test_resampler, tiered_switch_continues_resampling) {
+    constexpr int32_t kNumOutputFrames = 2048;
+    constexpr int32_t kSwitchFrames = 1024;
+    constexpr float kPhaseIncrement = 0.05f; // arbitrary
+    // Polyphase, then sinc for the Best tier.
+    for (int32_t outputRate : {48000, 48001}) {
+        SCOPED_TRACE(testing::Message() << "outputRate = " << outputRate);
+        TieredResampler tiered(1, 44100, outputRate,
+                               {MultiChannelResampler::Quality::Low,
+                                MultiChannelResampler::Quality::Best}, 0);
+        TieredResampler lowOnly(1, 44100, outputRate, {MultiChannelResampler::Quality::Low}, 0);
+        std::vector<float> actual = runTieredSine(tiered, kPhaseIncrement, kNumOutputFrames,
+                                                  kSwitchFrames);
+        std::vector<float> expected = runTieredSine(lowOnly, kPhaseIncrement, kNumOutputFrames, 0);
+        EXPECT_EQ(0, tiered.getActiveTier());
+        for (int32_t i = kSwitchFrames; i < kNumOutputFrames; i++) {
+            ASSERT_NEAR(expected[i], actual[i], kTolerance) << "at frame " << i;
+        }
+    }
+}
+
+static float measureLargestStep(const std::vector<float> &samples) {
+    float maxStep = 0.0f;
+    for (size_t i = 100; i < samples.size(); i++) { // skip the start of the filter
+        maxStep = std::max(maxStep, fabsf(samples[i] - samples[i - 1]));
+    }
+    return maxStep;
+}
+
+// The tiers have different delays so switching directly makes a click,
+// which the crossfade removes.
+TEST(test_resampler, tiered_crossfade_is_smooth) {
+    constexpr float kPhaseIncrement = 0.05f; // arbitrary, well below Nyquist
+    const std::vector<MultiChannelResampler::Quality> qualities = {
+            MultiChannelResampler::Quality::Low,
+            MultiChannelResampler::Quality::Medium,
+            MultiChannelResampler::Quality::Best};
+    const float sineStep = kPhaseIncrement * 44100 / 48000;
+
+    TieredResampler crossfaded(1, 44100, 48000, qualities, 256);
+    float maxStep = measureLargestStep(runTieredSine(crossfaded, kPhaseIncrement, 20000, 1000));
+    EXPECT_LT(maxStep, sineStep * 1.1f);
+
+    TieredResampler switched(1, 44100, 48000, qualities, 0);
+    maxStep = measureLargestStep(runTieredSine(switched, kPhaseIncrement, 20000, 1000));
+    EXPECT_GT(maxStep, sineStep * 4.0f);
+}
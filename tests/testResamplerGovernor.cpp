@@ -0,0 +1,98 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Test the ResamplerGovernor that chooses the adaptive resampler quality.
+ * The callback durations are made up so the tests do not depend on the CPU.
+ */
+
+#include <gtest/gtest.h>
+
+#include "oboe/Definitions.h"
+#include "common/ResamplerGovernor.h"
+
+using namespace oboe;
+
+constexpr int32_t kSampleRate = 48000;
+constexpr int32_t kFramesPerCallback = 96; // 2 msec
+constexpr int64_t kCallbackBudgetNanos = kFramesPerCallback * kNanosPerSecond / kSampleRate;
+constexpr int32_t kNumTiers = 3;
+
+// Run callbacks with the same load for a number of milliseconds.
+static int32_t runCallbacks(ResamplerGovernor &governor, double load, int32_t millis) {
+    int32_t tier = governor.getTier();
+    const int32_t numCallbacks = millis * kSampleRate / (kFramesPerCallback * kMillisPerSecond);
+    for (int32_t i = 0; i < numCallbacks; i++) {
+        tier = governor.update(static_cast<int64_t>(load * kCallbackBudgetNanos),
+                               kFramesPerCallback);
+    }
+    return tier;
+}
+
+TEST(test_resampler_governor, starts_at_highest_tier) {
+    ResamplerGovernor governor(kNumTiers, kSampleRate);
+    EXPECT_EQ(kNumTiers - 1, governor.getTier());
+    EXPECT_EQ(kNumTiers - 1, runCallbacks(governor, 0.3, 10000));
+}
+
+TEST(test_resampler_governor, overrun_lowers_tier_at_once) {
+    ResamplerGovernor governor(kNumTiers, kSampleRate);
+    runCallbacks(governor, 0.3, 1000);
+    EXPECT_EQ(kNumTiers - 2, governor.update(2 * kCallbackBudgetNanos, kFramesPerCallback));
+    // Another overrun straight away does not lower it again, the crossfade has to finish.
+    EXPECT_EQ(kNumTiers - 2, governor.update(2 * kCallbackBudgetNanos, kFramesPerCallback));
+    // Continuous overload goes down to the lowest tier and stays there.
+    EXPECT_EQ(0, runCallbacks(governor, 1.5, 1000));
+}
+
+TEST(test_resampler_governor, high_smoothed_load_lowers_tier) {
+    ResamplerGovernor governor(kNumTiers, kSampleRate);
+    // Below the overrun level but above the high load level.
+    EXPECT_EQ(kNumTiers - 1, runCallbacks(governor, ResamplerGovernor::kHighLoad - 0.05, 1000));
+    EXPECT_EQ(kNumTiers - 2, runCallbacks(governor, ResamplerGovernor::kHighLoad + 0.1, 100));
+    EXPECT_GT(governor.getSmoothedLoad(), ResamplerGovernor::kHighLoad);
+}
+
+TEST(test_resampler_governor, low_load_raises_tier_slowly) {
+    ResamplerGovernor governor(kNumTiers, kSampleRate);
+    EXPECT_EQ(0, runCallbacks(governor, 1.5, 1000));
+    const int32_t raiseDelayMillis = static_cast<int32_t>(
+            governor.getRaiseDelayFrames() * kMillisPerSecond / kSampleRate);
+    // A load between the low and high levels holds the tier.
+    EXPECT_EQ(0, runCallbacks(governor, 0.7, 2 * raiseDelayMillis));
+    // The load has to be low for the whole delay.
+    EXPECT_EQ(0, runCallbacks(governor, 0.2, raiseDelayMillis / 2));
+    EXPECT_EQ(1, runCallbacks(governor, 0.2, raiseDelayMillis));
+    EXPECT_EQ(2, runCallbacks(governor, 0.2, raiseDelayMillis + 10));
+}
+
+TEST(test_resampler_governor, raise_delay_backs_off) {
+    // Time for the smoothed load to fall below the low level.
+    constexpr int32_t kSettleMillis = 200;
+    ResamplerGovernor governor(kNumTiers, kSampleRate);
+    runCallbacks(governor, 1.5, 1000);
+    const int64_t raiseDelayFrames = governor.getRaiseDelayFrames();
+    const int32_t raiseDelayMillis = static_cast<int32_t>(
+            raiseDelayFrames * kMillisPerSecond / kSampleRate);
+    EXPECT_EQ(1, runCallbacks(governor, 0.2, raiseDelayMillis + kSettleMillis));
+    // The higher tier overloads the callback so the tier should come down
+    // and then wait twice as long before going back up.
+    EXPECT_EQ(0, runCallbacks(governor, 1.5, 100));
+    EXPECT_EQ(2 * raiseDelayFrames, governor.getRaiseDelayFrames());
+    EXPECT_EQ(0, runCallbacks(governor, 0.2, raiseDelayMillis + kSettleMillis));
+    EXPECT_EQ(1, runCallbacks(governor, 0.2, raiseDelayMillis + kSettleMillis));
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test a SharedMemoryFifo between two processes.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "oboe/SharedMemoryFifo.h"
+
+using namespace oboe;
+
+constexpr int32_t kChannelCount = 2;
+constexpr int32_t kCapacityInFrames = 256;
+
+TEST(test_shared_memory_fifo, create_and_attach) {
+    std::unique_ptr<SharedMemoryFifo> writerFifo;
+    ASSERT_EQ(Result::OK, SharedMemoryFifo::create(AudioFormat::I16, kChannelCount,
+                                                   kCapacityInFrames, writerFifo));
+    ASSERT_GE(writerFifo->getFileDescriptor(), 0);
+
+    // A second mapping of the same memory in this process.
+    std::unique_ptr<SharedMemoryFifo> readerFifo;
+    ASSERT_EQ(Result::OK, SharedMemoryFifo::attach(writerFifo->getFileDescriptor(), readerFifo));
+    EXPECT_EQ(AudioFormat::I16, readerFifo->getFormat());
+    EXPECT_EQ(kChannelCount, readerFifo->getChannelCount());
+    EXPECT_EQ(-1, readerFifo->getFileDescriptor());
+    FifoBuffer *reader = readerFifo->getFifoBuffer();
+    EXPECT_EQ(static_cast<uint32_t>(kCapacityInFrames), reader->getBufferCapacityInFrames());
+    EXPECT_EQ(static_cast<uint32_t>(kChannelCount * sizeof(int16_t)), reader->getBytesPerFrame());
+
+    int16_t data[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    ASSERT_EQ(4, writerFifo->getFifoBuffer()->write(data, 4));
+    EXPECT_EQ(4u, reader->getFullFramesAvailable());
+    int16_t result[8] = {};
+    ASSERT_EQ(4, reader->read(result, 4));
+    EXPECT_EQ(8, result[7]);
+    EXPECT_EQ(4u, writerFifo->getFifoBuffer()->getReadCounter());
+}
+
+TEST(test_shared_memory_fifo, attach_rejects_other_memory) {
+    std::unique_ptr<SharedMemoryFifo> fifo;
+    EXPECT_EQ(Result::ErrorInvalidHandle, SharedMemoryFifo::attach(-1, fifo));
+
+    // Memory that is big enough but does not contain a header.
+    int fd = static_cast<int>(syscall(SYS_memfd_create, "not_a_fifo", MFD_ALLOW_SEALING));
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(0, ftruncate(fd, 4096));
+    ASSERT_EQ(0, fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK));
+    EXPECT_EQ(Result::ErrorInvalidFormat, SharedMemoryFifo::attach(fd, fifo));
+    EXPECT_EQ(nullptr, fifo.get());
+    close(fd);
+
+    EXPECT_EQ(Result::ErrorInvalidFormat, SharedMemoryFifo::create(AudioFormat::Invalid,
+            kChannelCount, kCapacityInFrames, fifo));
+    EXPECT_EQ(Result::ErrorOutOfRange, SharedMemoryFifo::create(AudioFormat::Float,
+            kChannelCount, 0, fifo));
+}
+
+// A copy of a valid FIFO is only accepted once it cannot shrink.
+TEST(test_shared_memory_fifo, attach_rejects_unsealed_memory) {
+    std::unique_ptr<SharedMemoryFifo> writerFifo;
+    ASSERT_EQ(Result::OK, SharedMemoryFifo::create(AudioFormat::I16, kChannelCount,
+                                                   kCapacityInFrames, writerFifo));
+    int fd = static_cast<int>(syscall(SYS_memfd_create, "unsealed_fifo", MFD_ALLOW_SEALING));
+    ASSERT_GE(fd, 0);
+    char buffer[4096];
+    ssize_t numBytes;
+    off_t offset = 0;
+    while ((numBytes = pread(writerFifo->getFileDescriptor(), buffer, sizeof(buffer),
+                             offset)) > 0) {
+        ASSERT_EQ(numBytes, write(fd, buffer, static_cast<size_t>(numBytes)));
+        offset += numBytes;
+    }
+
+    std::unique_ptr<SharedMemoryFifo> fifo;
+    EXPECT_EQ(Result::ErrorInvalidHandle, SharedMemoryFifo::attach(fd, fifo));
+    EXPECT_EQ(nullptr, fifo.get());
+    ASSERT_EQ(0, fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK));
+    EXPECT_EQ(Result::OK, SharedMemoryFifo::attach(fd, fifo));
+    fifo.reset();
+    close(fd);
+}
+
+// A child process writes a counting sequence in place and the parent reads it in place.
+TEST(test_shared_memory_fifo, transfer_between_processes) {
+    constexpr int32_t kNumFrames = 100000;
+    std::unique_ptr<SharedMemoryFifo> fifo;
+    ASSERT_EQ(Result::OK, SharedMemoryFifo::create(AudioFormat::I32, 1,
+                                                   kCapacityInFrames, fifo));
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0) {
+        // The child attaches as a separate process would, using only the descriptor.
+        std::unique_ptr<SharedMemoryFifo> childFifo;
+        if (SharedMemoryFifo::attach(fifo->getFileDescriptor(), childFifo) != Result::OK) {
+            _exit(1);
+        }
+        FifoBuffer *writer = childFifo->getFifoBuffer();
+        int32_t next = 0;
+        while (next < kNumFrames) {
+            FifoBuffer::Region region = writer->acquireWriteRegion(kNumFrames - next);
+            for (int part = 0; part < 2; part++) {
+                int32_t *frames = reinterpret_cast<int32_t *>(region.data[part]);
+                for (int32_t i = 0; i < region.numFrames[part]; i++) {
+                    frames[i] = next++;
+                }
+            }
+            writer->commitWrite(region.getTotalFrames());
+            if (region.getTotalFrames() == 0) {
+                usleep(100);
+            }
+        }
+        _exit(0);
+    }
+
+    FifoBuffer *reader = fifo->getFifoBuffer();
+    int32_t expected = 0;
+    int32_t errors = 0;
+    while (expected < kNumFrames) {
+        FifoBuffer::Region region = reader->acquireReadRegion(kNumFrames);
+        for (int part = 0; part < 2; part++) {
+            const int32_t *frames = reinterpret_cast<const int32_t *>(region.data[part]);
+            for (int32_t i = 0; i < region.numFrames[part]; i++) {
+                if (frames[i] != expected++) errors++;
+            }
+        }
+        reader->commitRead(region.getTotalFrames());
+        if (region.getTotalFrames() == 0) {
+            usleep(100);
+        }
+    }
+    int status = 0;
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+    EXPECT_EQ(0, errors);
+}
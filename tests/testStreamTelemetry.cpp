@@ -0,0 +1,133 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Test the StreamTelemetry that is recorded by the audio thread.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "oboe/Definitions.h"
+#include "oboe/StreamTelemetry.h"
+
+using namespace oboe;
+
+TEST(test_stream_telemetry, duration_bins) {
+    int32_t previousBin = 0;
+    for (int64_t micros = 0; micros < 100000; micros++) {
+        int32_t bin = StreamTelemetry::getDurationBin(micros);
+        ASSERT_GE(bin, previousBin);
+        ASSERT_LE(bin, previousBin + 1);
+        ASSERT_LE(micros, StreamTelemetry::getDurationBinLimit(bin));
+        // The bins are no more than 25% wide.
+        ASSERT_LE(StreamTelemetry::getDurationBinLimit(bin), micros + (micros / 4) + 1);
+        previousBin = bin;
+    }
+}
+
+TEST(test_stream_telemetry, callback_percentiles) {
+    StreamTelemetry telemetry;
+    // 98 short callbacks and 2 long ones.
+    for (int i = 0; i < 98; i++) {
+        telemetry.recordCallbackDuration(100 * kNanosPerMicrosecond);
+    }
+    telemetry.recordCallbackDuration(1000 * kNanosPerMicrosecond);
+    telemetry.recordCallbackDuration(5000 * kNanosPerMicrosecond + 7);
+
+    StreamTelemetry::Snapshot snapshot;
+    telemetry.getSnapshot(&snapshot);
+    EXPECT_EQ(100, snapshot.callbackCount);
+    EXPECT_GE(snapshot.callbackNanos50, 100 * kNanosPerMicrosecond);
+    EXPECT_LT(snapshot.callbackNanos50, 125 * kNanosPerMicrosecond);
+    EXPECT_EQ(snapshot.callbackNanos50, snapshot.callbackNanos90);
+    EXPECT_GE(snapshot.callbackNanos99, 1000 * kNanosPerMicrosecond);
+    EXPECT_LT(snapshot.callbackNanos99, 1250 * kNanosPerMicrosecond);
+    EXPECT_EQ(5000 * kNanosPerMicrosecond + 7, snapshot.callbackNanosMax);
+    EXPECT_EQ(0, snapshot.fillLevelCount);
+    EXPECT_EQ(0, snapshot.numEvents);
+}
+
+TEST(test_stream_telemetry, fill_level_and_xruns) {
+    constexpr int32_t kSize = 160;
+    StreamTelemetry telemetry;
+    telemetry.recordFillLevel(0, kSize, -48);
+    telemetry.recordFillLevel(80, kSize, 32);
+    telemetry.recordFillLevel(kSize, kSize, 112);
+    for (int i = 0; i < StreamTelemetry::kMaxEvents + 3; i++) {
+        telemetry.recordXRun(StreamTelemetry::XRunType::Underrun, i * 100, 48, i * 1000);
+    }
+    telemetry.recordXRun(StreamTelemetry::XRunType::Overrun, 5000, 16, 99000);
+
+    StreamTelemetry::Snapshot snapshot;
+    telemetry.getSnapshot(&snapshot);
+    EXPECT_EQ(3, snapshot.fillLevelCount);
+    EXPECT_EQ(1, snapshot.fillLevelHistogram[0]);
+    EXPECT_EQ(1, snapshot.fillLevelHistogram[StreamTelemetry::kNumFillLevelBins / 2]);
+    EXPECT_EQ(1, snapshot.fillLevelHistogram[StreamTelemetry::kNumFillLevelBins - 1]);
+    EXPECT_EQ(-48, snapshot.minHeadroomFrames);
+    EXPECT_EQ(112, snapshot.maxHeadroomFrames);
+
+    EXPECT_EQ(StreamTelemetry::kMaxEvents + 3, snapshot.underrunCount);
+    EXPECT_EQ(48 * (StreamTelemetry::kMaxEvents + 3), snapshot.framesUnderrun);
+    EXPECT_EQ(1, snapshot.overrunCount);
+    EXPECT_EQ(16, snapshot.framesOverrun);
+    // Only the most recent events are kept, oldest first.
+    ASSERT_EQ(StreamTelemetry::kMaxEvents, snapshot.numEvents);
+    EXPECT_EQ(400, snapshot.events[0].framePosition);
+    const StreamTelemetry::XRunEvent &last = snapshot.events[snapshot.numEvents - 1];
+    EXPECT_EQ(StreamTelemetry::XRunType::Overrun, last.type);
+    EXPECT_EQ(5000, last.framePosition);
+    EXPECT_EQ(16, last.numFrames);
+    EXPECT_EQ(99000, last.timeNanos);
+}
+
+// Take snapshots while another thread records. Run with TSAN to check for data races.
+TEST(test_stream_telemetry, snapshot_while_recording) {
+    constexpr int kNumCallbacks = 100000;
+    StreamTelemetry telemetry;
+    std::atomic<bool> done{false};
+    std::thread audioThread([&]() {
+        for (int i = 0; i < kNumCallbacks; i++) {
+            telemetry.recordCallbackDuration(i % 1000);
+            telemetry.recordFillLevel(i % 100, 100, (i % 100) - 50);
+            if ((i % 100) == 0) {
+                telemetry.recordXRun(StreamTelemetry::XRunType::Underrun, i, 50, i);
+            }
+        }
+        done.store(true);
+    });
+    int64_t previousCount = 0;
+    StreamTelemetry::Snapshot snapshot;
+    while (!done.load()) {
+        telemetry.getSnapshot(&snapshot);
+        ASSERT_GE(snapshot.callbackCount, previousCount);
+        previousCount = snapshot.callbackCount;
+        for (int i = 1; i < snapshot.numEvents; i++) {
+            ASSERT_EQ(50, snapshot.events[i].numFrames);
+        }
+        std::this_thread::yield();
+    }
+    audioThread.join();
+    telemetry.getSnapshot(&snapshot);
+    EXPECT_EQ(kNumCallbacks, snapshot.callbackCount);
+    EXPECT_EQ(kNumCallbacks, snapshot.fillLevelCount);
+    EXPECT_EQ(kNumCallbacks / 100, snapshot.underrunCount);
+    EXPECT_EQ(-50, snapshot.minHeadroomFrames);
+    EXPECT_EQ(49, snapshot.maxHeadroomFrames);
+}
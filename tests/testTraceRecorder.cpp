@@ -0,0 +1,203 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <atomic>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <oboe/Oboe.h>
+
+#include "common/AudioClock.h"
+
+using namespace oboe;
+
+// Write the JSON into a string.
+static int32_t writeJson(std::string *json) {
+    char *text = nullptr;
+    size_t size = 0;
+    FILE *file = open_memstream(&text, &size);
+    int32_t numEvents = TraceRecorder::writeChromeJson(file);
+    fclose(file);
+    json->assign(text, size);
+    free(text);
+    return numEvents;
+}
+
+static int32_t countSubstrings(const std::string &text, const std::string &pattern) {
+    int32_t count = 0;
+    for (size_t position = text.find(pattern); position != std::string::npos;
+            position = text.find(pattern, position + 1)) {
+        count++;
+    }
+    return count;
+}
+
+class TraceRecorderTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        TraceRecorder::clear();
+    }
+
+    void TearDown() override {
+        TraceRecorder::setEnabled(false);
+    }
+};
+
+TEST_F(TraceRecorderTest, DisabledRecordsNothing) {
+    TraceRecorder::setEnabled(false);
+    TraceRecorder::begin(TraceRecorder::kEventDataCallback, 192);
+    TraceRecorder::end(TraceRecorder::kEventDataCallback);
+    {
+        TraceRecorder::Scope scope(TraceRecorder::kEventConversion);
+    }
+    std::string json;
+    EXPECT_EQ(0, writeJson(&json));
+    EXPECT_EQ(0, countSubstrings(json, "\"ph\":\"B\""));
+}
+
+// Loading ATrace, as a StabilizedCallback does, does not start recording.
+TEST_F(TraceRecorderTest, LoadATraceDoesNotRecord) {
+    TraceRecorder::loadATrace();
+    EXPECT_FALSE(TraceRecorder::isEnabled());
+    {
+        TraceRecorder::Scope scope(TraceRecorder::kEventActualLoad, 192);
+    }
+    std::string json;
+    EXPECT_EQ(0, writeJson(&json));
+}
+
+TEST_F(TraceRecorderTest, WritesNestedScopes) {
+    static const int32_t eventId = TraceRecorder::registerEvent("Test \"quoted\"");
+    ASSERT_GE(eventId, 0);
+    TraceRecorder::setEnabled(true);
+    {
+        TraceRecorder::Scope outer(TraceRecorder::kEventDataCallback, 192);
+        TraceRecorder::Scope inner(eventId, 42);
+    }
+    TraceRecorder::setEnabled(false);
+
+    std::string json;
+    EXPECT_EQ(4, writeJson(&json));
+    EXPECT_EQ(0u, json.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    EXPECT_EQ(2, countSubstrings(json, "\"ph\":\"B\""));
+    EXPECT_EQ(2, countSubstrings(json, "\"ph\":\"E\""));
+    EXPECT_EQ(2, countSubstrings(json, "\"name\":\"Test \\\"quoted\\\"\""));
+    EXPECT_EQ(1, countSubstrings(json, "\"args\":{\"arg\":192}"));
+    EXPECT_EQ(1, countSubstrings(json, "\"args\":{\"arg\":42}"));
+    // The inner scope ends before the outer one.
+    size_t innerEnd = json.find("\"ph\":\"E\"");
+    EXPECT_LT(json.find("\"name\":\"Test"), innerEnd);
+    EXPECT_EQ(json.rfind("{\"name\":\"DataCallback\""), json.rfind("{\"name\":", json.size()));
+}
+
+TEST_F(TraceRecorderTest, KeepsLatestEventsOfEachThread) {
+    constexpr int32_t kNumThreads = 4;
+    constexpr int32_t kPairsPerThread = 100;
+    TraceRecorder::setEnabled(true);
+    // Run two batches so that the second one reuses the rings of the first.
+    for (int batch = 0; batch < 2; batch++) {
+        std::vector<std::thread> threads;
+        for (int32_t i = 0; i < kNumThreads; i++) {
+            threads.emplace_back([]() {
+                for (int32_t pair = 0; pair < kPairsPerThread; pair++) {
+                    TraceRecorder::Scope scope(TraceRecorder::kEventAppCallback, pair);
+                }
+            });
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+    // This thread wraps around its ring.
+    for (int32_t i = 0; i < TraceRecorder::kEventsPerThread; i++) {
+        TraceRecorder::Scope scope(TraceRecorder::kEventConversion);
+    }
+    TraceRecorder::setEnabled(false);
+
+    std::string json;
+    int32_t numEvents = writeJson(&json);
+    EXPECT_EQ(2 * kNumThreads * kPairsPerThread * 2 + TraceRecorder::kEventsPerThread, numEvents);
+    EXPECT_EQ(TraceRecorder::kEventsPerThread / 2,
+              countSubstrings(json, "{\"name\":\"Conversion\",\"ph\":\"B\""));
+}
+
+// Events that are overwritten during the export are skipped instead of written half updated,
+// so the arguments of one thread always increase.
+TEST_F(TraceRecorderTest, WritesWhileRecording) {
+    static const int32_t eventId = TraceRecorder::registerEvent("Concurrent");
+    ASSERT_GE(eventId, 0);
+    TraceRecorder::setEnabled(true);
+    std::atomic<bool> isRunning{true};
+    std::thread recorder([&isRunning]() {
+        for (int64_t i = 0; isRunning.load(std::memory_order_relaxed); i++) {
+            TraceRecorder::Scope scope(eventId, i);
+        }
+    });
+    const std::string pattern = "{\"name\":\"Concurrent\",\"ph\":\"B\"";
+    const std::string argPattern = "\"arg\":";
+    for (int pass = 0; pass < 20; pass++) {
+        std::string json;
+        EXPECT_GE(writeJson(&json), 0);
+        long long previousArg = -1;
+        for (size_t position = json.find(pattern); position != std::string::npos;
+                position = json.find(pattern, position + 1)) {
+            size_t argPosition = json.find(argPattern, position);
+            ASSERT_NE(std::string::npos, argPosition);
+            long long arg = atoll(json.c_str() + argPosition + argPattern.size());
+            EXPECT_GT(arg, previousArg);
+            previousArg = arg;
+        }
+    }
+    isRunning.store(false);
+    recorder.join();
+}
+
+TEST_F(TraceRecorderTest, RecordsVirtualStreamCallbacks) {
+    AudioStreamBuilder builder;
+    AudioStream *stream = nullptr;
+    class SilenceCallback : public AudioStreamDataCallback {
+        DataCallbackResult onAudioReady(AudioStream *, void *, int32_t) override {
+            return DataCallbackResult::Continue;
+        }
+    } silence;
+    // Converting from I16 mono means the app is called by the flowgraph.
+    builder.setAudioApi(AudioApi::Virtual)
+            ->setFormat(AudioFormat::I16)
+            ->setChannelCount(1)
+            ->setFormatConversionAllowed(true)
+            ->setChannelConversionAllowed(true)
+            ->setDataCallback(&silence);
+    ASSERT_EQ(Result::OK, builder.openStream(&stream));
+    TraceRecorder::setEnabled(true);
+    ASSERT_EQ(Result::OK, stream->requestStart());
+    AudioClock::sleepForNanos(50 * kNanosPerMillisecond);
+    stream->stop();
+    TraceRecorder::setEnabled(false);
+    stream->close();
+    delete stream;
+
+    std::string json;
+    EXPECT_GT(writeJson(&json), 0);
+    EXPECT_GT(countSubstrings(json, "{\"name\":\"DataCallback\",\"ph\":\"B\""), 0);
+    EXPECT_GT(countSubstrings(json, "{\"name\":\"Conversion\",\"ph\":\"B\""), 0);
+    EXPECT_GT(countSubstrings(json, "{\"name\":\"AppCallback\",\"ph\":\"B\""), 0);
+    EXPECT_GT(countSubstrings(json, "\"args\":{\"name\":\"oboe_virtual\"}"), 0);
+}
@@ -0,0 +1,263 @@
+/*
+ * Copyright 2022 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Test the virtual device. It runs without audio hardware so these tests
+ * check the timing loosely because the test machine may be busy.
+ */
+
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <oboe/Oboe.h>
+
+#include "common/AudioClock.h"
+
+using namespace oboe;
+
+constexpr int64_t kTimeoutNanos = 500 * kNanosPerMillisecond;
+
+// Counts frames and returns Stop after a number of callbacks if stopAfter is set.
+class CountingCallback : public AudioStreamDataCallback {
+public:
+    DataCallbackResult onAudioReady(AudioStream * /* audioStream */,
+                                    void * /* audioData */,
+                                    int32_t numFrames) override {
+        frameCount += numFrames;
+        callCount++;
+        return (stopAfter == 0 || callCount < stopAfter)
+                ? DataCallbackResult::Continue : DataCallbackResult::Stop;
+    }
+
+    std::atomic<int64_t> frameCount{0};
+    std::atomic<int32_t> callCount{0};
+    int32_t stopAfter = 0;
+};
+
+class DisconnectCallback : public AudioStreamErrorCallback {
+public:
+    void onErrorAfterClose(AudioStream * /* audioStream */, Result error) override {
+        lastError = error;
+        afterCloseCount++;
+    }
+
+    std::atomic<Result> lastError{Result::OK};
+    std::atomic<int32_t> afterCloseCount{0};
+};
+
+class VirtualDeviceTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        VirtualDevice::getInstance().reset();
+        mBuilder.setAudioApi(AudioApi::Virtual);
+    }
+
+    void TearDown() override {
+        if (mStream != nullptr) {
+            mStream->close();
+            delete mStream;
+        }
+        VirtualDevice::getInstance().reset();
+    }
+
+    void openStream() {
+        ASSERT_EQ(Result::OK, mBuilder.openStream(&mStream));
+        ASSERT_NE(nullptr, mStream);
+    }
+
+    AudioStreamBuilder mBuilder;
+    AudioStream *mStream = nullptr;
+};
+
+TEST_F(VirtualDeviceTest, OpenUsesDeviceConfiguration) {
+    VirtualDevice &device = VirtualDevice::getInstance();
+    device.setSampleRate(44100);
+    device.setFramesPerBurst(96);
+    device.setChannelCount(1);
+    device.setFormat(AudioFormat::I16);
+    openStream();
+    EXPECT_EQ(AudioApi::Virtual, mStream->getAudioApi());
+    EXPECT_EQ(44100, mStream->getSampleRate());
+    EXPECT_EQ(96, mStream->getFramesPerBurst());
+    EXPECT_EQ(1, mStream->getChannelCount());
+    EXPECT_EQ(AudioFormat::I16, mStream->getFormat());
+    EXPECT_EQ(StreamState::Open, mStream->getState());
+}
+
+TEST_F(VirtualDeviceTest, CallbackRunsAtSampleRate) {
+    CountingCallback callback;
+    mBuilder.setDataCallback(&callback);
+    openStream();
+    ASSERT_EQ(Result::OK, mStream->requestStart());
+    AudioClock::sleepForNanos(200 * kNanosPerMillisecond);
+    ASSERT_EQ(Result::OK, mStream->stop(kTimeoutNanos));
+    EXPECT_EQ(StreamState::Stopped, mStream->getState());
+
+    // 200 msec at 48000 Hz, allowing for a slow start and a busy machine.
+    int64_t frameCount = callback.frameCount;
+    EXPECT_GT(frameCount, 9600 / 2);
+    EXPECT_LT(frameCount, 9600 * 2);
+    EXPECT_EQ(frameCount, mStream->getFramesWritten());
+    EXPECT_EQ(frameCount % mStream->getFramesPerBurst(), 0);
+    int64_t framePosition = 0;
+    int64_t timeNanos = 0;
+    EXPECT_EQ(Result::OK, mStream->getTimestamp(CLOCK_MONOTONIC, &framePosition, &timeNanos));
+    EXPECT_GT(framePosition, 0);
+}
+
+TEST_F(VirtualDeviceTest, CallbackReturningStopStopsStream) {
+    CountingCallback callback;
+    callback.stopAfter = 3;
+    mBuilder.setDataCallback(&callback);
+    openStream();
+    ASSERT_EQ(Result::OK, mStream->requestStart());
+    StreamState nextState = StreamState::Unknown;
+    ASSERT_EQ(Result::OK, mStream->waitForStateChange(StreamState::Started, &nextState,
+                                                      kTimeoutNanos));
+    EXPECT_EQ(StreamState::Stopped, nextState);
+    EXPECT_EQ(3, callback.callCount);
+    // It can be started again.
+    callback.stopAfter = 0;
+    ASSERT_EQ(Result::OK, mStream->requestStart());
+    AudioClock::sleepForNanos(20 * kNanosPerMillisecond);
+    ASSERT_EQ(Result::OK, mStream->stop(kTimeoutNanos));
+    EXPECT_GT(callback.callCount, 3);
+}
+
+TEST_F(VirtualDeviceTest, ConversionToDeviceFormat) {
+    // The app asks for a different rate, format and channel count than the device has.
+    CountingCallback callback;
+    mBuilder.setDataCallback(&callback)
+            ->setSampleRate(44100)
+            ->setSampleRateConversionQuality(SampleRateConversionQuality::Medium)
+            ->setFormat(AudioFormat::I16)
+            ->setChannelCount(1)
+            ->setFramesPerCallback(100);
+    openStream();
+    EXPECT_EQ(44100, mStream->getSampleRate());
+    EXPECT_EQ(AudioFormat::I16, mStream->getFormat());
+    EXPECT_EQ(1, mStream->getChannelCount());
+    ASSERT_EQ(Result::OK, mStream->requestStart());
+    AudioClock::sleepForNanos(200 * kNanosPerMillisecond);
+    ASSERT_EQ(Result::OK, mStream->stop(kTimeoutNanos));
+    EXPECT_GT(callback.callCount, 0);
+    EXPECT_EQ(callback.frameCount, callback.callCount * 100);
+}
+
+TEST_F(VirtualDeviceTest, BlockingWrite) {
+    openStream();
+    int32_t framesPerBurst = mStream->getFramesPerBurst();
+    std::vector<float> buffer(framesPerBurst * mStream->getChannelCount());
+    ASSERT_EQ(Result::OK, mStream->requestStart());
+    int64_t framesWritten = 0;
+    for (int i = 0; i < 20; i++) {
+        auto result = mStream->write(buffer.data(), framesPerBurst, kTimeoutNanos);
+        ASSERT_TRUE(result);
+        framesWritten += result.value();
+    }
+    EXPECT_EQ(20 * framesPerBurst, framesWritten);
+    EXPECT_GT(mStream->getFramesRead(), 0);
+    ASSERT_EQ(Result::OK, mStream->stop(kTimeoutNanos));
+}
+
+TEST_F(VirtualDeviceTest, BlockingReadGetsSilence) {
+    mBuilder.setDirection(Direction::Input);
+    openStream();
+    int32_t numSamples = mStream->getFramesPerBurst() * mStream->getChannelCount();
+    std::vector<float> buffer(numSamples, 1.0f);
+    ASSERT_EQ(Result::OK, mStream->requestStart());
+    auto result = mStream->read(buffer.data(), mStream->getFramesPerBurst(), kTimeoutNanos);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(mStream->getFramesPerBurst(), result.value());
+    for (int i = 0; i < numSamples; i++) {
+        ASSERT_EQ(0.0f, buffer[i]);
+    }
+    ASSERT_EQ(Result::OK, mStream->stop(kTimeoutNanos));
+}
+
+TEST_F(VirtualDeviceTest, OpenInputKeepsDefaultFifo) {
+    mBuilder.setDirection(Direction::Input);
+    openStream();
+    // AudioStreamBuffered allocates 16 bursts when it opens, and can grow to 64 bursts.
+    const int32_t defaultFrames = 16 * mStream->getFramesPerBurst();
+    EXPECT_EQ(defaultFrames, mStream->getAllocatedCapacityInFrames());
+    EXPECT_EQ(defaultFrames, mStream->getBufferSizeInFrames());
+    const int32_t capacityFrames = mStream->getBufferCapacityInFrames();
+    ASSERT_GT(capacityFrames, defaultFrames);
+
+    // Raising the buffer size still grows the FIFO.
+    auto result = mStream->setBufferSizeInFrames(capacityFrames);
+    ASSERT_TRUE(result);
+    EXPECT_EQ(capacityFrames, result.value());
+    EXPECT_GT(mStream->getAllocatedCapacityInFrames(), defaultFrames);
+}
+
+TEST_F(VirtualDeviceTest, StallCausesXRun) {
+    CountingCallback callback;
+    mBuilder.setDataCallback(&callback);
+    openStream();
+    ASSERT_TRUE(mStream->setBufferSizeInFrames(2 * mStream->getFramesPerBurst()));
+    ASSERT_EQ(Result::OK, mStream->requestStart());
+    AudioClock::sleepForNanos(20 * kNanosPerMillisecond);
+    VirtualDevice::getInstance().injectStall(50 * kNanosPerMillisecond);
+    AudioClock::sleepForNanos(100 * kNanosPerMillisecond);
+    ASSERT_EQ(Result::OK, mStream->stop(kTimeoutNanos));
+
+    EXPECT_GE(mStream->getXRunCount().value(), 1);
+    StreamTelemetry::Snapshot snapshot;
+    mStream->getTelemetry().getSnapshot(&snapshot);
+    EXPECT_GE(snapshot.underrunCount, 1);
+    // The device skipped the missed bursts so it is ahead of the app.
+    EXPECT_GT(mStream->getFramesRead(), mStream->getFramesWritten());
+}
+
+TEST_F(VirtualDeviceTest, DisconnectCallsErrorCallback) {
+    CountingCallback callback;
+    DisconnectCallback errorCallback;
+    mBuilder.setDataCallback(&callback)->setErrorCallback(&errorCallback);
+    openStream();
+    ASSERT_EQ(Result::OK, mStream->requestStart());
+    AudioClock::sleepForNanos(20 * kNanosPerMillisecond);
+    VirtualDevice::getInstance().injectDisconnect();
+    for (int i = 0; i < 100 && errorCallback.afterCloseCount == 0; i++) {
+        AudioClock::sleepForNanos(10 * kNanosPerMillisecond);
+    }
+    EXPECT_EQ(1, errorCallback.afterCloseCount);
+    EXPECT_EQ(Result::ErrorDisconnected, errorCallback.lastError);
+    EXPECT_EQ(StreamState::Closed, mStream->getState());
+}
+
+TEST_F(VirtualDeviceTest, DisconnectFailsBlockingWrite) {
+    openStream();
+    std::vector<float> buffer(mStream->getFramesPerBurst() * mStream->getChannelCount());
+    ASSERT_EQ(Result::OK, mStream->requestStart());
+    VirtualDevice::getInstance().injectDisconnect();
+    StreamState nextState = StreamState::Unknown;
+    mStream->waitForStateChange(StreamState::Started, &nextState, kTimeoutNanos);
+    EXPECT_EQ(StreamState::Disconnected, nextState);
+    auto result = mStream->write(buffer.data(), mStream->getFramesPerBurst(), 0);
+    EXPECT_EQ(Result::ErrorDisconnected, result.error());
+    // A stream opened afterwards is not disconnected.
+    AudioStream *stream2 = nullptr;
+    ASSERT_EQ(Result::OK, mBuilder.openStream(&stream2));
+    ASSERT_EQ(Result::OK, stream2->requestStart());
+    EXPECT_TRUE(stream2->write(buffer.data(), mStream->getFramesPerBurst(), kTimeoutNanos));
+    stream2->close();
+    delete stream2;
+}